@@ -0,0 +1,133 @@
+#include <stdint.h>
+
+#include "audio_adpcm.h"
+
+static const int16_t step_table[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+    19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+    130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+    876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+    5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767};
+
+static const int8_t index_table[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8};
+
+static inline int16_t decode_nibble(int32_t *predictor, int32_t *index, uint8_t nibble)
+{
+    const int32_t step = step_table[*index];
+    int32_t diff = step >> 3;
+
+    if (nibble & 4)
+    {
+        diff += step;
+    }
+    if (nibble & 2)
+    {
+        diff += step >> 1;
+    }
+    if (nibble & 1)
+    {
+        diff += step >> 2;
+    }
+
+    *predictor += (nibble & 8) ? -diff : diff;
+    *predictor = *predictor > INT16_MAX ? INT16_MAX : (*predictor < INT16_MIN ? INT16_MIN : *predictor);
+
+    *index += index_table[nibble];
+    *index = *index < 0 ? 0 : (*index > 88 ? 88 : *index);
+
+    return *predictor;
+}
+
+// quantises the difference to the predictor and steps the predictor exactly as the decoder will
+static inline uint8_t encode_nibble(int32_t *predictor, int32_t *index, int16_t sample)
+{
+    int32_t step = step_table[*index];
+    int32_t diff = sample - *predictor;
+    uint8_t nibble = 0;
+
+    if (diff < 0)
+    {
+        nibble = 8;
+        diff = -diff;
+    }
+    if (diff >= step)
+    {
+        nibble |= 4;
+        diff -= step;
+    }
+    step >>= 1;
+    if (diff >= step)
+    {
+        nibble |= 2;
+        diff -= step;
+    }
+    step >>= 1;
+    if (diff >= step)
+    {
+        nibble |= 1;
+    }
+
+    decode_nibble(predictor, index, nibble);
+
+    return nibble;
+}
+
+// decodes one mono IMA-ADPCM block (wav format 0x11), the last block of a file may be short.
+// returns the number of samples written to out, at most AUDIO_ADPCM_BLOCK_SAMPLES(len)
+int audio_adpcm_decode_block(const uint8_t *block, size_t len, int16_t *out)
+{
+    if (len < AUDIO_ADPCM_BLOCK_HEADER)
+    {
+        return 0;
+    }
+
+    // block header: first sample, step index, reserved
+    int32_t predictor = (int16_t)(block[1] << 8 | block[0]);
+    int32_t index = block[2] > 88 ? 88 : block[2];
+    int samples = 0;
+
+    out[samples++] = predictor;
+
+    // two samples per byte, low nibble first
+    for (size_t i = AUDIO_ADPCM_BLOCK_HEADER; i < len; i++)
+    {
+        out[samples++] = decode_nibble(&predictor, &index, block[i] & 0x0F);
+        out[samples++] = decode_nibble(&predictor, &index, block[i] >> 4);
+    }
+
+    return samples;
+}
+
+// encodes one mono IMA-ADPCM block from samples, at most AUDIO_ADPCM_BLOCK_SAMPLES(AUDIO_ADPCM_MAX_BLOCK).
+// index carries the step index from the previous block so the first nibbles of a block do not
+// have to adapt again. an even sample count pads the last nibble, returns the block length
+int audio_adpcm_encode_block(const int16_t *samples, int count, int32_t *index, uint8_t *block)
+{
+    if (count <= 0)
+    {
+        return 0;
+    }
+
+    int32_t predictor = samples[0];
+    int len = AUDIO_ADPCM_BLOCK_HEADER;
+
+    block[0] = predictor & 0xFF;
+    block[1] = (predictor >> 8) & 0xFF;
+    block[2] = *index;
+    block[3] = 0;
+
+    for (int i = 1; i < count; i += 2)
+    {
+        const uint8_t lo = encode_nibble(&predictor, index, samples[i]);
+        const uint8_t hi = i + 1 < count ? encode_nibble(&predictor, index, samples[i + 1]) : 0;
+        block[len++] = hi << 4 | lo;
+    }
+
+    return len;
+}
@@ -0,0 +1,273 @@
+#include <string.h>
+#include <stdbool.h>
+#include <sys/param.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/i2s.h"
+
+#include "audio_capture.h"
+#include "audio_player.h"
+#include "audio_adpcm.h"
+#include "audio_vad.h"
+
+static const char *TAG = "audio_capture.c";
+
+#define AUDIO_CAPTURE_I2S_NUM (I2S_NUM_1) // shares the speaker's bus, see init_i2s()
+#define AUDIO_CAPTURE_BLOCK (256)         // ima-adpcm block bytes
+#define AUDIO_CAPTURE_BLOCK_SAMPLES AUDIO_ADPCM_BLOCK_SAMPLES(AUDIO_CAPTURE_BLOCK) // 505, 32 ms
+#define AUDIO_CAPTURE_PREROLL_MS (200) // kept before the onset, the vad confirms speech late
+#define AUDIO_CAPTURE_TAIL_MS (200)    // kept after the last speech frame
+#define AUDIO_CAPTURE_SETTLE_MS (60)   // discarded after the bus starts while the microphone settles
+#define AUDIO_CAPTURE_READ_TIMEOUT_MS (200)
+#define AUDIO_CAPTURE_IDLE_WAIT_MS (2000) // for the speaker to finish before recording
+#define AUDIO_CAPTURE_MS_SAMPLES(ms) ((ms) * (AUDIO_SAMPLE_RATE / 1000))
+
+// riff, fmt with the ima-adpcm extension, fact and data chunk headers
+#define AUDIO_CAPTURE_WAV_HEADER (60)
+#define AUDIO_CAPTURE_MAX_BLOCKS (AUDIO_CAPTURE_MS_SAMPLES(AUDIO_CAPTURE_ONSET_TIMEOUT_MS + AUDIO_CAPTURE_MAX_SPEECH_MS) / AUDIO_CAPTURE_BLOCK_SAMPLES + 1)
+#define AUDIO_CAPTURE_BUF_SIZE (AUDIO_CAPTURE_WAV_HEADER + AUDIO_CAPTURE_MAX_BLOCKS * AUDIO_CAPTURE_BLOCK)
+
+// the recording is compressed into psram as it is read, silence before the onset is later
+// dropped by moving the kept blocks down, each block decodes on its own
+static uint8_t *capture_buf = NULL;
+static int capture_len = 0; // wav bytes of the last question, 0 when there is none
+
+static int16_t frame[AUDIO_VAD_FRAME_SAMPLES];
+static int16_t pending[AUDIO_CAPTURE_BLOCK_SAMPLES];
+static int pending_count = 0;
+static int32_t adpcm_index = 0;
+static int blocks_written = 0;
+static int partial_len = 0; // bytes of a short last block, 0 when all blocks are full
+static int partial_samples = 0;
+
+static void put_le16(uint8_t *b, uint16_t v)
+{
+    b[0] = v & 0xFF;
+    b[1] = v >> 8;
+}
+
+static void put_le32(uint8_t *b, uint32_t v)
+{
+    put_le16(b, v & 0xFFFF);
+    put_le16(&b[2], v >> 16);
+}
+
+static void write_wav_header(uint8_t *b, uint32_t samples, uint32_t data_len)
+{
+    memcpy(&b[0], "RIFF", 4);
+    put_le32(&b[4], AUDIO_CAPTURE_WAV_HEADER - 8 + data_len);
+    memcpy(&b[8], "WAVE", 4);
+
+    memcpy(&b[12], "fmt ", 4);
+    put_le32(&b[16], 20);
+    put_le16(&b[20], AUDIO_WAV_FORMAT_IMA_ADPCM);
+    put_le16(&b[22], 1);
+    put_le32(&b[24], AUDIO_SAMPLE_RATE);
+    put_le32(&b[28], AUDIO_SAMPLE_RATE * AUDIO_CAPTURE_BLOCK / AUDIO_CAPTURE_BLOCK_SAMPLES);
+    put_le16(&b[32], AUDIO_CAPTURE_BLOCK);
+    put_le16(&b[34], 4);
+    put_le16(&b[36], 2);
+    put_le16(&b[38], AUDIO_CAPTURE_BLOCK_SAMPLES);
+
+    memcpy(&b[40], "fact", 4);
+    put_le32(&b[44], 4);
+    put_le32(&b[48], samples);
+
+    memcpy(&b[52], "data", 4);
+    put_le32(&b[56], data_len);
+}
+
+static void flush_block(void)
+{
+    if (pending_count == 0)
+    {
+        return;
+    }
+
+    uint8_t *block = &capture_buf[AUDIO_CAPTURE_WAV_HEADER + blocks_written * AUDIO_CAPTURE_BLOCK];
+    const int len = audio_adpcm_encode_block(pending, pending_count, &adpcm_index, block);
+
+    if (pending_count < AUDIO_CAPTURE_BLOCK_SAMPLES)
+    {
+        partial_len = len;
+        partial_samples = pending_count;
+    }
+
+    blocks_written++;
+    pending_count = 0;
+}
+
+// returns false once the buffer is full
+static bool append_samples(const int16_t *samples, int count)
+{
+    while (count > 0)
+    {
+        if (blocks_written == AUDIO_CAPTURE_MAX_BLOCKS)
+        {
+            return false;
+        }
+
+        const int n = MIN(count, AUDIO_CAPTURE_BLOCK_SAMPLES - pending_count);
+        memcpy(&pending[pending_count], samples, n * sizeof(int16_t));
+        pending_count += n;
+        samples += n;
+        count -= n;
+
+        if (pending_count == AUDIO_CAPTURE_BLOCK_SAMPLES)
+        {
+            flush_block();
+        }
+    }
+
+    return true;
+}
+
+// keeps the blocks holding [first_sample, end_sample) and puts the wav header in front of them
+static void finish_wav(int first_sample, int end_sample)
+{
+    if (end_sample > blocks_written * AUDIO_CAPTURE_BLOCK_SAMPLES)
+    {
+        flush_block();
+    }
+
+    const int first = first_sample / AUDIO_CAPTURE_BLOCK_SAMPLES;
+    const int last = MIN((end_sample + AUDIO_CAPTURE_BLOCK_SAMPLES - 1) / AUDIO_CAPTURE_BLOCK_SAMPLES, blocks_written);
+    const bool short_last = last == blocks_written && partial_len > 0;
+
+    const int data_len = (last - first) * AUDIO_CAPTURE_BLOCK - (short_last ? AUDIO_CAPTURE_BLOCK - partial_len : 0);
+    const int samples = (last - first) * AUDIO_CAPTURE_BLOCK_SAMPLES - (short_last ? AUDIO_CAPTURE_BLOCK_SAMPLES - partial_samples : 0);
+
+    memmove(&capture_buf[AUDIO_CAPTURE_WAV_HEADER], &capture_buf[AUDIO_CAPTURE_WAV_HEADER + first * AUDIO_CAPTURE_BLOCK], data_len);
+    write_wav_header(capture_buf, samples, data_len);
+    capture_len = AUDIO_CAPTURE_WAV_HEADER + data_len;
+
+    ESP_LOGI(TAG, "question %d ms, %d bytes (%d bytes as pcm)", samples / (AUDIO_SAMPLE_RATE / 1000), capture_len, samples * (int)sizeof(int16_t));
+}
+
+// records from the microphone until the student has asked a question and paused, or nobody
+// spoke within AUDIO_CAPTURE_ONSET_TIMEOUT_MS. returns ESP_ERR_NOT_FOUND when there was no speech
+esp_err_t audio_capture_question(void)
+{
+    if (capture_buf == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // the speaker would be recorded as speech
+    const audio_playback_handle_t playing = audio_player_current();
+    if (playing != 0 && audio_player_wait(playing, AUDIO_CAPTURE_IDLE_WAIT_MS / portTICK_PERIOD_MS) == ESP_ERR_TIMEOUT)
+    {
+        ESP_LOGW(TAG, "still playing after %d ms, recording anyway", AUDIO_CAPTURE_IDLE_WAIT_MS);
+    }
+
+    capture_len = 0;
+    pending_count = 0;
+    adpcm_index = 0;
+    blocks_written = 0;
+    partial_len = 0;
+    partial_samples = 0;
+
+    audio_vad_t vad;
+    audio_vad_init(&vad);
+
+    esp_err_t err = audio_player_capture_begin();
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "audio_player_capture_begin() err: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    int settle = AUDIO_CAPTURE_MS_SAMPLES(AUDIO_CAPTURE_SETTLE_MS);
+    int recorded = 0;
+    int onset = -1;
+
+    while (true)
+    {
+        size_t bytes_read = 0;
+        err = i2s_read(AUDIO_CAPTURE_I2S_NUM, frame, sizeof(frame), &bytes_read, AUDIO_CAPTURE_READ_TIMEOUT_MS / portTICK_PERIOD_MS);
+        if (err != ESP_OK || bytes_read == 0)
+        {
+            // the player keeps the bus running while recording, so this is a driver fault
+            ESP_LOGW(TAG, "i2s_read() stalled: %s", esp_err_to_name(err));
+            break;
+        }
+
+        const int count = bytes_read / sizeof(int16_t);
+        if (settle > 0)
+        {
+            settle -= count;
+            continue;
+        }
+
+        const audio_vad_result_t result = audio_vad_process(&vad, frame, count);
+
+        if (!append_samples(frame, count))
+        {
+            ESP_LOGW(TAG, "capture buffer full");
+            break;
+        }
+        recorded += count;
+
+        if (result == AUDIO_VAD_ONSET)
+        {
+            onset = MAX(recorded - AUDIO_VAD_ONSET_FRAMES * AUDIO_VAD_FRAME_SAMPLES, 0);
+            ESP_LOGI(TAG, "speech at %d ms, noise floor %d", onset / (AUDIO_SAMPLE_RATE / 1000), vad.noise_floor);
+        }
+        else if (result == AUDIO_VAD_END)
+        {
+            break;
+        }
+
+        if (onset < 0 && recorded >= AUDIO_CAPTURE_MS_SAMPLES(AUDIO_CAPTURE_ONSET_TIMEOUT_MS))
+        {
+            break;
+        }
+        if (onset >= 0 && recorded - onset >= AUDIO_CAPTURE_MS_SAMPLES(AUDIO_CAPTURE_MAX_SPEECH_MS))
+        {
+            ESP_LOGW(TAG, "question cut at %d ms", AUDIO_CAPTURE_MAX_SPEECH_MS);
+            break;
+        }
+    }
+
+    audio_player_capture_end();
+
+    if (onset < 0)
+    {
+        ESP_LOGI(TAG, "no question spoken");
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // frames of the hangover are silence, a question cut off while speaking keeps everything
+    const int speech_end = recorded - (vad.speaking ? 0 : vad.silent_frames * AUDIO_VAD_FRAME_SAMPLES);
+
+    finish_wav(MAX(onset - AUDIO_CAPTURE_MS_SAMPLES(AUDIO_CAPTURE_PREROLL_MS), 0),
+               MIN(speech_end + AUDIO_CAPTURE_MS_SAMPLES(AUDIO_CAPTURE_TAIL_MS), recorded));
+
+    return ESP_OK;
+}
+
+// returns the length of the recorded question as an ima-adpcm wav file, 0 when there is none
+int audio_capture_wav(const uint8_t **wav)
+{
+    *wav = capture_buf;
+    return capture_len;
+}
+
+void audio_capture_clear(void)
+{
+    capture_len = 0;
+}
+
+esp_err_t init_audio_capture(void)
+{
+    capture_buf = heap_caps_malloc(AUDIO_CAPTURE_BUF_SIZE, MALLOC_CAP_SPIRAM);
+    if (capture_buf == NULL)
+    {
+        ESP_LOGE(TAG, "heap_caps_malloc(%d) failed", AUDIO_CAPTURE_BUF_SIZE);
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
@@ -0,0 +1,451 @@
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "audio_clip.h"
+#include "audio_pack.h"
+#include "audio_assets.h" // generated from audio_source_files, see main/CMakeLists.txt
+
+static const char *TAG = "audio_clip.c";
+
+#define AUDIO_CLIP_PARTITION "audio"
+
+// PSRAM held by littlefs clips, a clip that does not fit beside the ones playing is
+// streamed from littlefs instead
+#define AUDIO_CLIP_CACHE_BUDGET (512 * 1024)
+// of which prefetched clips that have not been played yet may hold
+#define AUDIO_CLIP_PREFETCH_BUDGET (192 * 1024)
+
+typedef struct
+{
+    const char *name;
+    const char *path;        // littlefs path, NULL for embedded clips
+    const uint8_t *embedded; // in the linked audio assets, NULL for littlefs clips
+    int embedded_len;
+} audio_clip_desc_t;
+
+#define LITTLEFS_CLIP(clip_name) {#clip_name, "/audio/" #clip_name ".wav", NULL, 0}
+
+#if AUDIO_ASSETS_EMBEDDED
+// offsets into the linked blob are constants, a clip missing from audio_source_files fails to compile
+#define EMBEDDED_CLIP(clip_name) {#clip_name, NULL, &audio_assets_start[AUDIO_ASSET_OFFSET_##clip_name], AUDIO_ASSET_LEN_##clip_name}
+#else
+// built into the audio pack instead, littlefs is the fallback on devices without one
+#define EMBEDDED_CLIP(clip_name) LITTLEFS_CLIP(clip_name)
+#endif
+
+static const audio_clip_desc_t audio_clip_desc[AUDIO_CLIP_MAX] = {
+    [AUDIO_CLIP_WELCOME_TO_TUTOR_FISH_01] = EMBEDDED_CLIP(welcome_to_tutor_fish_01),
+    [AUDIO_CLIP_SUBMIT_A_QUESTION_00] = EMBEDDED_CLIP(submit_a_question_00),
+    [AUDIO_CLIP_TUTOR_FISH_SETTINGS_00] = EMBEDDED_CLIP(tutor_fish_settings_00),
+    [AUDIO_CLIP_LOOK_AT_YOUR_QUESTION_01] = EMBEDDED_CLIP(look_at_your_question_01),
+    [AUDIO_CLIP_THE_CAMERA_TAKE_A_PIC_01] = EMBEDDED_CLIP(the_camera_take_a_pic_01),
+    [AUDIO_CLIP_TO_CONSERVE_BATTERY_01] = EMBEDDED_CLIP(to_conserve_battery_01),
+    [AUDIO_CLIP_TAKING_A_PICTURE321_02] = EMBEDDED_CLIP(taking_a_picture321_02),
+    [AUDIO_CLIP_UPLOADING_THE_PICTURE_PLEASE_WAIT_00] = EMBEDDED_CLIP(uploading_the_picture_please_wait_00),
+    [AUDIO_CLIP_TO_HEAR_THE_ANSWER_AGAIN_00] = EMBEDDED_CLIP(to_hear_the_answer_again_00),
+    [AUDIO_CLIP_TUTORS_FOUND_ANSWER_00] = EMBEDDED_CLIP(tutors_found_answer_00),
+    [AUDIO_CLIP_TUTORS_LOOK_FOR_ANSWER_00] = EMBEDDED_CLIP(tutors_look_for_answer_00),
+
+    [AUDIO_CLIP_CONFIRM_SFX_04] = LITTLEFS_CLIP(confirm_sfx_04),
+    [AUDIO_CLIP_RETURNING_HOME_07] = LITTLEFS_CLIP(returning_home_07),
+    [AUDIO_CLIP_EXIT_THIS_APP_01] = LITTLEFS_CLIP(exit_this_app_01),
+    [AUDIO_CLIP_HOME_INSTRUCTIONS_00] = LITTLEFS_CLIP(home_instructions_00),
+    [AUDIO_CLIP_ATTEMPT_WIFI_CONN_00] = LITTLEFS_CLIP(attempt_wifi_conn_00),
+    [AUDIO_CLIP_WIFI_DISCONN_00] = LITTLEFS_CLIP(wifi_disconn_00),
+    [AUDIO_CLIP_ERROR_MESSAGE_00] = LITTLEFS_CLIP(error_message_00),
+    [AUDIO_CLIP_WAIT_APP_LOADS_00] = LITTLEFS_CLIP(wait_app_loads_00),
+    [AUDIO_CLIP_PERCENT_COMPLETED_00] = LITTLEFS_CLIP(percent_completed_00),
+    [AUDIO_CLIP_ASCII_5_00] = LITTLEFS_CLIP(ascii_5_00),
+    [AUDIO_CLIP_10_00] = LITTLEFS_CLIP(10_00),
+    [AUDIO_CLIP_20_00] = LITTLEFS_CLIP(20_00),
+    [AUDIO_CLIP_30_00] = LITTLEFS_CLIP(30_00),
+    [AUDIO_CLIP_40_00] = LITTLEFS_CLIP(40_00),
+    [AUDIO_CLIP_50_00] = LITTLEFS_CLIP(50_00),
+    [AUDIO_CLIP_60_00] = LITTLEFS_CLIP(60_00),
+    [AUDIO_CLIP_70_00] = LITTLEFS_CLIP(70_00),
+    [AUDIO_CLIP_80_00] = LITTLEFS_CLIP(80_00),
+    [AUDIO_CLIP_90_00] = LITTLEFS_CLIP(90_00),
+};
+
+typedef struct
+{
+    audio_clip_t clip;
+    bool resident;      // embedded or mapped from the audio pack, played in place
+    bool prefetched;    // loaded ahead of time and not acquired since
+    uint8_t *psram_buf; // owned copy of a littlefs clip, NULL when not cached
+    uint16_t refs;
+    uint32_t last_used;
+} audio_clip_entry_t;
+
+static audio_clip_entry_t audio_clip_cache[AUDIO_CLIP_MAX];
+static audio_clip_cache_stats_t cache_stats = {.budget_bytes = AUDIO_CLIP_CACHE_BUDGET, .prefetch_budget_bytes = AUDIO_CLIP_PREFETCH_BUDGET};
+static uint32_t use_counter = 0;
+static SemaphoreHandle_t cache_mutex = NULL;
+
+static void evict_clip(audio_clip_entry_t *entry)
+{
+    ESP_LOGI(TAG, "evicting %s (%d bytes)", audio_clip_desc[entry->clip.id].name, entry->clip.len);
+
+    cache_stats.cached_bytes -= entry->clip.len;
+    cache_stats.evictions++;
+
+    if (entry->prefetched)
+    {
+        // the prediction was wrong or came too early
+        cache_stats.prefetched_bytes -= entry->clip.len;
+        cache_stats.prefetch_wasted++;
+        entry->prefetched = false;
+    }
+
+    heap_caps_free(entry->psram_buf);
+    entry->psram_buf = NULL;
+    entry->clip.buf = NULL;
+    entry->clip.len = 0;
+}
+
+// evict least recently used clips that are not playing until needed_bytes fits the budget,
+// false when it cannot fit beside the clips in use
+static bool make_room(size_t needed_bytes)
+{
+    while (cache_stats.cached_bytes + needed_bytes > cache_stats.budget_bytes)
+    {
+        audio_clip_entry_t *lru = NULL;
+
+        for (int i = 0; i < AUDIO_CLIP_MAX; i++)
+        {
+            audio_clip_entry_t *entry = &audio_clip_cache[i];
+            if (entry->psram_buf != NULL && entry->refs == 0 && (lru == NULL || entry->last_used < lru->last_used))
+            {
+                lru = entry;
+            }
+        }
+
+        // everything left is in use
+        if (lru == NULL)
+        {
+            return false;
+        }
+
+        evict_clip(lru);
+    }
+
+    return true;
+}
+
+// reads a whole littlefs clip into a new PSRAM buffer
+static esp_err_t read_littlefs_clip(const char *audio_file_path, uint8_t **buf, int *len)
+{
+    FILE *f = fopen(audio_file_path, "r");
+    if (f == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to open %s for reading", audio_file_path);
+        return ESP_FAIL;
+    }
+
+    // Moving pointer to end
+    int f_err = fseek(f, 0, SEEK_END);
+    if (f_err != 0)
+    {
+        ESP_LOGE(TAG, "fseek() SEEK_END error");
+        fclose(f);
+        return ESP_FAIL;
+    }
+
+    // get audio file length
+    const int audio_file_len = ftell(f);
+
+    // Moving pointer to beginning
+    f_err = fseek(f, 0, SEEK_SET);
+    if (f_err != 0)
+    {
+        ESP_LOGE(TAG, "fseek() SEEK_SET error");
+        fclose(f);
+        return ESP_FAIL;
+    }
+
+    uint8_t *psram_buf = heap_caps_malloc(audio_file_len, MALLOC_CAP_SPIRAM);
+    if (psram_buf == NULL)
+    {
+        ESP_LOGE(TAG, "heap_caps_malloc(%d) failed", audio_file_len);
+        fclose(f);
+        return ESP_ERR_NO_MEM;
+    }
+
+    int read_ret = fread(psram_buf, sizeof(uint8_t), audio_file_len, f);
+    fclose(f);
+    if (read_ret != audio_file_len)
+    {
+        ESP_LOGE(TAG, "fread() error. read %d bytes out of %d", read_ret, audio_file_len);
+        heap_caps_free(psram_buf);
+        return ESP_FAIL;
+    }
+
+    *buf = psram_buf;
+    *len = audio_file_len;
+
+    return ESP_OK;
+}
+
+// takes ownership of a buffer from read_littlefs_clip(), called with the cache locked.
+// the caller still owns the buffer when ESP_ERR_NO_MEM is returned
+static esp_err_t install_clip(audio_clip_entry_t *entry, uint8_t *psram_buf, int len)
+{
+    if (!make_room(len))
+    {
+        ESP_LOGW(TAG, "no room for %s (%d bytes), %u bytes in use", audio_clip_desc[entry->clip.id].name, len, cache_stats.cached_bytes);
+        return ESP_ERR_NO_MEM;
+    }
+
+    entry->psram_buf = psram_buf;
+    entry->clip.buf = psram_buf;
+    entry->clip.len = len;
+    cache_stats.cached_bytes += len;
+
+    return ESP_OK;
+}
+
+static esp_err_t load_littlefs_clip(audio_clip_entry_t *entry, const char *audio_file_path)
+{
+    uint8_t *psram_buf = NULL;
+    int len = 0;
+
+    esp_err_t err = read_littlefs_clip(audio_file_path, &psram_buf, &len);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    err = install_clip(entry, psram_buf, len);
+    if (err != ESP_OK)
+    {
+        heap_caps_free(psram_buf);
+    }
+
+    return err;
+}
+
+esp_err_t init_audio_clips(void)
+{
+    cache_mutex = xSemaphoreCreateMutex();
+    if (cache_mutex == NULL)
+    {
+        ESP_LOGE(TAG, "xSemaphoreCreateMutex() failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (int i = 0; i < AUDIO_CLIP_MAX; i++)
+    {
+        audio_clip_cache[i].clip.id = i;
+
+        // embedded clips are played in place from flash and never take cache space
+        if (audio_clip_desc[i].embedded != NULL)
+        {
+            audio_clip_cache[i].clip.buf = audio_clip_desc[i].embedded;
+            audio_clip_cache[i].clip.len = audio_clip_desc[i].embedded_len;
+            audio_clip_cache[i].resident = true;
+        }
+    }
+
+    // devices flashed before the pack still have littlefs on the partition
+    esp_err_t err = audio_pack_open(AUDIO_CLIP_PARTITION);
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "no audio pack (%s), system clips load from littlefs", esp_err_to_name(err));
+        return ESP_OK;
+    }
+
+    // system clips in the pack are mapped flash too, resolved here so acquiring is O(1)
+    for (int i = 0; i < AUDIO_CLIP_MAX; i++)
+    {
+        audio_clip_entry_t *entry = &audio_clip_cache[i];
+
+        if (entry->resident)
+        {
+            continue;
+        }
+
+        if (audio_pack_find(audio_clip_desc[i].name, &entry->clip.buf, &entry->clip.len) == ESP_OK)
+        {
+            entry->resident = true;
+        }
+        else
+        {
+            ESP_LOGW(TAG, "%s is missing from the audio pack", audio_clip_desc[i].name);
+        }
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t audio_clip_acquire(audio_clip_id_t id, const audio_clip_t **clip)
+{
+    esp_err_t err = ESP_OK;
+
+    if (id >= AUDIO_CLIP_MAX || clip == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    audio_clip_entry_t *entry = &audio_clip_cache[id];
+
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+
+    if (!entry->resident)
+    {
+        if (entry->psram_buf != NULL)
+        {
+            cache_stats.hits++;
+
+            if (entry->prefetched)
+            {
+                cache_stats.prefetched_bytes -= entry->clip.len;
+                cache_stats.prefetch_hits++;
+                entry->prefetched = false;
+            }
+        }
+        else
+        {
+            cache_stats.misses++;
+
+            err = load_littlefs_clip(entry, audio_clip_desc[id].path);
+        }
+    }
+
+    if (err == ESP_OK)
+    {
+        entry->refs++;
+        entry->last_used = ++use_counter;
+        *clip = &entry->clip;
+    }
+
+    xSemaphoreGive(cache_mutex);
+
+    return err;
+}
+
+// loads a clip into the cache without holding it, so a later acquire is a hit. a no-op
+// for clips played in place, ESP_ERR_NO_MEM when the clip would take the unplayed
+// prefetches over AUDIO_CLIP_PREFETCH_BUDGET or does not fit beside the clips playing
+esp_err_t audio_clip_prefetch(audio_clip_id_t id)
+{
+    if (id >= AUDIO_CLIP_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    audio_clip_entry_t *entry = &audio_clip_cache[id];
+
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    const bool needed = !entry->resident && entry->psram_buf == NULL;
+    const size_t prefetched_bytes = cache_stats.prefetched_bytes;
+    xSemaphoreGive(cache_mutex);
+
+    if (!needed)
+    {
+        return ESP_OK;
+    }
+
+    // the size is checked before reading, so a clip that will not fit is not read for nothing
+    struct stat st;
+    if (stat(audio_clip_desc[id].path, &st) != 0)
+    {
+        ESP_LOGE(TAG, "stat(%s) failed", audio_clip_desc[id].path);
+        return ESP_FAIL;
+    }
+
+    if (prefetched_bytes + (size_t)st.st_size > cache_stats.prefetch_budget_bytes)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // read without the cache locked so a prompt being acquired meanwhile is not held up
+    uint8_t *psram_buf = NULL;
+    int len = 0;
+
+    esp_err_t err = read_littlefs_clip(audio_clip_desc[id].path, &psram_buf, &len);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+
+    if (entry->psram_buf != NULL)
+    {
+        // acquired while it was being read
+        heap_caps_free(psram_buf);
+    }
+    else if (cache_stats.prefetched_bytes + len > cache_stats.prefetch_budget_bytes)
+    {
+        // another prefetch filled the budget meanwhile
+        heap_caps_free(psram_buf);
+        err = ESP_ERR_NO_MEM;
+    }
+    else
+    {
+        err = install_clip(entry, psram_buf, len);
+        if (err == ESP_OK)
+        {
+            entry->prefetched = true;
+            entry->last_used = ++use_counter;
+            cache_stats.prefetched_bytes += len;
+            cache_stats.prefetches++;
+        }
+        else
+        {
+            heap_caps_free(psram_buf);
+        }
+    }
+
+    xSemaphoreGive(cache_mutex);
+
+    return err;
+}
+
+void audio_clip_release(const audio_clip_t *clip)
+{
+    if (clip == NULL)
+    {
+        return;
+    }
+
+    audio_clip_entry_t *entry = &audio_clip_cache[clip->id];
+
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+
+    if (entry->refs > 0)
+    {
+        entry->refs--;
+    }
+
+    xSemaphoreGive(cache_mutex);
+}
+
+const char *audio_clip_name(audio_clip_id_t id)
+{
+    return id < AUDIO_CLIP_MAX ? audio_clip_desc[id].name : "unknown";
+}
+
+// littlefs path of the clip, NULL for embedded and packed clips
+const char *audio_clip_path(audio_clip_id_t id)
+{
+    return id < AUDIO_CLIP_MAX && !audio_clip_cache[id].resident ? audio_clip_desc[id].path : NULL;
+}
+
+// the audio partition holds a pack instead of littlefs and must not be mounted
+bool audio_clip_pack_loaded(void)
+{
+    return audio_pack_clip_count() > 0;
+}
+
+void audio_clip_cache_stats(audio_clip_cache_stats_t *stats)
+{
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    *stats = cache_stats;
+    xSemaphoreGive(cache_mutex);
+}
@@ -0,0 +1,133 @@
+#include <string.h>
+#include <stdint.h>
+
+#include "audio_dsp.h"
+
+static inline int16_t saturate16(int32_t x)
+{
+    return x > INT16_MAX ? INT16_MAX : (x < INT16_MIN ? INT16_MIN : x);
+}
+
+static inline int16_t scale_q15(int16_t sample, int32_t gain)
+{
+    return saturate16((sample * gain) >> 15);
+}
+
+int32_t audio_gain_from_volume(float volume)
+{
+    if (volume <= 0.0f)
+    {
+        return 0;
+    }
+
+    const int32_t q15 = (int32_t)(volume * AUDIO_GAIN_Q15_ONE + 0.5f);
+    return q15 > AUDIO_GAIN_MAX ? AUDIO_GAIN_MAX : q15;
+}
+
+void audio_gain_init(audio_gain_t *gain, int32_t q15)
+{
+    gain->gain = q15;
+    gain->target = q15;
+    gain->step = 0;
+}
+
+// moves to the new gain over AUDIO_GAIN_RAMP_SAMPLES instead of stepping, which clicks
+void audio_gain_set(audio_gain_t *gain, int32_t q15)
+{
+    audio_gain_ramp(gain, q15, AUDIO_GAIN_RAMP_SAMPLES);
+}
+
+// linear ramp to q15 over ramp_samples, applied by audio_gain_apply() as the samples
+// are scaled so fades cost no extra pass and add no latency
+void audio_gain_ramp(audio_gain_t *gain, int32_t q15, int ramp_samples)
+{
+    if (q15 == gain->target)
+    {
+        return;
+    }
+
+    gain->target = q15;
+    gain->step = (q15 - gain->gain) / (ramp_samples > 0 ? ramp_samples : 1);
+
+    if (gain->step == 0)
+    {
+        gain->step = q15 > gain->gain ? 1 : -1;
+    }
+}
+
+static int apply_ramp(audio_gain_t *gain, int16_t *samples, int len)
+{
+    int i = 0;
+
+    for (; i < len && gain->gain != gain->target; i++)
+    {
+        gain->gain += gain->step;
+        if ((gain->step > 0 && gain->gain > gain->target) || (gain->step < 0 && gain->gain < gain->target))
+        {
+            gain->gain = gain->target;
+        }
+
+        samples[i] = scale_q15(samples[i], gain->gain);
+    }
+
+    return i;
+}
+
+// samples should be 4-byte aligned so pairs load and store as one word
+void audio_gain_apply(audio_gain_t *gain, int16_t *samples, int len)
+{
+    int i = apply_ramp(gain, samples, len);
+
+    const int32_t g = gain->gain;
+
+    if (g == AUDIO_GAIN_Q15_ONE)
+    {
+        return;
+    }
+
+    if (g == 0)
+    {
+        memset(&samples[i], 0, (len - i) * sizeof(int16_t));
+        return;
+    }
+
+    // realign after a ramp that ended on an odd sample
+    if ((i & 1) && i < len)
+    {
+        samples[i] = scale_q15(samples[i], g);
+        i++;
+    }
+
+    // two samples per 32-bit word, the ESP32 has no packed 16-bit multiply so each
+    // half is scaled with a 32-bit multiply and clamped. memcpy compiles to a single
+    // aligned load/store and keeps the access legal under strict aliasing
+    const int pair_count = (len - i) / 2;
+
+    for (int p = 0; p < pair_count; p++)
+    {
+        uint32_t w;
+        memcpy(&w, &samples[i + p * 2], sizeof(w));
+
+        const int16_t lo = scale_q15((int16_t)(w & 0xFFFF), g);
+        const int16_t hi = scale_q15((int16_t)(w >> 16), g);
+
+        w = (uint16_t)lo | (uint32_t)(uint16_t)hi << 16;
+        memcpy(&samples[i + p * 2], &w, sizeof(w));
+    }
+
+    i += pair_count * 2;
+
+    if (i < len)
+    {
+        samples[i] = scale_q15(samples[i], g);
+    }
+}
+
+// adds src into dst, clamping instead of wrapping where two loud voices overlap
+void audio_mix(int16_t *dst, const int16_t *src, int len)
+{
+    for (int i = 0; i < len; i++)
+    {
+        dst[i] = saturate16((int32_t)dst[i] + src[i]);
+    }
+}
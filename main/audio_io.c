@@ -1,22 +1,17 @@
 #include <string.h>
+#include <sys/param.h>
 #include "driver/i2s.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
 
 #include "audio_io.h"
-
-#include "welcome_to_tutor_fish_01.h"
-#include "submit_a_question_00.h"
-#include "tutor_fish_settings_00.h"
-#include "look_at_your_question_01.h"
-#include "the_camera_take_a_pic_01.h"
-#include "to_conserve_battery_01.h"
-#include "taking_a_picture321_02.h"
-#include "uploading_the_picture_please_wait_00.h"
-#include "to_hear_the_answer_again_00.h"
-#include "tutors_found_answer_00.h"
-#include "tutors_look_for_answer_00.h"
+#include "audio_clip.h"
+#include "audio_player.h"
+#include "audio_phrase.h"
+#include "nvs.h"
+#include "latency_trace.h"
 
 static const char *TAG = "audio_io.c";
 
@@ -25,1985 +20,649 @@ static const char *TAG = "audio_io.c";
 #define I2S_DO_IO (5)
 #define I2S_DI_IO (36)
 
-static QueueHandle_t i2s_event_queue;
-static int queued_audio_file_len = 0;
+#define AUDIO_REQUEST_QUEUE_LEN (4)
+
+// the first boot plays AUDIO_DMA_CALIBRATION_MS of silence at each dma configuration from
+// the smallest and keeps the first without a dma underrun or a late refill. a level that
+// underruns more than AUDIO_DMA_TARGET_UNDERRUNS_PER_HOUR in use is calibrated again on the
+// next boot, from the level above it
+#define AUDIO_DMA_CALIBRATION_MS (1000)
+#define AUDIO_DMA_TARGET_UNDERRUNS_PER_HOUR (6)
+#define AUDIO_DMA_CHECK_PERIOD (10000 / portTICK_PERIOD_MS)
+#define AUDIO_DMA_NVS_KEY "i2s_dma_level"
+#define AUDIO_DMA_FLOOR_NVS_KEY "i2s_dma_floor" // where the next calibration starts
+
+typedef struct
+{
+    int count;
+    int len; // samples
+} audio_dma_level_t;
+
+// smallest first, internal dma capable ram used is count * len * 2 bytes
+static const audio_dma_level_t dma_levels[] = {
+    {3, 256},
+    {4, 256},
+    {4, 512},
+    {6, 512},
+    {8, 512},
+    {AUDIO_DMA_BUF_COUNT, AUDIO_DMA_BUF_LEN},
+};
+
+#define AUDIO_DMA_LEVEL_COUNT (sizeof(dma_levels) / sizeof(dma_levels[0]))
+
+static uint8_t dma_level = AUDIO_DMA_LEVEL_COUNT - 1;
+static bool dma_recheck_stored = false;  // once per boot
+static audio_player_stats_t dma_in_use; // the counters when the level was put to use
+static QueueHandle_t i2s_events = NULL;
+
+typedef struct
+{
+    audio_clip_id_t id;
+    bool stoppable;
+    int percentage; // >= 0 for a completion announcement instead of the clip
+} audio_request_t;
+
+static const audio_clip_id_t completion_phrase[] = {AUDIO_PHRASE_VALUE, AUDIO_CLIP_PERCENT_COMPLETED_00};
 
-static int16_t *temp_buf = NULL;
-static bool queued_audio_file_stoppable;
+static QueueHandle_t audio_requests = NULL;
 
 audio_buf_t audio_buf;
 
-esp_err_t malloc_confirm_sfx_04_wav(void)
+static const audio_clip_t *stage_clip(audio_clip_id_t id)
 {
-    const char *audio_file_path = "/audio/confirm_sfx_04.wav";
+    const audio_clip_t *clip = NULL;
 
-    FILE *f = fopen(audio_file_path, "r");
-    if (f == NULL)
+    esp_err_t err = audio_clip_acquire(id, &clip);
+    if (err != ESP_OK)
     {
-        ESP_LOGE(TAG, "Failed to open file reading");
-        return ESP_FAIL;
+        ESP_LOGE(TAG, "audio_clip_acquire(%s) err: %s", audio_clip_name(id), esp_err_to_name(err));
+        return NULL;
     }
 
-    // Moving pointer to end
-    int f_err = fseek(f, 0, SEEK_END);
-    if (f_err != 0)
+    return clip;
+}
+
+// writes one playlist clip and stages the following one (next_id NULL for the last clip),
+// returns false once the stream has been stopped
+static bool write_clip(audio_clip_id_t id, const audio_clip_t *clip, const audio_clip_id_t *next_id, const audio_clip_t **next)
+{
+    if (clip == NULL)
     {
-        ESP_LOGE(TAG, "fseek() SEEK_END error");
-        return ESP_FAIL;
-    }
+        // no room in the cache, stream the clip straight from littlefs instead
+        audio_source_t source;
+
+        if (next_id != NULL)
+        {
+            *next = stage_clip(*next_id);
+        }
+
+        if (audio_clip_path(id) == NULL || audio_source_file(&source, audio_clip_path(id)) != ESP_OK)
+        {
+            return true;
+        }
 
-    // get audio file length
-    audio_buf.confirm_sfx_04_wav_audio_len = ftell(f);
-    audio_buf.confirm_sfx_04_wav_audio_buf = malloc(audio_buf.confirm_sfx_04_wav_audio_len * sizeof(int16_t));
+        esp_err_t err = audio_player_write_source(&source);
+        source.close(source.ctx);
 
-    // Moving pointer to beginning
-    f_err = fseek(f, 0, SEEK_SET);
-    if (f_err != 0)
-    {
-        ESP_LOGE(TAG, "fseek() SEEK_SET error");
-        return ESP_FAIL;
+        return err != ESP_ERR_INVALID_STATE;
     }
 
-    int read_ret = fread(audio_buf.confirm_sfx_04_wav_audio_buf, sizeof(uint8_t), audio_buf.confirm_sfx_04_wav_audio_len, f);
-    if (read_ret != audio_buf.confirm_sfx_04_wav_audio_len)
+    // queue the start of the clip first so staging the next clip never starves the player
+    const int head_len = MIN(clip->len, AUDIO_RINGBUF_SIZE);
+    if (audio_player_write(clip->buf, head_len) < 0)
     {
-        ESP_LOGE(TAG, "fread() error. read %d bytes out of %d", read_ret, audio_buf.confirm_sfx_04_wav_audio_len);
-        return ESP_FAIL;
+        return false;
     }
 
-    f_err = fclose(f);
-    if (f_err != 0)
+    if (next_id != NULL)
     {
-        ESP_LOGW(TAG, "fclose() failed");
-        return ESP_FAIL;
+        *next = stage_clip(*next_id);
     }
 
-    return ESP_OK;
+    return audio_player_write(&clip->buf[head_len], clip->len - head_len) >= 0;
 }
 
-void free_confirm_sfx_04_wav(void)
+static esp_err_t enqueue_clips(const audio_clip_id_t *clips, int clip_count, bool audio_playback_stoppable, audio_priority_t priority, audio_playback_handle_t *handle)
 {
-    free(audio_buf.confirm_sfx_04_wav_audio_buf);
-    audio_buf.confirm_sfx_04_wav_audio_buf = NULL;
-}
+    if (clips == NULL || clip_count <= 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
 
+    // staged before waiting on the player so loading overlaps the previous stream
+    const audio_clip_t *current = stage_clip(clips[0]);
+    const audio_clip_t *next = NULL;
 
-esp_err_t malloc_wait_app_loads_00_wav(void)
-{
-    const char *audio_file_path = "/audio/wait_app_loads_00.wav";
+    latency_trace_mark(LATENCY_STAGE_CLIP_READY);
 
-    FILE *f = fopen(audio_file_path, "r");
-    if (f == NULL)
+    esp_err_t err = audio_player_begin(audio_volume, audio_playback_stoppable, priority, handle);
+    if (err != ESP_OK)
     {
-        ESP_LOGE(TAG, "Failed to open file reading");
-        return ESP_FAIL;
+        ESP_LOGE(TAG, "audio_player_begin() err: %s", esp_err_to_name(err));
+        audio_clip_release(current);
+        return err;
     }
 
-    // Moving pointer to end
-    int f_err = fseek(f, 0, SEEK_END);
-    if (f_err != 0)
-    {
-        ESP_LOGE(TAG, "fseek() SEEK_END error");
-        return ESP_FAIL;
-    }
+    latency_trace_mark(LATENCY_STAGE_QUEUED);
 
-    // get audio file length
-    audio_buf.wait_app_loads_00_wav_audio_len = ftell(f);
-    audio_buf.wait_app_loads_00_wav_audio_buf = malloc(audio_buf.wait_app_loads_00_wav_audio_len * sizeof(int16_t));
+    bool playing = true;
 
-    // Moving pointer to beginning
-    f_err = fseek(f, 0, SEEK_SET);
-    if (f_err != 0)
+    for (int i = 0; i < clip_count && playing; i++)
     {
-        ESP_LOGE(TAG, "fseek() SEEK_SET error");
-        return ESP_FAIL;
-    }
+        audio_player_next_clip();
 
-    int read_ret = fread(audio_buf.wait_app_loads_00_wav_audio_buf, sizeof(uint8_t), audio_buf.wait_app_loads_00_wav_audio_len, f);
-    if (read_ret != audio_buf.wait_app_loads_00_wav_audio_len)
-    {
-        ESP_LOGE(TAG, "fread() error. read %d bytes out of %d", read_ret, audio_buf.wait_app_loads_00_wav_audio_len);
-        return ESP_FAIL;
+        playing = write_clip(clips[i], current, i + 1 < clip_count ? &clips[i + 1] : NULL, &next);
+
+        audio_clip_release(current);
+        current = next;
+        next = NULL;
     }
 
-    f_err = fclose(f);
-    if (f_err != 0)
+    // stopped part way through, the staged clip was never written
+    audio_clip_release(current);
+
+    audio_player_end();
+
+    if (!playing)
     {
-        ESP_LOGW(TAG, "fclose() failed");
-        return ESP_FAIL;
+        ESP_LOGI(TAG, "playlist stopped");
     }
 
     return ESP_OK;
 }
 
-void free_wait_app_loads_00_wav(void)
+// plays the clips back to back as one I2S stream. returns once the last clip is queued,
+// pass handle to audio_player_wait() to block until it has been heard. a stop request
+// drops the rest of the playlist
+esp_err_t audio_playlist_enqueue(const audio_clip_id_t *clips, int clip_count, bool audio_playback_stoppable, audio_playback_handle_t *handle)
 {
-    free(audio_buf.wait_app_loads_00_wav_audio_buf);
-    audio_buf.wait_app_loads_00_wav_audio_buf = NULL;
+    return enqueue_clips(clips, clip_count, audio_playback_stoppable, AUDIO_PRIORITY_PROMPT, handle);
 }
 
-esp_err_t malloc_wifi_disconn_00_wav(void)
+esp_err_t playback_audio_clip(audio_clip_id_t id, bool audio_playback_stoppable)
 {
-    const char *audio_file_path = "/audio/wifi_disconn_00.wav";
+    return audio_playlist_enqueue(&id, 1, audio_playback_stoppable, NULL);
+}
 
-    FILE *f = fopen(audio_file_path, "r");
-    if (f == NULL)
-    {
-        ESP_LOGE(TAG, "Failed to open file reading");
-        return ESP_FAIL;
-    }
+// queues the clip for the audio request task and returns at once, for the wifi event
+// loop and the upload paths which must never wait on the speaker
+esp_err_t playback_audio_clip_async(audio_clip_id_t id, bool audio_playback_stoppable)
+{
+    const audio_request_t request = {
+        .id = id,
+        .stoppable = audio_playback_stoppable,
+        .percentage = -1,
+    };
 
-    // Moving pointer to end
-    int f_err = fseek(f, 0, SEEK_END);
-    if (f_err != 0)
+    if (xQueueSend(audio_requests, &request, 0) != pdTRUE)
     {
-        ESP_LOGE(TAG, "fseek() SEEK_END error");
-        return ESP_FAIL;
+        ESP_LOGW(TAG, "audio request queue full, %s dropped", audio_clip_name(id));
+        return ESP_ERR_TIMEOUT;
     }
 
-    // get audio file length
-    audio_buf.wifi_disconnect_00_wav_audio_len = ftell(f);
-    audio_buf.wifi_disconnect_00_wav_audio_buf = malloc(audio_buf.wifi_disconnect_00_wav_audio_len * sizeof(int16_t));
+    return ESP_OK;
+}
 
-    // Moving pointer to beginning
-    f_err = fseek(f, 0, SEEK_SET);
-    if (f_err != 0)
-    {
-        ESP_LOGE(TAG, "fseek() SEEK_SET error");
-        return ESP_FAIL;
-    }
+// "forty" "five" "percent completed", queued as playback_audio_clip_async() so the ota copy
+// never waits on the speaker. the recorded words run from five to ninety five, 0% and 100%
+// are not announced (ESP_ERR_INVALID_ARG), the start and the end of a transfer have prompts
+// of their own
+esp_err_t playback_completion_percentage(int file_size, float written_bytes, bool skippable)
+{
+    audio_clip_id_t clips[AUDIO_PHRASE_MAX_CLIPS];
+
+    const int percentage = file_size > 0 ? (int)(written_bytes * 100 / file_size) : 0;
 
-    int read_ret = fread(audio_buf.wifi_disconnect_00_wav_audio_buf, sizeof(uint8_t), audio_buf.wifi_disconnect_00_wav_audio_len, f);
-    if (read_ret != audio_buf.wifi_disconnect_00_wav_audio_len)
+    if (audio_phrase_compose(completion_phrase, 2, percentage, clips, AUDIO_PHRASE_MAX_CLIPS) == 0)
     {
-        ESP_LOGE(TAG, "fread() error. read %d bytes out of %d", read_ret, audio_buf.wifi_disconnect_00_wav_audio_len);
-        return ESP_FAIL;
+        return ESP_ERR_INVALID_ARG;
     }
 
-    f_err = fclose(f);
-    if (f_err != 0)
+    const audio_request_t request = {
+        .id = AUDIO_CLIP_PERCENT_COMPLETED_00,
+        .stoppable = skippable,
+        .percentage = percentage,
+    };
+
+    if (xQueueSend(audio_requests, &request, 0) != pdTRUE)
     {
-        ESP_LOGW(TAG, "fclose() failed");
-        return ESP_FAIL;
+        ESP_LOGW(TAG, "audio request queue full, %d%% dropped", percentage);
+        return ESP_ERR_TIMEOUT;
     }
 
     return ESP_OK;
 }
 
-esp_err_t malloc_attempt_wifi_conn_00_wav(void)
+// the calibration under the wifi and camera load the boot did not have. once underruns
+// exceed the target rate for the audio played so far, the next boot calibrates again
+// starting above this level
+static void check_dma_calibration(void)
 {
-    const char *audio_file_path = "/audio/attempt_wifi_conn_00.wav";
-
-    FILE *f = fopen(audio_file_path, "r");
-    if (f == NULL)
-    {
-        ESP_LOGE(TAG, "Failed to open file reading");
-        return ESP_FAIL;
-    }
-
-    // Moving pointer to end
-    int f_err = fseek(f, 0, SEEK_END);
-    if (f_err != 0)
-    {
-        ESP_LOGE(TAG, "fseek() SEEK_END error");
-        return ESP_FAIL;
-    }
+    audio_player_stats_t stats;
+    audio_player_stats(&stats);
 
-    // get audio file length
-    audio_buf.attempt_wifi_conn_00_wav_audio_len = ftell(f);
-    audio_buf.attempt_wifi_conn_00_wav_audio_buf = malloc(audio_buf.attempt_wifi_conn_00_wav_audio_len * sizeof(int16_t));
+    // the levels tried before it are not counted against it
+    const uint64_t played_us = stats.played_us - dma_in_use.played_us;
+    const uint32_t underruns = stats.dma_underruns - dma_in_use.dma_underruns;
+    const uint64_t allowed = played_us * AUDIO_DMA_TARGET_UNDERRUNS_PER_HOUR / (3600ULL * 1000000);
 
-    // Moving pointer to beginning
-    f_err = fseek(f, 0, SEEK_SET);
-    if (f_err != 0)
+    if (dma_recheck_stored || underruns <= allowed || (size_t)dma_level + 1 >= AUDIO_DMA_LEVEL_COUNT)
     {
-        ESP_LOGE(TAG, "fseek() SEEK_SET error");
-        return ESP_FAIL;
+        return;
     }
 
-    int read_ret = fread(audio_buf.attempt_wifi_conn_00_wav_audio_buf, sizeof(uint8_t), audio_buf.attempt_wifi_conn_00_wav_audio_len, f);
-    if (read_ret != audio_buf.attempt_wifi_conn_00_wav_audio_len)
+    esp_err_t err = write_nvs_int(AUDIO_DMA_FLOOR_NVS_KEY, dma_level + 1);
+    if (err != ESP_OK)
     {
-        ESP_LOGE(TAG, "fread() error. read %d bytes out of %d", read_ret, audio_buf.attempt_wifi_conn_00_wav_audio_len);
-        return ESP_FAIL;
+        ESP_LOGE(TAG, "write_nvs_int(%s) err: %s", AUDIO_DMA_FLOOR_NVS_KEY, esp_err_to_name(err));
+        return;
     }
 
-    f_err = fclose(f);
-    if (f_err != 0)
+    err = erase_nvs_key(AUDIO_DMA_NVS_KEY);
+    if (err != ESP_OK)
     {
-        ESP_LOGW(TAG, "fclose() failed");
-        return ESP_FAIL;
+        ESP_LOGE(TAG, "erase_nvs_key(%s) err: %s", AUDIO_DMA_NVS_KEY, esp_err_to_name(err));
+        return;
     }
 
-    return ESP_OK;
-}
+    ESP_LOGW(TAG, "dma %dx%d: %u underruns in %llu ms of audio, the next boot calibrates from level %d",
+             stats.dma_buf_count, stats.dma_buf_len, underruns, played_us / 1000, dma_level + 1);
 
-void free_attempt_wifi_conn_00(void)
-{
-    free(audio_buf.attempt_wifi_conn_00_wav_audio_buf);
-    audio_buf.attempt_wifi_conn_00_wav_audio_buf = NULL;
+    dma_recheck_stored = true;
 }
 
-esp_err_t malloc_returning_home_wav_sfx(void)
+static void audio_request_task(void *pvParameters)
 {
-    const char *audio_file_path = "/audio/returning_home_07.wav";
+    audio_request_t request;
 
-    FILE *f = fopen(audio_file_path, "r");
-    if (f == NULL)
+    while (true)
     {
-        ESP_LOGE(TAG, "Failed to open file reading");
-        return ESP_FAIL;
-    }
+        if (xQueueReceive(audio_requests, &request, AUDIO_DMA_CHECK_PERIOD) == pdTRUE)
+        {
+            if (request.percentage >= 0)
+            {
+                audio_phrase_play(completion_phrase, 2, request.percentage, request.stoppable);
+            }
+            else
+            {
+                playback_audio_clip(request.id, request.stoppable);
+            }
+        }
 
-    // Moving pointer to end
-    int f_err = fseek(f, 0, SEEK_END);
-    if (f_err != 0)
-    {
-        ESP_LOGE(TAG, "fseek() SEEK_END error");
-        return ESP_FAIL;
+        check_dma_calibration();
     }
+}
 
-    // get audio file length
-    audio_buf.returning_home_wav_audio_len = ftell(f);
-    audio_buf.returning_home_wav_audio_buf = malloc(audio_buf.returning_home_wav_audio_len * sizeof(int16_t));
+esp_err_t play_submit_question_instructions(void)
+{
+    static const audio_clip_id_t instructions[] = {
+        AUDIO_CLIP_THE_CAMERA_TAKE_A_PIC_01,
+        AUDIO_CLIP_LOOK_AT_YOUR_QUESTION_01,
+        AUDIO_CLIP_TO_CONSERVE_BATTERY_01,
+    };
 
-    // Moving pointer to beginning
-    f_err = fseek(f, 0, SEEK_SET);
-    if (f_err != 0)
-    {
-        ESP_LOGE(TAG, "fseek() SEEK_SET error");
-        return ESP_FAIL;
-    }
+    return audio_playlist_enqueue(instructions, sizeof(instructions) / sizeof(instructions[0]), true, NULL);
+}
 
-    int read_ret = fread(audio_buf.returning_home_wav_audio_buf, sizeof(uint8_t), audio_buf.returning_home_wav_audio_len, f);
-    if (read_ret != audio_buf.returning_home_wav_audio_len)
+// plays a downloaded answer, any prompt cuts it off
+esp_err_t playback_audio_file(const void *audio_file_buf, int audio_file_len, float audio_volume, bool audio_playback_stoppable)
+{
+    esp_err_t err = audio_player_begin(audio_volume, audio_playback_stoppable, AUDIO_PRIORITY_ANSWER, NULL);
+    if (err != ESP_OK)
     {
-        ESP_LOGE(TAG, "fread() error. read %d bytes out of %d", read_ret, audio_buf.returning_home_wav_audio_len);
-        return ESP_FAIL;
+        ESP_LOGE(TAG, "audio_player_begin() err: %s", esp_err_to_name(err));
+        return err;
     }
 
-    f_err = fclose(f);
-    if (f_err != 0)
+    // the player task scales and plays the clip while it is copied in, block by block
+    if (audio_player_write(audio_file_buf, audio_file_len) < 0)
     {
-        ESP_LOGW(TAG, "fclose() failed");
-        return ESP_FAIL;
+        ESP_LOGI(TAG, "playback stopped");
     }
 
-    return ESP_OK;
-}
+    audio_player_end();
 
-void free_returning_home_wav_sfx(void)
-{
-    free(audio_buf.returning_home_wav_audio_buf);
-    audio_buf.returning_home_wav_audio_buf = NULL;
+    return ESP_OK;
 }
 
-esp_err_t malloc_home_instructions_00_wav(void)
+/*
+esp_err_t playback_audio_file_2(int16_t *audio_file_buf, int audio_file_len, float audio_volume, bool audio_playback_stoppable)
 {
-    const char *audio_file_path = "/audio/home_instructions_00.wav";
+    esp_err_t err;
 
-    FILE *f = fopen(audio_file_path, "r");
-    if (f == NULL)
+    // wait until the previous audio file has completed
+    while (audio_buf.system_i2s_playing)
     {
-        ESP_LOGE(TAG, "Failed to open file reading");
-        return ESP_FAIL;
+        vTaskDelay(10 / portTICK_PERIOD_MS);
     }
 
-    // Moving pointer to end
-    int f_err = fseek(f, 0, SEEK_END);
-    if (f_err != 0)
+    // if the audio file length is less than 64048 it needs additional padding
+    if (audio_file_len < 84048)
     {
-        ESP_LOGE(TAG, "fseek() SEEK_END error");
-        return ESP_FAIL;
-    }
+        const int padding = 84048 - audio_file_len;
+        const int audio_file_len_padded = audio_file_len + padding;
 
-    // get audio file length
-    audio_buf.home_instructions_00_wav_audio_len = ftell(f);
-    audio_buf.home_instructions_00_wav_audio_buf = malloc(audio_buf.home_instructions_00_wav_audio_len * sizeof(int16_t));
+        temp_buf = malloc(audio_file_len_padded * sizeof(int16_t));
+        queued_audio_file_len = audio_file_len_padded;
+        queued_audio_file_stoppable = audio_playback_stoppable;
+
+        for (int i = 0; i <= audio_file_len_padded / sizeof(int16_t); i++)
+        {
+            // removes the pop from the beginning of the wav file bytes
+            if (i <= 1000)
+            {
+                temp_buf[i] = 0x00;
+            }
+            else
+            {
+                if (i <= audio_file_len)
+                {
+                    temp_buf[i] = audio_file_buf[i] * audio_volume;
+                }
+                else
+                {
+                    temp_buf[i] = 0;
+                }
+            }
+        }
 
-    // Moving pointer to beginning
-    f_err = fseek(f, 0, SEEK_SET);
-    if (f_err != 0)
+        audio_file_len += padding;
+    }
+    else
     {
-        ESP_LOGE(TAG, "fseek() SEEK_SET error");
-        return ESP_FAIL;
+        temp_buf = malloc(audio_file_len * sizeof(int16_t));
+        queued_audio_file_len = audio_file_len;
+        queued_audio_file_stoppable = audio_playback_stoppable;
+
+        for (int i = 0; i <= audio_file_len / sizeof(int16_t); i++)
+        {
+            // removes the pop from the beginning of the wav file bytes
+            if (i <= 1000)
+            {
+                temp_buf[i] = 0x00;
+            }
+            else
+            {
+                temp_buf[i] = audio_file_buf[i] * audio_volume;
+            }
+        }
     }
 
-    int read_ret = fread(audio_buf.home_instructions_00_wav_audio_buf, sizeof(uint8_t), audio_buf.home_instructions_00_wav_audio_len, f);
-    if (read_ret != audio_buf.home_instructions_00_wav_audio_len)
+    err = i2s_start(I2S_NUM_1);
+    if (err != ESP_OK)
     {
-        ESP_LOGE(TAG, "fread() error. read %d bytes out of %d", read_ret, audio_buf.home_instructions_00_wav_audio_len);
-        return ESP_FAIL;
+        ESP_LOGI(TAG, "i2s_start() err %s", esp_err_to_name(err));
+        return err;
     }
 
-    f_err = fclose(f);
-    if (f_err != 0)
+    audio_buf.system_i2s_playing = true;
+    audio_buf.system_i2s_stop = false;
+
+    // vTaskDelay(500 / portTICK_PERIOD_MS);
+
+    ESP_LOGI(TAG, "i2s_write() starting...");
+
+    size_t bytes_written = 0;
+    err = i2s_write(I2S_NUM_1, temp_buf, audio_file_len, &bytes_written, 10);
+    if (err != ESP_OK)
     {
-        ESP_LOGW(TAG, "fclose() failed");
-        return ESP_FAIL;
+        ESP_LOGI(TAG, "i2s_write() err %s", esp_err_to_name(err));
+        return err;
     }
+    ESP_LOGI(TAG, "i2s_write() complete");
 
-    return ESP_OK;
+    return err;
 }
+*/
 
-void free_home_instructions_00(void)
+esp_err_t playback_error_message(void)
 {
-    free(audio_buf.home_instructions_00_wav_audio_buf);
-    audio_buf.home_instructions_00_wav_audio_buf = NULL;
+    return playback_audio_clip(AUDIO_CLIP_ERROR_MESSAGE_00, false);
 }
 
-esp_err_t malloc_exit_this_app_01_wav(void)
+// mixed over whatever is playing instead of waiting for it to finish
+esp_err_t playback_confirm_sfx_04(bool skippable)
 {
-    const char *audio_file_path = "/audio/exit_this_app_01.wav";
+    const audio_clip_t *clip = stage_clip(AUDIO_CLIP_CONFIRM_SFX_04);
 
-    FILE *f = fopen(audio_file_path, "r");
-    if (f == NULL)
+    if (clip != NULL && audio_player_mix_clip(clip) == ESP_OK)
     {
-        ESP_LOGE(TAG, "Failed to open file reading");
-        return ESP_FAIL;
+        return ESP_OK;
     }
 
-    // Moving pointer to end
-    int f_err = fseek(f, 0, SEEK_END);
-    if (f_err != 0)
-    {
-        ESP_LOGE(TAG, "fseek() SEEK_END error");
-        return ESP_FAIL;
-    }
-
-    // get audio file length
-    audio_buf.exit_this_app_01_wav_audio_len = ftell(f);
-    audio_buf.exit_this_app_01_wav_audio_buf = malloc(audio_buf.exit_this_app_01_wav_audio_len * sizeof(int16_t));
-
-    // Moving pointer to beginning
-    f_err = fseek(f, 0, SEEK_SET);
-    if (f_err != 0)
-    {
-        ESP_LOGE(TAG, "fseek() SEEK_SET error");
-        return ESP_FAIL;
-    }
-
-    int read_ret = fread(audio_buf.exit_this_app_01_wav_audio_buf, sizeof(uint8_t), audio_buf.exit_this_app_01_wav_audio_len, f);
-    if (read_ret != audio_buf.exit_this_app_01_wav_audio_len)
-    {
-        ESP_LOGE(TAG, "fread() error. read %d bytes out of %d", read_ret, audio_buf.exit_this_app_01_wav_audio_len);
-        return ESP_FAIL;
-    }
+    audio_clip_release(clip);
 
-    f_err = fclose(f);
-    if (f_err != 0)
-    {
-        ESP_LOGW(TAG, "fclose() failed");
-        return ESP_FAIL;
-    }
+    // played on its own, it still cuts off a prompt rather than waiting behind it
+    const audio_clip_id_t id = AUDIO_CLIP_CONFIRM_SFX_04;
+    return enqueue_clips(&id, 1, skippable, AUDIO_PRIORITY_SFX, NULL);
+}
 
-    return ESP_OK;
+esp_err_t playback_returning_home_wav(void)
+{
+    return playback_audio_clip(AUDIO_CLIP_RETURNING_HOME_07, false);
 }
 
-void free_exit_this_app_01(void)
+esp_err_t _i2s_stop(void)
 {
-    free(audio_buf.exit_this_app_01_wav_audio_buf);
-    audio_buf.exit_this_app_01_wav_audio_buf = NULL;
+    return i2s_stop(I2S_NUM_1);
 }
 
-esp_err_t malloc_error_message_00_wav(void)
+// installs the driver with the dma configuration of the level, stopped
+static esp_err_t install_i2s(uint8_t level)
 {
-    const char *audio_file_path = "/audio/error_message_00.wav";
+    esp_err_t err;
+
+    ESP_LOGI(TAG, "i2s dma %d x %d samples (level %d)", dma_levels[level].count, dma_levels[level].len, level);
+
+    const i2s_config_t i2s_config_1 = {
+        .mode = I2S_MODE_MASTER | I2S_MODE_TX | I2S_MODE_RX,
+        .sample_rate = AUDIO_SAMPLE_RATE,
+        .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
+        .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT,
+        .communication_format = I2S_COMM_FORMAT_STAND_I2S, // I2S_COMM_FORMAT_STAND_MSB <- big-endian
+        .intr_alloc_flags = ESP_INTR_FLAG_INTRDISABLED,    // ESP_INTR_FLAG_INTRDISABLED //ESP_INTR_FLAG_LEVEL1
+        .dma_buf_count = dma_levels[level].count,          // number of buffers
+        .dma_buf_len = dma_levels[level].len               /*,    //64
+        .use_apll = false,
+        .tx_desc_auto_clear = false*/
+    };
+
+    i2s_pin_config_t pin_config = {
+        .bck_io_num = I2S_BCK_IO,
+        .ws_io_num = I2S_WS_IO,
+        .data_out_num = I2S_DO_IO,
+        .data_in_num = I2S_DI_IO};
 
-    FILE *f = fopen(audio_file_path, "r");
-    if (f == NULL)
+    // Configuring the I2S driver and pins.
+    // This function must be called before any I2S driver read/write operations.
+    err = i2s_driver_install(I2S_NUM_1, &i2s_config_1, dma_levels[level].count, &i2s_events);
+    if (err != ESP_OK)
     {
-        ESP_LOGE(TAG, "Failed to open file reading");
-        return ESP_FAIL;
+        ESP_LOGE(TAG, "i2s_driver_install() err: %s", esp_err_to_name(err));
+        return err;
     }
-
-    // Moving pointer to end
-    int f_err = fseek(f, 0, SEEK_END);
-    if (f_err != 0)
+    err = i2s_set_pin(I2S_NUM_1, &pin_config);
+    if (err != ESP_OK)
     {
-        ESP_LOGE(TAG, "fseek() SEEK_END error");
-        return ESP_FAIL;
+        ESP_LOGE(TAG, "i2s_set_pin() err: %s", esp_err_to_name(err));
+        return err;
     }
 
-    // get audio file length
-    audio_buf.error_message_00_wav_audio_len = ftell(f);
-    audio_buf.error_message_00_wav_audio_buf = malloc(audio_buf.error_message_00_wav_audio_len * sizeof(int16_t));
-
-    // Moving pointer to beginning
-    f_err = fseek(f, 0, SEEK_SET);
-    if (f_err != 0)
+    err = i2s_set_clk(I2S_NUM_1, AUDIO_SAMPLE_RATE, I2S_BITS_PER_SAMPLE_16BIT, I2S_CHANNEL_MONO);
+    if (err != ESP_OK)
     {
-        ESP_LOGE(TAG, "fseek() SEEK_SET error");
-        return ESP_FAIL;
+        ESP_LOGE(TAG, "i2s_set_pin() err: %s", esp_err_to_name(err));
+        return err;
     }
 
-    int read_ret = fread(audio_buf.error_message_00_wav_audio_buf, sizeof(uint8_t), audio_buf.error_message_00_wav_audio_len, f);
-    if (read_ret != audio_buf.error_message_00_wav_audio_len)
+    err = i2s_set_sample_rates(I2S_NUM_1, AUDIO_SAMPLE_RATE);
+    if (err != ESP_OK)
     {
-        ESP_LOGE(TAG, "fread() error. read %d bytes out of %d", read_ret, audio_buf.error_message_00_wav_audio_len);
-        return ESP_FAIL;
+        ESP_LOGE(TAG, "i2s_set_pin() err: %s", esp_err_to_name(err));
+        return err;
     }
 
-    f_err = fclose(f);
-    if (f_err != 0)
+    err = i2s_stop(I2S_NUM_1);
+    if (err != ESP_OK)
     {
-        ESP_LOGW(TAG, "fclose() failed");
-        return ESP_FAIL;
+        ESP_LOGE(TAG, "i2s_stop() err: %s", esp_err_to_name(err));
+        return err;
     }
 
     return ESP_OK;
 }
 
-void free_error_message_00_wav(void)
-{
-    free(audio_buf.error_message_00_wav_audio_buf);
-    audio_buf.error_message_00_wav_audio_buf = NULL;
-}
+#define AUDIO_DMA_CALIBRATION_BYTES (AUDIO_SAMPLE_RATE / 1000 * AUDIO_DMA_CALIBRATION_MS * 2)
+#define LE32(v) (v) & 0xFF, ((v) >> 8) & 0xFF, ((v) >> 16) & 0xFF, ((v) >> 24) & 0xFF
 
-esp_err_t malloc_welcome_to_tutor_fish_01(void)
+// 16 kHz mono pcm, AUDIO_DMA_CALIBRATION_MS long
+static const uint8_t silence_wav_header[] = {
+    'R', 'I', 'F', 'F', LE32(36 + AUDIO_DMA_CALIBRATION_BYTES), 'W', 'A', 'V', 'E',
+    'f', 'm', 't', ' ', LE32(16), 1, 0, 1, 0, LE32(AUDIO_SAMPLE_RATE), LE32(AUDIO_SAMPLE_RATE * 2), 2, 0, 16, 0,
+    'd', 'a', 't', 'a', LE32(AUDIO_DMA_CALIBRATION_BYTES),
+};
+
+static esp_err_t play_silence(void)
 {
-    audio_buf.welcome_01_audio_len = welcome_to_tutor_fish_01_wav_len;
+    static const uint8_t zeros[256] = {0};
+    audio_playback_handle_t handle;
 
-    audio_buf.welcome_01_wav_audio_buf = malloc(audio_buf.welcome_01_audio_len);
+    esp_err_t err = audio_player_begin(0.0f, false, AUDIO_PRIORITY_PROMPT, &handle);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
 
-    for (int i = 0; i < audio_buf.welcome_01_audio_len; i++)
+    audio_player_write(silence_wav_header, sizeof(silence_wav_header));
+    for (int written = 0; written < AUDIO_DMA_CALIBRATION_BYTES; written += sizeof(zeros))
     {
-        audio_buf.welcome_01_wav_audio_buf[i] = welcome_to_tutor_fish_01_wav[i];
+        audio_player_write(zeros, MIN(sizeof(zeros), AUDIO_DMA_CALIBRATION_BYTES - written));
     }
+    audio_player_end();
 
-    return ESP_OK;
+    return audio_player_wait(handle, portMAX_DELAY);
 }
 
-void free_welcome_to_tutor_fish_01(void)
+// steps from the start level up to the first that plays the calibration without a dma
+// underrun or a late refill, the largest if none does, and stores it
+static esp_err_t calibrate_dma(void)
 {
-    free(audio_buf.welcome_01_wav_audio_buf);
-    audio_buf.welcome_01_wav_audio_buf = NULL;
-}
+    esp_err_t err;
 
-esp_err_t malloc_submit_a_question_00_wav(void)
-{
-    audio_buf.submit_a_question_00_wav_len = submit_a_question_00_wav_len;
+    while (true)
+    {
+        audio_player_stats_t before;
+        audio_player_stats_t after;
 
-    audio_buf.submit_a_question_00_wav_audio_buf = malloc(audio_buf.submit_a_question_00_wav_len);
+        audio_player_stats(&before);
+        err = play_silence();
+        audio_player_stats(&after);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "play_silence() err: %s", esp_err_to_name(err));
+            return err;
+        }
 
-    for (int i = 0; i < audio_buf.submit_a_question_00_wav_len; i++)
-    {
-        audio_buf.submit_a_question_00_wav_audio_buf[i] = submit_a_question_00_wav[i];
-    }
+        const uint32_t underruns = after.dma_underruns - before.dma_underruns;
+        const uint32_t late_refills = after.late_refills - before.late_refills;
+        ESP_LOGI(TAG, "dma calibration level %d: %u dma underruns, %u late refills, %u us worst jitter", dma_level,
+                 underruns, late_refills, after.max_event_jitter_us);
 
-    return ESP_OK;
-}
+        if ((underruns == 0 && late_refills == 0) || (size_t)dma_level + 1 >= AUDIO_DMA_LEVEL_COUNT)
+        {
+            break;
+        }
 
-void free_submit_a_question_00(void)
-{
-    free(audio_buf.submit_a_question_00_wav_audio_buf);
-    audio_buf.submit_a_question_00_wav_audio_buf = NULL;
-}
+        // the monitor lets go of the old event queue before the driver is reinstalled
+        audio_player_set_dma(0, 0, NULL);
+        i2s_driver_uninstall(I2S_NUM_1);
 
-esp_err_t malloc_tutor_fish_settings_00_wav(void)
-{
-    audio_buf.tutor_fish_settings_00_wav_len = tutor_fish_settings_00_wav_len;
+        dma_level++;
+        err = install_i2s(dma_level);
+        if (err != ESP_OK)
+        {
+            return err;
+        }
 
-    audio_buf.tutor_fish_settings_00_wav_audio_buf = malloc(audio_buf.tutor_fish_settings_00_wav_len);
+        err = audio_player_set_dma(dma_levels[dma_level].count, dma_levels[dma_level].len, i2s_events);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "audio_player_set_dma() err: %s", esp_err_to_name(err));
+            return err;
+        }
+    }
 
-    for (int i = 0; i < audio_buf.tutor_fish_settings_00_wav_len; i++)
+    err = write_nvs_int(AUDIO_DMA_NVS_KEY, dma_level);
+    if (err != ESP_OK)
     {
-        audio_buf.tutor_fish_settings_00_wav_audio_buf[i] = tutor_fish_settings_00_wav[i];
+        ESP_LOGE(TAG, "write_nvs_int(%s) err: %s", AUDIO_DMA_NVS_KEY, esp_err_to_name(err));
     }
 
-    return ESP_OK;
-}
+    ESP_LOGI(TAG, "dma calibrated at %d x %d samples (level %d)", dma_levels[dma_level].count, dma_levels[dma_level].len, dma_level);
 
-void free_tutor_fish_settings_00(void)
-{
-    free(audio_buf.tutor_fish_settings_00_wav_audio_buf);
-    audio_buf.tutor_fish_settings_00_wav_audio_buf = NULL;
+    return ESP_OK;
 }
 
-esp_err_t malloc_look_at_your_question_01_wav(void)
+esp_err_t init_i2s(void)
 {
-    audio_buf.look_at_your_question_01_wav_len = look_at_your_question_01_wav_len;
+    esp_err_t err;
 
-    audio_buf.look_at_your_question_01_wav_audio_buf = malloc(audio_buf.look_at_your_question_01_wav_len);
+    uint8_t stored_level = 0;
+    const bool calibrated = read_nvs_int(AUDIO_DMA_NVS_KEY, &stored_level) == ESP_OK && stored_level < AUDIO_DMA_LEVEL_COUNT;
 
-    for (int i = 0; i < audio_buf.look_at_your_question_01_wav_len; i++)
+    uint8_t floor_level = 0;
+    if (read_nvs_int(AUDIO_DMA_FLOOR_NVS_KEY, &floor_level) != ESP_OK || floor_level >= AUDIO_DMA_LEVEL_COUNT)
     {
-        audio_buf.look_at_your_question_01_wav_audio_buf[i] = look_at_your_question_01_wav[i];
+        floor_level = 0;
     }
 
-    return ESP_OK;
-}
-
-void free_look_at_your_question_01(void)
-{
-    free(audio_buf.look_at_your_question_01_wav_audio_buf);
-    audio_buf.look_at_your_question_01_wav_audio_buf = NULL;
-}
-
-esp_err_t malloc_the_camera_take_a_pic_01_wav(void)
-{
-    audio_buf.the_camera_take_a_pic_01_wav_len = the_camera_take_a_pic_01_wav_len;
-
-    audio_buf.the_camera_take_a_pic_01_wav_audio_buf = malloc(audio_buf.the_camera_take_a_pic_01_wav_len);
-
-    for (int i = 0; i < audio_buf.the_camera_take_a_pic_01_wav_len; i++)
-    {
-        audio_buf.the_camera_take_a_pic_01_wav_audio_buf[i] = the_camera_take_a_pic_01_wav[i];
-    }
-
-    return ESP_OK;
-}
-
-void free_the_camera_take_a_pic_01(void)
-{
-    free(audio_buf.the_camera_take_a_pic_01_wav_audio_buf);
-    audio_buf.the_camera_take_a_pic_01_wav_audio_buf = NULL;
-}
-
-esp_err_t malloc_to_conserve_battery_01_wav(void)
-{
-    audio_buf.to_conserve_battery_01_wav_len = to_conserve_battery_01_wav_len;
-
-    audio_buf.to_conserve_battery_01_wav_audio_buf = malloc(audio_buf.to_conserve_battery_01_wav_len);
-
-    for (int i = 0; i < audio_buf.to_conserve_battery_01_wav_len; i++)
-    {
-        audio_buf.to_conserve_battery_01_wav_audio_buf[i] = to_conserve_battery_01_wav[i];
-    }
-
-    return ESP_OK;
-}
-
-void free_to_conserve_battery_01(void)
-{
-    free(audio_buf.to_conserve_battery_01_wav_audio_buf);
-    audio_buf.to_conserve_battery_01_wav_audio_buf = NULL;
-}
-
-esp_err_t malloc_taking_a_picture321_02_wav(void)
-{
-    audio_buf.taking_a_picture321_02_wav_len = taking_a_picture321_02_wav_len;
-
-    audio_buf.taking_a_picture321_02_wav_audio_buf = malloc(audio_buf.taking_a_picture321_02_wav_len);
-
-    for (int i = 0; i < audio_buf.taking_a_picture321_02_wav_len; i++)
-    {
-        audio_buf.taking_a_picture321_02_wav_audio_buf[i] = taking_a_picture321_02_wav[i];
-    }
-
-    return ESP_OK;
-}
-
-void free_taking_a_picture321_02_wav(void)
-{
-    free(audio_buf.taking_a_picture321_02_wav_audio_buf);
-    audio_buf.taking_a_picture321_02_wav_audio_buf = NULL;
-}
-
-esp_err_t malloc_uploading_the_picture_please_wait_00_wav(void)
-{
-    audio_buf.uploading_the_picture_please_wait_00_wav_len = uploading_the_picture_please_wait_00_wav_len;
-
-    audio_buf.uploading_the_picture_please_wait_00_wav_audio_buf = malloc(audio_buf.uploading_the_picture_please_wait_00_wav_len);
-
-    for (int i = 0; i < audio_buf.uploading_the_picture_please_wait_00_wav_len; i++)
-    {
-        audio_buf.uploading_the_picture_please_wait_00_wav_audio_buf[i] = uploading_the_picture_please_wait_00_wav[i];
-    }
-
-    return ESP_OK;
-}
-
-void free_uploading_the_picture_please_wait_00_wav(void)
-{
-    free(audio_buf.uploading_the_picture_please_wait_00_wav_audio_buf);
-    audio_buf.uploading_the_picture_please_wait_00_wav_audio_buf = NULL;
-}
-
-esp_err_t malloc_to_hear_the_answer_again_00_wav(void)
-{
-    audio_buf.to_hear_the_answer_again_00_wav_len = to_hear_the_answer_again_00_wav_len;
-
-    audio_buf.to_hear_the_answer_again_00_wav_audio_buf = malloc(audio_buf.to_hear_the_answer_again_00_wav_len);
-
-    for (int i = 0; i < audio_buf.to_hear_the_answer_again_00_wav_len; i++)
-    {
-        audio_buf.to_hear_the_answer_again_00_wav_audio_buf[i] = to_hear_the_answer_again_00_wav[i];
-    }
-
-    return ESP_OK;
-}
-
-void free_to_hear_the_answer_again_00_wav(void)
-{
-    free(audio_buf.to_hear_the_answer_again_00_wav_audio_buf);
-    audio_buf.to_hear_the_answer_again_00_wav_audio_buf = NULL;
-}
-
-esp_err_t malloc_tutors_found_answer_00_wav(void)
-{
-    audio_buf.tutors_found_answer_00_wav_len = tutors_found_answer_00_wav_len;
-
-    audio_buf.tutors_found_answer_00_wav_audio_buf = malloc(audio_buf.tutors_found_answer_00_wav_len);
-
-    for (int i = 0; i < audio_buf.tutors_found_answer_00_wav_len; i++)
-    {
-        audio_buf.tutors_found_answer_00_wav_audio_buf[i] = tutors_found_answer_00_wav[i];
-    }
-
-    return ESP_OK;
-}
-
-void free_tutors_found_answer_00_wav(void)
-{
-    free(audio_buf.tutors_found_answer_00_wav_audio_buf);
-    audio_buf.to_hear_the_answer_again_00_wav_audio_buf = NULL;
-}
-
-esp_err_t malloc_tutors_look_for_answer_00_wav(void)
-{
-    audio_buf.tutors_look_for_answer_00_wav_len = tutors_look_for_answer_00_wav_len;
-
-    audio_buf.tutors_look_for_answer_00_wav_audio_buf = malloc(audio_buf.tutors_look_for_answer_00_wav_len);
-
-    for (int i = 0; i < audio_buf.tutors_look_for_answer_00_wav_len; i++)
-    {
-        audio_buf.tutors_look_for_answer_00_wav_audio_buf[i] = tutors_look_for_answer_00_wav[i];
-    }
-
-    return ESP_OK;
-}
-
-void free_tutors_look_for_answer_00_wav(void)
-{
-    free(audio_buf.tutors_look_for_answer_00_wav_audio_buf);
-    audio_buf.tutors_look_for_answer_00_wav_audio_buf = NULL;
-}
-
-esp_err_t malloc_ascii_5_00_wav(void)
-{
-    const char *audio_file_path = "/audio/ascii_5_00.wav";
-
-    FILE *f = fopen(audio_file_path, "r");
-    if (f == NULL)
-    {
-        ESP_LOGE(TAG, "Failed to open file reading");
-        return ESP_FAIL;
-    }
-
-    // Moving pointer to end
-    int f_err = fseek(f, 0, SEEK_END);
-    if (f_err != 0)
-    {
-        ESP_LOGE(TAG, "fseek() SEEK_END error");
-        return ESP_FAIL;
-    }
-
-    // get audio file length
-    audio_buf.ascii_5_00_wav_audio_len = ftell(f);
-    audio_buf.ascii_5_00_wav_audio_buf = malloc(audio_buf.ascii_5_00_wav_audio_len * sizeof(int16_t));
-
-    // Moving pointer to beginning
-    f_err = fseek(f, 0, SEEK_SET);
-    if (f_err != 0)
-    {
-        ESP_LOGE(TAG, "fseek() SEEK_SET error");
-        return ESP_FAIL;
-    }
-
-    int read_ret = fread(audio_buf.ascii_5_00_wav_audio_buf, sizeof(uint8_t), audio_buf.ascii_5_00_wav_audio_len, f);
-    if (read_ret != audio_buf.ascii_5_00_wav_audio_len)
-    {
-        ESP_LOGE(TAG, "fread() error. read %d bytes out of %d", read_ret, audio_buf.ascii_5_00_wav_audio_len);
-        return ESP_FAIL;
-    }
-
-    f_err = fclose(f);
-    if (f_err != 0)
-    {
-        ESP_LOGW(TAG, "fclose() failed");
-        return ESP_FAIL;
-    }
-
-    return ESP_OK;
-}
-
-void free_ascii_5_00_wav(void)
-{
-    free(audio_buf.ascii_5_00_wav_audio_buf);
-    audio_buf.ascii_5_00_wav_audio_buf = NULL;
-}
-
-///////
-
-esp_err_t malloc_percent_completed_00_wav(void)
-{
-    const char *audio_file_path = "/audio/percent_completed_00.wav";
-
-    FILE *f = fopen(audio_file_path, "r");
-    if (f == NULL)
-    {
-        ESP_LOGE(TAG, "Failed to open file reading");
-        return ESP_FAIL;
-    }
-
-    // Moving pointer to end
-    int f_err = fseek(f, 0, SEEK_END);
-    if (f_err != 0)
-    {
-        ESP_LOGE(TAG, "fseek() SEEK_END error");
-        return ESP_FAIL;
-    }
-
-    // get audio file length
-    audio_buf.percent_completed_00_wav_audio_len = ftell(f);
-    audio_buf.percent_completed_00_wav_audio_buf = malloc(audio_buf.percent_completed_00_wav_audio_len * sizeof(int16_t));
-
-    // Moving pointer to beginning
-    f_err = fseek(f, 0, SEEK_SET);
-    if (f_err != 0)
-    {
-        ESP_LOGE(TAG, "fseek() SEEK_SET error");
-        return ESP_FAIL;
-    }
-
-    int read_ret = fread(audio_buf.percent_completed_00_wav_audio_buf, sizeof(uint8_t), audio_buf.percent_completed_00_wav_audio_len, f);
-    if (read_ret != audio_buf.percent_completed_00_wav_audio_len)
-    {
-        ESP_LOGE(TAG, "fread() error. read %d bytes out of %d", read_ret, audio_buf.percent_completed_00_wav_audio_len);
-        return ESP_FAIL;
-    }
-
-    f_err = fclose(f);
-    if (f_err != 0)
-    {
-        ESP_LOGW(TAG, "fclose() failed");
-        return ESP_FAIL;
-    }
-
-    return ESP_OK;
-}
-
-void free_percent_completed_00_wav(void)
-{
-    free(audio_buf.percent_completed_00_wav_audio_buf);
-    audio_buf.percent_completed_00_wav_audio_buf = NULL;
-}
-
-esp_err_t malloc_10_00_wav(void)
-{
-    const char *audio_file_path = "/audio/10_00.wav";
-
-    FILE *f = fopen(audio_file_path, "r");
-    if (f == NULL)
-    {
-        ESP_LOGE(TAG, "Failed to open file reading");
-        return ESP_FAIL;
-    }
-
-    // Moving pointer to end
-    int f_err = fseek(f, 0, SEEK_END);
-    if (f_err != 0)
-    {
-        ESP_LOGE(TAG, "fseek() SEEK_END error");
-        return ESP_FAIL;
-    }
-
-    // get audio file length
-    audio_buf._10_00_wav_audio_len = ftell(f);
-    audio_buf._10_00_wav_audio_buf = malloc(audio_buf._10_00_wav_audio_len * sizeof(int16_t));
-
-    // Moving pointer to beginning
-    f_err = fseek(f, 0, SEEK_SET);
-    if (f_err != 0)
-    {
-        ESP_LOGE(TAG, "fseek() SEEK_SET error");
-        return ESP_FAIL;
-    }
-
-    int read_ret = fread(audio_buf._10_00_wav_audio_buf, sizeof(uint8_t), audio_buf._10_00_wav_audio_len, f);
-    if (read_ret != audio_buf._10_00_wav_audio_len)
-    {
-        ESP_LOGE(TAG, "fread() error. read %d bytes out of %d", read_ret, audio_buf._10_00_wav_audio_len);
-        return ESP_FAIL;
-    }
-
-    f_err = fclose(f);
-    if (f_err != 0)
-    {
-        ESP_LOGW(TAG, "fclose() failed");
-        return ESP_FAIL;
-    }
-
-    return ESP_OK;
-}
-
-void free_10_00_wav(void)
-{
-    free(audio_buf._10_00_wav_audio_buf);
-    audio_buf._10_00_wav_audio_buf = NULL;
-}
-
-esp_err_t malloc_20_00_wav(void)
-{
-    const char *audio_file_path = "/audio/20_00.wav";
-
-    FILE *f = fopen(audio_file_path, "r");
-    if (f == NULL)
-    {
-        ESP_LOGE(TAG, "Failed to open file reading");
-        return ESP_FAIL;
-    }
-
-    // Moving pointer to end
-    int f_err = fseek(f, 0, SEEK_END);
-    if (f_err != 0)
-    {
-        ESP_LOGE(TAG, "fseek() SEEK_END error");
-        return ESP_FAIL;
-    }
-
-    // get audio file length
-    audio_buf._20_00_wav_audio_len = ftell(f);
-    audio_buf._20_00_wav_audio_buf = malloc(audio_buf._20_00_wav_audio_len * sizeof(int16_t));
-
-    // Moving pointer to beginning
-    f_err = fseek(f, 0, SEEK_SET);
-    if (f_err != 0)
-    {
-        ESP_LOGE(TAG, "fseek() SEEK_SET error");
-        return ESP_FAIL;
-    }
-
-    int read_ret = fread(audio_buf._20_00_wav_audio_buf, sizeof(uint8_t), audio_buf._20_00_wav_audio_len, f);
-    if (read_ret != audio_buf._20_00_wav_audio_len)
-    {
-        ESP_LOGE(TAG, "fread() error. read %d bytes out of %d", read_ret, audio_buf._20_00_wav_audio_len);
-        return ESP_FAIL;
-    }
-
-    f_err = fclose(f);
-    if (f_err != 0)
-    {
-        ESP_LOGW(TAG, "fclose() failed");
-        return ESP_FAIL;
-    }
-
-    return ESP_OK;
-}
-
-void free_20_00_wav(void)
-{
-    free(audio_buf._20_00_wav_audio_buf);
-    audio_buf._20_00_wav_audio_buf = NULL;
-}
-
-esp_err_t malloc_30_00_wav(void)
-{
-    const char *audio_file_path = "/audio/30_00.wav";
-
-    FILE *f = fopen(audio_file_path, "r");
-    if (f == NULL)
-    {
-        ESP_LOGE(TAG, "Failed to open file reading");
-        return ESP_FAIL;
-    }
-
-    // Moving pointer to end
-    int f_err = fseek(f, 0, SEEK_END);
-    if (f_err != 0)
-    {
-        ESP_LOGE(TAG, "fseek() SEEK_END error");
-        return ESP_FAIL;
-    }
-
-    // get audio file length
-    audio_buf._30_00_wav_audio_len = ftell(f);
-    audio_buf._30_00_wav_audio_buf = malloc(audio_buf._30_00_wav_audio_len * sizeof(int16_t));
-
-    // Moving pointer to beginning
-    f_err = fseek(f, 0, SEEK_SET);
-    if (f_err != 0)
-    {
-        ESP_LOGE(TAG, "fseek() SEEK_SET error");
-        return ESP_FAIL;
-    }
-
-    int read_ret = fread(audio_buf._30_00_wav_audio_buf, sizeof(uint8_t), audio_buf._30_00_wav_audio_len, f);
-    if (read_ret != audio_buf._30_00_wav_audio_len)
-    {
-        ESP_LOGE(TAG, "fread() error. read %d bytes out of %d", read_ret, audio_buf._30_00_wav_audio_len);
-        return ESP_FAIL;
-    }
-
-    f_err = fclose(f);
-    if (f_err != 0)
-    {
-        ESP_LOGW(TAG, "fclose() failed");
-        return ESP_FAIL;
-    }
-
-    return ESP_OK;
-}
-
-void free_30_00_wav(void)
-{
-    free(audio_buf._30_00_wav_audio_buf);
-    audio_buf._30_00_wav_audio_buf = NULL;
-}
-
-esp_err_t malloc_40_00_wav(void)
-{
-    const char *audio_file_path = "/audio/40_00.wav";
-
-    FILE *f = fopen(audio_file_path, "r");
-    if (f == NULL)
-    {
-        ESP_LOGE(TAG, "Failed to open file reading");
-        return ESP_FAIL;
-    }
-
-    // Moving pointer to end
-    int f_err = fseek(f, 0, SEEK_END);
-    if (f_err != 0)
-    {
-        ESP_LOGE(TAG, "fseek() SEEK_END error");
-        return ESP_FAIL;
-    }
-
-    // get audio file length
-    audio_buf._40_00_wav_audio_len = ftell(f);
-    audio_buf._40_00_wav_audio_buf = malloc(audio_buf._40_00_wav_audio_len * sizeof(int16_t));
-
-    // Moving pointer to beginning
-    f_err = fseek(f, 0, SEEK_SET);
-    if (f_err != 0)
-    {
-        ESP_LOGE(TAG, "fseek() SEEK_SET error");
-        return ESP_FAIL;
-    }
-
-    int read_ret = fread(audio_buf._40_00_wav_audio_buf, sizeof(uint8_t), audio_buf._40_00_wav_audio_len, f);
-    if (read_ret != audio_buf._40_00_wav_audio_len)
-    {
-        ESP_LOGE(TAG, "fread() error. read %d bytes out of %d", read_ret, audio_buf._40_00_wav_audio_len);
-        return ESP_FAIL;
-    }
-
-    f_err = fclose(f);
-    if (f_err != 0)
-    {
-        ESP_LOGW(TAG, "fclose() failed");
-        return ESP_FAIL;
-    }
-
-    return ESP_OK;
-}
-
-void free_40_00_wav(void)
-{
-    free(audio_buf._40_00_wav_audio_buf);
-    audio_buf._40_00_wav_audio_buf = NULL;
-}
-
-esp_err_t malloc_50_00_wav(void)
-{
-    const char *audio_file_path = "/audio/50_00.wav";
-
-    FILE *f = fopen(audio_file_path, "r");
-    if (f == NULL)
-    {
-        ESP_LOGE(TAG, "Failed to open file reading");
-        return ESP_FAIL;
-    }
-
-    // Moving pointer to end
-    int f_err = fseek(f, 0, SEEK_END);
-    if (f_err != 0)
-    {
-        ESP_LOGE(TAG, "fseek() SEEK_END error");
-        return ESP_FAIL;
-    }
-
-    // get audio file length
-    audio_buf._50_00_wav_audio_len = ftell(f);
-    audio_buf._50_00_wav_audio_buf = malloc(audio_buf._50_00_wav_audio_len * sizeof(int16_t));
-
-    // Moving pointer to beginning
-    f_err = fseek(f, 0, SEEK_SET);
-    if (f_err != 0)
-    {
-        ESP_LOGE(TAG, "fseek() SEEK_SET error");
-        return ESP_FAIL;
-    }
-
-    int read_ret = fread(audio_buf._50_00_wav_audio_buf, sizeof(uint8_t), audio_buf._50_00_wav_audio_len, f);
-    if (read_ret != audio_buf._50_00_wav_audio_len)
-    {
-        ESP_LOGE(TAG, "fread() error. read %d bytes out of %d", read_ret, audio_buf._50_00_wav_audio_len);
-        return ESP_FAIL;
-    }
-
-    f_err = fclose(f);
-    if (f_err != 0)
-    {
-        ESP_LOGW(TAG, "fclose() failed");
-        return ESP_FAIL;
-    }
-
-    return ESP_OK;
-}
-
-void free_50_00_wav(void)
-{
-    free(audio_buf._50_00_wav_audio_buf);
-    audio_buf._50_00_wav_audio_buf = NULL;
-}
-
-esp_err_t malloc_60_00_wav(void)
-{
-    const char *audio_file_path = "/audio/60_00.wav";
-
-    FILE *f = fopen(audio_file_path, "r");
-    if (f == NULL)
-    {
-        ESP_LOGE(TAG, "Failed to open file reading");
-        return ESP_FAIL;
-    }
-
-    // Moving pointer to end
-    int f_err = fseek(f, 0, SEEK_END);
-    if (f_err != 0)
-    {
-        ESP_LOGE(TAG, "fseek() SEEK_END error");
-        return ESP_FAIL;
-    }
-
-    // get audio file length
-    audio_buf._60_00_wav_audio_len = ftell(f);
-    audio_buf._60_00_wav_audio_buf = malloc(audio_buf._60_00_wav_audio_len * sizeof(int16_t));
-
-    // Moving pointer to beginning
-    f_err = fseek(f, 0, SEEK_SET);
-    if (f_err != 0)
-    {
-        ESP_LOGE(TAG, "fseek() SEEK_SET error");
-        return ESP_FAIL;
-    }
-
-    int read_ret = fread(audio_buf._60_00_wav_audio_buf, sizeof(uint8_t), audio_buf._60_00_wav_audio_len, f);
-    if (read_ret != audio_buf._60_00_wav_audio_len)
-    {
-        ESP_LOGE(TAG, "fread() error. read %d bytes out of %d", read_ret, audio_buf._60_00_wav_audio_len);
-        return ESP_FAIL;
-    }
-
-    f_err = fclose(f);
-    if (f_err != 0)
-    {
-        ESP_LOGW(TAG, "fclose() failed");
-        return ESP_FAIL;
-    }
-
-    return ESP_OK;
-}
-
-void free_60_00_wav(void)
-{
-    free(audio_buf._60_00_wav_audio_buf);
-    audio_buf._60_00_wav_audio_buf = NULL;
-}
-
-esp_err_t malloc_70_00_wav(void)
-{
-    const char *audio_file_path = "/audio/70_00.wav";
-
-    FILE *f = fopen(audio_file_path, "r");
-    if (f == NULL)
-    {
-        ESP_LOGE(TAG, "Failed to open file reading");
-        return ESP_FAIL;
-    }
-
-    // Moving pointer to end
-    int f_err = fseek(f, 0, SEEK_END);
-    if (f_err != 0)
-    {
-        ESP_LOGE(TAG, "fseek() SEEK_END error");
-        return ESP_FAIL;
-    }
-
-    // get audio file length
-    audio_buf._70_00_wav_audio_len = ftell(f);
-    audio_buf._70_00_wav_audio_buf = malloc(audio_buf._70_00_wav_audio_len * sizeof(int16_t));
-
-    // Moving pointer to beginning
-    f_err = fseek(f, 0, SEEK_SET);
-    if (f_err != 0)
-    {
-        ESP_LOGE(TAG, "fseek() SEEK_SET error");
-        return ESP_FAIL;
-    }
-
-    int read_ret = fread(audio_buf._70_00_wav_audio_buf, sizeof(uint8_t), audio_buf._70_00_wav_audio_len, f);
-    if (read_ret != audio_buf._70_00_wav_audio_len)
-    {
-        ESP_LOGE(TAG, "fread() error. read %d bytes out of %d", read_ret, audio_buf._70_00_wav_audio_len);
-        return ESP_FAIL;
-    }
-
-    f_err = fclose(f);
-    if (f_err != 0)
-    {
-        ESP_LOGW(TAG, "fclose() failed");
-        return ESP_FAIL;
-    }
-
-    return ESP_OK;
-}
-
-void free_70_00_wav(void)
-{
-    free(audio_buf._70_00_wav_audio_buf);
-    audio_buf._70_00_wav_audio_buf = NULL;
-}
-
-esp_err_t malloc_80_00_wav(void)
-{
-    const char *audio_file_path = "/audio/80_00.wav";
-
-    FILE *f = fopen(audio_file_path, "r");
-    if (f == NULL)
-    {
-        ESP_LOGE(TAG, "Failed to open file reading");
-        return ESP_FAIL;
-    }
-
-    // Moving pointer to end
-    int f_err = fseek(f, 0, SEEK_END);
-    if (f_err != 0)
-    {
-        ESP_LOGE(TAG, "fseek() SEEK_END error");
-        return ESP_FAIL;
-    }
-
-    // get audio file length
-    audio_buf._80_00_wav_audio_len = ftell(f);
-    audio_buf._80_00_wav_audio_buf = malloc(audio_buf._80_00_wav_audio_len * sizeof(int16_t));
-
-    // Moving pointer to beginning
-    f_err = fseek(f, 0, SEEK_SET);
-    if (f_err != 0)
-    {
-        ESP_LOGE(TAG, "fseek() SEEK_SET error");
-        return ESP_FAIL;
-    }
-
-    int read_ret = fread(audio_buf._80_00_wav_audio_buf, sizeof(uint8_t), audio_buf._80_00_wav_audio_len, f);
-    if (read_ret != audio_buf._80_00_wav_audio_len)
-    {
-        ESP_LOGE(TAG, "fread() error. read %d bytes out of %d", read_ret, audio_buf._80_00_wav_audio_len);
-        return ESP_FAIL;
-    }
-
-    f_err = fclose(f);
-    if (f_err != 0)
-    {
-        ESP_LOGW(TAG, "fclose() failed");
-        return ESP_FAIL;
-    }
-
-    return ESP_OK;
-}
-
-void free_80_00_wav(void)
-{
-    free(audio_buf._80_00_wav_audio_buf);
-    audio_buf._80_00_wav_audio_buf = NULL;
-}
-
-esp_err_t malloc_90_00_wav(void)
-{
-    const char *audio_file_path = "/audio/90_00.wav";
-
-    FILE *f = fopen(audio_file_path, "r");
-    if (f == NULL)
-    {
-        ESP_LOGE(TAG, "Failed to open file reading");
-        return ESP_FAIL;
-    }
-
-    // Moving pointer to end
-    int f_err = fseek(f, 0, SEEK_END);
-    if (f_err != 0)
-    {
-        ESP_LOGE(TAG, "fseek() SEEK_END error");
-        return ESP_FAIL;
-    }
-
-    // get audio file length
-    audio_buf._90_00_wav_audio_len = ftell(f);
-    audio_buf._90_00_wav_audio_buf = malloc(audio_buf._90_00_wav_audio_len * sizeof(int16_t));
-
-    // Moving pointer to beginning
-    f_err = fseek(f, 0, SEEK_SET);
-    if (f_err != 0)
-    {
-        ESP_LOGE(TAG, "fseek() SEEK_SET error");
-        return ESP_FAIL;
-    }
-
-    int read_ret = fread(audio_buf._90_00_wav_audio_buf, sizeof(uint8_t), audio_buf._90_00_wav_audio_len, f);
-    if (read_ret != audio_buf._90_00_wav_audio_len)
-    {
-        ESP_LOGE(TAG, "fread() error. read %d bytes out of %d", read_ret, audio_buf._90_00_wav_audio_len);
-        return ESP_FAIL;
-    }
-
-    f_err = fclose(f);
-    if (f_err != 0)
-    {
-        ESP_LOGW(TAG, "fclose() failed");
-        return ESP_FAIL;
-    }
-
-    return ESP_OK;
-}
-
-void free_90_00_wav(void)
-{
-    free(audio_buf._90_00_wav_audio_buf);
-    audio_buf._90_00_wav_audio_buf = NULL;
-}
-
-
-esp_err_t play_submit_question_instructions(void)
-{
-    esp_err_t err;
-
-    if (audio_buf.the_camera_take_a_pic_01_wav_audio_buf == NULL)
-    {
-        err = malloc_the_camera_take_a_pic_01_wav();
-        if (err != ESP_OK)
-        {
-            ESP_LOGE(TAG, "malloc_the_camera_take_a_pic_01_wav() err: %s", esp_err_to_name(err));
-        }
-
-        if (err == ESP_OK)
-        {
-            playback_audio_file(audio_buf.the_camera_take_a_pic_01_wav_audio_buf, audio_buf.the_camera_take_a_pic_01_wav_len, audio_volume, true);
-            if (err != ESP_OK)
-            {
-                ESP_LOGE(TAG, "playback_audio_file(the_camera_take_a_pic_01_wav_audio_buf) err: %s", esp_err_to_name(err));
-            }
-
-            free_the_camera_take_a_pic_01();
-        }
-    }
-
-    if (audio_buf.look_at_your_question_01_wav_audio_buf == NULL)
-    {
-        err = malloc_look_at_your_question_01_wav();
-        if (err != ESP_OK)
-        {
-            ESP_LOGE(TAG, "malloc_look_at_your_question_01_wav() err: %s", esp_err_to_name(err));
-        }
-
-        if (err == ESP_OK)
-        {
-            playback_audio_file(audio_buf.look_at_your_question_01_wav_audio_buf, audio_buf.look_at_your_question_01_wav_len, audio_volume, true);
-            if (err != ESP_OK)
-            {
-                ESP_LOGE(TAG, "playback_audio_file(look_at_your_question_01_wav_audio_buf) err: %s", esp_err_to_name(err));
-            }
-
-            free_look_at_your_question_01();
-        }
-    }
-
-    if (audio_buf.to_conserve_battery_01_wav_audio_buf == NULL)
-    {
-        err = malloc_to_conserve_battery_01_wav();
-        if (err != ESP_OK)
-        {
-            ESP_LOGE(TAG, "malloc_to_conserve_battery_01_wav() err: %s", esp_err_to_name(err));
-        }
-
-        if (err == ESP_OK)
-        {
-            playback_audio_file(audio_buf.to_conserve_battery_01_wav_audio_buf, audio_buf.to_conserve_battery_01_wav_len, audio_volume, true);
-            if (err != ESP_OK)
-            {
-                ESP_LOGE(TAG, "playback_audio_file(look_at_your_question_01_wav_audio_buf) err: %s", esp_err_to_name(err));
-            }
-
-            free_to_conserve_battery_01();
-        }
-    }
-
-    return ESP_OK;
-}
-
-esp_err_t playback_audio_file(int16_t *audio_file_buf, int audio_file_len, float audio_volume, bool audio_playback_stoppable)
-{
-    esp_err_t err;
-    int padding = 0;
-
-    // wait until the previous audio file has completed
-    while (audio_buf.system_i2s_playing)
-    {
-        vTaskDelay(10 / portTICK_PERIOD_MS);
-    }
-
-    temp_buf = malloc(audio_file_len * sizeof(int16_t));
-
-    // pad short audio files
-    if (audio_file_len < 32024)
-    {
-        padding = 32024 - audio_file_len;
-        queued_audio_file_len = audio_file_len + padding;
-    }
-    else
-    {
-        queued_audio_file_len = audio_file_len;
-    }
-
-    queued_audio_file_stoppable = audio_playback_stoppable;
-
-    /*
-    uint8_t audio bytes
-    int ii = 0;
-    for (int i = 0; i < audio_file_len; i += 2)
-    {
-        temp_buf[ii++] = (int16_t)(audio_file_buf[i + 1] << 8 | audio_file_buf[i]) * audio_volume;
-    }
-    */
-
-    for (int i = 0; i <= audio_file_len / sizeof(int16_t); i++)
-    {
-        // removes the pop from the wav file bytes
-        if (i <= 2000)
-        {
-            temp_buf[i] = 0x00;
-        }
-        else
-        {
-            temp_buf[i] = audio_file_buf[i] * audio_volume;
-        }
-    }
-
-    err = i2s_start(I2S_NUM_1);
-    if (err != ESP_OK)
-    {
-        ESP_LOGI(TAG, "i2s_start() err %s", esp_err_to_name(err));
-        return err;
-    }
-
-    audio_buf.system_i2s_playing = true;
-    audio_buf.system_i2s_stop = false;
-
-    ESP_LOGI(TAG, "i2s_write() starting...");
-
-    size_t bytes_written = 0;
-    err = i2s_write(I2S_NUM_1, temp_buf, audio_file_len, &bytes_written, 10);
-    if (err != ESP_OK)
-    {
-        ESP_LOGI(TAG, "i2s_write() err %s", esp_err_to_name(err));
-        return err;
-    }
-
-    ESP_LOGI(TAG, "i2s_write() complete");
-
-    return err;
-}
-
-/*
-esp_err_t playback_audio_file_2(int16_t *audio_file_buf, int audio_file_len, float audio_volume, bool audio_playback_stoppable)
-{
-    esp_err_t err;
-
-    // wait until the previous audio file has completed
-    while (audio_buf.system_i2s_playing)
-    {
-        vTaskDelay(10 / portTICK_PERIOD_MS);
-    }
-
-    // if the audio file length is less than 64048 it needs additional padding
-    if (audio_file_len < 84048)
-    {
-        const int padding = 84048 - audio_file_len;
-        const int audio_file_len_padded = audio_file_len + padding;
-
-        temp_buf = malloc(audio_file_len_padded * sizeof(int16_t));
-        queued_audio_file_len = audio_file_len_padded;
-        queued_audio_file_stoppable = audio_playback_stoppable;
-
-        for (int i = 0; i <= audio_file_len_padded / sizeof(int16_t); i++)
-        {
-            // removes the pop from the beginning of the wav file bytes
-            if (i <= 1000)
-            {
-                temp_buf[i] = 0x00;
-            }
-            else
-            {
-                if (i <= audio_file_len)
-                {
-                    temp_buf[i] = audio_file_buf[i] * audio_volume;
-                }
-                else
-                {
-                    temp_buf[i] = 0;
-                }
-            }
-        }
-
-        audio_file_len += padding;
-    }
-    else
-    {
-        temp_buf = malloc(audio_file_len * sizeof(int16_t));
-        queued_audio_file_len = audio_file_len;
-        queued_audio_file_stoppable = audio_playback_stoppable;
-
-        for (int i = 0; i <= audio_file_len / sizeof(int16_t); i++)
-        {
-            // removes the pop from the beginning of the wav file bytes
-            if (i <= 1000)
-            {
-                temp_buf[i] = 0x00;
-            }
-            else
-            {
-                temp_buf[i] = audio_file_buf[i] * audio_volume;
-            }
-        }
-    }
-
-    err = i2s_start(I2S_NUM_1);
-    if (err != ESP_OK)
-    {
-        ESP_LOGI(TAG, "i2s_start() err %s", esp_err_to_name(err));
-        return err;
-    }
-
-    audio_buf.system_i2s_playing = true;
-    audio_buf.system_i2s_stop = false;
-
-    // vTaskDelay(500 / portTICK_PERIOD_MS);
-
-    ESP_LOGI(TAG, "i2s_write() starting...");
-
-    size_t bytes_written = 0;
-    err = i2s_write(I2S_NUM_1, temp_buf, audio_file_len, &bytes_written, 10);
-    if (err != ESP_OK)
-    {
-        ESP_LOGI(TAG, "i2s_write() err %s", esp_err_to_name(err));
-        return err;
-    }
-    ESP_LOGI(TAG, "i2s_write() complete");
-
-    return err;
-}
-*/
-
-esp_err_t playback_error_message(void)
-{
-    esp_err_t err = ESP_OK;
-
-    // playback error message
-    if (audio_buf.error_message_00_wav_audio_buf == NULL)
-    {
-        err = malloc_error_message_00_wav();
-        if (err != ESP_OK)
-        {
-            ESP_LOGE(TAG, "malloc_error_message_00_wav() err: %s", esp_err_to_name(err));
-        }
-    }
-    if (err == ESP_OK)
-    {
-        err = playback_audio_file(audio_buf.error_message_00_wav_audio_buf, audio_buf.error_message_00_wav_audio_len, audio_volume, false);
-        if (err != ESP_OK)
-        {
-            ESP_LOGE(TAG, "playback_audio_file(error_message_00_wav_audio_buf) err: %s", esp_err_to_name(err));
-        }
-    }
-
-    free_error_message_00_wav();
-
-    return err;
-}
-
-esp_err_t playback_confirm_sfx_04(bool skippable)
-{
-    esp_err_t err = ESP_OK;
-
-    // playback error message
-    if (audio_buf.confirm_sfx_04_wav_audio_buf == NULL)
-    {
-        err = malloc_confirm_sfx_04_wav();
-        if (err != ESP_OK)
-        {
-            ESP_LOGE(TAG, "malloc_confirm_sfx_04_wav() err: %s", esp_err_to_name(err));
-        }
-    }
-    if (err == ESP_OK)
-    {
-        err = playback_audio_file(audio_buf.confirm_sfx_04_wav_audio_buf, audio_buf.confirm_sfx_04_wav_audio_len, audio_volume, skippable);
-        if (err != ESP_OK)
-        {
-            ESP_LOGE(TAG, "playback_audio_file(confirm_sfx_04_wav_audio_buf) err: %s", esp_err_to_name(err));
-        }
-    }
-
-    free_confirm_sfx_04_wav();
-
-    return err;
-}
-
-esp_err_t playback_returning_home_wav(void)
-{
-    esp_err_t err = ESP_OK;
-
-    if (audio_buf.returning_home_wav_audio_buf == NULL)
-    {
-        err = malloc_returning_home_wav_sfx();
-        if (err != ESP_OK)
-        {
-            ESP_LOGE(TAG, "malloc_smart_glasses_home_01_wav() err: %s", esp_err_to_name(err));
-        }
-    }
-
-    if (err == ESP_OK)
-    {
-        playback_audio_file(audio_buf.returning_home_wav_audio_buf, audio_buf.returning_home_wav_audio_len, audio_volume, false);
-        if (err != ESP_OK)
-        {
-            ESP_LOGE(TAG, "playback_audio_file() err: %s", esp_err_to_name(err));
-        }
-    }
-
-    free_returning_home_wav_sfx();
-
-    return err;
-}
-
-esp_err_t playback_completion_percentage(int file_size, float written_bytes, bool skippable)
-{
-    esp_err_t err = ESP_OK;
-
-    if (written_bytes <= file_size * 0.1f)
-    {
-        if (audio_buf.ascii_5_00_wav_audio_buf == NULL)
-        {
-            err = malloc_ascii_5_00_wav();
-            if (err != ESP_OK)
-            {
-                ESP_LOGE(TAG, "malloc_ascii_5_00_wav() err: %s", esp_err_to_name(err));
-            }
-        }
-
-        if (err == ESP_OK)
-        {
-            playback_audio_file(audio_buf.ascii_5_00_wav_audio_buf, audio_buf.ascii_5_00_wav_audio_len, audio_volume, skippable);
-            if (err != ESP_OK)
-            {
-                ESP_LOGE(TAG, "playback_audio_file() err: %s", esp_err_to_name(err));
-            }
-        }
-
-        free_ascii_5_00_wav();
-    }
-    else if (written_bytes > file_size * 0.1f && written_bytes <= file_size * 0.2f)
-    {
-        if (audio_buf._10_00_wav_audio_buf == NULL)
-        {
-            err = malloc_10_00_wav();
-            if (err != ESP_OK)
-            {
-                ESP_LOGE(TAG, "malloc_10_00_wav() err: %s", esp_err_to_name(err));
-            }
-        }
-
-        if (err == ESP_OK)
-        {
-            playback_audio_file(audio_buf._10_00_wav_audio_buf, audio_buf._10_00_wav_audio_len, audio_volume, skippable);
-            if (err != ESP_OK)
-            {
-                ESP_LOGE(TAG, "playback_audio_file() err: %s", esp_err_to_name(err));
-            }
-        }
-
-        free_10_00_wav();
-    }
-    else if (written_bytes > file_size * 0.2f && written_bytes <= file_size * 0.3f)
-    {
-        if (audio_buf._20_00_wav_audio_buf == NULL)
-        {
-            err = malloc_20_00_wav();
-            if (err != ESP_OK)
-            {
-                ESP_LOGE(TAG, "malloc_20_00_wav() err: %s", esp_err_to_name(err));
-            }
-        }
-
-        if (err == ESP_OK)
-        {
-            playback_audio_file(audio_buf._20_00_wav_audio_buf, audio_buf._20_00_wav_audio_len, audio_volume, skippable);
-            if (err != ESP_OK)
-            {
-                ESP_LOGE(TAG, "playback_audio_file() err: %s", esp_err_to_name(err));
-            }
-        }
-
-        free_20_00_wav();
-    }
-    else if (written_bytes > file_size * 0.3f && written_bytes <= file_size * 0.4f)
-    {
-        if (audio_buf._30_00_wav_audio_buf == NULL)
-        {
-            err = malloc_30_00_wav();
-            if (err != ESP_OK)
-            {
-                ESP_LOGE(TAG, "malloc_30_00_wav() err: %s", esp_err_to_name(err));
-            }
-        }
-
-        if (err == ESP_OK)
-        {
-            playback_audio_file(audio_buf._30_00_wav_audio_buf, audio_buf._30_00_wav_audio_len, audio_volume, skippable);
-            if (err != ESP_OK)
-            {
-                ESP_LOGE(TAG, "playback_audio_file() err: %s", esp_err_to_name(err));
-            }
-        }
-
-        free_30_00_wav();
-    }
-    else if (written_bytes > file_size * 0.4f && written_bytes <= file_size * 0.5f)
-    {
-        if (audio_buf._40_00_wav_audio_buf == NULL)
-        {
-            err = malloc_40_00_wav();
-            if (err != ESP_OK)
-            {
-                ESP_LOGE(TAG, "malloc_40_00_wav() err: %s", esp_err_to_name(err));
-            }
-        }
-
-        if (err == ESP_OK)
-        {
-            playback_audio_file(audio_buf._40_00_wav_audio_buf, audio_buf._40_00_wav_audio_len, audio_volume, skippable);
-            if (err != ESP_OK)
-            {
-                ESP_LOGE(TAG, "playback_audio_file() err: %s", esp_err_to_name(err));
-            }
-        }
-
-        free_40_00_wav();
-    }
-    else if (written_bytes > file_size * 0.5f && written_bytes <= file_size * 0.6f)
-    {
-        if (audio_buf._50_00_wav_audio_buf == NULL)
-        {
-            err = malloc_50_00_wav();
-            if (err != ESP_OK)
-            {
-                ESP_LOGE(TAG, "malloc_50_00_wav() err: %s", esp_err_to_name(err));
-            }
-        }
-        if (err == ESP_OK)
-        {
-            playback_audio_file(audio_buf._50_00_wav_audio_buf, audio_buf._50_00_wav_audio_len, audio_volume, skippable);
-            if (err != ESP_OK)
-            {
-                ESP_LOGE(TAG, "playback_audio_file() err: %s", esp_err_to_name(err));
-            }
-        }
-
-        free_50_00_wav();
-    }
-    else if (written_bytes > file_size * 0.6f && written_bytes <= file_size * 0.7f)
-    {
-        if (audio_buf._60_00_wav_audio_buf == NULL)
-        {
-            err = malloc_60_00_wav();
-            if (err != ESP_OK)
-            {
-                ESP_LOGE(TAG, "malloc_60_00_wav() err: %s", esp_err_to_name(err));
-            }
-        }
-        if (err == ESP_OK)
-        {
-            playback_audio_file(audio_buf._60_00_wav_audio_buf, audio_buf._60_00_wav_audio_len, audio_volume, skippable);
-            if (err != ESP_OK)
-            {
-                ESP_LOGE(TAG, "playback_audio_file() err: %s", esp_err_to_name(err));
-            }
-        }
-
-        free_60_00_wav();
-    }
-    else if (written_bytes > file_size * 0.7f && written_bytes <= file_size * 0.8f)
-    {
-        if (audio_buf._70_00_wav_audio_buf == NULL)
-        {
-            err = malloc_70_00_wav();
-            if (err != ESP_OK)
-            {
-                ESP_LOGE(TAG, "malloc_70_00_wav() err: %s", esp_err_to_name(err));
-            }
-        }
-        if (err == ESP_OK)
-        {
-            playback_audio_file(audio_buf._70_00_wav_audio_buf, audio_buf._70_00_wav_audio_len, audio_volume, skippable);
-            if (err != ESP_OK)
-            {
-                ESP_LOGE(TAG, "playback_audio_file() err: %s", esp_err_to_name(err));
-            }
-        }
+    dma_level = calibrated ? stored_level : floor_level;
 
-        free_70_00_wav();
-    }
-    else if (written_bytes > file_size * 0.8f && written_bytes <= file_size * 0.9f)
+    err = install_i2s(dma_level);
+    if (err != ESP_OK)
     {
-        if (audio_buf._80_00_wav_audio_buf == NULL)
-        {
-            err = malloc_80_00_wav();
-            if (err != ESP_OK)
-            {
-                ESP_LOGE(TAG, "malloc_80_00_wav() err: %s", esp_err_to_name(err));
-            }
-        }
-
-        if (err == ESP_OK)
-        {
-            playback_audio_file(audio_buf._80_00_wav_audio_buf, audio_buf._80_00_wav_audio_len, audio_volume, skippable);
-            if (err != ESP_OK)
-            {
-                ESP_LOGE(TAG, "playback_audio_file() err: %s", esp_err_to_name(err));
-            }
-        }
-
-        free_80_00_wav();
+        return err;
     }
-    else if (written_bytes > file_size * 0.9f)
-    {
-        if (audio_buf._90_00_wav_audio_buf == NULL)
-        {
-            err = malloc_90_00_wav();
-            if (err != ESP_OK)
-            {
-                ESP_LOGE(TAG, "malloc_90_00_wav() err: %s", esp_err_to_name(err));
-            }
-        }
-        if (err == ESP_OK)
-        {
-            playback_audio_file(audio_buf._90_00_wav_audio_buf, audio_buf._90_00_wav_audio_len, audio_volume, skippable);
-            if (err != ESP_OK)
-            {
-                ESP_LOGE(TAG, "playback_audio_file() err: %s", esp_err_to_name(err));
-            }
-        }
 
-        free_90_00_wav();
-    }
+    // audio_buf.hfp_i2s_playing = false;
+    // audio_buf.hfp_i2s_stop = true;
 
-    if (audio_buf.percent_completed_00_wav_audio_buf == NULL)
+    err = init_audio_player(dma_levels[dma_level].count, dma_levels[dma_level].len, i2s_events);
+    if (err != ESP_OK)
     {
-        err = malloc_percent_completed_00_wav();
-        if (err != ESP_OK)
-        {
-            ESP_LOGE(TAG, "malloc_percent_completed_00_wav() err: %s", esp_err_to_name(err));
-        }
+        ESP_LOGE(TAG, "init_audio_player() err: %s", esp_err_to_name(err));
+        return err;
     }
 
-    if (err == ESP_OK)
+    if (!calibrated)
     {
-        err = playback_audio_file(audio_buf.percent_completed_00_wav_audio_buf, audio_buf.percent_completed_00_wav_audio_len, audio_volume, skippable);
+        err = calibrate_dma();
         if (err != ESP_OK)
         {
-            ESP_LOGE(TAG, "playback_audio_file(percent_completed_00_wav_audio_buf) err: %s", esp_err_to_name(err));
-        }
-    }
-
-    free_percent_completed_00_wav();
-
-    return err;
-}
-
-esp_err_t _i2s_stop(void)
-{
-    return i2s_stop(I2S_NUM_1);
-}
-
-static void i2sTask(void *pvParameters)
-{
-    i2s_event_t event;
-    int txEvents = 0;
-
-    while (true)
-    {
-        // Wait indefinitely for a new message in the queue
-        if (xQueueReceive(i2s_event_queue, &event, portMAX_DELAY) == pdTRUE)
-        {
-
-            /*
-            if (event.type == I2S_EVENT_TX_DONE && glasses_state == GLASSES_HFP)
-            {
-                if (!audio_buf.hfp_i2s_ready)
-                {
-                    i2s_zero_dma_buffer(I2S_NUM_1);
-                    i2s_stop(I2S_NUM_1);
-                }
-            }
-            else if (event.type == I2S_EVENT_TX_DONE)
-            {
-                if (++txEvents >= (queued_audio_file_len / 2048) + 8)
-                {
-                    i2s_zero_dma_buffer(I2S_NUM_1);
-                    i2s_stop(I2S_NUM_1);
-
-                    free(temp_buf);
-                    temp_buf = NULL;
-
-                    txEvents = 0;
-                }
-                printf("txEvents: %d\n", txEvents);
-            }
-            */
-            if (event.type == I2S_EVENT_TX_DONE)
-            {
-                if (audio_buf.system_i2s_playing)
-                {
-                    if (++txEvents >= (queued_audio_file_len / 2048))
-                    {
-                        i2s_zero_dma_buffer(I2S_NUM_1);
-                        i2s_stop(I2S_NUM_1);
-
-                        free(temp_buf);
-                        temp_buf = NULL;
-
-                        txEvents = 0;
-
-                        audio_buf.system_i2s_playing = false;
-                    }
-                    printf("txEvents: %d\n", txEvents);
-
-                    if (audio_buf.system_i2s_stop && queued_audio_file_stoppable)
-                    {
-                        i2s_zero_dma_buffer(I2S_NUM_1);
-                        i2s_stop(I2S_NUM_1);
-
-                        free(temp_buf);
-                        temp_buf = NULL;
-
-                        txEvents = 0;
-
-                        audio_buf.system_i2s_playing = false;
-                        audio_buf.system_i2s_stop = false;
-                    }
-                }
-
-                // else if (audio_buf.hfp_i2s_playing)
-                // {
-                //     if (audio_buf.hfp_i2s_stop)
-                //     {
-                //         i2s_zero_dma_buffer(I2S_NUM_1);
-                //         i2s_stop(I2S_NUM_1);
-
-                //         audio_buf.hfp_i2s_stop = false;
-                //         audio_buf.hfp_i2s_playing = false;
-                //     }
-                // }
-            }
+            ESP_LOGE(TAG, "calibrate_dma() err: %s", esp_err_to_name(err));
+            return err;
         }
-        vTaskDelay(10 / portTICK_PERIOD_MS);
-    }
-}
-
-esp_err_t init_i2s(void)
-{
-    esp_err_t err;
-    BaseType_t task_err;
-
-    const i2s_config_t i2s_config_1 = {
-        .mode = I2S_MODE_MASTER | I2S_MODE_TX | I2S_MODE_RX,
-        .sample_rate = 16000,
-        .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
-        .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT,
-        .communication_format = I2S_COMM_FORMAT_STAND_I2S, // I2S_COMM_FORMAT_STAND_MSB <- big-endian
-        .intr_alloc_flags = ESP_INTR_FLAG_INTRDISABLED,    // ESP_INTR_FLAG_INTRDISABLED //ESP_INTR_FLAG_LEVEL1
-        .dma_buf_count = 8,                                // number of buffers
-        .dma_buf_len = 1024                                /*,    //64
-        .use_apll = false,
-        .tx_desc_auto_clear = false*/
-    };
-
-    i2s_pin_config_t pin_config = {
-        .bck_io_num = I2S_BCK_IO,
-        .ws_io_num = I2S_WS_IO,
-        .data_out_num = I2S_DO_IO,
-        .data_in_num = I2S_DI_IO};
-
-    // Configuring the I2S driver and pins.
-    // This function must be called before any I2S driver read/write operations.
-    err = i2s_driver_install(I2S_NUM_1, &i2s_config_1, 1, &i2s_event_queue);
-    if (err != ESP_OK)
-    {
-        ESP_LOGE(TAG, "i2s_driver_install() err: %s", esp_err_to_name(err));
-        return err;
-    }
-    err = i2s_set_pin(I2S_NUM_1, &pin_config);
-    if (err != ESP_OK)
-    {
-        ESP_LOGE(TAG, "i2s_set_pin() err: %s", esp_err_to_name(err));
-        return err;
-    }
-
-    err = i2s_set_clk(I2S_NUM_1, 16000, I2S_BITS_PER_SAMPLE_16BIT, I2S_CHANNEL_MONO);
-    if (err != ESP_OK)
-    {
-        ESP_LOGE(TAG, "i2s_set_pin() err: %s", esp_err_to_name(err));
-        return err;
     }
 
-    err = i2s_set_sample_rates(I2S_NUM_1, 16000);
-    if (err != ESP_OK)
-    {
-        ESP_LOGE(TAG, "i2s_set_pin() err: %s", esp_err_to_name(err));
-        return err;
-    }
+    audio_player_stats(&dma_in_use);
 
-    err = i2s_stop(I2S_NUM_1);
-    if (err != ESP_OK)
+    audio_requests = xQueueCreate(AUDIO_REQUEST_QUEUE_LEN, sizeof(audio_request_t));
+    if (audio_requests == NULL)
     {
-        ESP_LOGE(TAG, "i2s_stop() err: %s", esp_err_to_name(err));
-        return err;
+        ESP_LOGE(TAG, "xQueueCreate() failed");
+        return ESP_ERR_NO_MEM;
     }
 
-    audio_buf.system_i2s_playing = false;
-    audio_buf.system_i2s_stop = false;
-    // audio_buf.hfp_i2s_playing = false;
-    // audio_buf.hfp_i2s_stop = true;
-
-    task_err = xTaskCreatePinnedToCore(
-        i2sTask,
-        "i2sTask",
-        10000, // configMINIMAL_STACK_SIZE
-        NULL,
-        5,
-        NULL,
-        1);
+    BaseType_t task_err = xTaskCreatePinnedToCore(audio_request_task, "audio_request_task", 4096, NULL, 4, NULL, 1);
     if (task_err != pdPASS)
     {
-        ESP_LOGE(TAG, "xTaskCreatePinnedToCore(i2sTask) err: %d", task_err);
+        ESP_LOGE(TAG, "xTaskCreatePinnedToCore(audio_request_task) err: %d", task_err);
 
-        // attempt to create the home_button with xTaskCreate
-        task_err = xTaskCreate(i2sTask, "i2sTask", 20000, NULL, 10, NULL);
+        // attempt to create the audio_request_task with xTaskCreate
+        task_err = xTaskCreate(audio_request_task, "audio_request_task", 4096, NULL, 4, NULL);
         if (task_err != pdPASS)
         {
-            ESP_LOGE(TAG, "xTaskCreate(i2sTask) err: %d", task_err);
+            ESP_LOGE(TAG, "xTaskCreate(audio_request_task) err: %d", task_err);
             return ESP_FAIL;
         }
     }
@@ -0,0 +1,100 @@
+#include <string.h>
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_spi_flash.h"
+
+#include "audio_pack.h"
+
+static const char *TAG = "audio_pack.c";
+
+static const uint8_t *pack = NULL; // mapped through the flash cache, read only
+static const audio_pack_entry_t *pack_index = NULL;
+static uint16_t pack_clip_count = 0;
+static spi_flash_mmap_handle_t pack_mmap;
+
+// maps the pack on the partition so clips are played in place without a copy,
+// returns ESP_ERR_NOT_FOUND when the partition holds no pack
+esp_err_t audio_pack_open(const char *partition_label)
+{
+    esp_err_t err;
+    audio_pack_header_t header;
+
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, partition_label);
+    if (partition == NULL)
+    {
+        ESP_LOGE(TAG, "partition %s not found", partition_label);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    err = esp_partition_read(partition, 0, &header, sizeof(header));
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "esp_partition_read() err: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    if (header.magic != AUDIO_PACK_MAGIC)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    const size_t index_end = sizeof(header) + header.clip_count * sizeof(audio_pack_entry_t);
+
+    if (header.version != AUDIO_PACK_VERSION || header.pack_len > partition->size || header.pack_len < index_end)
+    {
+        ESP_LOGE(TAG, "unsupported audio pack, version %u, %u bytes", header.version, header.pack_len);
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    // only the pack is mapped, the data mmap window is shared with the app's rodata
+    const void *mapped = NULL;
+    err = esp_partition_mmap(partition, 0, header.pack_len, SPI_FLASH_MMAP_DATA, &mapped, &pack_mmap);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "esp_partition_mmap() err: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    const audio_pack_entry_t *index = (const audio_pack_entry_t *)((const uint8_t *)mapped + sizeof(header));
+
+    for (int i = 0; i < header.clip_count; i++)
+    {
+        // offset first, so the length check below cannot wrap
+        if (index[i].offset < index_end || index[i].offset > header.pack_len || index[i].len > header.pack_len - index[i].offset ||
+            memchr(index[i].name, '\0', AUDIO_PACK_NAME_LEN) == NULL)
+        {
+            ESP_LOGE(TAG, "audio pack entry %d is corrupt", i);
+            spi_flash_munmap(pack_mmap);
+            return ESP_ERR_INVALID_SIZE;
+        }
+    }
+
+    pack = mapped;
+    pack_index = index;
+    pack_clip_count = header.clip_count;
+
+    ESP_LOGI(TAG, "audio pack: %u clips, %u bytes mapped", pack_clip_count, header.pack_len);
+
+    return ESP_OK;
+}
+
+// looked up once per clip when the clip table is built, the clips keep the pointer
+esp_err_t audio_pack_find(const char *name, const uint8_t **buf, int *len)
+{
+    for (int i = 0; i < pack_clip_count; i++)
+    {
+        if (strncmp(pack_index[i].name, name, AUDIO_PACK_NAME_LEN) == 0)
+        {
+            *buf = &pack[pack_index[i].offset];
+            *len = pack_index[i].len;
+            return ESP_OK;
+        }
+    }
+
+    return ESP_ERR_NOT_FOUND;
+}
+
+int audio_pack_clip_count(void)
+{
+    return pack_clip_count;
+}
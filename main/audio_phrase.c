@@ -0,0 +1,120 @@
+#include <stddef.h>
+#include "esp_log.h"
+
+#include "audio_phrase.h"
+#include "audio_io.h"
+
+static const char *TAG = "audio_phrase.c";
+
+// recorded number words, index is the tens digit
+static const audio_clip_id_t tens_clips[10] = {
+    AUDIO_CLIP_MAX,
+    AUDIO_CLIP_10_00,
+    AUDIO_CLIP_20_00,
+    AUDIO_CLIP_30_00,
+    AUDIO_CLIP_40_00,
+    AUDIO_CLIP_50_00,
+    AUDIO_CLIP_60_00,
+    AUDIO_CLIP_70_00,
+    AUDIO_CLIP_80_00,
+    AUDIO_CLIP_90_00,
+};
+
+// number clips hold a cache reference once used so they are never evicted
+static const audio_clip_t *resident_clips[AUDIO_CLIP_MAX];
+
+static void keep_resident(audio_clip_id_t id)
+{
+    if (resident_clips[id] != NULL)
+    {
+        return;
+    }
+
+    esp_err_t err = audio_clip_acquire(id, &resident_clips[id]);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "audio_clip_acquire(%s) err: %s", audio_clip_name(id), esp_err_to_name(err));
+        resident_clips[id] = NULL;
+    }
+}
+
+static int append_clip(audio_clip_id_t id, audio_clip_id_t *clips, int count, int max_clips)
+{
+    if (count < max_clips)
+    {
+        clips[count++] = id;
+    }
+
+    return count;
+}
+
+// speaks 5 - 99 in steps of five with the recorded words, "forty" "five" for 45. there are
+// no words for zero or a hundred, values outside 5 - 99 give no clips
+int audio_phrase_number(int value, audio_clip_id_t *clips, int max_clips)
+{
+    int count = 0;
+
+    if (value < 5 || value > 99)
+    {
+        return 0;
+    }
+
+    const int tens = value / 10;
+    const int units = value % 10;
+
+    if (tens > 0)
+    {
+        count = append_clip(tens_clips[tens], clips, count, max_clips);
+    }
+
+    if (units >= 5)
+    {
+        count = append_clip(AUDIO_CLIP_ASCII_5_00, clips, count, max_clips);
+    }
+
+    return count;
+}
+
+// expands AUDIO_PHRASE_VALUE slots of the template, returns the number of clips. a value
+// that cannot be spoken leaves the whole phrase empty
+int audio_phrase_compose(const audio_clip_id_t *tmpl, int tmpl_len, int value, audio_clip_id_t *clips, int max_clips)
+{
+    int count = 0;
+
+    for (int i = 0; i < tmpl_len; i++)
+    {
+        if (tmpl[i] == AUDIO_PHRASE_VALUE)
+        {
+            const int value_count = audio_phrase_number(value, &clips[count], max_clips - count);
+            if (value_count == 0)
+            {
+                return 0;
+            }
+
+            count += value_count;
+        }
+        else
+        {
+            count = append_clip(tmpl[i], clips, count, max_clips);
+        }
+    }
+
+    return count;
+}
+
+esp_err_t audio_phrase_play(const audio_clip_id_t *tmpl, int tmpl_len, int value, bool stoppable)
+{
+    audio_clip_id_t clips[AUDIO_PHRASE_MAX_CLIPS];
+
+    const int count = audio_phrase_compose(tmpl, tmpl_len, value, clips, AUDIO_PHRASE_MAX_CLIPS);
+
+    for (int i = 0; i < count; i++)
+    {
+        if (clips[i] == AUDIO_CLIP_ASCII_5_00 || (clips[i] >= AUDIO_CLIP_10_00 && clips[i] <= AUDIO_CLIP_90_00))
+        {
+            keep_resident(clips[i]);
+        }
+    }
+
+    return audio_playlist_enqueue(clips, count, stoppable, NULL);
+}
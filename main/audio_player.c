@@ -0,0 +1,1258 @@
+#include <stdio.h>
+#include <string.h>
+#include <sys/param.h>
+#include "driver/i2s.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "freertos/event_groups.h"
+#include "freertos/ringbuf.h"
+#include "hal/cpu_hal.h"
+
+#include "audio_player.h"
+#include "audio_wav.h"
+#include "audio_dsp.h"
+#include "audio_adpcm.h"
+#include "audio_resample.h"
+#include "latency_trace.h"
+
+static const char *TAG = "audio_player.c";
+
+#define AUDIO_I2S_NUM (I2S_NUM_1)
+#define AUDIO_SEND_TIMEOUT (100 / portTICK_PERIOD_MS)
+#define AUDIO_RECEIVE_TIMEOUT (20 / portTICK_PERIOD_MS)
+#define AUDIO_MONITOR_TIMEOUT (50 / portTICK_PERIOD_MS)
+#define AUDIO_MAX_FRAME_BYTES (2 * sizeof(int16_t))
+// a whole ima-adpcm block is decoded at once
+#define AUDIO_OUT_BUF_SAMPLES (MAX(AUDIO_DMA_BUF_LEN + 1, AUDIO_ADPCM_BLOCK_SAMPLES(AUDIO_ADPCM_MAX_BLOCK)))
+// mixed clips are our own encodes, their blocks are kept small to save ram
+#define AUDIO_MIX_MAX_BLOCK (512)
+// decode budget on core 1, 10% of 240 MHz at 16 kHz
+#define AUDIO_ADPCM_CYCLE_BUDGET (1500)
+
+// player task notification bits
+#define AUDIO_CMD_START (1 << 0)
+#define AUDIO_CMD_STOP (1 << 1)
+#define AUDIO_CMD_PREEMPT (1 << 2) // stops the stream even if it is not stoppable
+
+// the main voice drops to a quarter (-12 dB) while a sound effect is mixed over it
+#define AUDIO_DUCK_GAIN_Q15 (AUDIO_GAIN_Q15_ONE / 4)
+#define AUDIO_MIX_QUEUE_LEN (2)
+
+// completed playbacks that can still be waited on, one event group bit each
+#define AUDIO_PLAYBACK_HISTORY (8)
+
+typedef enum
+{
+    AUDIO_STREAM_IDLE,
+    AUDIO_STREAM_PLAYING,
+    AUDIO_STREAM_STOPPED, // discarding until the producer ends the stream
+} audio_stream_state_t;
+
+// an in-memory clip played as a second voice over the current stream
+typedef struct
+{
+    const audio_clip_t *clip; // released by the player task when the voice ends
+    const uint8_t *data;
+    uint32_t remaining;
+    bool adpcm;
+    int block_align;
+} audio_mix_voice_t;
+
+static RingbufHandle_t audio_ringbuf = NULL;
+static QueueHandle_t clip_boundaries = NULL; // stream offsets where a new wav file starts
+static QueueHandle_t mix_requests = NULL;
+static SemaphoreHandle_t player_idle = NULL;
+static TaskHandle_t player_task_handle = NULL;
+static EventGroupHandle_t playback_done = NULL;
+
+static volatile audio_stream_state_t stream_state = AUDIO_STREAM_IDLE;
+static volatile bool stream_ended = false;
+static volatile int32_t stream_gain_q15 = AUDIO_GAIN_Q15_ONE;
+static bool stream_stoppable = false;
+static volatile audio_priority_t stream_priority = AUDIO_PRIORITY_ANSWER;
+static uint32_t producer_offset = 0;
+
+static audio_playback_info_t playback_history[AUDIO_PLAYBACK_HISTORY];
+static audio_playback_info_t *current_playback = NULL;
+static uint32_t next_playback_id = 1;
+
+static int dma_buf_count = AUDIO_DMA_BUF_COUNT;
+static int dma_buf_len = AUDIO_DMA_BUF_LEN;
+
+// dma accounting. like the driver's own queue, a buffer the DMA sends is handed back to
+// i2s_write() and the queue holds dma_buf_count - 1 of them, when a buffer is handed back
+// to a full queue the oldest one drops out and is sent again as it is. samples written by
+// the player against buffers reported sent by the TX_DONE events, each counter has a single
+// writer task
+static QueueHandle_t i2s_events = NULL; // the monitor receives and counts under dma_lock
+static SemaphoreHandle_t dma_lock = NULL;
+static volatile bool dma_swapping = false; // audio_player_set_dma() is waiting for dma_lock
+static volatile uint32_t dma_written = 0;  // player
+static volatile uint32_t dma_sent = 0;     // monitor
+static volatile uint32_t dma_dropped = 0;  // monitor, sent again without being written
+static volatile uint32_t dma_generation = 0;
+static int dma_fill = 0; // player, samples in the DMA buffer i2s_write() is filling, kept across i2s_stop()
+static audio_player_stats_t stats;
+
+// the bus is shared with audio_capture.c, the player only stops it while nothing records.
+// i2s_running and bus_capturing are changed under bus_lock
+static SemaphoreHandle_t bus_lock = NULL;
+static bool bus_started = false;
+static bool bus_capturing = false;
+
+// owned by the player task while a stream is playing
+static bool i2s_running = false;
+static bool starved = false;
+static bool fading_out = false; // stopped, the next block is faded to silence before i2s stops
+static uint32_t stream_offset = 0;
+static audio_wav_parser_t wav_parser;
+static uint32_t data_remaining = 0;
+static int stream_channels = 1;
+static int frame_bytes = sizeof(int16_t);
+static uint8_t frame_carry[AUDIO_MAX_FRAME_BYTES]; // frame split across ring buffer items
+static int frame_carry_len = 0;
+static audio_gain_t stream_gain;
+
+// ima-adpcm blocks are decoded whole, bytes are gathered here until one is complete
+static bool stream_adpcm = false;
+static int adpcm_block_align = 0;
+static uint8_t adpcm_block[AUDIO_ADPCM_MAX_BLOCK];
+static int adpcm_block_len = 0;
+static uint32_t adpcm_decode_cycles = 0;
+static uint32_t adpcm_decoded_samples = 0;
+
+// the mixed voice, decoded a block at a time when it is ima-adpcm
+static audio_mix_voice_t mix_voice;
+static audio_gain_t mix_gain;
+static int16_t mix_block[AUDIO_ADPCM_BLOCK_SAMPLES(AUDIO_MIX_MAX_BLOCK)];
+static int mix_block_samples = 0;
+static int mix_block_pos = 0;
+static int16_t mix_buf[AUDIO_DMA_BUF_LEN + 1] __attribute__((aligned(4)));
+
+// scaled samples for one ring buffer item plus a frame split across items, or one
+// decoded ima-adpcm block. word aligned for the gain kernel
+static int16_t out_buf[AUDIO_OUT_BUF_SAMPLES] __attribute__((aligned(4)));
+// clips that are not at the i2s rate are converted on the way out
+static audio_resampler_t resampler;
+static int16_t resample_buf[AUDIO_RESAMPLE_MAX_OUT(AUDIO_SAMPLE_RATE)] __attribute__((aligned(4)));
+
+// bytes read from a source before they are sent to the ring buffer
+static uint8_t source_block[AUDIO_BLOCK_BYTES];
+
+static int source_memory_read(void *ctx, uint8_t *buf, int len)
+{
+    audio_mem_source_t *mem = ctx;
+    const int n = MIN(len, mem->len - mem->pos);
+
+    memcpy(buf, &mem->buf[mem->pos], n);
+    mem->pos += n;
+
+    return n;
+}
+
+void audio_source_memory(audio_source_t *source, audio_mem_source_t *mem, const void *buf, int len)
+{
+    mem->buf = buf;
+    mem->len = len;
+    mem->pos = 0;
+
+    source->read = source_memory_read;
+    source->close = NULL;
+    source->ctx = mem;
+}
+
+static int source_file_read(void *ctx, uint8_t *buf, int len)
+{
+    FILE *f = ctx;
+    const size_t n = fread(buf, sizeof(uint8_t), len, f);
+
+    if (n == 0 && ferror(f))
+    {
+        return -1;
+    }
+
+    return n;
+}
+
+static void source_file_close(void *ctx)
+{
+    fclose(ctx);
+}
+
+esp_err_t audio_source_file(audio_source_t *source, const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to open %s for reading", path);
+        return ESP_FAIL;
+    }
+
+    source->read = source_file_read;
+    source->close = source_file_close;
+    source->ctx = f;
+
+    return ESP_OK;
+}
+
+static esp_err_t apply_format(const audio_wav_format_t *fmt)
+{
+    esp_err_t err;
+
+    ESP_LOGI(TAG, "wav format %u, %u Hz, %u ch, %u bit", fmt->format, fmt->sample_rate, fmt->channels, fmt->bits_per_sample);
+
+    const bool pcm = fmt->format == AUDIO_WAV_FORMAT_PCM && fmt->bits_per_sample == 16 &&
+                     fmt->channels >= 1 && fmt->channels <= 2;
+    const bool adpcm = fmt->format == AUDIO_WAV_FORMAT_IMA_ADPCM && fmt->bits_per_sample == 4 && fmt->channels == 1 &&
+                       fmt->block_align > AUDIO_ADPCM_BLOCK_HEADER && fmt->block_align <= AUDIO_ADPCM_MAX_BLOCK;
+
+    if (!pcm && !adpcm)
+    {
+        ESP_LOGE(TAG, "unsupported wav format");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    // the bus stays at AUDIO_SAMPLE_RATE, a clip at another rate is resampled
+    err = audio_resampler_init(&resampler, fmt->sample_rate, AUDIO_SAMPLE_RATE);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "audio_resampler_init(%u Hz) err: %s", fmt->sample_rate, esp_err_to_name(err));
+        return err;
+    }
+
+    stream_adpcm = adpcm;
+    adpcm_block_align = fmt->block_align;
+    stream_channels = fmt->channels;
+    frame_bytes = fmt->channels * sizeof(int16_t);
+
+    // streamed files may not know their length up front
+    data_remaining = (fmt->data_len == 0 || fmt->data_len == UINT32_MAX) ? UINT32_MAX : fmt->data_len;
+
+    return ESP_OK;
+}
+
+static int16_t frame_sample(const uint8_t *frame)
+{
+    // ring buffer items are byte aligned, build the little-endian samples bytewise
+    const int16_t left = (int16_t)(frame[1] << 8 | frame[0]);
+    if (stream_channels == 1)
+    {
+        return left;
+    }
+
+    const int16_t right = (int16_t)(frame[3] << 8 | frame[2]);
+    return (left + right) / 2;
+}
+
+// converts PCM bytes to mono samples, returns the number of samples
+static int decode_pcm(const uint8_t *data, size_t len, int16_t *out)
+{
+    int samples = 0;
+    size_t i = 0;
+
+    while (frame_carry_len > 0 && i < len)
+    {
+        frame_carry[frame_carry_len++] = data[i++];
+        if (frame_carry_len == frame_bytes)
+        {
+            out[samples++] = frame_sample(frame_carry);
+            frame_carry_len = 0;
+        }
+    }
+
+    for (; i + frame_bytes <= len; i += frame_bytes)
+    {
+        out[samples++] = frame_sample(&data[i]);
+    }
+
+    while (i < len)
+    {
+        frame_carry[frame_carry_len++] = data[i++];
+    }
+
+    return samples;
+}
+
+static void reset_clip(void)
+{
+    audio_wav_parser_init(&wav_parser);
+    data_remaining = 0;
+    frame_carry_len = 0;
+    adpcm_block_len = 0;
+}
+
+static void end_mix_voice(void)
+{
+    audio_clip_release(mix_voice.clip);
+    mix_voice.clip = NULL;
+}
+
+static void start_mix_voice(const audio_mix_voice_t *voice)
+{
+    if (stream_state != AUDIO_STREAM_PLAYING)
+    {
+        // the stream ended while the request was queued
+        audio_clip_release(voice->clip);
+        return;
+    }
+
+    if (mix_voice.clip != NULL)
+    {
+        end_mix_voice();
+    }
+
+    mix_voice = *voice;
+    mix_block_samples = 0;
+    mix_block_pos = 0;
+    audio_gain_init(&mix_gain, stream_gain_q15);
+}
+
+// decodes up to len samples of the mixed voice, returns fewer once it has ended
+static int mix_voice_read(int16_t *out, int len)
+{
+    int n = 0;
+
+    while (n < len && mix_voice.clip != NULL)
+    {
+        if (!mix_voice.adpcm)
+        {
+            if (mix_voice.remaining < sizeof(int16_t))
+            {
+                end_mix_voice();
+                break;
+            }
+
+            out[n++] = (int16_t)(mix_voice.data[1] << 8 | mix_voice.data[0]);
+            mix_voice.data += sizeof(int16_t);
+            mix_voice.remaining -= sizeof(int16_t);
+            continue;
+        }
+
+        if (mix_block_pos == mix_block_samples)
+        {
+            if (mix_voice.remaining == 0)
+            {
+                end_mix_voice();
+                break;
+            }
+
+            const uint32_t block_len = MIN(mix_voice.remaining, (uint32_t)mix_voice.block_align);
+            mix_block_samples = audio_adpcm_decode_block(mix_voice.data, block_len, mix_block);
+            mix_block_pos = 0;
+            mix_voice.data += block_len;
+            mix_voice.remaining -= block_len;
+            continue;
+        }
+
+        const int m = MIN(len - n, mix_block_samples - mix_block_pos);
+        memcpy(&out[n], &mix_block[mix_block_pos], m * sizeof(int16_t));
+        mix_block_pos += m;
+        n += m;
+    }
+
+    return n;
+}
+
+// scales, mixes and queues samples at the i2s rate
+static void output_samples(int16_t *buf, int samples)
+{
+    if (samples == 0)
+    {
+        return;
+    }
+
+    // picks up audio_player_set_volume() calls made mid-stream, ducked under a mixed voice
+    const bool mixing = mix_voice.clip != NULL;
+    if (!fading_out)
+    {
+        audio_gain_set(&stream_gain, mixing ? (stream_gain_q15 * AUDIO_DUCK_GAIN_Q15) >> 15 : stream_gain_q15);
+    }
+    audio_gain_apply(&stream_gain, buf, samples);
+
+    // an ima-adpcm block can be longer than mix_buf
+    for (int pos = 0; mixing && pos < samples && mix_voice.clip != NULL; pos += AUDIO_DMA_BUF_LEN)
+    {
+        const int mixed = mix_voice_read(mix_buf, MIN(samples - pos, AUDIO_DMA_BUF_LEN));
+        audio_gain_apply(&mix_gain, mix_buf, mixed);
+        audio_mix(&buf[pos], mix_buf, mixed);
+    }
+
+    if (!i2s_running)
+    {
+        dma_generation++;
+
+        xSemaphoreTake(bus_lock, portMAX_DELAY);
+        if (!bus_started)
+        {
+            i2s_start(AUDIO_I2S_NUM);
+            bus_started = true;
+        }
+        i2s_running = true;
+        xSemaphoreGive(bus_lock);
+
+        current_playback->started_us = esp_timer_get_time();
+        latency_trace_mark(LATENCY_STAGE_FIRST_SAMPLE);
+        ESP_LOGI(TAG, "first block queued after %lld us", current_playback->started_us - current_playback->queued_us);
+    }
+
+    // up to the end of one dma buffer at a time, i2s_write() only blocks before it starts
+    // the next one, so the monitor sees every buffer counted as soon as it is filled
+    for (int pos = 0; pos < samples;)
+    {
+        size_t bytes_written = 0;
+        const int n = MIN(samples - pos, dma_buf_len - dma_fill);
+        i2s_write(AUDIO_I2S_NUM, &buf[pos], n * sizeof(int16_t), &bytes_written, portMAX_DELAY);
+
+        const int written = bytes_written / sizeof(int16_t);
+        dma_written += written;
+        dma_fill = (dma_fill + written) % dma_buf_len;
+        stats.played_us += (uint64_t)written * 1000000 / AUDIO_SAMPLE_RATE;
+        pos += written;
+    }
+}
+
+// plays the decoded samples in out_buf, converting clips at other rates a chunk at a time
+static void play_samples(int samples)
+{
+    if (!audio_resampler_active(&resampler))
+    {
+        output_samples(out_buf, samples);
+        return;
+    }
+
+    for (int pos = 0; pos < samples; pos += AUDIO_RESAMPLE_CHUNK)
+    {
+        const int n = audio_resample(&resampler, &out_buf[pos], MIN(samples - pos, AUDIO_RESAMPLE_CHUNK), resample_buf);
+        output_samples(resample_buf, n);
+    }
+}
+
+// decodes the gathered ima-adpcm block, playing what is already in out_buf first since a
+// block holds up to a full DMA buffer of samples
+static void decode_adpcm_block(int *samples)
+{
+    play_samples(*samples);
+
+    const uint32_t start = cpu_hal_get_cycle_count();
+    *samples = audio_adpcm_decode_block(adpcm_block, adpcm_block_len, out_buf);
+    adpcm_decode_cycles += cpu_hal_get_cycle_count() - start;
+    adpcm_decoded_samples += *samples;
+
+    adpcm_block_len = 0;
+}
+
+static void decode_adpcm(const uint8_t *data, size_t len, int *samples)
+{
+    while (len > 0)
+    {
+        const size_t n = MIN(len, (size_t)(adpcm_block_align - adpcm_block_len));
+
+        memcpy(&adpcm_block[adpcm_block_len], data, n);
+        adpcm_block_len += n;
+        data += n;
+        len -= n;
+
+        // the last block of a file may be short, see end_clip() when its length is unknown
+        if (adpcm_block_len == adpcm_block_align || (len == 0 && data_remaining == 0))
+        {
+            decode_adpcm_block(samples);
+        }
+    }
+}
+
+// the source of the clip has ended. a streamed answer's length is unknown, its short last
+// block is only known to be the last one now
+static void end_clip(int *samples)
+{
+    if (stream_adpcm && adpcm_block_len > 0)
+    {
+        decode_adpcm_block(samples);
+    }
+}
+
+// parses and decodes bytes that belong to a single wav file, appending to out_buf
+static esp_err_t process_clip_bytes(const uint8_t *data, size_t len, int *samples)
+{
+    if (wav_parser.state != AUDIO_WAV_STATE_DATA)
+    {
+        size_t consumed = 0;
+
+        esp_err_t err = audio_wav_parse(&wav_parser, data, len, &consumed);
+        if (err == ESP_OK && wav_parser.state == AUDIO_WAV_STATE_DATA)
+        {
+            // the previous clip of a playlist may have used another rate or encoding,
+            // and a pcm item appended to a decoded block would overrun out_buf
+            play_samples(*samples);
+            *samples = 0;
+
+            err = apply_format(&wav_parser.fmt);
+        }
+
+        if (err != ESP_OK)
+        {
+            return err;
+        }
+
+        data += consumed;
+        len -= consumed;
+    }
+
+    // trailing chunks after the data chunk are not audio
+    len = MIN(len, data_remaining);
+    data_remaining -= len;
+
+    if (stream_adpcm)
+    {
+        decode_adpcm(data, len, samples);
+    }
+    else
+    {
+        *samples += decode_pcm(data, len, &out_buf[*samples]);
+    }
+
+    return ESP_OK;
+}
+
+static void signal_playback_done(void)
+{
+    if (current_playback->finished_us == 0)
+    {
+        current_playback->finished_us = esp_timer_get_time();
+    }
+
+    xEventGroupSetBits(playback_done, 1 << (current_playback->id % AUDIO_PLAYBACK_HISTORY));
+}
+
+static void drain_output(void)
+{
+    if (i2s_running)
+    {
+        // the last block has only been queued, push it out of the DMA buffers with silence.
+        // the driver keeps its write position across i2s_stop(), so the part filled buffer
+        // is completed first, or the next stream would begin in a buffer sent long before
+        // the rest of its first block
+        size_t bytes_written = 0;
+        memset(out_buf, 0, sizeof(out_buf));
+        if (dma_fill > 0)
+        {
+            i2s_write(AUDIO_I2S_NUM, out_buf, (dma_buf_len - dma_fill) * sizeof(int16_t), &bytes_written, portMAX_DELAY);
+            dma_written += bytes_written / sizeof(int16_t);
+            dma_fill = 0;
+        }
+        for (int i = 0; i < dma_buf_count; i++)
+        {
+            i2s_write(AUDIO_I2S_NUM, out_buf, dma_buf_len * sizeof(int16_t), &bytes_written, portMAX_DELAY);
+            dma_written += bytes_written / sizeof(int16_t);
+        }
+
+        // stopping the bus would stop a recording too, the zeroed DMA buffers then keep
+        // the speaker silent until the recording ends
+        xSemaphoreTake(bus_lock, portMAX_DELAY);
+        if (!bus_capturing)
+        {
+            i2s_zero_dma_buffer(AUDIO_I2S_NUM);
+            i2s_stop(AUDIO_I2S_NUM);
+            bus_started = false;
+        }
+        i2s_running = false;
+        xSemaphoreGive(bus_lock);
+    }
+
+    fading_out = false;
+
+    if (mix_voice.clip != NULL)
+    {
+        end_mix_voice();
+    }
+}
+
+// the stream is cut off by fading the next block out rather than zeroing the DMA
+// buffers mid-waveform, waiters are signalled once the fade has been heard
+static void stop_stream(bool fade)
+{
+    stream_state = AUDIO_STREAM_STOPPED;
+    current_playback->stopped = true;
+
+    if (fade && i2s_running)
+    {
+        fading_out = true;
+        audio_gain_ramp(&stream_gain, 0, AUDIO_FADE_OUT_SAMPLES);
+        audio_gain_ramp(&mix_gain, 0, AUDIO_FADE_OUT_SAMPLES);
+        return;
+    }
+
+    drain_output();
+    signal_playback_done();
+}
+
+static void end_fade_out(void)
+{
+    drain_output();
+    signal_playback_done();
+}
+
+static void finish_stream(void)
+{
+    if (stream_state == AUDIO_STREAM_PLAYING)
+    {
+        int samples = 0;
+        end_clip(&samples);
+        play_samples(samples);
+    }
+
+    drain_output();
+
+    ESP_LOGI(TAG, "totals: %u underruns, %u dma underruns, %u late refills, %u us worst dma event jitter",
+             stats.underruns, stats.dma_underruns, stats.late_refills, stats.max_event_jitter_us);
+
+    if (adpcm_decoded_samples > 0)
+    {
+        const uint32_t cycles_per_sample = adpcm_decode_cycles / adpcm_decoded_samples;
+        if (cycles_per_sample > AUDIO_ADPCM_CYCLE_BUDGET)
+        {
+            ESP_LOGW(TAG, "adpcm decode %u cycles/sample, over the %d budget", cycles_per_sample, AUDIO_ADPCM_CYCLE_BUDGET);
+        }
+        else
+        {
+            ESP_LOGI(TAG, "adpcm decode %u cycles/sample", cycles_per_sample);
+        }
+        adpcm_decode_cycles = 0;
+        adpcm_decoded_samples = 0;
+    }
+
+    // requests that arrived as the stream ended would otherwise play over the next one
+    audio_mix_voice_t voice;
+    while (xQueueReceive(mix_requests, &voice, 0) == pdTRUE)
+    {
+        audio_clip_release(voice.clip);
+    }
+
+    starved = false;
+    stream_state = AUDIO_STREAM_IDLE;
+
+    signal_playback_done();
+
+    xSemaphoreGive(player_idle);
+}
+
+// timestamps the driver's TX_DONE events as they arrive and counts the buffers handed back
+// that the player has not written again
+static void count_dma_event(void)
+{
+    const int64_t now = esp_timer_get_time();
+    static int64_t last_tx_done = 0;
+    static uint32_t generation = 0;
+
+    dma_sent += dma_buf_len;
+
+    // handed back and not written again, one i2s_write() has started on has left the queue
+    const int handed_back = (int32_t)(dma_sent - dma_dropped - dma_written) / dma_buf_len;
+    const bool dropped = handed_back > dma_buf_count - 1;
+    if (dropped)
+    {
+        dma_dropped += (handed_back - (dma_buf_count - 1)) * dma_buf_len;
+    }
+
+    if (!i2s_running)
+    {
+        return;
+    }
+
+    if (generation != dma_generation)
+    {
+        // the first event of a stream has no previous one to measure against
+        generation = dma_generation;
+        last_tx_done = now;
+        return;
+    }
+
+    const int64_t period_us = (int64_t)dma_buf_len * 1000000 / AUDIO_SAMPLE_RATE;
+    const int64_t jitter_us = now - last_tx_done - period_us;
+    if (jitter_us > (int64_t)stats.max_event_jitter_us)
+    {
+        stats.max_event_jitter_us = jitter_us;
+    }
+    last_tx_done = now;
+
+    if (dropped)
+    {
+        // the buffer the DMA has moved on to is stale
+        stats.dma_underruns++;
+    }
+    else if (handed_back == dma_buf_count - 1)
+    {
+        // only that one was written
+        stats.late_refills++;
+    }
+}
+
+static void audio_dma_monitor_task(void *pvParameters)
+{
+    i2s_event_t event;
+
+    while (true)
+    {
+        // the queue goes away while audio_player_set_dma() reinstalls the driver
+        if (dma_swapping)
+        {
+            vTaskDelay(1);
+            continue;
+        }
+
+        xSemaphoreTake(dma_lock, portMAX_DELAY);
+        if (i2s_events != NULL && xQueueReceive(i2s_events, &event, AUDIO_MONITOR_TIMEOUT) == pdTRUE &&
+            event.type == I2S_EVENT_TX_DONE)
+        {
+            count_dma_event();
+        }
+        xSemaphoreGive(dma_lock);
+    }
+}
+
+static void audio_player_task(void *pvParameters)
+{
+    uint32_t cmd;
+
+    while (true)
+    {
+        // commands from audio_player_begin() and audio_player_stop(), only block while idle
+        cmd = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &cmd, stream_state == AUDIO_STREAM_IDLE ? portMAX_DELAY : 0);
+
+        if (stream_state == AUDIO_STREAM_IDLE)
+        {
+            continue;
+        }
+
+        if ((cmd & AUDIO_CMD_STOP) && stream_state == AUDIO_STREAM_PLAYING && stream_stoppable)
+        {
+            ESP_LOGI(TAG, "playback stopped");
+            stop_stream(true);
+        }
+
+        if ((cmd & AUDIO_CMD_PREEMPT) && stream_state == AUDIO_STREAM_PLAYING)
+        {
+            ESP_LOGI(TAG, "playback preempted");
+            stop_stream(true);
+        }
+
+        audio_mix_voice_t voice;
+        while (xQueueReceive(mix_requests, &voice, 0) == pdTRUE)
+        {
+            start_mix_voice(&voice);
+        }
+
+        // read before receiving, the producer can queue its last item and end the stream
+        // while the receive times out, that item would start the next stream
+        const bool ended = stream_ended;
+
+        size_t item_len = 0;
+        uint8_t *item = xRingbufferReceiveUpTo(audio_ringbuf, &item_len, AUDIO_RECEIVE_TIMEOUT, AUDIO_BLOCK_BYTES);
+
+        if (item == NULL)
+        {
+            if (ended)
+            {
+                finish_stream();
+            }
+            else if (fading_out)
+            {
+                // nothing left to fade, the queued audio ends where it is
+                end_fade_out();
+            }
+            else if (i2s_running && !starved)
+            {
+                // the producer could not keep up, the DMA buffers are draining
+                stats.underruns++;
+                starved = true;
+            }
+            continue;
+        }
+
+        starved = false;
+
+        if (stream_state != AUDIO_STREAM_PLAYING && !fading_out)
+        {
+            vRingbufferReturnItem(audio_ringbuf, item);
+            continue;
+        }
+
+        esp_err_t err = ESP_OK;
+        int samples = 0;
+        size_t pos = 0;
+
+        // split the item where the next playlist clip starts
+        while (pos < item_len && err == ESP_OK)
+        {
+            size_t seg_len = item_len - pos;
+            uint32_t boundary;
+
+            if (xQueuePeek(clip_boundaries, &boundary, 0) == pdTRUE)
+            {
+                if (boundary <= stream_offset + pos)
+                {
+                    xQueueReceive(clip_boundaries, &boundary, 0);
+                    end_clip(&samples);
+                    reset_clip();
+                    continue;
+                }
+
+                seg_len = MIN(seg_len, boundary - (stream_offset + pos));
+            }
+
+            err = process_clip_bytes(&item[pos], seg_len, &samples);
+            pos += seg_len;
+        }
+
+        stream_offset += item_len;
+        vRingbufferReturnItem(audio_ringbuf, item);
+
+        if (err != ESP_OK)
+        {
+            // never play a header or an unknown encoding as PCM
+            if (fading_out)
+            {
+                end_fade_out();
+            }
+            else
+            {
+                stop_stream(false);
+            }
+            continue;
+        }
+
+        play_samples(samples);
+
+        if (fading_out && stream_gain.gain == 0)
+        {
+            end_fade_out();
+        }
+    }
+}
+
+// starts a stream, handle (optional) can be passed to audio_player_wait(). a playing
+// stream of lower priority is cut off, otherwise this waits for it to complete
+esp_err_t audio_player_begin(float volume, bool stoppable, audio_priority_t priority, audio_playback_handle_t *handle)
+{
+    const int64_t requested = esp_timer_get_time();
+
+    if (stream_state == AUDIO_STREAM_PLAYING && priority > stream_priority)
+    {
+        xTaskNotify(player_task_handle, AUDIO_CMD_PREEMPT, eSetBits);
+    }
+
+    // wait until the previous stream has completed
+    xSemaphoreTake(player_idle, portMAX_DELAY);
+
+    const uint32_t id = next_playback_id++;
+
+    current_playback = &playback_history[id % AUDIO_PLAYBACK_HISTORY];
+    memset(current_playback, 0, sizeof(*current_playback));
+    current_playback->id = id;
+    current_playback->queued_us = requested;
+    xEventGroupClearBits(playback_done, 1 << (id % AUDIO_PLAYBACK_HISTORY));
+
+    if (handle != NULL)
+    {
+        *handle = id;
+    }
+    stream_gain_q15 = audio_gain_from_volume(volume);
+
+    // fade in from silence so the first sample does not click
+    audio_gain_init(&stream_gain, 0);
+    audio_gain_ramp(&stream_gain, stream_gain_q15, AUDIO_FADE_IN_SAMPLES);
+    stream_stoppable = stoppable;
+    stream_priority = priority;
+    stream_ended = false;
+
+    producer_offset = 0;
+    stream_offset = 0;
+    xQueueReset(clip_boundaries);
+    reset_clip();
+
+    stream_state = AUDIO_STREAM_PLAYING;
+    xTaskNotify(player_task_handle, AUDIO_CMD_START, eSetBits);
+
+    return ESP_OK;
+}
+
+// blocks while the ring buffer is full, returns -1 once the stream has been stopped
+int audio_player_write(const void *data, int len)
+{
+    const uint8_t *bytes = data;
+    int written = 0;
+
+    while (written < len)
+    {
+        if (stream_state != AUDIO_STREAM_PLAYING)
+        {
+            return -1;
+        }
+
+        const int n = MIN(AUDIO_BLOCK_BYTES, len - written);
+        if (xRingbufferSend(audio_ringbuf, &bytes[written], n, AUDIO_SEND_TIMEOUT) == pdTRUE)
+        {
+            written += n;
+        }
+    }
+
+    producer_offset += written;
+
+    return written;
+}
+
+// the next bytes written start a new wav file, used to play several clips as one stream
+void audio_player_next_clip(void)
+{
+    xQueueSend(clip_boundaries, &producer_offset, portMAX_DELAY);
+}
+
+// copies a source into the current stream. returns ESP_ERR_INVALID_STATE once the
+// stream has been stopped and ESP_FAIL on a read error
+esp_err_t audio_player_write_source(audio_source_t *source)
+{
+    while (true)
+    {
+        const int n = source->read(source->ctx, source_block, sizeof(source_block));
+        if (n < 0)
+        {
+            ESP_LOGE(TAG, "audio source read error");
+            return ESP_FAIL;
+        }
+
+        if (n == 0)
+        {
+            return ESP_OK;
+        }
+
+        if (audio_player_write(source_block, n) < 0)
+        {
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+}
+
+void audio_player_end(void)
+{
+    stream_ended = true;
+}
+
+esp_err_t audio_player_play(audio_source_t *source, float volume, bool stoppable, audio_priority_t priority)
+{
+    esp_err_t err = audio_player_begin(volume, stoppable, priority, NULL);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    err = audio_player_write_source(source);
+
+    audio_player_end();
+
+    if (source->close != NULL)
+    {
+        source->close(source->ctx);
+    }
+
+    // being stopped is not an error for the caller
+    return err == ESP_ERR_INVALID_STATE ? ESP_OK : err;
+}
+
+// plays a mono wav clip over the current stream, ducking it until the clip ends. takes
+// over the clip reference on success. returns ESP_ERR_INVALID_STATE while idle and
+// ESP_ERR_NOT_SUPPORTED when the clip does not match the stream, the caller then plays
+// the clip as a stream of its own
+esp_err_t audio_player_mix_clip(const audio_clip_t *clip)
+{
+    if (clip == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (stream_state != AUDIO_STREAM_PLAYING)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    audio_wav_parser_t parser;
+    size_t consumed = 0;
+
+    audio_wav_parser_init(&parser);
+    esp_err_t err = audio_wav_parse(&parser, clip->buf, clip->len, &consumed);
+    if (err != ESP_OK || parser.state != AUDIO_WAV_STATE_DATA)
+    {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    const audio_wav_format_t *fmt = &parser.fmt;
+    const bool pcm = fmt->format == AUDIO_WAV_FORMAT_PCM && fmt->bits_per_sample == 16;
+    const bool adpcm = fmt->format == AUDIO_WAV_FORMAT_IMA_ADPCM && fmt->bits_per_sample == 4 &&
+                       fmt->block_align > AUDIO_ADPCM_BLOCK_HEADER && fmt->block_align <= AUDIO_MIX_MAX_BLOCK;
+
+    if ((!pcm && !adpcm) || fmt->channels != 1 || fmt->sample_rate != AUDIO_SAMPLE_RATE)
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    const audio_mix_voice_t voice = {
+        .clip = clip,
+        .data = &clip->buf[consumed],
+        .remaining = MIN(fmt->data_len, (uint32_t)(clip->len - consumed)),
+        .adpcm = adpcm,
+        .block_align = fmt->block_align,
+    };
+
+    if (xQueueSend(mix_requests, &voice, 0) != pdTRUE)
+    {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    return ESP_OK;
+}
+
+// stops a stoppable stream, safe to call from any task and a no-op while idle
+void audio_player_stop(void)
+{
+    if (stream_state == AUDIO_STREAM_PLAYING)
+    {
+        xTaskNotify(player_task_handle, AUDIO_CMD_STOP, eSetBits);
+    }
+}
+
+bool audio_player_is_playing(void)
+{
+    return stream_state == AUDIO_STREAM_PLAYING;
+}
+
+// handle of the playing stream for audio_player_wait(), 0 while idle
+audio_playback_handle_t audio_player_current(void)
+{
+    const audio_playback_info_t *playback = current_playback;
+
+    return stream_state != AUDIO_STREAM_IDLE && playback != NULL ? playback->id : 0;
+}
+
+// starts the shared bus for a recording, the player leaves it running until
+// audio_player_capture_end()
+esp_err_t audio_player_capture_begin(void)
+{
+    esp_err_t err = ESP_OK;
+
+    xSemaphoreTake(bus_lock, portMAX_DELAY);
+
+    if (!bus_started)
+    {
+        err = i2s_start(AUDIO_I2S_NUM);
+        bus_started = err == ESP_OK;
+    }
+    bus_capturing = bus_started;
+
+    xSemaphoreGive(bus_lock);
+
+    return err;
+}
+
+// stops the bus unless a stream is still playing on it
+void audio_player_capture_end(void)
+{
+    xSemaphoreTake(bus_lock, portMAX_DELAY);
+
+    bus_capturing = false;
+    if (bus_started && !i2s_running)
+    {
+        i2s_zero_dma_buffer(AUDIO_I2S_NUM);
+        i2s_stop(AUDIO_I2S_NUM);
+        bus_started = false;
+    }
+
+    xSemaphoreGive(bus_lock);
+}
+
+// blocks until the playback has finished or was stopped
+esp_err_t audio_player_wait(audio_playback_handle_t handle, TickType_t timeout)
+{
+    if (handle == 0 || handle >= next_playback_id)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // streams play one at a time, so a playback that has left the history is long done
+    if (playback_history[handle % AUDIO_PLAYBACK_HISTORY].id != handle)
+    {
+        return ESP_OK;
+    }
+
+    const EventBits_t bit = 1 << (handle % AUDIO_PLAYBACK_HISTORY);
+    const EventBits_t bits = xEventGroupWaitBits(playback_done, bit, pdFALSE, pdTRUE, timeout);
+
+    return (bits & bit) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t audio_player_info(audio_playback_handle_t handle, audio_playback_info_t *info)
+{
+    const audio_playback_info_t *entry = &playback_history[handle % AUDIO_PLAYBACK_HISTORY];
+
+    if (handle == 0 || entry->id != handle)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    *info = *entry;
+
+    return ESP_OK;
+}
+
+// ramps the playing stream to the new volume
+void audio_player_set_volume(float volume)
+{
+    stream_gain_q15 = audio_gain_from_volume(volume);
+}
+
+void audio_player_stats(audio_player_stats_t *out)
+{
+    *out = stats;
+    out->dma_buf_count = dma_buf_count;
+    out->dma_buf_len = dma_buf_len;
+}
+
+// takes the dma configuration and event queue of a reinstalled driver, for the calibration
+// in init_i2s(). events NULL lets go of the old queue before the driver is uninstalled.
+// only while nothing plays or records
+esp_err_t audio_player_set_dma(int buf_count, int buf_len, QueueHandle_t events)
+{
+    if (events != NULL && (buf_count < 2 || buf_len > AUDIO_DMA_BUF_LEN))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (stream_state != AUDIO_STREAM_IDLE || bus_started)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    dma_swapping = true;
+    xSemaphoreTake(dma_lock, portMAX_DELAY);
+
+    if (events != NULL)
+    {
+        dma_buf_count = buf_count;
+        dma_buf_len = buf_len;
+        dma_fill = 0;
+    }
+    i2s_events = events;
+    // the new driver starts with nothing handed back
+    dma_dropped = dma_sent - dma_written;
+
+    xSemaphoreGive(dma_lock);
+    dma_swapping = false;
+
+    return ESP_OK;
+}
+
+// the dma configuration and event queue come from the driver install in init_i2s()
+esp_err_t init_audio_player(int buf_count, int buf_len, QueueHandle_t events)
+{
+    BaseType_t task_err;
+
+    if (events == NULL || buf_count < 2 || buf_len > AUDIO_DMA_BUF_LEN)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    dma_buf_count = buf_count;
+    dma_buf_len = buf_len;
+    dma_fill = 0;
+    i2s_events = events;
+
+    audio_ringbuf = xRingbufferCreate(AUDIO_RINGBUF_SIZE, RINGBUF_TYPE_BYTEBUF);
+    if (audio_ringbuf == NULL)
+    {
+        ESP_LOGE(TAG, "xRingbufferCreate() failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    clip_boundaries = xQueueCreate(AUDIO_PLAYLIST_MAX, sizeof(uint32_t));
+    if (clip_boundaries == NULL)
+    {
+        ESP_LOGE(TAG, "xQueueCreate() failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    mix_requests = xQueueCreate(AUDIO_MIX_QUEUE_LEN, sizeof(audio_mix_voice_t));
+    if (mix_requests == NULL)
+    {
+        ESP_LOGE(TAG, "xQueueCreate() failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    playback_done = xEventGroupCreate();
+    if (playback_done == NULL)
+    {
+        ESP_LOGE(TAG, "xEventGroupCreate() failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    bus_lock = xSemaphoreCreateMutex();
+    if (bus_lock == NULL)
+    {
+        ESP_LOGE(TAG, "xSemaphoreCreateMutex() failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    dma_lock = xSemaphoreCreateMutex();
+    if (dma_lock == NULL)
+    {
+        ESP_LOGE(TAG, "xSemaphoreCreateMutex() failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    player_idle = xSemaphoreCreateBinary();
+    if (player_idle == NULL)
+    {
+        ESP_LOGE(TAG, "xSemaphoreCreateBinary() failed");
+        return ESP_ERR_NO_MEM;
+    }
+    xSemaphoreGive(player_idle);
+
+    task_err = xTaskCreatePinnedToCore(
+        audio_player_task,
+        "audio_player_task",
+        4096,
+        NULL,
+        5,
+        &player_task_handle,
+        1);
+    if (task_err != pdPASS)
+    {
+        ESP_LOGE(TAG, "xTaskCreatePinnedToCore(audio_player_task) err: %d", task_err);
+
+        // attempt to create the audio_player_task with xTaskCreate
+        task_err = xTaskCreate(audio_player_task, "audio_player_task", 4096, NULL, 5, &player_task_handle);
+        if (task_err != pdPASS)
+        {
+            ESP_LOGE(TAG, "xTaskCreate(audio_player_task) err: %d", task_err);
+            return ESP_FAIL;
+        }
+    }
+
+    // above the player so events are timestamped when they arrive
+    task_err = xTaskCreatePinnedToCore(audio_dma_monitor_task, "audio_dma_monitor_task", 2048, NULL, 6, NULL, 1);
+    if (task_err != pdPASS)
+    {
+        ESP_LOGE(TAG, "xTaskCreatePinnedToCore(audio_dma_monitor_task) err: %d", task_err);
+
+        // attempt to create the audio_dma_monitor_task with xTaskCreate
+        task_err = xTaskCreate(audio_dma_monitor_task, "audio_dma_monitor_task", 2048, NULL, 6, NULL);
+        if (task_err != pdPASS)
+        {
+            ESP_LOGE(TAG, "xTaskCreate(audio_dma_monitor_task) err: %d", task_err);
+            return ESP_FAIL;
+        }
+    }
+
+    return ESP_OK;
+}
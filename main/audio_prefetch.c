@@ -0,0 +1,115 @@
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+#include "audio_prefetch.h"
+#include "audio_clip.h"
+
+static const char *TAG = "audio_prefetch.c";
+
+#define AUDIO_PREFETCH_MAX_CLIPS (3)
+#define AUDIO_PREFETCH_QUEUE_LEN (4)
+#define AUDIO_PREFETCH_STATE_COUNT (TUTORFISH_PIC_ISSUE + 1)
+
+// prompts of the states most likely to follow each state, most likely first. warmed while
+// the current state runs its wifi connect or http request so the next prompt starts at once
+static const audio_clip_id_t likely_next_clips[AUDIO_PREFETCH_STATE_COUNT][AUDIO_PREFETCH_MAX_CLIPS] = {
+    [TUTORFISH_HOME] = {AUDIO_CLIP_CONFIRM_SFX_04, AUDIO_CLIP_SUBMIT_A_QUESTION_00, AUDIO_CLIP_TUTOR_FISH_SETTINGS_00},
+    [TUTORFISH_SUBMIT_QUESTION] = {AUDIO_CLIP_ATTEMPT_WIFI_CONN_00, AUDIO_CLIP_UPLOADING_THE_PICTURE_PLEASE_WAIT_00, AUDIO_CLIP_RETURNING_HOME_07},
+    [TUTORFISH_SETTINGS] = {AUDIO_CLIP_RETURNING_HOME_07, AUDIO_CLIP_CONFIRM_SFX_04, AUDIO_CLIP_MAX},
+    [CONNECT_TO_WIFI] = {AUDIO_CLIP_UPLOADING_THE_PICTURE_PLEASE_WAIT_00, AUDIO_CLIP_WIFI_DISCONN_00, AUDIO_CLIP_ERROR_MESSAGE_00},
+    [TUTORFISH_VALIDATE_SESSION] = {AUDIO_CLIP_UPLOADING_THE_PICTURE_PLEASE_WAIT_00, AUDIO_CLIP_ERROR_MESSAGE_00, AUDIO_CLIP_MAX},
+    [TUTORFISH_CAPTURE_PIC] = {AUDIO_CLIP_TUTORS_LOOK_FOR_ANSWER_00, AUDIO_CLIP_TUTORS_FOUND_ANSWER_00, AUDIO_CLIP_ERROR_MESSAGE_00},
+    [TUTORFISH_POLL_DB] = {AUDIO_CLIP_TUTORS_FOUND_ANSWER_00, AUDIO_CLIP_TO_HEAR_THE_ANSWER_AGAIN_00, AUDIO_CLIP_MAX},
+    [TUTORFISH_DOWNLOAD_TTS] = {AUDIO_CLIP_TO_HEAR_THE_ANSWER_AGAIN_00, AUDIO_CLIP_MAX, AUDIO_CLIP_MAX},
+    [TUTORFISH_PLAYBACK_ANSWER] = {AUDIO_CLIP_TAKING_A_PICTURE321_02, AUDIO_CLIP_MAX, AUDIO_CLIP_MAX},
+    [TUTORFISH_SUBMIT_QUESTION_COMPLETE] = {AUDIO_CLIP_TAKING_A_PICTURE321_02, AUDIO_CLIP_MAX, AUDIO_CLIP_MAX},
+    [TUTORFISH_PIC_ISSUE] = {AUDIO_CLIP_MAX, AUDIO_CLIP_MAX, AUDIO_CLIP_MAX},
+};
+
+static QueueHandle_t prefetch_requests = NULL;
+static state_machine_t last_state = AUDIO_PREFETCH_STATE_COUNT;
+
+static void audio_prefetch_task(void *pvParameters)
+{
+    state_machine_t state;
+    audio_clip_cache_stats_t stats;
+
+    while (true)
+    {
+        if (xQueueReceive(prefetch_requests, &state, portMAX_DELAY) != pdTRUE)
+        {
+            continue;
+        }
+
+        for (int i = 0; i < AUDIO_PREFETCH_MAX_CLIPS && likely_next_clips[state][i] != AUDIO_CLIP_MAX; i++)
+        {
+            const audio_clip_id_t id = likely_next_clips[state][i];
+
+            esp_err_t err = audio_clip_prefetch(id);
+            if (err == ESP_ERR_NO_MEM)
+            {
+                // no room for this clip, the ones after it are less likely anyway
+                break;
+            }
+            else if (err != ESP_OK)
+            {
+                ESP_LOGE(TAG, "audio_clip_prefetch(%s) err: %s", audio_clip_name(id), esp_err_to_name(err));
+            }
+        }
+
+        audio_clip_cache_stats(&stats);
+        ESP_LOGI(TAG, "state %d: %u prefetched, %u hits, %u wasted, %u/%u bytes waiting",
+                 state, stats.prefetches, stats.prefetch_hits, stats.prefetch_wasted,
+                 stats.prefetched_bytes, stats.prefetch_budget_bytes);
+    }
+}
+
+// called every pass of the state machine loop, only acts when the state has changed.
+// never blocks, a burst of transitions drops the oldest predictions
+void audio_prefetch_state(state_machine_t state)
+{
+    if (state == last_state || state >= AUDIO_PREFETCH_STATE_COUNT || prefetch_requests == NULL)
+    {
+        return;
+    }
+
+    last_state = state;
+
+    if (xQueueSend(prefetch_requests, &state, 0) != pdTRUE)
+    {
+        state_machine_t dropped;
+        xQueueReceive(prefetch_requests, &dropped, 0);
+        xQueueSend(prefetch_requests, &state, 0);
+    }
+}
+
+esp_err_t init_audio_prefetch(void)
+{
+    BaseType_t task_err;
+
+    prefetch_requests = xQueueCreate(AUDIO_PREFETCH_QUEUE_LEN, sizeof(state_machine_t));
+    if (prefetch_requests == NULL)
+    {
+        ESP_LOGE(TAG, "xQueueCreate() failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    // below the player and the request task, loading never delays playback
+    task_err = xTaskCreatePinnedToCore(audio_prefetch_task, "audio_prefetch_task", 4096, NULL, 2, NULL, 1);
+    if (task_err != pdPASS)
+    {
+        ESP_LOGE(TAG, "xTaskCreatePinnedToCore(audio_prefetch_task) err: %d", task_err);
+
+        // attempt to create the audio_prefetch_task with xTaskCreate
+        task_err = xTaskCreate(audio_prefetch_task, "audio_prefetch_task", 4096, NULL, 2, NULL);
+        if (task_err != pdPASS)
+        {
+            ESP_LOGE(TAG, "xTaskCreate(audio_prefetch_task) err: %d", task_err);
+            return ESP_FAIL;
+        }
+    }
+
+    return ESP_OK;
+}
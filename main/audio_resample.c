@@ -0,0 +1,137 @@
+#include <math.h>
+#include <string.h>
+
+#include "audio_resample.h"
+
+static inline int16_t saturate16(int32_t x)
+{
+    return x > INT16_MAX ? INT16_MAX : (x < INT16_MIN ? INT16_MIN : x);
+}
+
+// blackman windowed sinc, x in input samples from the filter centre
+static float lowpass(float x, float cutoff)
+{
+    const float half = AUDIO_RESAMPLE_TAPS / 2.0f;
+
+    if (fabsf(x) >= half)
+    {
+        return 0.0f;
+    }
+
+    const float sinc = x == 0.0f ? 1.0f : sinf(M_PI * cutoff * x) / (M_PI * cutoff * x);
+    const float w = 0.42f + 0.5f * cosf(M_PI * x / half) + 0.08f * cosf(2.0f * M_PI * x / half);
+
+    return cutoff * sinc * w;
+}
+
+// the coefficient table is built once per rate change, in float since it is off the
+// sample path, and each phase is normalised so dc passes at exactly unity gain
+esp_err_t audio_resampler_init(audio_resampler_t *rs, uint32_t in_rate, uint32_t out_rate)
+{
+    if (in_rate < AUDIO_RESAMPLE_MIN_RATE || in_rate > AUDIO_RESAMPLE_MAX_RATE || out_rate == 0)
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    rs->in_rate = in_rate;
+    rs->out_rate = out_rate;
+    rs->step = ((uint64_t)in_rate << 32) / out_rate;
+    rs->pos = 0;
+
+    // the history starts silent
+    rs->window_len = AUDIO_RESAMPLE_TAPS - 1;
+    memset(rs->window, 0, sizeof(rs->window));
+
+    if (!audio_resampler_active(rs))
+    {
+        return ESP_OK;
+    }
+
+    // below the lower of the two nyquist rates, with room for the transition band
+    const float cutoff = 0.9f * (in_rate < out_rate ? 1.0f : (float)out_rate / in_rate);
+
+    for (int p = 0; p <= AUDIO_RESAMPLE_PHASES; p++)
+    {
+        const float frac = (float)p / AUDIO_RESAMPLE_PHASES;
+        float taps[AUDIO_RESAMPLE_TAPS];
+        float sum = 0.0f;
+
+        for (int k = 0; k < AUDIO_RESAMPLE_TAPS; k++)
+        {
+            taps[k] = lowpass(k - (AUDIO_RESAMPLE_TAPS / 2 - 1) - frac, cutoff);
+            sum += taps[k];
+        }
+
+        int32_t total = 0;
+        for (int k = 0; k < AUDIO_RESAMPLE_TAPS; k++)
+        {
+            rs->coeffs[p][k] = (int16_t)lrintf(taps[k] / sum * 32767.0f);
+            total += rs->coeffs[p][k];
+        }
+
+        // put the rounding error on the centre tap
+        rs->coeffs[p][AUDIO_RESAMPLE_TAPS / 2 - 1] += 32767 - total;
+    }
+
+    return ESP_OK;
+}
+
+bool audio_resampler_active(const audio_resampler_t *rs)
+{
+    return rs->in_rate != rs->out_rate;
+}
+
+// resamples up to AUDIO_RESAMPLE_CHUNK samples into out, which must hold
+// AUDIO_RESAMPLE_MAX_OUT(out_rate). returns the number of samples written
+int audio_resample(audio_resampler_t *rs, const int16_t *in, int in_len, int16_t *out)
+{
+    if (!audio_resampler_active(rs))
+    {
+        memcpy(out, in, in_len * sizeof(int16_t));
+        return in_len;
+    }
+
+    if (in_len > AUDIO_RESAMPLE_CHUNK)
+    {
+        in_len = AUDIO_RESAMPLE_CHUNK;
+    }
+
+    memcpy(&rs->window[rs->window_len], in, in_len * sizeof(int16_t));
+    rs->window_len += in_len;
+
+    int n = 0;
+
+    // an output sample needs a full set of taps from its integer position onwards
+    while ((int)(rs->pos >> 32) + AUDIO_RESAMPLE_TAPS <= rs->window_len)
+    {
+        const int16_t *x = &rs->window[rs->pos >> 32];
+        const uint32_t frac = (uint32_t)rs->pos;
+        const int phase = frac >> (32 - AUDIO_RESAMPLE_PHASE_BITS);                // top bits pick the phase
+        const int32_t mix = (frac >> (32 - AUDIO_RESAMPLE_PHASE_BITS - 15)) & 0x7FFF; // the next 15 interpolate
+        const int16_t *c0 = rs->coeffs[phase];
+        const int16_t *c1 = rs->coeffs[phase + 1];
+
+        int32_t acc0 = 0;
+        int32_t acc1 = 0;
+        for (int k = 0; k < AUDIO_RESAMPLE_TAPS; k++)
+        {
+            acc0 += x[k] * c0[k];
+            acc1 += x[k] * c1[k];
+        }
+
+        // the Q15 sums are shifted down before interpolating so the product cannot overflow
+        acc0 >>= 15;
+        acc1 >>= 15;
+        out[n++] = saturate16(acc0 + (((acc1 - acc0) * mix) >> 15));
+
+        rs->pos += rs->step;
+    }
+
+    // keep the samples the next output still needs
+    const int consumed = rs->pos >> 32;
+    rs->window_len -= consumed;
+    memmove(rs->window, &rs->window[consumed], rs->window_len * sizeof(int16_t));
+    rs->pos -= (uint64_t)consumed << 32;
+
+    return n;
+}
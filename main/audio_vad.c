@@ -0,0 +1,107 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "audio_vad.h"
+
+void audio_vad_init(audio_vad_t *vad)
+{
+    vad->noise_floor = -1;
+    vad->voiced_frames = 0;
+    vad->silent_frames = 0;
+    vad->speaking = false;
+}
+
+// follows quiet passages quickly and loud ones slowly, a noise floor that rose with every
+// frame of speech would end the speech it is measuring
+static void track_noise_floor(audio_vad_t *vad, int32_t level)
+{
+    if (vad->noise_floor < 0)
+    {
+        vad->noise_floor = level;
+    }
+    else if (level < vad->noise_floor)
+    {
+        vad->noise_floor += (level - vad->noise_floor) / 4;
+    }
+    else
+    {
+        vad->noise_floor += (level - vad->noise_floor) / 32;
+    }
+}
+
+// classifies one frame by its mean amplitude and zero crossings around the frame's dc offset.
+// voiced sound is loud with few crossings, unvoiced consonants are quieter but cross often
+// and only count once speech has started, so hiss and fans do not start a recording
+audio_vad_result_t audio_vad_process(audio_vad_t *vad, const int16_t *frame, int len)
+{
+    if (len <= 0)
+    {
+        return vad->speaking ? AUDIO_VAD_SPEECH : AUDIO_VAD_SILENCE;
+    }
+
+    int32_t sum = 0;
+    for (int i = 0; i < len; i++)
+    {
+        sum += frame[i];
+    }
+    const int32_t dc = sum / len;
+
+    int32_t level = 0;
+    int crossings = 0;
+    bool positive = frame[0] >= dc;
+    for (int i = 0; i < len; i++)
+    {
+        const int32_t x = frame[i] - dc;
+        level += x < 0 ? -x : x;
+
+        if ((x >= 0) != positive)
+        {
+            positive = x >= 0;
+            crossings++;
+        }
+    }
+    level /= len;
+
+    // frames shorter than AUDIO_VAD_FRAME_SAMPLES are scaled to the thresholds
+    crossings = crossings * AUDIO_VAD_FRAME_SAMPLES / len;
+
+    const int32_t floor = vad->noise_floor < 0 ? level : vad->noise_floor;
+    const int32_t loud = floor * AUDIO_VAD_ONSET_RATIO > AUDIO_VAD_MIN_LEVEL ? floor * AUDIO_VAD_ONSET_RATIO : AUDIO_VAD_MIN_LEVEL;
+    const bool voiced = level > loud && crossings < AUDIO_VAD_ZCR_VOICED;
+
+    if (!vad->speaking)
+    {
+        if (!voiced)
+        {
+            vad->voiced_frames = 0;
+            track_noise_floor(vad, level);
+            return AUDIO_VAD_SILENCE;
+        }
+
+        if (++vad->voiced_frames < AUDIO_VAD_ONSET_FRAMES)
+        {
+            return AUDIO_VAD_SILENCE;
+        }
+
+        vad->speaking = true;
+        vad->silent_frames = 0;
+        return AUDIO_VAD_ONSET;
+    }
+
+    const bool fricative = level > loud / 2 && crossings >= AUDIO_VAD_ZCR_FRICATIVE;
+
+    if (level > loud || fricative)
+    {
+        vad->silent_frames = 0;
+        return AUDIO_VAD_SPEECH;
+    }
+
+    if (++vad->silent_frames < AUDIO_VAD_HANGOVER_FRAMES)
+    {
+        return AUDIO_VAD_SPEECH;
+    }
+
+    vad->speaking = false;
+    vad->voiced_frames = 0;
+    return AUDIO_VAD_END;
+}
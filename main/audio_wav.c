@@ -0,0 +1,161 @@
+#include <string.h>
+#include <stdbool.h>
+#include <sys/param.h>
+#include "esp_log.h"
+
+#include "audio_wav.h"
+
+static const char *TAG = "audio_wav.c";
+
+#define WAV_RIFF_HEADER_LEN (12)
+#define WAV_CHUNK_HEADER_LEN (8)
+#define WAV_FMT_LEN (16)
+
+static uint16_t read_le16(const uint8_t *b)
+{
+    return b[0] | b[1] << 8;
+}
+
+static uint32_t read_le32(const uint8_t *b)
+{
+    return (uint32_t)b[0] | (uint32_t)b[1] << 8 | (uint32_t)b[2] << 16 | (uint32_t)b[3] << 24;
+}
+
+static esp_err_t parse_error(audio_wav_parser_t *parser, const char *reason)
+{
+    ESP_LOGE(TAG, "invalid wav: %s", reason);
+    parser->state = AUDIO_WAV_STATE_ERROR;
+    return ESP_ERR_INVALID_RESPONSE;
+}
+
+static esp_err_t handle_chunk_header(audio_wav_parser_t *parser)
+{
+    const uint8_t *id = parser->hdr;
+    const uint32_t size = read_le32(&parser->hdr[4]);
+
+    if (memcmp(id, "data", 4) == 0)
+    {
+        if (!parser->has_fmt)
+        {
+            return parse_error(parser, "data chunk before fmt chunk");
+        }
+
+        parser->fmt.data_len = size;
+        parser->state = AUDIO_WAV_STATE_DATA;
+        return ESP_OK;
+    }
+
+    // chunks are word aligned, odd sized chunks carry a pad byte. the pad of a 0xFFFFFFFF
+    // sized chunk would wrap chunk_remaining to 0, no such chunk can precede the samples
+    if (size == UINT32_MAX)
+    {
+        return parse_error(parser, "chunk larger than the file");
+    }
+
+    parser->chunk_remaining = size + (size & 1);
+
+    if (memcmp(id, "fmt ", 4) == 0)
+    {
+        if (size < WAV_FMT_LEN)
+        {
+            return parse_error(parser, "short fmt chunk");
+        }
+        parser->state = AUDIO_WAV_STATE_FMT;
+    }
+    else
+    {
+        parser->state = parser->chunk_remaining > 0 ? AUDIO_WAV_STATE_SKIP : AUDIO_WAV_STATE_CHUNK;
+    }
+
+    return ESP_OK;
+}
+
+static void handle_fmt(audio_wav_parser_t *parser)
+{
+    parser->fmt.format = read_le16(&parser->hdr[0]);
+    parser->fmt.channels = read_le16(&parser->hdr[2]);
+    parser->fmt.sample_rate = read_le32(&parser->hdr[4]);
+    parser->fmt.block_align = read_le16(&parser->hdr[12]);
+    parser->fmt.bits_per_sample = read_le16(&parser->hdr[14]);
+    parser->has_fmt = true;
+}
+
+void audio_wav_parser_init(audio_wav_parser_t *parser)
+{
+    memset(parser, 0, sizeof(*parser));
+    parser->state = AUDIO_WAV_STATE_RIFF;
+}
+
+// consumes header bytes from buf until the start of the data chunk. once the parser
+// reaches AUDIO_WAV_STATE_DATA, buf[*consumed] is the first sample byte
+esp_err_t audio_wav_parse(audio_wav_parser_t *parser, const uint8_t *buf, size_t len, size_t *consumed)
+{
+    esp_err_t err = ESP_OK;
+    size_t i = 0;
+
+    while (i < len && err == ESP_OK && parser->state != AUDIO_WAV_STATE_DATA)
+    {
+        switch (parser->state)
+        {
+        case AUDIO_WAV_STATE_RIFF:
+            parser->hdr[parser->hdr_len++] = buf[i++];
+            if (parser->hdr_len == WAV_RIFF_HEADER_LEN)
+            {
+                parser->hdr_len = 0;
+                if (memcmp(parser->hdr, "RIFF", 4) != 0 || memcmp(&parser->hdr[8], "WAVE", 4) != 0)
+                {
+                    err = parse_error(parser, "missing RIFF/WAVE header");
+                }
+                else
+                {
+                    parser->state = AUDIO_WAV_STATE_CHUNK;
+                }
+            }
+            break;
+
+        case AUDIO_WAV_STATE_CHUNK:
+            parser->hdr[parser->hdr_len++] = buf[i++];
+            if (parser->hdr_len == WAV_CHUNK_HEADER_LEN)
+            {
+                parser->hdr_len = 0;
+                err = handle_chunk_header(parser);
+            }
+            break;
+
+        case AUDIO_WAV_STATE_FMT:
+            // keep the PCM fields, skip any extension bytes
+            if (parser->hdr_len < WAV_FMT_LEN)
+            {
+                parser->hdr[parser->hdr_len++] = buf[i];
+            }
+            i++;
+            if (--parser->chunk_remaining == 0)
+            {
+                parser->hdr_len = 0;
+                handle_fmt(parser);
+                parser->state = AUDIO_WAV_STATE_CHUNK;
+            }
+            break;
+
+        case AUDIO_WAV_STATE_SKIP:
+        {
+            const size_t n = MIN(len - i, parser->chunk_remaining);
+            i += n;
+            parser->chunk_remaining -= n;
+            if (parser->chunk_remaining == 0)
+            {
+                parser->state = AUDIO_WAV_STATE_CHUNK;
+            }
+            break;
+        }
+
+        default:
+            err = ESP_ERR_INVALID_STATE;
+            break;
+        }
+    }
+
+    *consumed = i;
+
+    return err;
+}
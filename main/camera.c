@@ -7,9 +7,16 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 
 #include "esp_camera.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
 #include "nvs_data_struct.h"
+#include "nvs.h"
+#include "jpeg_quality.h"
+#include "jpeg_sharpness.h"
+#include "camera.h"
 
 #define BOARD_WROVER_KIT 1
 
@@ -65,6 +72,26 @@
 
 static const char *TAG = "camera.c";
 
+#define CAMERA_BASE_JPG_QUALITY (6)
+#define CAMERA_JPG_QUALITY_GROWTH (1.33)
+#define CAMERA_JPG_EXPONENT_MAX (5)
+#define CAMERA_WARMUP_FRAMES (2) // discarded while the exposure settles, they still steer the quality
+#define CAMERA_MAX_FRAMES (8)
+#define CAMERA_BURST_FRAMES (3) // frames scored for sharpness, the sharpest is the picture
+#define CAMERA_MAX_FAILURES (5)
+#define CAMERA_WARM_STOP_TIMEOUT_MS (3000) // a few WQXGA frame times
+
+static jpeg_quality_t jpg_quality_ctl;
+
+static camera_lifecycle_t lifecycle;
+static SemaphoreHandle_t warm_stopped = NULL;
+static volatile bool warm_streaming = false;
+static volatile int warm_frames = 0; // frames discarded since the sensor was last powered up
+
+// the sharpest frame of a burst so far, copied out of the one frame buffer so the next can be
+// taken. buf is in psram and NULL when no copy is held
+static camera_fb_t picture_copy;
+
 /*
     FRAMESIZE_96X96,    // 96x96
     FRAMESIZE_QQVGA,    // 160x120
@@ -94,7 +121,7 @@ static const char *TAG = "camera.c";
 
 camera_config_t setup_camera_config(void)
 {
-    const uint8_t base_jpg_quality = 6; //6
+    const uint8_t base_jpg_quality = CAMERA_BASE_JPG_QUALITY; //6
     uint8_t jpg_quality = base_jpg_quality;
 
     // base_jpg_quality = 3; FRAMESIZE_QXGA works (little difference), daytime
@@ -118,7 +145,7 @@ camera_config_t setup_camera_config(void)
         // 6 * 1.33^4 = 19
         // 6 * 1.33^5 = 25
 
-        jpg_quality = (uint8_t)round(base_jpg_quality * pow(1.33, nvs_data.jpeg_quality_exponent));
+        jpg_quality = (uint8_t)round(base_jpg_quality * pow(CAMERA_JPG_QUALITY_GROWTH, nvs_data.jpeg_quality_exponent));
     }
 
     ESP_LOGI(TAG, "setup_camera_config()");
@@ -282,9 +309,286 @@ esp_err_t init_camera(void)
         return err;
     }
 
+    jpeg_quality_init(&jpg_quality_ctl, camera_config.jpeg_quality, JPEG_QUALITY_TARGET_BYTES);
+
     return ESP_OK;
 }
 
+// the quality the controller settled on seeds the next boot through the old exponent key
+static void store_jpg_quality(void)
+{
+    int exponent = (int)round(log((double)jpg_quality_ctl.quality / CAMERA_BASE_JPG_QUALITY) / log(CAMERA_JPG_QUALITY_GROWTH));
+    exponent = exponent < 0 ? 0 : (exponent > CAMERA_JPG_EXPONENT_MAX ? CAMERA_JPG_EXPONENT_MAX : exponent);
+
+    if (exponent == nvs_data.jpeg_quality_exponent)
+    {
+        return;
+    }
+
+    nvs_data.jpeg_quality_exponent = exponent;
+    ESP_LOGI(TAG, "nvs_data.jpeg_quality_exponent: %d", nvs_data.jpeg_quality_exponent);
+
+    esp_err_t err = write_nvs_int("jpg_exponent", nvs_data.jpeg_quality_exponent);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "write_nvs_int(jpg_exponent) err: %s", esp_err_to_name(err));
+    }
+}
+
+// grabs a frame and steers the jpeg quality of the next one from its size and capture time.
+// NULL when the driver delivered no frame, usually because it overflowed the frame buffer
+static camera_fb_t *grab_frame(sensor_t *sensor)
+{
+    const int quality = jpg_quality_ctl.quality;
+
+    const int64_t start_us = esp_timer_get_time();
+    camera_fb_t *fb = esp_camera_fb_get();
+    const uint32_t capture_us = esp_timer_get_time() - start_us;
+
+    if (fb != NULL && fb->len == 0)
+    {
+        esp_camera_fb_return(fb);
+        fb = NULL;
+    }
+
+    if (fb == NULL)
+    {
+        jpeg_quality_failed(&jpg_quality_ctl);
+        ESP_LOGW(TAG, "no frame at jpg_quality %d after %u us", quality, capture_us);
+    }
+    else
+    {
+        jpeg_quality_frame(&jpg_quality_ctl, fb->len, capture_us);
+        ESP_LOGI(TAG, "frame %zu bytes in %u us at jpg_quality %d", fb->len, capture_us, quality);
+    }
+
+    if (jpg_quality_ctl.quality != quality && sensor->set_quality(sensor, jpg_quality_ctl.quality) != 0)
+    {
+        ESP_LOGE(TAG, "set_quality(%d) failed", jpg_quality_ctl.quality);
+    }
+
+    return fb;
+}
+
+// takes a picture, steering the jpeg quality through the sensor from frame to frame towards
+// JPEG_QUALITY_TARGET_BYTES. failed frames are retried coarser within the same capture
+// instead of reinitialising the camera. the frames streamed while warm count towards the
+// warm up, so after a countdown the burst starts at once. of the CAMERA_BURST_FRAMES frames
+// within the budget the sharpest is kept. every frame is returned to the driver before the
+// next is taken, a frame that beats the ones before it is copied to psram first, unless it
+// is the last of the burst and can stay in the frame buffer. the caller gives *pic back with
+// camera_return_picture()
+esp_err_t camera_capture(camera_fb_t **pic)
+{
+    sensor_t *sensor = esp_camera_sensor_get();
+    if (sensor == NULL)
+    {
+        ESP_LOGE(TAG, "esp_camera_sensor_get() failed");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    const int warmup = warm_frames < CAMERA_WARMUP_FRAMES ? CAMERA_WARMUP_FRAMES - warm_frames : 0;
+    int frames = 0;
+    int failures = 0;
+    int scored = 0;
+    camera_fb_t *best = NULL;
+    uint32_t best_score = 0;
+
+    ESP_LOGI(TAG, "Taking picture... (%d warm frames)", warm_frames);
+
+    while (scored < CAMERA_BURST_FRAMES && frames < CAMERA_MAX_FRAMES && failures < CAMERA_MAX_FAILURES)
+    {
+        camera_fb_t *fb = grab_frame(sensor);
+        if (fb == NULL)
+        {
+            failures++;
+            continue;
+        }
+
+        frames++;
+        const bool last = frames == CAMERA_MAX_FRAMES || failures == CAMERA_MAX_FAILURES - 1;
+
+        if (frames <= warmup || !(jpeg_quality_within_budget(&jpg_quality_ctl, fb->len) || (last && best == NULL)))
+        {
+            esp_camera_fb_return(fb);
+            continue;
+        }
+
+        uint32_t score = 0;
+        const int64_t start_us = esp_timer_get_time();
+        esp_err_t err = jpeg_sharpness_score(fb->buf, fb->len, &score);
+        if (err != ESP_OK)
+        {
+            ESP_LOGW(TAG, "jpeg_sharpness_score() err: %s", esp_err_to_name(err));
+        }
+        ESP_LOGI(TAG, "frame sharpness %u, scored in %lld us", score, esp_timer_get_time() - start_us);
+
+        scored++;
+
+        if (best != NULL && score <= best_score)
+        {
+            esp_camera_fb_return(fb);
+            continue;
+        }
+
+        if (best != NULL)
+        {
+            // a copy, its frame buffer went back to the driver when it was taken
+            camera_return_picture(best);
+            best = NULL;
+        }
+        best_score = score;
+
+        // no frame follows the last one, it stays in the frame buffer
+        if (scored == CAMERA_BURST_FRAMES || frames == CAMERA_MAX_FRAMES)
+        {
+            best = fb;
+            break;
+        }
+
+        picture_copy = *fb;
+        picture_copy.buf = heap_caps_malloc(fb->len, MALLOC_CAP_SPIRAM);
+        if (picture_copy.buf == NULL)
+        {
+            // the burst ends with the frame it has
+            ESP_LOGE(TAG, "heap_caps_malloc(%zu) failed", fb->len);
+            best = fb;
+            break;
+        }
+
+        memcpy(picture_copy.buf, fb->buf, fb->len);
+        esp_camera_fb_return(fb);
+        best = &picture_copy;
+    }
+
+    store_jpg_quality();
+
+    if (best != NULL)
+    {
+        ESP_LOGI(TAG, "Picture taken! Its size is: %zu bytes, sharpness %u of %d frames", best->len, best_score, scored);
+        *pic = best;
+        return ESP_OK;
+    }
+
+    ESP_LOGE(TAG, "no picture after %d frames and %d failures", frames, failures);
+
+    return ESP_FAIL;
+}
+
+// a picture from camera_capture(), back to the driver or, for a copy, to the heap
+void camera_return_picture(camera_fb_t *pic)
+{
+    if (pic == &picture_copy)
+    {
+        heap_caps_free(picture_copy.buf);
+        picture_copy.buf = NULL;
+        return;
+    }
+
+    esp_camera_fb_return(pic);
+}
+
+// discards frames while the camera is warm, so the exposure and white balance settle and
+// the jpeg quality is steered before the picture is taken
+static void camera_warm_task(void *pvParameters)
+{
+    sensor_t *sensor = esp_camera_sensor_get();
+
+    while (warm_streaming)
+    {
+        camera_fb_t *fb = grab_frame(sensor);
+        if (fb != NULL)
+        {
+            esp_camera_fb_return(fb);
+            warm_frames++;
+        }
+    }
+
+    xSemaphoreGive(warm_stopped);
+    vTaskDelete(NULL);
+}
+
+static esp_err_t camera_stream(bool on)
+{
+    if (!on)
+    {
+        warm_streaming = false;
+
+        // the frame in flight is finished and returned first, the driver only has the one
+        // frame buffer
+        if (xSemaphoreTake(warm_stopped, CAMERA_WARM_STOP_TIMEOUT_MS / portTICK_PERIOD_MS) != pdTRUE)
+        {
+            ESP_LOGE(TAG, "camera_warm_task did not stop");
+            return ESP_ERR_TIMEOUT;
+        }
+
+        return ESP_OK;
+    }
+
+    if (esp_camera_sensor_get() == NULL)
+    {
+        ESP_LOGE(TAG, "esp_camera_sensor_get() failed");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    warm_streaming = true;
+
+    BaseType_t task_err = xTaskCreatePinnedToCore(camera_warm_task, "camera_warm_task", 3072, NULL, 5, NULL, 1);
+    if (task_err != pdPASS)
+    {
+        ESP_LOGE(TAG, "xTaskCreatePinnedToCore(camera_warm_task) err: %d", task_err);
+
+        task_err = xTaskCreate(camera_warm_task, "camera_warm_task", 3072, NULL, 5, NULL);
+        if (task_err != pdPASS)
+        {
+            ESP_LOGE(TAG, "xTaskCreate(camera_warm_task) err: %d", task_err);
+            warm_streaming = false;
+            return ESP_FAIL;
+        }
+    }
+
+    return ESP_OK;
+}
+
+static esp_err_t camera_power(bool on)
+{
+    if (!on)
+    {
+        // the sensor settles again after a power down
+        warm_frames = 0;
+    }
+
+    return toggle_camera_pwdn(on ? CAMERA_ON : CAMERA_OFF);
+}
+
+static const camera_driver_t camera_driver = {
+    .init = init_camera,
+    .deinit = esp_camera_deinit,
+    .power = camera_power,
+    .stream = camera_stream,
+    .now_us = esp_timer_get_time,
+};
+
+// expects the PWDN pin configured by init_camera_pwdn(), leaves the camera in standby
+esp_err_t init_camera_lifecycle(void)
+{
+    warm_stopped = xSemaphoreCreateBinary();
+    if (warm_stopped == NULL)
+    {
+        ESP_LOGE(TAG, "xSemaphoreCreateBinary() failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    camera_lifecycle_init(&lifecycle, &camera_driver);
+
+    return camera_lifecycle_set(&lifecycle, CAMERA_STATE_STANDBY);
+}
+
+esp_err_t camera_set_state(camera_state_t state)
+{
+    return camera_lifecycle_set(&lifecycle, state);
+}
+
 // void capture_image(void)
 // {
 //     ESP_LOGI(TAG, "Taking picture...");
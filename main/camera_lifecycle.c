@@ -0,0 +1,147 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_log.h"
+
+#include "camera_lifecycle.h"
+
+static const char *TAG = "camera_lifecycle.c";
+
+static const char *const state_names[CAMERA_STATE_MAX] = {
+    [CAMERA_STATE_OFF] = "off",
+    [CAMERA_STATE_STANDBY] = "standby",
+    [CAMERA_STATE_WARM] = "warm",
+    [CAMERA_STATE_CAPTURE] = "capture",
+};
+
+const char *camera_state_name(camera_state_t state)
+{
+    return state < CAMERA_STATE_MAX ? state_names[state] : "?";
+}
+
+void camera_lifecycle_init(camera_lifecycle_t *cam, const camera_driver_t *driver)
+{
+    cam->driver = driver;
+    cam->state = CAMERA_STATE_OFF;
+    cam->streaming = false;
+    cam->entered_us = driver->now_us();
+}
+
+// moves one state towards capture
+static esp_err_t step_up(camera_lifecycle_t *cam)
+{
+    const camera_driver_t *driver = cam->driver;
+    esp_err_t err = ESP_OK;
+
+    switch (cam->state)
+    {
+    case CAMERA_STATE_OFF:
+        // the sensor registers are written during init, so it is powered for it
+        err = driver->power(true);
+        if (err != ESP_OK)
+        {
+            return err;
+        }
+
+        err = driver->init();
+        driver->power(false);
+        break;
+    case CAMERA_STATE_STANDBY:
+        err = driver->power(true);
+        break;
+    default:
+        break;
+    }
+
+    if (err == ESP_OK)
+    {
+        cam->state++;
+    }
+
+    return err;
+}
+
+// moves one state towards off
+static esp_err_t step_down(camera_lifecycle_t *cam)
+{
+    const camera_driver_t *driver = cam->driver;
+    esp_err_t err = ESP_OK;
+
+    switch (cam->state)
+    {
+    case CAMERA_STATE_WARM:
+        err = driver->power(false);
+        break;
+    case CAMERA_STATE_STANDBY:
+        err = driver->deinit();
+        break;
+    default:
+        break;
+    }
+
+    if (err == ESP_OK)
+    {
+        cam->state--;
+    }
+
+    return err;
+}
+
+// walks the camera to target. on a driver error the camera is left in the last state it
+// reached and the error is returned. the frames are streamed only while it rests in warm
+esp_err_t camera_lifecycle_set(camera_lifecycle_t *cam, camera_state_t target)
+{
+    if (target >= CAMERA_STATE_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const camera_state_t from = cam->state;
+    const int64_t start_us = cam->driver->now_us();
+    esp_err_t err = ESP_OK;
+
+    if (cam->streaming && target != CAMERA_STATE_WARM)
+    {
+        err = cam->driver->stream(false);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "stream(false) err: %s", esp_err_to_name(err));
+            return err;
+        }
+
+        cam->streaming = false;
+    }
+
+    while (err == ESP_OK && cam->state < target)
+    {
+        err = step_up(cam);
+    }
+
+    while (err == ESP_OK && cam->state > target)
+    {
+        err = step_down(cam);
+    }
+
+    if (err == ESP_OK && target == CAMERA_STATE_WARM && !cam->streaming)
+    {
+        err = cam->driver->stream(true);
+        cam->streaming = err == ESP_OK;
+    }
+
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "%s -> %s stopped at %s, err: %s", state_names[from], state_names[target],
+                 state_names[cam->state], esp_err_to_name(err));
+    }
+
+    if (cam->state != from)
+    {
+        const int64_t now_us = cam->driver->now_us();
+
+        ESP_LOGI(TAG, "%s -> %s in %lld us, %s for %lld ms", state_names[from], state_names[cam->state],
+                 now_us - start_us, state_names[from], (start_us - cam->entered_us) / 1000);
+
+        cam->entered_us = now_us;
+    }
+
+    return err;
+}
@@ -6,3 +6,23 @@
 # embed files from the "certs" directory as binary data symbols
 # in the app
 COMPONENT_EMBED_TXTFILES := howsmyssl_com_root_cert.pem
+
+# the clips in audio_source_files are built and linked into the app as CMakeLists.txt does in
+# its default "embed" mode. the audio pack is only built and flashed by the cmake build
+AUDIO_ASSETS_MODE ?= embed
+ifneq ($(AUDIO_ASSETS_MODE),embed)
+$(error AUDIO_ASSETS_MODE $(AUDIO_ASSETS_MODE) is only supported by the cmake build (idf.py))
+endif
+
+AUDIO_ASSETS_SOURCES := $(wildcard $(PROJECT_PATH)/audio_source_files/*.wav)
+AUDIO_ASSETS_TOOLS := $(wildcard $(PROJECT_PATH)/tools/*.py)
+
+COMPONENT_EMBED_FILES := $(COMPONENT_BUILD_DIR)/audio_assets.bin
+COMPONENT_EXTRA_INCLUDES := $(COMPONENT_BUILD_DIR)
+COMPONENT_EXTRA_CLEAN := audio_assets.bin audio_assets.h
+
+$(COMPONENT_BUILD_DIR)/audio_assets.bin $(COMPONENT_BUILD_DIR)/audio_assets.h: $(AUDIO_ASSETS_SOURCES) $(AUDIO_ASSETS_TOOLS)
+	$(summary) AUDIO_ASSETS $(patsubst $(PWD)/%,%,$(CURDIR))/audio_assets.bin
+	$(PYTHON) $(PROJECT_PATH)/tools/audio_assets.py embed --adpcm $(COMPONENT_BUILD_DIR)/audio_assets.bin $(COMPONENT_BUILD_DIR)/audio_assets.h $(AUDIO_ASSETS_SOURCES)
+
+audio_clip.o: $(COMPONENT_BUILD_DIR)/audio_assets.h
@@ -88,10 +88,13 @@ esp_err_t esp_littlefs_ota(void)
         return err = ESP_FAIL;
     }
 
-    err = deinit_littlefs("audio");
-    if (err != ESP_OK)
+    if (!audio_clip_pack_loaded())
     {
-        ESP_LOGE(TAG, "deinit_littlefs() err: %s", esp_err_to_name(err));
+        err = deinit_littlefs("audio");
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "deinit_littlefs() err: %s", esp_err_to_name(err));
+        }
     }
 
     esp_vfs_littlefs_conf_t conf = {
@@ -147,6 +150,7 @@ esp_err_t esp_littlefs_ota(void)
     bool playback_please_wait_message = false;
     char *firmware_buf = malloc(1024);
     int bytes_written = 0;
+    int announced_quarter = 0;
 
     while (bytes_written <= littlefs_ota_handle->binary_file_len)
     {
@@ -193,6 +197,14 @@ esp_err_t esp_littlefs_ota(void)
         }
 
         bytes_written += 1024;
+
+        // the copy takes a while, its progress is announced in quarters
+        const int quarter = (int)((int64_t)bytes_written * 4 / littlefs_ota_handle->binary_file_len);
+        if (quarter > announced_quarter && quarter < 4)
+        {
+            playback_completion_percentage(littlefs_ota_handle->binary_file_len, bytes_written, true);
+            announced_quarter = quarter;
+        }
     }
 
     if (err != ESP_OK)
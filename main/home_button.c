@@ -16,6 +16,7 @@
 #include "menu.h"
 #include "init_variables.h"
 #include "home_button.h"
+#include "latency_trace.h"
 
 //#include "esp_intr_alloc.h"
 #define ESP_INTR_FLAG_DEFAULT (0)
@@ -63,10 +64,7 @@ static void handle_single_press(void)
         return;
     }
 
-    if (audio_buf.system_i2s_playing)
-    {
-        audio_buf.system_i2s_stop = true;
-    }
+    audio_player_stop();
 
     if (state_machine == TUTORFISH_HOME)
     {
@@ -94,10 +92,7 @@ static void handle_double_press(void)
         return;
     }
 
-    if (audio_buf.system_i2s_playing)
-    {
-        audio_buf.system_i2s_stop = true;
-    }
+    audio_player_stop();
 
     // return to pillar home
     // TODO : ask the user if they are sure they want to return, press the home button once to confirm
@@ -105,25 +100,7 @@ static void handle_double_press(void)
     {
         playback_returning_home_wav();
 
-        if (audio_buf.wait_app_loads_00_wav_audio_buf == NULL)
-        {
-            esp_err_t err_ = malloc_wait_app_loads_00_wav();
-            if (err_ != ESP_OK)
-            {
-                ESP_LOGE(TAG, "malloc_wait_app_loads_00_wav() err: %s", esp_err_to_name(err_));
-            }
-
-            if (err_ == ESP_OK)
-            {
-                playback_audio_file(audio_buf.wait_app_loads_00_wav_audio_buf, audio_buf.wait_app_loads_00_wav_audio_len, audio_volume, true);
-                if (err_ != ESP_OK)
-                {
-                    ESP_LOGE(TAG, "playback_audio_file(wait_app_loads_00_wav_audio_buf) err: %s", esp_err_to_name(err_));
-                }
-
-                free_wait_app_loads_00_wav();
-            }
-        }
+        playback_audio_clip(AUDIO_CLIP_WAIT_APP_LOADS_00, true);
 
         err = get_current_running_app();
         if (err == ESP_OK)
@@ -177,6 +154,7 @@ static void IRAM_ATTR gpio_isr_handler(void *arg)
     uint32_t gpio_num = (uint32_t)arg;
     if (!button_pressed)
     {
+        latency_trace_begin_from_isr(LATENCY_SOURCE_BUTTON);
         xQueueSendFromISR(gpio_evt_queue, &gpio_num, NULL);
     }
 }
@@ -227,6 +205,7 @@ static void gpio_task_example(void *arg)
                 // if the current loaded partition is not he glasses firmware, ota load the glasses firmware
                 printf("double pressed\n");
 
+                latency_trace_mark(LATENCY_STAGE_HANDLED);
                 handle_double_press();
             }
             else
@@ -234,6 +213,7 @@ static void gpio_task_example(void *arg)
                 printf("single press\n");
                 // https_send_file();
 
+                latency_trace_mark(LATENCY_STAGE_HANDLED);
                 handle_single_press();
             }
 
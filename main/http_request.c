@@ -7,10 +7,14 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
+#include <sys/param.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
 #include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
 #include "nvs_flash.h"
 #include "esp_event.h"
 #include "esp_netif.h"
@@ -22,9 +26,11 @@
 
 #include "driver/i2s.h"
 #include "esp_camera.h"
+#include "esp_http_client_example.h"
 #include "esp_ota.h"
 #include "nvs_data_struct.h"
 #include "audio_io.h"
+#include "audio_capture.h"
 
 #include "camera.h" // <- remove after test camera PWDN toggle before/after using camera
 
@@ -34,6 +40,14 @@ static const char *TAG = "HTTP_CLIENT";
 
 #define HTTP_BOUNDARY "----123"
 #define HTTP_BUFFER_SIZE 1024
+#define HTTP_IMAGE_CHUNK_SIZE 4096 // written straight from the frame buffer
+
+// tts body read size, playback starts once the first read is handed to the player
+#define HTTP_TTS_READ_SIZE 2048
+// psram copy kept for "tap to hear again" when the server does not send a content length
+// wav codec 0x11 is ima-adpcm (RFC 2361), pcm wav is still accepted from older servers
+#define HTTP_TTS_ACCEPT "audio/vnd.wave;codec=11, audio/wav;q=0.5"
+#define HTTP_TTS_INITIAL_CAPACITY (64 * 1024)
 
 #define TXRX_TO_PIC12_EN (0)
 
@@ -52,7 +66,6 @@ extern const char postman_root_cert_pem_end[] asm("_binary_postman_root_cert_pem
 
 extern const uint8_t server_cert_pem_start[] asm("_binary_ca_cert_pem_start");
 
-static char *img_buf = NULL;
 static char *session_buf = NULL;
 static char *response_buffer = NULL;
 
@@ -141,12 +154,104 @@ esp_err_t _http_event_handler(esp_http_client_event_t *evt)
     return ESP_OK;
 }
 
+// streams the tts body into the audio player as it arrives and keeps a psram copy for repeats
+static esp_err_t stream_tts_response(esp_http_client_handle_t client, int content_length, int64_t request_start)
+{
+    static char read_buf[HTTP_TTS_READ_SIZE];
+    esp_err_t err = ESP_OK;
+    audio_playback_handle_t handle = 0;
+    bool preempted = false;
+
+    free(audio_buf.tts_audio_buf);
+    audio_buf.tts_audio_len = 0;
+    audio_buf.tts_audio_streamed = false;
+
+    int capacity = content_length > 0 ? content_length : HTTP_TTS_INITIAL_CAPACITY;
+    audio_buf.tts_audio_buf = heap_caps_malloc(capacity, MALLOC_CAP_SPIRAM);
+    if (audio_buf.tts_audio_buf == NULL)
+    {
+        ESP_LOGE(TAG, "heap_caps_malloc(%d) failed", capacity);
+        return ESP_ERR_NO_MEM;
+    }
+
+    err = audio_player_begin(audio_volume, false, AUDIO_PRIORITY_ANSWER, &handle);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "audio_player_begin() err: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    while (true)
+    {
+        const int data_read = esp_http_client_read(client, read_buf, sizeof(read_buf));
+        if (data_read < 0)
+        {
+            ESP_LOGE(TAG, "esp_http_client_read() failed");
+            err = ESP_FAIL;
+            break;
+        }
+
+        if (data_read == 0)
+        {
+            break;
+        }
+
+        if (audio_buf.tts_audio_len + data_read > capacity)
+        {
+            char *grown = heap_caps_realloc(audio_buf.tts_audio_buf, capacity * 2, MALLOC_CAP_SPIRAM);
+            if (grown == NULL)
+            {
+                ESP_LOGE(TAG, "heap_caps_realloc(%d) failed", capacity * 2);
+                err = ESP_ERR_NO_MEM;
+                break;
+            }
+            audio_buf.tts_audio_buf = grown;
+            capacity *= 2;
+        }
+
+        memcpy(&audio_buf.tts_audio_buf[audio_buf.tts_audio_len], read_buf, data_read);
+        audio_buf.tts_audio_len += data_read;
+
+        // keep downloading after a prompt cut the answer off, it is replayed from psram.
+        // the stream is ended at once so the prompt does not wait for the whole body
+        if (!preempted && audio_player_write(read_buf, data_read) < 0)
+        {
+            preempted = true;
+            audio_player_end();
+        }
+    }
+
+    // after a preemption the player already belongs to the prompt
+    if (!preempted)
+    {
+        audio_player_end();
+    }
+
+    if (err != ESP_OK)
+    {
+        free(audio_buf.tts_audio_buf);
+        audio_buf.tts_audio_buf = NULL;
+        audio_buf.tts_audio_len = 0;
+        return err;
+    }
+
+    audio_buf.tts_audio_streamed = !preempted;
+
+    audio_playback_info_t info;
+    if (audio_player_info(handle, &info) == ESP_OK && info.started_us > 0)
+    {
+        ESP_LOGI(TAG, "tts first audio %lld us after the request, %d bytes downloaded", info.started_us - request_start, audio_buf.tts_audio_len);
+    }
+
+    return ESP_OK;
+}
+
 int http_download_file(char *hostname, char *path, char *query, bool cookie)
 {
     esp_http_client_config_t config = {
         .host = hostname,
         .path = path,
-        .event_handler = _http_event_handler,
+        // no event handler, _http_event_handler would buffer the whole body
         .disable_auto_redirect = true,
         .user_agent = "SmartGlassesOS/1.0.0",
         .buffer_size_tx = 2048 // fix HTTP_HEADER: Buffer length is small to fit all the headers error. https://www.reddit.com/r/esp32/comments/krwajq/esp32_http_post_fails_when_using_a_long_header/
@@ -182,6 +287,14 @@ int http_download_file(char *hostname, char *path, char *query, bool cookie)
     // GET Request
     esp_err_t err = esp_http_client_set_method(client, HTTP_METHOD_GET);
 
+    if (strcmp(path, "/student-download-tts") == 0)
+    {
+        // the player decodes ima-adpcm while it streams, a quarter of the pcm download
+        esp_http_client_set_header(client, "Accept", HTTP_TTS_ACCEPT);
+    }
+
+    const int64_t request_start = esp_timer_get_time();
+
     err = esp_http_client_open(client, 0);
     if (err != ESP_OK)
     {
@@ -198,70 +311,24 @@ int http_download_file(char *hostname, char *path, char *query, bool cookie)
     }
 
     // GET
-    err = esp_http_client_perform(client);
-    if (err != ESP_OK)
-    {
-        err = esp_http_client_cleanup(client);
-        if (err != ESP_OK)
-        {
-            ESP_LOGE(TAG, "esp_http_client_cleanup() err: %s", esp_err_to_name(err));
-            return err;
-        }
+    int content_length = esp_http_client_fetch_headers(client);
+    ESP_LOGI(TAG, "esp_http_client_fetch_headers(): %d", content_length);
 
-        return ESP_FAIL;
-    }
+    int http_status = esp_http_client_get_status_code(client);
 
-    int content_length = esp_http_client_get_content_length(client);
-    ESP_LOGI(TAG, "esp_http_client_get_content_length(): %d", content_length);
+    esp_err_t read_err = ESP_OK;
 
     if (content_length < 0)
     {
-        ESP_LOGE(TAG, "esp_http_client_get_content_length is 0");
+        ESP_LOGE(TAG, "esp_http_client_fetch_headers() failed");
+        read_err = ESP_FAIL;
     }
-    else
+    else if (http_status == 200 && strcmp(path, "/student-download-tts") == 0)
     {
-        // check the path of the request and handle accordingly
-        if (strcmp(path, "/student-download-tts") == 0)
-        {
-            // allocate audio buffer
-            // NOTE : added 10000 additional bytes to prevent early playback stop
-            audio_buf.tts_audio_len = content_length;
-            if (audio_buf.tts_audio_buf == NULL)
-            {
-                audio_buf.tts_audio_buf = malloc(audio_buf.tts_audio_len);
-            }
-            else
-            {
-                free(audio_buf.tts_audio_buf);
-                audio_buf.tts_audio_buf = NULL;
-                audio_buf.tts_audio_buf = malloc(audio_buf.tts_audio_len);
-            }
-
-            int data_read = esp_http_client_read_response(client, audio_buf.tts_audio_buf, MAX_HTTP_OUTPUT_BUFFER);
-            if (data_read < 0)
-            {
-                ESP_LOGE(TAG, "Failed to read response");
-                free(audio_buf.tts_audio_buf);
-                audio_buf.tts_audio_buf = NULL;
-            }
-            /*
-            if (data_read >= 0)
-            {
-                //ESP_LOGI(TAG, "HTTP GET Status = %d, content_length = %d", esp_http_client_get_status_code(client), esp_http_client_get_content_length(client));
-                //ESP_LOG_BUFFER_HEX(TAG, audio_buf.tts_audio_buf, 8);
-            }
-            else
-            {
-                ESP_LOGE(TAG, "Failed to read response");
-                free(audio_buf.tts_audio_buf);
-                audio_buf.tts_audio_buf = NULL;
-            }
-            */
-        }
+        // a chunked response reports a content length of 0
+        read_err = stream_tts_response(client, content_length, request_start);
     }
 
-    int http_status = esp_http_client_get_status_code(client);
-
     err = esp_http_client_close(client);
     if (err != ESP_OK)
     {
@@ -275,6 +342,11 @@ int http_download_file(char *hostname, char *path, char *query, bool cookie)
         return err;
     }
 
+    if (read_err != ESP_OK)
+    {
+        return read_err;
+    }
+
     return err == ESP_OK && http_status == 200 ? err = ESP_OK : http_status;
 }
 
@@ -645,13 +717,13 @@ size_t http_post_request(char *hostname, char *path, char *post_data, char *sess
     return http_status;
 }
 
+// streams the jpeg straight out of the picture, the camera frame buffer or its copy, and
+// gives it back with camera_return_picture() once its last byte is written, or as soon as
+// the upload fails
 static int sendImage(esp_http_client_handle_t client, camera_fb_t *pic)
 {
-    img_buf = malloc(pic->len * sizeof(char));
-    int img_len = pic->len;
-    memcpy(img_buf, pic->buf, pic->len);
-
-    esp_camera_fb_return(pic);
+    const char *img_buf = (const char *)pic->buf;
+    const int img_len = pic->len;
 
     time_t fileTransferStart = 0;
     time(&fileTransferStart);
@@ -665,6 +737,18 @@ static int sendImage(esp_http_client_handle_t client, camera_fb_t *pic)
 
     // TODO : add expiry to HTTP req
 
+    // the spoken question, when one was recorded, follows the picture as a second part
+    const uint8_t *question_wav = NULL;
+    const int question_len = audio_capture_wav(&question_wav);
+    char questionHead[200] = "";
+    if (question_len > 0)
+    {
+        strcat(questionHead, "\r\n--");
+        strcat(questionHead, HTTP_BOUNDARY);
+        strcat(questionHead, "\r\n");
+        strcat(questionHead, "Content-Disposition: form-data; name=\"questionAudio\"; filename=\"question.wav\"\r\nContent-Type: audio/wav\r\n\r\n");
+    }
+
     // request tail
     char tail[50] = "";
     strcat(tail, "\r\n--");
@@ -673,7 +757,7 @@ static int sendImage(esp_http_client_handle_t client, camera_fb_t *pic)
     ESP_LOGI(TAG, "tail: %s", tail);
 
     // Set Content-Length
-    int contentLength = strlen(requestHead) + img_len + strlen(tail);
+    int contentLength = strlen(requestHead) + img_len + strlen(questionHead) + question_len + strlen(tail);
     ESP_LOGI(TAG, "length: %d", contentLength);
     char lengthStr[10];
     sprintf(lengthStr, "%i", contentLength);
@@ -686,7 +770,8 @@ static int sendImage(esp_http_client_handle_t client, camera_fb_t *pic)
     if (err != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to open HTTP connection: %s", esp_err_to_name(err));
-        esp_http_client_cleanup(client);
+        camera_return_picture(pic);
+        return false;
     }
 
     ESP_LOGI(TAG, "client connection open");
@@ -698,27 +783,13 @@ static int sendImage(esp_http_client_handle_t client, camera_fb_t *pic)
     unsigned fileProgress = 0;
     while (fileProgress < img_len)
     {
-        // write the remaining bytes that is less than 1024 to the client
-        if ((fileProgress + 1024) > img_len)
-        {
-            uint16_t remaining_bytes = img_len % 1024;
-
-            int write_ret = esp_http_client_write(client, &img_buf[remaining_bytes], remaining_bytes);
-            ESP_LOGI(TAG, "write file:\t%d/%d", write_ret, remaining_bytes);
-            if (write_ret < 0)
-            {
-                return false;
-            }
-
-            fileProgress += write_ret;
-
-            break;
-        }
+        const int chunk = MIN(img_len - fileProgress, HTTP_IMAGE_CHUNK_SIZE);
 
-        int write_ret = esp_http_client_write(client, &img_buf[fileProgress], 1024);
-        ESP_LOGI(TAG, "write file:\t%d/%d", write_ret, 1024);
+        int write_ret = esp_http_client_write(client, &img_buf[fileProgress], chunk);
+        ESP_LOGD(TAG, "write file:\t%d/%d", write_ret, chunk);
         if (write_ret < 0)
         {
+            camera_return_picture(pic);
             return false;
         }
 
@@ -733,37 +804,35 @@ static int sendImage(esp_http_client_handle_t client, camera_fb_t *pic)
         // playback uploading message when the picture is halfway uploaded
         if (fileProgress >= img_len / 2 && !playback_uploading_picture_message)
         {
-            if (audio_buf.uploading_the_picture_please_wait_00_wav_audio_buf == NULL)
-            {
-                err = malloc_uploading_the_picture_please_wait_00_wav();
-                if (err != ESP_OK)
-                {
-                    ESP_LOGE(TAG, "malloc_uploading_the_picture_please_wait_00_wav() err: %s", esp_err_to_name(err));
-                }
+            err = playback_audio_clip_async(AUDIO_CLIP_UPLOADING_THE_PICTURE_PLEASE_WAIT_00, true);
 
-                if (err == ESP_OK)
-                {
-                    err = playback_audio_file(audio_buf.uploading_the_picture_please_wait_00_wav_audio_buf, audio_buf.uploading_the_picture_please_wait_00_wav_len, audio_volume, true);
-                    if (err != ESP_OK)
-                    {
-                        ESP_LOGE(TAG, "playback_audio_file(uploading_the_picture_please_wait_00_wav_audio_buf) err: %s", esp_err_to_name(err));
-                    }
+            playback_uploading_picture_message = true;
+        }
+    }
 
-                    free_uploading_the_picture_please_wait_00_wav();
-                }
+    // the picture has left, the frame buffer or the copy can go
+    camera_return_picture(pic);
+
+    if (question_len > 0)
+    {
+        ESP_LOGI(TAG, "questionHead:\t%d", esp_http_client_write(client, questionHead, strlen(questionHead)));
+
+        for (int sent = 0; sent < question_len;)
+        {
+            int write_ret = esp_http_client_write(client, (const char *)&question_wav[sent], MIN(question_len - sent, HTTP_BUFFER_SIZE));
+            if (write_ret < 0)
+            {
+                return false;
             }
 
-            playback_uploading_picture_message = true;
+            sent += write_ret;
         }
+        ESP_LOGI(TAG, "question sent:\t%d bytes", question_len);
     }
 
     // finish Multipart request
     ESP_LOGI(TAG, "tail:\t%d", esp_http_client_write(client, tail, strlen(tail)));
 
-    // return pic img_buf
-    free(img_buf);
-    img_buf = NULL;
-
     // Get response
     ESP_LOGI(TAG, "fetch_headers:\t%d", esp_http_client_fetch_headers(client));
     ESP_LOGI(TAG, "chunked:\t%d", esp_http_client_is_chunked_response(client));
@@ -774,6 +843,12 @@ static int sendImage(esp_http_client_handle_t client, camera_fb_t *pic)
     int status = esp_http_client_get_status_code(client);
     ESP_LOGI(TAG, "status:\t%d", status);
 
+    if (status == 200)
+    {
+        // the question went with this picture, a retry after a failure sends it again
+        audio_capture_clear();
+    }
+
     if (responseLength)
     {
         // malloc documentId if the server uploaded ok
@@ -804,9 +879,11 @@ static int sendImage(esp_http_client_handle_t client, camera_fb_t *pic)
     return status;
 }
 
+// uploads pic and gives it back with camera_return_picture(), except when -1 is returned for
+// a missing session cookie, then the caller still holds it for the retry after the session check
 int https_send_pic(bool cookie, camera_fb_t *pic)
 {
-    char url[200] = "http://tutorfish-env.eba-tdamw63n.us-east-1.elasticbeanstalk.com/upload-image";
+    char url[200] = "http://" TUTORFISH_HOSTNAME "/upload-image";
 
     ESP_LOGI(TAG, "url = %s", url);
     esp_err_t err;
@@ -0,0 +1,16 @@
+#ifndef AUDIO_ADPCM_H__
+#define AUDIO_ADPCM_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define AUDIO_WAV_FORMAT_IMA_ADPCM (0x11)
+#define AUDIO_ADPCM_MAX_BLOCK (1024) // bytes, 2041 mono samples, the usual encoder default
+#define AUDIO_ADPCM_BLOCK_HEADER (4)
+
+#define AUDIO_ADPCM_BLOCK_SAMPLES(block_len) (1 + ((block_len) - AUDIO_ADPCM_BLOCK_HEADER) * 2)
+
+int audio_adpcm_decode_block(const uint8_t *block, size_t len, int16_t *out);
+int audio_adpcm_encode_block(const int16_t *samples, int count, int32_t *index, uint8_t *block);
+
+#endif //AUDIO_ADPCM_H__
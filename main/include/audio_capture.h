@@ -0,0 +1,16 @@
+#ifndef AUDIO_CAPTURE_H__
+#define AUDIO_CAPTURE_H__
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#define AUDIO_CAPTURE_QUESTION (1)            // record a spoken question after the picture is taken
+#define AUDIO_CAPTURE_ONSET_TIMEOUT_MS (4000) // no speech by then, the picture is sent alone
+#define AUDIO_CAPTURE_MAX_SPEECH_MS (10000)
+
+esp_err_t init_audio_capture(void);
+esp_err_t audio_capture_question(void);
+int audio_capture_wav(const uint8_t **wav);
+void audio_capture_clear(void);
+
+#endif //AUDIO_CAPTURE_H__
@@ -0,0 +1,79 @@
+#ifndef AUDIO_CLIP_H__
+#define AUDIO_CLIP_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+typedef enum
+{
+    // tutorfish audio, built from audio_source_files and linked into the app image (or
+    // into the audio pack when AUDIO_ASSETS_MODE is "pack")
+    AUDIO_CLIP_WELCOME_TO_TUTOR_FISH_01,
+    AUDIO_CLIP_SUBMIT_A_QUESTION_00,
+    AUDIO_CLIP_TUTOR_FISH_SETTINGS_00,
+    AUDIO_CLIP_LOOK_AT_YOUR_QUESTION_01,
+    AUDIO_CLIP_THE_CAMERA_TAKE_A_PIC_01,
+    AUDIO_CLIP_TO_CONSERVE_BATTERY_01,
+    AUDIO_CLIP_TAKING_A_PICTURE321_02,
+    AUDIO_CLIP_UPLOADING_THE_PICTURE_PLEASE_WAIT_00,
+    AUDIO_CLIP_TO_HEAR_THE_ANSWER_AGAIN_00,
+    AUDIO_CLIP_TUTORS_FOUND_ANSWER_00,
+    AUDIO_CLIP_TUTORS_LOOK_FOR_ANSWER_00,
+
+    // system audio, mapped from the audio pack on the "audio" partition, or read
+    // from littlefs there on devices without a pack
+    AUDIO_CLIP_CONFIRM_SFX_04,
+    AUDIO_CLIP_RETURNING_HOME_07,
+    AUDIO_CLIP_EXIT_THIS_APP_01,
+    AUDIO_CLIP_HOME_INSTRUCTIONS_00,
+    AUDIO_CLIP_ATTEMPT_WIFI_CONN_00,
+    AUDIO_CLIP_WIFI_DISCONN_00,
+    AUDIO_CLIP_ERROR_MESSAGE_00,
+    AUDIO_CLIP_WAIT_APP_LOADS_00,
+    AUDIO_CLIP_PERCENT_COMPLETED_00,
+    AUDIO_CLIP_ASCII_5_00,
+    AUDIO_CLIP_10_00,
+    AUDIO_CLIP_20_00,
+    AUDIO_CLIP_30_00,
+    AUDIO_CLIP_40_00,
+    AUDIO_CLIP_50_00,
+    AUDIO_CLIP_60_00,
+    AUDIO_CLIP_70_00,
+    AUDIO_CLIP_80_00,
+    AUDIO_CLIP_90_00,
+
+    AUDIO_CLIP_MAX
+} audio_clip_id_t;
+
+typedef struct
+{
+    audio_clip_id_t id;
+    const uint8_t *buf;
+    int len;
+} audio_clip_t;
+
+typedef struct
+{
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+    size_t cached_bytes;
+    size_t budget_bytes;
+    uint32_t prefetches;      // clips loaded by audio_clip_prefetch()
+    uint32_t prefetch_hits;   // prefetched clips acquired before they were evicted
+    uint32_t prefetch_wasted; // prefetched clips evicted without being acquired
+    size_t prefetched_bytes;
+    size_t prefetch_budget_bytes;
+} audio_clip_cache_stats_t;
+
+esp_err_t init_audio_clips(void);
+esp_err_t audio_clip_acquire(audio_clip_id_t id, const audio_clip_t **clip);
+void audio_clip_release(const audio_clip_t *clip);
+esp_err_t audio_clip_prefetch(audio_clip_id_t id);
+const char *audio_clip_name(audio_clip_id_t id);
+const char *audio_clip_path(audio_clip_id_t id);
+bool audio_clip_pack_loaded(void);
+void audio_clip_cache_stats(audio_clip_cache_stats_t *stats);
+
+#endif //AUDIO_CLIP_H__
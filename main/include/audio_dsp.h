@@ -0,0 +1,26 @@
+#ifndef AUDIO_DSP_H__
+#define AUDIO_DSP_H__
+
+#include <stdint.h>
+
+#define AUDIO_GAIN_Q15_ONE (1 << 15)
+#define AUDIO_GAIN_MAX (2 * AUDIO_GAIN_Q15_ONE) // +6 dB
+#define AUDIO_GAIN_RAMP_SAMPLES (256)           // 16 ms at 16 kHz
+#define AUDIO_FADE_IN_SAMPLES (80)              // 5 ms, short enough not to soften the first syllable
+#define AUDIO_FADE_OUT_SAMPLES (160)            // 10 ms
+
+typedef struct
+{
+    int32_t gain;   // Q15
+    int32_t target; // Q15
+    int32_t step;   // Q15 change per sample while ramping
+} audio_gain_t;
+
+int32_t audio_gain_from_volume(float volume);
+void audio_gain_init(audio_gain_t *gain, int32_t q15);
+void audio_gain_set(audio_gain_t *gain, int32_t q15);
+void audio_gain_ramp(audio_gain_t *gain, int32_t q15, int ramp_samples);
+void audio_gain_apply(audio_gain_t *gain, int16_t *samples, int len);
+void audio_mix(int16_t *dst, const int16_t *src, int len);
+
+#endif //AUDIO_DSP_H__
@@ -0,0 +1,37 @@
+#ifndef AUDIO_PACK_H__
+#define AUDIO_PACK_H__
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// layout written by tools/audio_pack.py, all fields little-endian:
+// header, clip_count index entries, then each clip's wav file on a 4 byte boundary
+#define AUDIO_PACK_MAGIC (0x50414654) // "TFAP"
+#define AUDIO_PACK_VERSION (1)
+#define AUDIO_PACK_NAME_LEN (48)
+#define AUDIO_PACK_ALIGN (4)
+
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t clip_count;
+    uint32_t pack_len; // header, index and clip data
+    uint32_t reserved;
+} audio_pack_header_t;
+
+typedef struct
+{
+    char name[AUDIO_PACK_NAME_LEN]; // nul terminated clip name, file name without .wav
+    uint32_t offset;                // from the start of the pack
+    uint32_t len;
+    uint16_t format; // wav format tag, informational
+    uint16_t channels;
+    uint32_t sample_rate;
+} audio_pack_entry_t;
+
+esp_err_t audio_pack_open(const char *partition_label);
+esp_err_t audio_pack_find(const char *name, const uint8_t **buf, int *len);
+int audio_pack_clip_count(void);
+
+#endif //AUDIO_PACK_H__
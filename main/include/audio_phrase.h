@@ -0,0 +1,16 @@
+#ifndef AUDIO_PHRASE_H__
+#define AUDIO_PHRASE_H__
+
+#include <stdbool.h>
+#include "esp_err.h"
+#include "audio_clip.h"
+
+// template slot that is replaced by the clips for the spoken value
+#define AUDIO_PHRASE_VALUE (AUDIO_CLIP_MAX)
+#define AUDIO_PHRASE_MAX_CLIPS (8)
+
+int audio_phrase_number(int value, audio_clip_id_t *clips, int max_clips);
+int audio_phrase_compose(const audio_clip_id_t *tmpl, int tmpl_len, int value, audio_clip_id_t *clips, int max_clips);
+esp_err_t audio_phrase_play(const audio_clip_id_t *tmpl, int tmpl_len, int value, bool stoppable);
+
+#endif //AUDIO_PHRASE_H__
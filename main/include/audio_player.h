@@ -0,0 +1,89 @@
+#ifndef AUDIO_PLAYER_H__
+#define AUDIO_PLAYER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "audio_clip.h"
+
+#define AUDIO_SAMPLE_RATE (16000)
+#define AUDIO_DMA_BUF_COUNT (8)  // largest DMA configuration, see init_i2s()
+#define AUDIO_DMA_BUF_LEN (1024) // samples per DMA buffer
+#define AUDIO_BLOCK_BYTES (AUDIO_DMA_BUF_LEN * sizeof(int16_t))
+#define AUDIO_RINGBUF_BLOCKS (4)
+#define AUDIO_RINGBUF_SIZE (AUDIO_RINGBUF_BLOCKS * AUDIO_BLOCK_BYTES)
+#define AUDIO_PLAYLIST_MAX (16)
+
+// returns the number of bytes read, 0 at the end of the source and < 0 on error
+typedef int (*audio_source_read_t)(void *ctx, uint8_t *buf, int len);
+typedef void (*audio_source_close_t)(void *ctx);
+
+typedef struct
+{
+    audio_source_read_t read;
+    audio_source_close_t close; // optional
+    void *ctx;
+} audio_source_t;
+
+typedef struct
+{
+    const uint8_t *buf;
+    int len;
+    int pos;
+} audio_mem_source_t;
+
+void audio_source_memory(audio_source_t *source, audio_mem_source_t *mem, const void *buf, int len);
+esp_err_t audio_source_file(audio_source_t *source, const char *path);
+
+// a stream preempts a playing stream of lower priority
+typedef enum
+{
+    AUDIO_PRIORITY_ANSWER,
+    AUDIO_PRIORITY_PROMPT,
+    AUDIO_PRIORITY_SFX,
+} audio_priority_t;
+
+typedef uint32_t audio_playback_handle_t;
+
+typedef struct
+{
+    audio_playback_handle_t id;
+    int64_t queued_us;   // audio_player_begin() was called
+    int64_t started_us;  // first block handed to I2S
+    int64_t finished_us; // last sample played or the stream was stopped
+    bool stopped;
+} audio_playback_info_t;
+
+typedef struct
+{
+    uint32_t underruns;           // the ring buffer ran dry while playing, the producer was late
+    uint32_t dma_underruns;       // a DMA buffer was sent before the player refilled it
+    uint32_t late_refills;        // refilled with less than one DMA buffer to spare
+    uint32_t max_event_jitter_us; // worst TX_DONE interval beyond the DMA buffer period
+    uint64_t played_us;
+    int dma_buf_count;
+    int dma_buf_len;
+} audio_player_stats_t;
+
+esp_err_t init_audio_player(int dma_buf_count, int dma_buf_len, QueueHandle_t i2s_events);
+esp_err_t audio_player_set_dma(int dma_buf_count, int dma_buf_len, QueueHandle_t i2s_events);
+esp_err_t audio_player_begin(float volume, bool stoppable, audio_priority_t priority, audio_playback_handle_t *handle);
+int audio_player_write(const void *data, int len);
+esp_err_t audio_player_write_source(audio_source_t *source);
+void audio_player_next_clip(void);
+void audio_player_end(void);
+esp_err_t audio_player_play(audio_source_t *source, float volume, bool stoppable, audio_priority_t priority);
+esp_err_t audio_player_mix_clip(const audio_clip_t *clip);
+void audio_player_stop(void);
+bool audio_player_is_playing(void);
+audio_playback_handle_t audio_player_current(void);
+esp_err_t audio_player_capture_begin(void);
+void audio_player_capture_end(void);
+esp_err_t audio_player_wait(audio_playback_handle_t handle, TickType_t timeout);
+esp_err_t audio_player_info(audio_playback_handle_t handle, audio_playback_info_t *info);
+void audio_player_set_volume(float volume);
+void audio_player_stats(audio_player_stats_t *stats);
+
+#endif //AUDIO_PLAYER_H__
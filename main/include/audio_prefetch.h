@@ -0,0 +1,10 @@
+#ifndef AUDIO_PREFETCH_H__
+#define AUDIO_PREFETCH_H__
+
+#include "esp_err.h"
+#include "state_machine.h"
+
+esp_err_t init_audio_prefetch(void);
+void audio_prefetch_state(state_machine_t state);
+
+#endif //AUDIO_PREFETCH_H__
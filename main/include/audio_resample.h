@@ -0,0 +1,33 @@
+#ifndef AUDIO_RESAMPLE_H__
+#define AUDIO_RESAMPLE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#define AUDIO_RESAMPLE_TAPS (32) // per phase, 15 input samples of delay
+#define AUDIO_RESAMPLE_PHASE_BITS (6)
+#define AUDIO_RESAMPLE_PHASES (1 << AUDIO_RESAMPLE_PHASE_BITS) // interpolated between, so 64 are plenty
+#define AUDIO_RESAMPLE_CHUNK (256) // input samples filtered per pass
+#define AUDIO_RESAMPLE_MIN_RATE (8000)
+#define AUDIO_RESAMPLE_MAX_RATE (48000)
+
+// output samples audio_resample() can produce from AUDIO_RESAMPLE_CHUNK input samples
+#define AUDIO_RESAMPLE_MAX_OUT(out_rate) (AUDIO_RESAMPLE_CHUNK * (out_rate) / AUDIO_RESAMPLE_MIN_RATE + 2)
+
+typedef struct
+{
+    uint32_t in_rate;
+    uint32_t out_rate;
+    uint64_t step; // input samples per output sample, Q32
+    uint64_t pos;  // position of the next output sample in window, Q32
+    int16_t coeffs[AUDIO_RESAMPLE_PHASES + 1][AUDIO_RESAMPLE_TAPS]; // Q15, a low-pass per phase
+    int16_t window[AUDIO_RESAMPLE_TAPS - 1 + AUDIO_RESAMPLE_CHUNK];
+    int window_len;
+} audio_resampler_t;
+
+esp_err_t audio_resampler_init(audio_resampler_t *rs, uint32_t in_rate, uint32_t out_rate);
+bool audio_resampler_active(const audio_resampler_t *rs);
+int audio_resample(audio_resampler_t *rs, const int16_t *in, int in_len, int16_t *out);
+
+#endif //AUDIO_RESAMPLE_H__
@@ -0,0 +1,34 @@
+#ifndef AUDIO_VAD_H__
+#define AUDIO_VAD_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define AUDIO_VAD_FRAME_SAMPLES (320)  // 20 ms at 16 kHz
+#define AUDIO_VAD_MIN_LEVEL (200)      // mean amplitude below which a frame is never speech
+#define AUDIO_VAD_ONSET_RATIO (4)      // voiced frames are this far above the noise floor
+#define AUDIO_VAD_ONSET_FRAMES (3)     // 60 ms of voice before speech starts
+#define AUDIO_VAD_HANGOVER_FRAMES (40) // 800 ms of silence ends the speech
+#define AUDIO_VAD_ZCR_VOICED (80)      // zero crossings per frame (2 kHz), noisier frames are not voiced
+#define AUDIO_VAD_ZCR_FRICATIVE (120)  // 3 kHz, a quiet frame this noisy is an unvoiced consonant
+
+typedef enum
+{
+    AUDIO_VAD_SILENCE,
+    AUDIO_VAD_ONSET, // first frame of speech, AUDIO_VAD_ONSET_FRAMES after it began
+    AUDIO_VAD_SPEECH,
+    AUDIO_VAD_END, // AUDIO_VAD_HANGOVER_FRAMES after the last speech frame
+} audio_vad_result_t;
+
+typedef struct
+{
+    int32_t noise_floor; // mean amplitude of the background, < 0 until the first frame
+    int voiced_frames;   // consecutive frames above the floor
+    int silent_frames;   // frames since the last speech frame
+    bool speaking;
+} audio_vad_t;
+
+void audio_vad_init(audio_vad_t *vad);
+audio_vad_result_t audio_vad_process(audio_vad_t *vad, const int16_t *frame, int len);
+
+#endif //AUDIO_VAD_H__
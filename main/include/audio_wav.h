@@ -0,0 +1,45 @@
+#ifndef AUDIO_WAV_H__
+#define AUDIO_WAV_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#define AUDIO_WAV_FORMAT_PCM (1)
+
+typedef enum
+{
+    AUDIO_WAV_STATE_RIFF,  // "RIFF" <size> "WAVE"
+    AUDIO_WAV_STATE_CHUNK, // <id> <size>
+    AUDIO_WAV_STATE_FMT,
+    AUDIO_WAV_STATE_SKIP,
+    AUDIO_WAV_STATE_DATA,
+    AUDIO_WAV_STATE_ERROR,
+} audio_wav_state_t;
+
+typedef struct
+{
+    uint16_t format;
+    uint16_t channels;
+    uint32_t sample_rate;
+    uint16_t block_align;
+    uint16_t bits_per_sample;
+    uint32_t data_len; // 0xFFFFFFFF or 0 when the writer did not know the length
+} audio_wav_format_t;
+
+// streaming parser state, the caller owns it so parsing never allocates
+typedef struct
+{
+    audio_wav_state_t state;
+    uint8_t hdr[16];
+    uint8_t hdr_len;
+    uint32_t chunk_remaining;
+    bool has_fmt;
+    audio_wav_format_t fmt;
+} audio_wav_parser_t;
+
+void audio_wav_parser_init(audio_wav_parser_t *parser);
+esp_err_t audio_wav_parse(audio_wav_parser_t *parser, const uint8_t *buf, size_t len, size_t *consumed);
+
+#endif //AUDIO_WAV_H__
@@ -1,9 +1,16 @@
 #ifndef CAMERA_H__
 #define CAMERA_H__
 
+#include "esp_camera.h"
+#include "camera_lifecycle.h"
+
 esp_err_t init_camera_pwdn(uint8_t level);
 esp_err_t toggle_camera_pwdn(uint8_t level);
 esp_err_t init_camera(void);
+esp_err_t init_camera_lifecycle(void);
+esp_err_t camera_set_state(camera_state_t state);
+esp_err_t camera_capture(camera_fb_t **pic);
+void camera_return_picture(camera_fb_t *pic);
 void capture_image(void);
 
 #define CAMERA_OFF (1)
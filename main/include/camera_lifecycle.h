@@ -0,0 +1,40 @@
+#ifndef CAMERA_LIFECYCLE_H__
+#define CAMERA_LIFECYCLE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+// in order, a change of state passes through every state between the two
+typedef enum
+{
+    CAMERA_STATE_OFF,     // driver deinitialised, no frame buffer, sensor powered down
+    CAMERA_STATE_STANDBY, // sensor powered down, its registers and the frame buffer are kept
+    CAMERA_STATE_WARM,    // powered and streaming frames that are discarded while exposure settles
+    CAMERA_STATE_CAPTURE, // powered and idle, the caller grabs the frames
+    CAMERA_STATE_MAX
+} camera_state_t;
+
+// what the lifecycle drives, the esp32-camera driver on the glasses
+typedef struct
+{
+    esp_err_t (*init)(void);      // allocates the frame buffer and loads the sensor registers, needs power
+    esp_err_t (*deinit)(void);
+    esp_err_t (*power)(bool on);  // the PWDN pin
+    esp_err_t (*stream)(bool on); // starts or stops discarding frames, stopping waits for the frame in flight
+    int64_t (*now_us)(void);
+} camera_driver_t;
+
+typedef struct
+{
+    const camera_driver_t *driver;
+    camera_state_t state;
+    bool streaming;
+    int64_t entered_us; // when the current state was entered
+} camera_lifecycle_t;
+
+void camera_lifecycle_init(camera_lifecycle_t *cam, const camera_driver_t *driver);
+esp_err_t camera_lifecycle_set(camera_lifecycle_t *cam, camera_state_t target);
+const char *camera_state_name(camera_state_t state);
+
+#endif //CAMERA_LIFECYCLE_H__
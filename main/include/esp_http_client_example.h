@@ -3,6 +3,8 @@
 
 #include "esp_camera.h"
 
+#define TUTORFISH_HOSTNAME "tutorfish-env.eba-tdamw63n.us-east-1.elasticbeanstalk.com"
+
 size_t http_get_request_(char *hostname, char *path, char *query, bool cookie);
 size_t http_post_request_(char *hostname, char *path, char *post_data, bool cookie);
 
@@ -0,0 +1,25 @@
+#ifndef JPEG_QUALITY_H__
+#define JPEG_QUALITY_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define JPEG_QUALITY_MIN (4)                      // 0-63, lower is finer
+#define JPEG_QUALITY_MAX (25)                     // the coarsest the old nvs exponent reached
+#define JPEG_QUALITY_TARGET_BYTES (320 * 1024)    // well inside the WQXGA frame buffer, ~3 s upload
+#define JPEG_QUALITY_DEADBAND_PCT (15)            // frames this close to the target keep the quality
+#define JPEG_QUALITY_SLOW_CAPTURE_US (1500000)    // a frame this slow counts as a full budget
+
+typedef struct
+{
+    int quality;
+    size_t target_bytes;
+} jpeg_quality_t;
+
+void jpeg_quality_init(jpeg_quality_t *ctl, int quality, size_t target_bytes);
+int jpeg_quality_frame(jpeg_quality_t *ctl, size_t len, uint32_t capture_us);
+int jpeg_quality_failed(jpeg_quality_t *ctl);
+bool jpeg_quality_within_budget(const jpeg_quality_t *ctl, size_t len);
+
+#endif //JPEG_QUALITY_H__
@@ -0,0 +1,13 @@
+#ifndef JPEG_SHARPNESS_H__
+#define JPEG_SHARPNESS_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#define JPEG_SHARPNESS_BAND_START (3) // zigzag indices of the luma coefficients scored
+#define JPEG_SHARPNESS_BAND_END (15)
+
+esp_err_t jpeg_sharpness_score(const uint8_t *jpeg, size_t len, uint32_t *score);
+
+#endif //JPEG_SHARPNESS_H__
@@ -0,0 +1,48 @@
+#ifndef LATENCY_TRACE_H__
+#define LATENCY_TRACE_H__
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#define LATENCY_TRACE_REPLAY (0)        // inject synthetic touches at boot and report the latencies
+#define LATENCY_TRACE_REPLAY_EVENTS (32)
+#define LATENCY_TRACE_HISTORY (64)      // latencies kept per stage for the percentiles
+#define LATENCY_TRACE_REPORT_EVERY (16) // traces between two reports
+
+// stages from an input to its prompt reaching i2s, in the order they are passed. a stage
+// that an input does not pass through is left out of that trace
+typedef enum
+{
+    LATENCY_STAGE_INPUT,        // touch threshold crossed or home button falling edge
+    LATENCY_STAGE_HANDLED,      // the input task has acted on it
+    LATENCY_STAGE_MENU,         // the main loop chose the prompt
+    LATENCY_STAGE_CLIP_READY,   // the clip is loaded
+    LATENCY_STAGE_QUEUED,       // the player accepted the stream
+    LATENCY_STAGE_FIRST_SAMPLE, // the first block was handed to i2s
+    LATENCY_STAGE_MAX
+} latency_stage_t;
+
+typedef enum
+{
+    LATENCY_SOURCE_TOUCH,
+    LATENCY_SOURCE_BUTTON,
+    LATENCY_SOURCE_REPLAY,
+} latency_source_t;
+
+typedef struct
+{
+    uint32_t count; // traces that reached the stage, the percentiles cover the last LATENCY_TRACE_HISTORY
+    uint32_t p50_us;
+    uint32_t p99_us;
+    uint32_t max_us;
+} latency_stats_t;
+
+esp_err_t init_latency_trace(void);
+void latency_trace_begin(latency_source_t source);
+void latency_trace_begin_from_isr(latency_source_t source);
+void latency_trace_mark(latency_stage_t stage);
+esp_err_t latency_trace_stats(latency_stage_t stage, latency_stats_t *stats);
+void latency_trace_report(void);
+void latency_trace_reset(void);
+
+#endif //LATENCY_TRACE_H__
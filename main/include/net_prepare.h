@@ -0,0 +1,16 @@
+#ifndef NET_PREPARE_H__
+#define NET_PREPARE_H__
+
+#include <stdbool.h>
+#include "esp_err.h"
+
+#define NET_PREPARE_OVERLAP (1) // connect and check the session while the picture is taken
+
+esp_err_t init_net_prepare(void);
+esp_err_t net_prepare_start(void);
+bool net_prepare_active(void);
+esp_err_t net_prepare_wifi(void);
+bool net_prepare_session(void);
+void net_prepare_cancel(void);
+
+#endif //NET_PREPARE_H__
@@ -2,6 +2,7 @@
 #define TOUCH_H__
 
 esp_err_t init_touch(void);
+void touch_replay(bool forward);
 
 extern uint8_t menu_selection_idx;
 extern bool touch_pad_forward;
@@ -1,10 +1,14 @@
 #ifndef WIFI_STATION_H__
 #define WIFI_STATION_H__
 
+#include <stdbool.h>
+#include "esp_err.h"
+
 esp_err_t wifi_init_sta(void);
 esp_err_t _esp_wifi_init(void);
 esp_err_t _wifi_deinit(void);
 esp_err_t start_wifi(void);
 esp_err_t stop_wifi(void);
+void wifi_announce_connection(bool announce);
 
 #endif // WIFI_STATION_H__
\ No newline at end of file
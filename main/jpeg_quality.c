@@ -0,0 +1,70 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "jpeg_quality.h"
+
+static int clamp_quality(int quality)
+{
+    return quality < JPEG_QUALITY_MIN ? JPEG_QUALITY_MIN : (quality > JPEG_QUALITY_MAX ? JPEG_QUALITY_MAX : quality);
+}
+
+void jpeg_quality_init(jpeg_quality_t *ctl, int quality, size_t target_bytes)
+{
+    ctl->quality = clamp_quality(quality);
+    ctl->target_bytes = target_bytes;
+}
+
+// steers the quality of the next frame from the last one. the jpeg size falls roughly in
+// proportion as the quantiser value rises, so the quality is scaled by how far the frame
+// was from the budget, at most 1.5x coarser or 0.75x finer per frame so a single odd frame
+// cannot throw it to the limits. a slow capture, usually a noisy low light frame, pushes
+// the same way as a large one. returns the quality to set
+int jpeg_quality_frame(jpeg_quality_t *ctl, size_t len, uint32_t capture_us)
+{
+    const int size_pct = (int)((uint64_t)len * 100 / ctl->target_bytes);
+    const int time_pct = (int)((uint64_t)capture_us * 100 / JPEG_QUALITY_SLOW_CAPTURE_US);
+    const int pressure_pct = size_pct > time_pct ? size_pct : time_pct;
+
+    if (pressure_pct >= 100 - JPEG_QUALITY_DEADBAND_PCT && pressure_pct <= 100 + JPEG_QUALITY_DEADBAND_PCT)
+    {
+        return ctl->quality;
+    }
+
+    const int q = ctl->quality;
+    int next = (q * pressure_pct + 50) / 100;
+
+    if (next > q * 3 / 2)
+    {
+        next = q * 3 / 2;
+    }
+    if (next < q * 3 / 4)
+    {
+        next = q * 3 / 4;
+    }
+
+    // outside the deadband the quality always moves
+    if (next == q)
+    {
+        next += pressure_pct > 100 ? 1 : -1;
+    }
+
+    ctl->quality = clamp_quality(next);
+    return ctl->quality;
+}
+
+// a frame the driver could not deliver has usually overflowed the frame buffer, the same
+// step the nvs exponent took between attempts
+int jpeg_quality_failed(jpeg_quality_t *ctl)
+{
+    const int q = ctl->quality;
+    const int next = q * 4 / 3 > q ? q * 4 / 3 : q + 1;
+
+    ctl->quality = clamp_quality(next);
+    return ctl->quality;
+}
+
+bool jpeg_quality_within_budget(const jpeg_quality_t *ctl, size_t len)
+{
+    return (uint64_t)len * 100 <= (uint64_t)ctl->target_bytes * (100 + JPEG_QUALITY_DEADBAND_PCT);
+}
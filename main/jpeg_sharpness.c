@@ -0,0 +1,499 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "jpeg_sharpness.h"
+
+// scores the focus of a baseline jpeg from its dct coefficients. the entropy coded data is
+// huffman decoded but never inverse transformed, so a frame costs a fraction of decoding
+// it. the score is the rms of the dequantised luma coefficients in a middle band: blur
+// empties it first, the lowest frequencies mostly follow the lighting and the highest the
+// sensor noise. dequantising keeps frames taken at different qualities comparable, the
+// score is only meaningful between frames of the same scene
+
+#define HUFFMAN_LUT_BITS (9)
+#define MAX_COMPONENTS (3)
+#define MAX_BLOCKS_PER_MCU (10)
+
+typedef struct
+{
+    uint16_t lut[1 << HUFFMAN_LUT_BITS]; // (length << 8) | symbol for the short codes, 0 for the longer ones
+    int32_t maxcode[18];                 // largest code of each length, -1 when there is none
+    int32_t valoffset[17];               // index into values less the first code of each length
+    uint8_t values[256];
+    bool defined;
+} huffman_t;
+
+typedef struct
+{
+    uint8_t id;
+    uint8_t h;
+    uint8_t v;
+    uint8_t tq;
+    uint8_t td;
+    uint8_t ta;
+} component_t;
+
+typedef struct
+{
+    const uint8_t *p;
+    const uint8_t *end;
+    uint32_t bits; // msb first
+    int count;
+    bool marker; // reached a marker, zeros are fed from here on
+    int padded;  // zero bytes fed since the marker
+} bit_reader_t;
+
+// static, the tables are too large for the stack of the task taking pictures
+static huffman_t dc_tables[4];
+static huffman_t ac_tables[4];
+static uint16_t quant_tables[4][64]; // in zigzag order, as the coefficients are decoded
+
+static esp_err_t build_huffman(huffman_t *h, const uint8_t *counts, const uint8_t *values, int total)
+{
+    memset(h, 0, sizeof(huffman_t));
+    memcpy(h->values, values, total);
+
+    int32_t code = 0;
+    int k = 0;
+
+    for (int len = 1; len <= 16; len++)
+    {
+        h->valoffset[len] = k - code;
+
+        for (int i = 0; i < counts[len - 1]; i++, k++, code++)
+        {
+            // more codes than the length has room for
+            if (code >= (1 << len))
+            {
+                return ESP_ERR_INVALID_ARG;
+            }
+
+            if (len <= HUFFMAN_LUT_BITS)
+            {
+                const int shift = HUFFMAN_LUT_BITS - len;
+                for (int j = 0; j < (1 << shift); j++)
+                {
+                    h->lut[(code << shift) | j] = (len << 8) | values[k];
+                }
+            }
+        }
+
+        h->maxcode[len] = counts[len - 1] ? code - 1 : -1;
+        code <<= 1;
+    }
+
+    h->maxcode[17] = INT32_MAX;
+    h->defined = true;
+
+    return ESP_OK;
+}
+
+static void fill_bits(bit_reader_t *b)
+{
+    while (b->count <= 24)
+    {
+        uint32_t byte = 0;
+
+        if (!b->marker && b->p < b->end)
+        {
+            byte = *b->p;
+
+            if (byte != 0xFF)
+            {
+                b->p++;
+            }
+            else if (b->p + 1 < b->end && b->p[1] == 0x00)
+            {
+                // stuffed zero
+                b->p += 2;
+            }
+            else
+            {
+                b->marker = true;
+                byte = 0;
+            }
+        }
+
+        if (b->marker || b->p >= b->end)
+        {
+            b->padded++;
+        }
+
+        b->bits |= byte << (24 - b->count);
+        b->count += 8;
+    }
+}
+
+static inline uint32_t take_bits(bit_reader_t *b, int n)
+{
+    const uint32_t value = b->bits >> (32 - n);
+    b->bits <<= n;
+    b->count -= n;
+    return value;
+}
+
+static int decode_symbol(bit_reader_t *b, const huffman_t *h)
+{
+    fill_bits(b);
+
+    const uint16_t entry = h->lut[b->bits >> (32 - HUFFMAN_LUT_BITS)];
+    if (entry != 0)
+    {
+        take_bits(b, entry >> 8);
+        return entry & 0xFF;
+    }
+
+    for (int len = HUFFMAN_LUT_BITS + 1; len <= 16; len++)
+    {
+        const int32_t code = b->bits >> (32 - len);
+        if (code <= h->maxcode[len])
+        {
+            take_bits(b, len);
+            return h->values[h->valoffset[len] + code];
+        }
+    }
+
+    return -1;
+}
+
+// bits taken from the zeros fed past a marker mean the data was cut short or is corrupt,
+// a complete segment pads its last byte with ones
+static bool overran(const bit_reader_t *b)
+{
+    return b->padded * 8 > b->count;
+}
+
+// walks one block, adding the energy of its band to energy when quant is given
+static esp_err_t decode_block(bit_reader_t *b, const huffman_t *dc, const huffman_t *ac, const uint16_t *quant,
+                              uint64_t *energy)
+{
+    const int dc_bits = decode_symbol(b, dc);
+    if (dc_bits < 0 || dc_bits > 11)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (dc_bits > 0)
+    {
+        fill_bits(b);
+        take_bits(b, dc_bits);
+    }
+
+    for (int k = 1; k < 64;)
+    {
+        const int rs = decode_symbol(b, ac);
+        if (rs < 0)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        const int run = rs >> 4;
+        const int size = rs & 0x0F;
+
+        if (size == 0)
+        {
+            if (run != 15)
+            {
+                break; // end of block
+            }
+            k += 16;
+            continue;
+        }
+
+        k += run;
+        if (k > 63)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        fill_bits(b);
+        int32_t value = take_bits(b, size);
+        if (value < (1 << (size - 1)))
+        {
+            value -= (1 << size) - 1;
+        }
+
+        if (quant != NULL && k >= JPEG_SHARPNESS_BAND_START && k < JPEG_SHARPNESS_BAND_END)
+        {
+            const int64_t c = (int64_t)value * quant[k];
+            *energy += c * c;
+        }
+
+        k++;
+    }
+
+    return ESP_OK;
+}
+
+static uint16_t read_u16(const uint8_t *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+// higher scores are sharper. ESP_ERR_NOT_SUPPORTED for progressive, 12 bit or multi scan
+// files, none of which the camera produces, ESP_ERR_INVALID_SIZE for a truncated one
+esp_err_t jpeg_sharpness_score(const uint8_t *jpeg, size_t len, uint32_t *score)
+{
+    component_t components[MAX_COMPONENTS];
+    int component_count = 0;
+    int width = 0;
+    int height = 0;
+    int restart_interval = 0;
+
+    if (len < 4 || jpeg[0] != 0xFF || jpeg[1] != 0xD8)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+        dc_tables[i].defined = false;
+        ac_tables[i].defined = false;
+        for (int k = 0; k < 64; k++)
+        {
+            quant_tables[i][k] = 1;
+        }
+    }
+
+    const uint8_t *p = jpeg + 2;
+    const uint8_t *const end = jpeg + len;
+
+    while (p + 4 <= end)
+    {
+        if (p[0] != 0xFF)
+        {
+            p++;
+            continue;
+        }
+
+        const uint8_t marker = p[1];
+        if (marker == 0xFF || marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7))
+        {
+            p += marker == 0xFF ? 1 : 2;
+            continue;
+        }
+        if (marker == 0xD9)
+        {
+            break;
+        }
+
+        const int seg_len = read_u16(p + 2);
+        const uint8_t *seg = p + 4;
+        const uint8_t *const seg_end = p + 2 + seg_len;
+        if (seg_len < 2 || seg_end > end)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        switch (marker)
+        {
+        case 0xDB: // quantisation tables
+            while (seg < seg_end)
+            {
+                const int precision = seg[0] >> 4;
+                uint16_t *table = quant_tables[seg[0] & 0x03];
+                seg++;
+                if (seg + 64 * (precision + 1) > seg_end)
+                {
+                    return ESP_ERR_INVALID_ARG;
+                }
+                for (int k = 0; k < 64; k++)
+                {
+                    table[k] = precision ? read_u16(seg + 2 * k) : seg[k];
+                }
+                seg += 64 * (precision + 1);
+            }
+            break;
+        case 0xC4: // huffman tables
+            while (seg + 17 <= seg_end)
+            {
+                const int table_class = seg[0] >> 4;
+                const int table_id = seg[0] & 0x03;
+                const uint8_t *counts = seg + 1;
+                int total = 0;
+                for (int i = 0; i < 16; i++)
+                {
+                    total += counts[i];
+                }
+                if (total > 256 || seg + 17 + total > seg_end)
+                {
+                    return ESP_ERR_INVALID_ARG;
+                }
+
+                esp_err_t err = build_huffman(table_class ? &ac_tables[table_id] : &dc_tables[table_id], counts, seg + 17, total);
+                if (err != ESP_OK)
+                {
+                    return err;
+                }
+                seg += 17 + total;
+            }
+            break;
+        case 0xC0: // baseline
+        case 0xC1: // extended huffman
+            if (seg[0] != 8 || seg_len < 8)
+            {
+                return ESP_ERR_NOT_SUPPORTED;
+            }
+            height = read_u16(seg + 1);
+            width = read_u16(seg + 3);
+            component_count = seg[5];
+            if (component_count < 1 || component_count > MAX_COMPONENTS || seg_len < 8 + 3 * component_count)
+            {
+                return ESP_ERR_NOT_SUPPORTED;
+            }
+            for (int i = 0; i < component_count; i++)
+            {
+                components[i].id = seg[6 + 3 * i];
+                components[i].h = seg[7 + 3 * i] >> 4;
+                components[i].v = seg[7 + 3 * i] & 0x0F;
+                components[i].tq = seg[8 + 3 * i] & 0x03;
+                if (components[i].h < 1 || components[i].v < 1)
+                {
+                    return ESP_ERR_INVALID_ARG;
+                }
+            }
+            break;
+        case 0xC2:
+        case 0xC3:
+        case 0xC5:
+        case 0xC6:
+        case 0xC7:
+        case 0xC9:
+        case 0xCA:
+        case 0xCB:
+        case 0xCD:
+        case 0xCE:
+        case 0xCF:
+            return ESP_ERR_NOT_SUPPORTED;
+        case 0xDD: // restart interval
+            if (seg_len < 4)
+            {
+                return ESP_ERR_INVALID_ARG;
+            }
+            restart_interval = read_u16(seg);
+            break;
+        case 0xDA: // start of scan
+        {
+            // one scan holding every component, as the camera writes it
+            if (component_count == 0 || seg_len < 6 + 2 * component_count || seg[0] != component_count)
+            {
+                return ESP_ERR_NOT_SUPPORTED;
+            }
+            for (int i = 0; i < component_count; i++)
+            {
+                if (seg[1 + 2 * i] != components[i].id)
+                {
+                    return ESP_ERR_NOT_SUPPORTED;
+                }
+                components[i].td = seg[2 + 2 * i] >> 4 & 0x03;
+                components[i].ta = seg[2 + 2 * i] & 0x03;
+                if (!dc_tables[components[i].td].defined || !ac_tables[components[i].ta].defined)
+                {
+                    return ESP_ERR_INVALID_ARG;
+                }
+            }
+
+            // the blocks of one mcu in scan order, by component index
+            uint8_t mcu_blocks[MAX_BLOCKS_PER_MCU];
+            int blocks_per_mcu = 0;
+            int h_max = 1;
+            int v_max = 1;
+
+            if (component_count == 1)
+            {
+                // a single component scan is never interleaved, one block per mcu
+                mcu_blocks[blocks_per_mcu++] = 0;
+            }
+            else
+            {
+                for (int i = 0; i < component_count; i++)
+                {
+                    h_max = components[i].h > h_max ? components[i].h : h_max;
+                    v_max = components[i].v > v_max ? components[i].v : v_max;
+                    for (int j = 0; j < components[i].h * components[i].v; j++)
+                    {
+                        if (blocks_per_mcu == MAX_BLOCKS_PER_MCU)
+                        {
+                            return ESP_ERR_INVALID_ARG;
+                        }
+                        mcu_blocks[blocks_per_mcu++] = i;
+                    }
+                }
+            }
+
+            int luma_per_mcu = 0;
+            for (int i = 0; i < blocks_per_mcu; i++)
+            {
+                luma_per_mcu += mcu_blocks[i] == 0;
+            }
+
+            const int mcus = ((width + 8 * h_max - 1) / (8 * h_max)) * ((height + 8 * v_max - 1) / (8 * v_max));
+            bit_reader_t bits = {.p = seg_end, .end = end};
+            uint64_t energy = 0;
+            uint32_t blocks = 0;
+
+            for (int mcu = 0; mcu < mcus; mcu++)
+            {
+                if (overran(&bits))
+                {
+                    return ESP_ERR_INVALID_SIZE;
+                }
+
+                if (restart_interval && mcu > 0 && mcu % restart_interval == 0)
+                {
+                    // the data restarts byte aligned after an RSTn marker
+                    bits.bits = 0;
+                    bits.count = 0;
+                    bits.marker = false;
+                    bits.padded = 0;
+                    while (bits.p + 1 < end && bits.p[0] == 0xFF && bits.p[1] == 0xFF)
+                    {
+                        bits.p++;
+                    }
+                    if (bits.p + 1 < end && bits.p[0] == 0xFF && (bits.p[1] & 0xF8) == 0xD0)
+                    {
+                        bits.p += 2;
+                    }
+                }
+
+                for (int i = 0; i < blocks_per_mcu; i++)
+                {
+                    const component_t *c = &components[mcu_blocks[i]];
+                    esp_err_t err = decode_block(&bits, &dc_tables[c->td], &ac_tables[c->ta],
+                                                 mcu_blocks[i] == 0 ? quant_tables[c->tq] : NULL, &energy);
+                    if (err != ESP_OK)
+                    {
+                        return err;
+                    }
+                }
+
+                blocks += luma_per_mcu;
+            }
+
+            if (overran(&bits))
+            {
+                return ESP_ERR_INVALID_SIZE;
+            }
+
+            // a zero sized frame, or a scan without the luma, has nothing to score
+            if (blocks == 0)
+            {
+                return ESP_ERR_INVALID_SIZE;
+            }
+
+            *score = (uint32_t)sqrt((double)energy / blocks);
+
+            return ESP_OK;
+        }
+        default:
+            break;
+        }
+
+        p = seg_end;
+    }
+
+    return ESP_ERR_INVALID_ARG;
+}
@@ -0,0 +1,253 @@
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "latency_trace.h"
+#include "touch.h"
+
+static const char *TAG = "latency_trace.c";
+
+#define LATENCY_TRACE_TIMEOUT_US (3000000) // an input that started no prompt by then is dropped
+#define LATENCY_TRACE_REPLAY_INTERVAL_MS (1500)
+
+// timestamps come from esp_timer rather than the cpu cycle counters, the stages run on
+// both cores and the counters of the two cores are neither synchronised nor scaled alike
+static portMUX_TYPE trace_lock = portMUX_INITIALIZER_UNLOCKED;
+static int64_t stage_us[LATENCY_STAGE_MAX]; // 0 for stages not reached
+static latency_source_t trace_source;
+static bool tracing = false;
+
+// microseconds spent reaching each stage from the one before it, the input slot holds
+// the whole input to first sample latency
+static uint32_t history[LATENCY_STAGE_MAX][LATENCY_TRACE_HISTORY];
+static uint32_t history_count[LATENCY_STAGE_MAX];
+static uint32_t traces = 0;
+
+static const char *const stage_names[LATENCY_STAGE_MAX] = {
+    [LATENCY_STAGE_INPUT] = "total",
+    [LATENCY_STAGE_HANDLED] = "handled",
+    [LATENCY_STAGE_MENU] = "menu",
+    [LATENCY_STAGE_CLIP_READY] = "clip ready",
+    [LATENCY_STAGE_QUEUED] = "queued",
+    [LATENCY_STAGE_FIRST_SAMPLE] = "first sample",
+};
+
+static const char *const source_names[] = {
+    [LATENCY_SOURCE_TOUCH] = "touch",
+    [LATENCY_SOURCE_BUTTON] = "button",
+    [LATENCY_SOURCE_REPLAY] = "replay",
+};
+
+static void record(latency_stage_t stage, int64_t us)
+{
+    history[stage][history_count[stage] % LATENCY_TRACE_HISTORY] = us;
+    history_count[stage]++;
+}
+
+// called with the finished trace copied out of the lock
+static void finish_trace(const int64_t *us, latency_source_t source)
+{
+    int64_t previous = us[LATENCY_STAGE_INPUT];
+
+    for (int stage = LATENCY_STAGE_HANDLED; stage < LATENCY_STAGE_MAX; stage++)
+    {
+        if (us[stage] != 0)
+        {
+            record(stage, us[stage] - previous);
+            previous = us[stage];
+        }
+    }
+
+    const int64_t total = us[LATENCY_STAGE_FIRST_SAMPLE] - us[LATENCY_STAGE_INPUT];
+    record(LATENCY_STAGE_INPUT, total);
+
+    ESP_LOGI(TAG, "%s to first sample %lld us", source_names[source], total);
+
+    if (++traces % LATENCY_TRACE_REPORT_EVERY == 0)
+    {
+        latency_trace_report();
+    }
+}
+
+// starts a trace, an unfinished one is replaced since its input has been superseded
+void latency_trace_begin(latency_source_t source)
+{
+    const int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&trace_lock);
+    memset(stage_us, 0, sizeof(stage_us));
+    stage_us[LATENCY_STAGE_INPUT] = now;
+    trace_source = source;
+    tracing = true;
+    portEXIT_CRITICAL(&trace_lock);
+}
+
+void IRAM_ATTR latency_trace_begin_from_isr(latency_source_t source)
+{
+    const int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL_ISR(&trace_lock);
+    for (int stage = 0; stage < LATENCY_STAGE_MAX; stage++)
+    {
+        stage_us[stage] = 0;
+    }
+    stage_us[LATENCY_STAGE_INPUT] = now;
+    trace_source = source;
+    tracing = true;
+    portEXIT_CRITICAL_ISR(&trace_lock);
+}
+
+// records the first time the current trace reaches stage, the first sample ends the trace
+void latency_trace_mark(latency_stage_t stage)
+{
+    if (!tracing || stage <= LATENCY_STAGE_INPUT || stage >= LATENCY_STAGE_MAX)
+    {
+        return;
+    }
+
+    const int64_t now = esp_timer_get_time();
+    int64_t us[LATENCY_STAGE_MAX];
+    latency_source_t source;
+    bool finished = false;
+
+    portENTER_CRITICAL(&trace_lock);
+    if (tracing && now - stage_us[LATENCY_STAGE_INPUT] > LATENCY_TRACE_TIMEOUT_US)
+    {
+        // the input led to no prompt, this stage belongs to something else
+        tracing = false;
+    }
+    else if (tracing && stage_us[stage] == 0)
+    {
+        stage_us[stage] = now;
+
+        if (stage == LATENCY_STAGE_FIRST_SAMPLE)
+        {
+            memcpy(us, stage_us, sizeof(us));
+            source = trace_source;
+            tracing = false;
+            finished = true;
+        }
+    }
+    portEXIT_CRITICAL(&trace_lock);
+
+    if (finished)
+    {
+        finish_trace(us, source);
+    }
+}
+
+// nearest rank, so the p99 of a short history is its maximum rather than the second largest
+static uint32_t percentile(const uint32_t *sorted, int count, int pct)
+{
+    return sorted[(count * pct + 99) / 100 - 1];
+}
+
+// p50, p99 and the maximum of the latencies kept for stage, ESP_ERR_NOT_FOUND before any
+// trace has reached it
+esp_err_t latency_trace_stats(latency_stage_t stage, latency_stats_t *stats)
+{
+    uint32_t sorted[LATENCY_TRACE_HISTORY];
+
+    if (stage >= LATENCY_STAGE_MAX || stats == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const int count = history_count[stage] < LATENCY_TRACE_HISTORY ? history_count[stage] : LATENCY_TRACE_HISTORY;
+    if (count == 0)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    memcpy(sorted, history[stage], count * sizeof(uint32_t));
+
+    // insertion sort, the history is short
+    for (int i = 1; i < count; i++)
+    {
+        const uint32_t v = sorted[i];
+        int j = i - 1;
+        for (; j >= 0 && sorted[j] > v; j--)
+        {
+            sorted[j + 1] = sorted[j];
+        }
+        sorted[j + 1] = v;
+    }
+
+    stats->count = history_count[stage];
+    stats->p50_us = percentile(sorted, count, 50);
+    stats->p99_us = percentile(sorted, count, 99);
+    stats->max_us = sorted[count - 1];
+
+    return ESP_OK;
+}
+
+// logs the stats of every stage
+void latency_trace_report(void)
+{
+    latency_stats_t stats;
+
+    ESP_LOGI(TAG, "input to audio latency, up to the last %d traces (us):", LATENCY_TRACE_HISTORY);
+
+    for (int stage = 0; stage < LATENCY_STAGE_MAX; stage++)
+    {
+        if (latency_trace_stats(stage, &stats) == ESP_OK)
+        {
+            ESP_LOGI(TAG, "  %-12s n %4u  p50 %7u  p99 %7u  max %7u", stage_names[stage], stats.count, stats.p50_us,
+                     stats.p99_us, stats.max_us);
+        }
+    }
+}
+
+// forgets the kept latencies and any trace in flight, to measure a new run on its own
+void latency_trace_reset(void)
+{
+    portENTER_CRITICAL(&trace_lock);
+    tracing = false;
+    portEXIT_CRITICAL(&trace_lock);
+
+    memset(history_count, 0, sizeof(history_count));
+    traces = 0;
+}
+
+// alternates synthetic forward and backward touches through the touch pad handlers, so the
+// menu prompts are played exactly as for a finger, then reports
+static void latency_replay_task(void *pvParameters)
+{
+    for (int i = 0; i < LATENCY_TRACE_REPLAY_EVENTS; i++)
+    {
+        vTaskDelay(LATENCY_TRACE_REPLAY_INTERVAL_MS / portTICK_PERIOD_MS);
+
+        touch_replay(i % 2 == 0);
+    }
+
+    vTaskDelay(LATENCY_TRACE_REPLAY_INTERVAL_MS / portTICK_PERIOD_MS);
+    latency_trace_report();
+
+    vTaskDelete(NULL);
+}
+
+esp_err_t init_latency_trace(void)
+{
+    if (!LATENCY_TRACE_REPLAY)
+    {
+        return ESP_OK;
+    }
+
+    BaseType_t task_err = xTaskCreatePinnedToCore(latency_replay_task, "latency_replay_task", 2048, NULL, 1, NULL, 1);
+    if (task_err != pdPASS)
+    {
+        ESP_LOGE(TAG, "xTaskCreatePinnedToCore(latency_replay_task) err: %d", task_err);
+
+        task_err = xTaskCreate(latency_replay_task, "latency_replay_task", 2048, NULL, 1, NULL);
+        if (task_err != pdPASS)
+        {
+            ESP_LOGE(TAG, "xTaskCreate(latency_replay_task) err: %d", task_err);
+            return ESP_FAIL;
+        }
+    }
+
+    return ESP_OK;
+}
@@ -36,6 +36,10 @@ bool tutorfish_settings_init = false;
 static bool tutorfish_playback_answer_init = false;
 
 #include "audio_io.h"
+#include "audio_prefetch.h"
+#include "audio_capture.h"
+#include "latency_trace.h"
+#include "net_prepare.h"
 bool repeat_tts_playback = false;
 float audio_volume;
 
@@ -77,7 +81,7 @@ esp_err_t get_new_session_cookie(void)
     strcat(post_data, json_obj_ending);
 
     // retreive session cookie for account access
-    size_t http_status = http_post_request_("tutorfish-env.eba-tdamw63n.us-east-1.elasticbeanstalk.com", "/session-smartglasses-login", post_data, false);
+    size_t http_status = http_post_request_(TUTORFISH_HOSTNAME, "/session-smartglasses-login", post_data, false);
     if (http_status == 600)
     {
         // TODO : handle esp error
@@ -232,16 +236,27 @@ void app_main(void)
 
     print_nvs_credentials();
 
-    // LittleFs configuration struct
-    esp_vfs_littlefs_conf_t conf = {
-        .base_path = "/audio",
-        .partition_label = "audio",
-        .format_if_mount_failed = true};
-
-    err = init_littlefs(conf);
+    err = init_audio_clips();
     if (err != ESP_OK)
     {
-        ESP_LOGE(TAG, "init_littlefs() err: %s", esp_err_to_name(err));
+        ESP_LOGE(TAG, "init_audio_clips() err: %s", esp_err_to_name(err));
+        esp_restart();
+    }
+
+    // a partition holding an audio pack would be formatted by the littlefs mount
+    if (!audio_clip_pack_loaded())
+    {
+        // LittleFs configuration struct
+        esp_vfs_littlefs_conf_t conf = {
+            .base_path = "/audio",
+            .partition_label = "audio",
+            .format_if_mount_failed = true};
+
+        err = init_littlefs(conf);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "init_littlefs() err: %s", esp_err_to_name(err));
+        }
     }
 
     err = init_i2s();
@@ -251,23 +266,35 @@ void app_main(void)
         esp_restart();
     }
 
-    err = init_camera_pwdn(CAMERA_ON);
+    err = init_audio_prefetch();
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "init_audio_prefetch() err: %s", esp_err_to_name(err));
+    }
+
+    err = init_audio_capture();
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "init_audio_capture() err: %s", esp_err_to_name(err));
+    }
+
+    err = init_camera_pwdn(CAMERA_OFF);
     if (err != ESP_OK)
     {
         ESP_LOGE(TAG, "init_camera_pwdn() err: %s", esp_err_to_name(err));
     }
 
-    err = init_camera();
+    err = init_camera_lifecycle();
     if (err != ESP_OK)
     {
-        ESP_LOGE(TAG, "init_camera() err: %s", esp_err_to_name(err));
+        ESP_LOGE(TAG, "init_camera_lifecycle() err: %s", esp_err_to_name(err));
         esp_restart();
     }
 
-    err = toggle_camera_pwdn(CAMERA_OFF);
+    err = init_net_prepare();
     if (err != ESP_OK)
     {
-        ESP_LOGE(TAG, "toggle_camera_pwdn() err: %s", esp_err_to_name(err));
+        ESP_LOGE(TAG, "init_net_prepare() err: %s", esp_err_to_name(err));
     }
 
     err = init_home_button();
@@ -284,6 +311,12 @@ void app_main(void)
         esp_restart();
     }
 
+    err = init_latency_trace();
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "init_latency_trace() err: %s", esp_err_to_name(err));
+    }
+
     err = init_blue_led();
     if (err != ESP_OK)
     {
@@ -300,11 +333,15 @@ void app_main(void)
 
     while (true)
     {
+        // warm the prompts of the likely next states while this one runs
+        audio_prefetch_state(state_machine);
+
         switch (state_machine)
         {
         case CONNECT_TO_WIFI:
 
-            if (!wifi_bt_status.wifi_init)
+            // a connection started with the picture has already initialised the wifi
+            if (!wifi_bt_status.wifi_init && !net_prepare_active())
             {
                 err = _esp_wifi_init();
                 if (err == ESP_OK)
@@ -317,7 +354,7 @@ void app_main(void)
                 }
             }
 
-            if (!wifi_bt_status.wifi_sta_init)
+            if (!wifi_bt_status.wifi_sta_init && !net_prepare_active())
             {
                 err = wifi_init_sta();
                 if (err == ESP_OK)
@@ -343,28 +380,10 @@ void app_main(void)
             // playback submit a question before connecting to wifi
             if (tutorfish_submit_question_init)
             {
-                if (audio_buf.submit_a_question_00_wav_audio_buf == NULL)
-                {
-                    err = malloc_submit_a_question_00_wav();
-                    if (err != ESP_OK)
-                    {
-                        ESP_LOGE(TAG, "malloc_tutor_fish_settings_00_wav() err: %s", esp_err_to_name(err));
-                    }
-
-                    if (err == ESP_OK)
-                    {
-                        playback_audio_file(audio_buf.submit_a_question_00_wav_audio_buf, audio_buf.submit_a_question_00_wav_len, audio_volume, false);
-                        if (err != ESP_OK)
-                        {
-                            ESP_LOGE(TAG, "playback_audio_file(submit_a_question_00_wav_audio_buf) err: %s", esp_err_to_name(err));
-                        }
-
-                        free_submit_a_question_00();
-                    }
-                }
+                err = playback_audio_clip(AUDIO_CLIP_SUBMIT_A_QUESTION_00, false);
             }
 
-            err = start_wifi();
+            err = net_prepare_active() ? net_prepare_wifi() : start_wifi();
             if (err == ESP_OK)
             {
                 if (blue_led_task_init)
@@ -473,66 +492,12 @@ void app_main(void)
             {
                 ESP_LOGI(TAG, "TUTORFISH_HOME");
 
-                if (audio_buf.welcome_01_wav_audio_buf == NULL)
-                {
-                    err = malloc_welcome_to_tutor_fish_01();
-                    if (err != ESP_OK)
-                    {
-                        ESP_LOGE(TAG, "malloc_welcome_to_tutor_fish_01() err: %s", esp_err_to_name(err));
-                    }
-
-                    if (err == ESP_OK)
-                    {
-                        playback_audio_file(audio_buf.welcome_01_wav_audio_buf, audio_buf.welcome_01_audio_len, audio_volume, false);
-                        if (err != ESP_OK)
-                        {
-                            ESP_LOGE(TAG, "playback_audio_file(welcome_01_wav_audio_buf) err: %s", esp_err_to_name(err));
-                        }
-
-                        free_welcome_to_tutor_fish_01();
-                    }
-                }
+                err = playback_audio_clip(AUDIO_CLIP_WELCOME_TO_TUTOR_FISH_01, false);
 
                 /*
-                if (audio_buf.home_instructions_00_wav_audio_buf == NULL)
-                {
-                    err = malloc_home_instructions_00_wav();
-                    if (err != ESP_OK)
-                    {
-                        ESP_LOGE(TAG, "malloc_home_instructions_00_wav() err: %s", esp_err_to_name(err));
-                    }
-
-                    if (err == ESP_OK)
-                    {
-                        playback_audio_file(audio_buf.home_instructions_00_wav_audio_buf, audio_buf.home_instructions_00_wav_audio_len, audio_volume, true);
-                        if (err != ESP_OK)
-                        {
-                            ESP_LOGE(TAG, "playback_audio_file(home_instructions_00_wav_audio_buf) err: %s", esp_err_to_name(err));
-                        }
-
-                        free_home_instructions_00();
-                    }
-                }
-
-                if (audio_buf.exit_this_app_00_wav_audio_buf == NULL)
-                {
-                    err = malloc_exit_this_app_00_wav();
-                    if (err != ESP_OK)
-                    {
-                        ESP_LOGE(TAG, "malloc_home_instructions_00_wav() err: %s", esp_err_to_name(err));
-                    }
-
-                    if (err == ESP_OK)
-                    {
-                        playback_audio_file(audio_buf.exit_this_app_00_wav_audio_buf, audio_buf.exit_this_app_00_wav_audio_len, audio_volume, true);
-                        if (err != ESP_OK)
-                        {
-                            ESP_LOGE(TAG, "playback_audio_file(exit_this_app_00_wav_audio_buf) err: %s", esp_err_to_name(err));
-                        }
+                err = playback_audio_clip(AUDIO_CLIP_HOME_INSTRUCTIONS_00, true);
 
-                        free_exit_this_app_00();
-                    }
-                }
+                err = playback_audio_clip(AUDIO_CLIP_EXIT_THIS_APP_01, true);
 
                 */
 
@@ -552,25 +517,7 @@ void app_main(void)
                 ESP_LOGE(TAG, "toggle_camera_pwdn() err: %s", esp_err_to_name(err));
             }
 
-            if (audio_buf.taking_a_picture321_02_wav_audio_buf == NULL)
-            {
-                err = malloc_taking_a_picture321_02_wav();
-                if (err != ESP_OK)
-                {
-                    ESP_LOGE(TAG, "malloc_taking_a_picture321_02_wav() err: %s", esp_err_to_name(err));
-                }
-
-                if (err == ESP_OK)
-                {
-                    err = playback_audio_file(audio_buf.taking_a_picture321_02_wav_audio_buf, audio_buf.taking_a_picture321_02_wav_len, audio_volume, false);
-                    if (err != ESP_OK)
-                    {
-                        ESP_LOGE(TAG, "playback_audio_file(taking_a_picture321_02_wav_audio_buf) err: %s", esp_err_to_name(err));
-                    }
-
-                    free_taking_a_picture321_02_wav();
-                }
-            }
+            err = playback_audio_clip(AUDIO_CLIP_TAKING_A_PICTURE321_02, false);
 
             bool pic_taken = false;
             uint8_t pic_null_increment = 0;
@@ -709,67 +656,51 @@ void app_main(void)
             // capture the picture, then attempt wifi connection
             else
             {
-                err = toggle_camera_pwdn(CAMERA_ON);
-                if (err != ESP_OK)
+                // the wifi connects and the session is checked while the picture is taken
+                if (NET_PREPARE_OVERLAP)
                 {
-                    ESP_LOGE(TAG, "toggle_camera_pwdn() err: %s", esp_err_to_name(err));
-                }
-
-                if (audio_buf.taking_a_picture321_02_wav_audio_buf == NULL)
-                {
-                    err = malloc_taking_a_picture321_02_wav();
+                    err = net_prepare_start();
                     if (err != ESP_OK)
                     {
-                        ESP_LOGE(TAG, "malloc_taking_a_picture321_02_wav() err: %s", esp_err_to_name(err));
+                        ESP_LOGE(TAG, "net_prepare_start() err: %s", esp_err_to_name(err));
                     }
+                }
 
-                    if (err == ESP_OK)
-                    {
-                        err = playback_audio_file(audio_buf.taking_a_picture321_02_wav_audio_buf, audio_buf.taking_a_picture321_02_wav_len, audio_volume, false);
-                        if (err != ESP_OK)
-                        {
-                            ESP_LOGE(TAG, "playback_audio_file(taking_a_picture321_02_wav_audio_buf) err: %s", esp_err_to_name(err));
-                        }
+                // the sensor settles during the countdown, so the shutter costs the rest of the
+                // frame in flight and the next one
+                err = camera_set_state(CAMERA_STATE_WARM);
+                if (err != ESP_OK)
+                {
+                    ESP_LOGE(TAG, "camera_set_state(CAMERA_STATE_WARM) err: %s", esp_err_to_name(err));
+                }
 
-                        free_taking_a_picture321_02_wav();
-                    }
+                const audio_clip_id_t countdown = AUDIO_CLIP_TAKING_A_PICTURE321_02;
+                audio_playback_handle_t countdown_handle = 0;
+
+                err = audio_playlist_enqueue(&countdown, 1, false, &countdown_handle);
+                if (err == ESP_OK)
+                {
+                    audio_player_wait(countdown_handle, portMAX_DELAY);
                 }
 
                 bool pic_taken = false;
-                uint8_t pic_null_increment = 0;
-                uint8_t pic_taken_increment = 0;
 
-                while (true)
+                err = camera_set_state(CAMERA_STATE_CAPTURE);
+                if (err != ESP_OK)
                 {
-                    ESP_LOGI(TAG, "Taking picture...");
-                    pic = esp_camera_fb_get();
-                    if (pic != NULL)
-                    {
-                        if (pic->len > 0 && pic_taken_increment++ >= 2)
-                        {
-                            ESP_LOGI(TAG, "Picture taken! Its size is: %zu bytes", pic->len);
-                            pic_taken = true;
-                            break;
-                        }
-                    }
-                    else
-                    {
-                        printf("pic_null_increment: %d\n", pic_null_increment);
-                        if (pic_null_increment++ >= 1)
-                        {
-                            pic_taken = false;
-                            break;
-                        }
-                    }
-
-                    esp_camera_fb_return(pic);
-                    vTaskDelay(10 / portTICK_PERIOD_MS);
+                    ESP_LOGE(TAG, "camera_set_state(CAMERA_STATE_CAPTURE) err: %s", esp_err_to_name(err));
+                }
+                else
+                {
+                    // the jpeg quality is steered frame by frame inside camera_capture()
+                    err = camera_capture(&pic);
+                    pic_taken = err == ESP_OK;
                 }
 
-                err = toggle_camera_pwdn(CAMERA_OFF);
+                err = camera_set_state(CAMERA_STATE_STANDBY);
                 if (err != ESP_OK)
                 {
-                    ESP_LOGE(TAG, "toggle_camera_pwdn() err: %s", esp_err_to_name(err));
+                    ESP_LOGE(TAG, "camera_set_state(CAMERA_STATE_STANDBY) err: %s", esp_err_to_name(err));
                 }
 
                 if (pic_taken)
@@ -786,31 +717,26 @@ void app_main(void)
                         nvs_data.attempting_pic_capture = 0;
                     }
 
-                    // lower the jpg_quality of the pic to capture image reliably
-                    if (nvs_data.jpeg_quality_exponent > 0)
+                    // the confirm sound cues the student to ask their question, it is sent with the picture
+                    if (AUDIO_CAPTURE_QUESTION)
                     {
-                        nvs_data.jpeg_quality_exponent -= 1;
-                        ESP_LOGI(TAG, "pic_taken nvs_data.jpeg_quality_exponent: %d", nvs_data.jpeg_quality_exponent);
+                        playback_confirm_sfx_04(false);
 
-                        // decrease jpg_quality inside nvs
-                        err = write_nvs_int("jpg_exponent", nvs_data.jpeg_quality_exponent);
-                        if (err != ESP_OK)
+                        err = audio_capture_question();
+                        if (err != ESP_OK && err != ESP_ERR_NOT_FOUND)
                         {
-                            ESP_LOGE(TAG, "write_nvs_int(jpeg_quality_exponent) err: %s", esp_err_to_name(err));
+                            ESP_LOGE(TAG, "audio_capture_question() err: %s", esp_err_to_name(err));
                         }
-
-                        // TODO : deinit/init camera?
                     }
 
-                    // NOTE : the improved jpg quality wont take effect until the user restarts the esp32
-
                     state_machine = CONNECT_TO_WIFI;
                     break;
                 }
                 else
                 {
-                    // pic error, usually happens when lighting conditions are poor
-                    // lowering the camera_config jpg_quality value fixes the issue
+                    // pic error, usually happens when lighting conditions are poor. camera_capture()
+                    // has already coarsened the jpg_quality and stored it, the next attempt
+                    // starts from there
 
                     if (nvs_data.attempting_pic_capture == 0)
                     {
@@ -827,35 +753,10 @@ void app_main(void)
                     // playback error message
                     playback_error_message();
 
-                    if (nvs_data.jpeg_quality_exponent < 5)
-                    {
-                        nvs_data.jpeg_quality_exponent += 1;
-                        ESP_LOGI(TAG, "!pic_taken nvs_data.jpeg_quality_exponent: %d", nvs_data.jpeg_quality_exponent);
-
-                        // increase jpg_quality inside nvs
-                        err = write_nvs_int("jpg_exponent", nvs_data.jpeg_quality_exponent);
-                        if (err != ESP_OK)
-                        {
-                            ESP_LOGE(TAG, "write_nvs_int(jpg_exponent) err: %s", esp_err_to_name(err));
-                        }
-                    }
-                    else if (nvs_data.jpeg_quality_exponent == 5)
-                    {
-                        ESP_LOGE(TAG, "User needs better lighting conditions");
-                    }
-
-                    // deinit the camera then reinit to let the new jpg_quality settings take effect
-                    err = esp_camera_deinit();
-                    if (err != ESP_OK)
-                    {
-                        ESP_LOGE(TAG, "esp_camera_deinit() err: %s", esp_err_to_name(err));
-                    }
+                    ESP_LOGE(TAG, "User needs better lighting conditions");
 
-                    err = init_camera();
-                    if (err != ESP_OK)
-                    {
-                        ESP_LOGE(TAG, "init_camera() err: %s", esp_err_to_name(err));
-                    }
+                    // the connection is not needed until the next attempt
+                    net_prepare_cancel();
 
                     // go to sleep and remain in the picture capture state
                     if (setup_sleep() != ESP_OK)
@@ -877,12 +778,20 @@ void app_main(void)
 
             break;
         case TUTORFISH_VALIDATE_SESSION:
+            // checked in the background while the picture was taken
+            if (net_prepare_active() && net_prepare_session())
+            {
+                validate_session_cookie_get_attempts = 0;
+                state_machine = TUTORFISH_CAPTURE_PIC;
+                break;
+            }
+
             // check if the session is valid
 
             if (validate_session_cookie_get_attempts++ <= validate_session_cookie_get_limit)
             {
                 ESP_LOGI(TAG, "Checking session validity...");
-                http_status = http_get_request_("tutorfish-env.eba-tdamw63n.us-east-1.elasticbeanstalk.com", "/validate-session", NULL, true);
+                http_status = http_get_request_(TUTORFISH_HOSTNAME, "/validate-session", NULL, true);
                 // Ok: session cookie valid
                 if (http_status == 200)
                 {
@@ -934,25 +843,7 @@ void app_main(void)
             break;
         case TUTORFISH_CAPTURE_PIC: //; // ; fixes random err
 
-            if (audio_buf.uploading_the_picture_please_wait_00_wav_audio_buf == NULL)
-            {
-                err = malloc_uploading_the_picture_please_wait_00_wav();
-                if (err != ESP_OK)
-                {
-                    ESP_LOGE(TAG, "malloc_uploading_the_picture_please_wait_00_wav() err: %s", esp_err_to_name(err));
-                }
-
-                if (err == ESP_OK)
-                {
-                    err = playback_audio_file(audio_buf.uploading_the_picture_please_wait_00_wav_audio_buf, audio_buf.uploading_the_picture_please_wait_00_wav_len, audio_volume, false);
-                    if (err != ESP_OK)
-                    {
-                        ESP_LOGE(TAG, "playback_audio_file(uploading_the_picture_please_wait_00_wav_audio_buf) err: %s", esp_err_to_name(err));
-                    }
-
-                    free_uploading_the_picture_please_wait_00_wav();
-                }
-            }
+            err = playback_audio_clip(AUDIO_CLIP_UPLOADING_THE_PICTURE_PLEASE_WAIT_00, false);
 
             // send pic buffer to server via http
             const int ret_code = https_send_pic(true, pic);
@@ -963,7 +854,11 @@ void app_main(void)
                 state_machine = TUTORFISH_VALIDATE_SESSION;
                 break;
             }
-            else if (ret_code != 200)
+
+            // the frame buffer went back to the camera driver with the upload
+            pic = NULL;
+
+            if (ret_code != 200)
             {
                 // playback error message
                 playback_error_message();
@@ -1011,7 +906,7 @@ void app_main(void)
                 // wait until the question status has changed
                 vTaskDelay(30000 / portTICK_PERIOD_MS);
 
-                http_status = http_get_request("tutorfish-env.eba-tdamw63n.us-east-1.elasticbeanstalk.com", "/student-question-status", "documentId", true);
+                http_status = http_get_request(TUTORFISH_HOSTNAME, "/student-question-status", "documentId", true);
                 if (http_status == 200)
                 {
                     // memset(nvs_data.question_status, 0, 255);
@@ -1035,25 +930,7 @@ void app_main(void)
                     else if (strcmp(nvs_data.question_status, "unanswered") == 0 || strcmp(nvs_data.question_status, "pending") == 0)
                     {
                         // playback "unanswered" audio
-                        if (audio_buf.tutors_look_for_answer_00_wav_audio_buf == NULL)
-                        {
-                            err = malloc_tutors_look_for_answer_00_wav();
-                            if (err != ESP_OK)
-                            {
-                                ESP_LOGE(TAG, "malloc_tutors_look_for_answer_00_wav() err: %s", esp_err_to_name(err));
-                            }
-
-                            if (err == ESP_OK)
-                            {
-                                err = playback_audio_file(audio_buf.tutors_look_for_answer_00_wav_audio_buf, audio_buf.tutors_look_for_answer_00_wav_len, audio_volume, false);
-                                if (err != ESP_OK)
-                                {
-                                    ESP_LOGE(TAG, "playback_audio_file(tutors_look_for_answer_00_wav_audio_buf) err: %s", esp_err_to_name(err));
-                                }
-
-                                free_tutors_look_for_answer_00_wav();
-                            }
-                        }
+                        err = playback_audio_clip(AUDIO_CLIP_TUTORS_LOOK_FOR_ANSWER_00, false);
                     }
                     else if (strcmp(nvs_data.question_status, "expired") == 0)
                     {
@@ -1077,25 +954,7 @@ void app_main(void)
                         // check TutorFish website source, "student_question_status.js" ~line 49 for more details
 
                         // playback audio
-                        if (audio_buf.tutors_found_answer_00_wav_audio_buf == NULL)
-                        {
-                            err = malloc_tutors_found_answer_00_wav();
-                            if (err != ESP_OK)
-                            {
-                                ESP_LOGE(TAG, "malloc_tutors_found_answer_00_wav() err: %s", esp_err_to_name(err));
-                            }
-
-                            if (err == ESP_OK)
-                            {
-                                err = playback_audio_file(audio_buf.tutors_found_answer_00_wav_audio_buf, audio_buf.tutors_found_answer_00_wav_len, audio_volume, false);
-                                if (err != ESP_OK)
-                                {
-                                    ESP_LOGE(TAG, "playback_audio_file(tutors_found_answer_00_wav_audio_buf) err: %s", esp_err_to_name(err));
-                                }
-
-                                free_tutors_found_answer_00_wav();
-                            }
-                        }
+                        err = playback_audio_clip(AUDIO_CLIP_TUTORS_FOUND_ANSWER_00, false);
 
                         memset(nvs_data.question_ttsKey, 0, 255);
                         strcpy(nvs_data.question_ttsKey, nvs_data.question_status);
@@ -1166,7 +1025,7 @@ void app_main(void)
                     break;
                 }
 
-                http_status = http_download_file("tutorfish-env.eba-tdamw63n.us-east-1.elasticbeanstalk.com", "/student-download-tts", "ttsKey", true);
+                http_status = http_download_file(TUTORFISH_HOSTNAME, "/student-download-tts", "ttsKey", true);
                 if (http_status == ESP_OK)
                 {
                     if (audio_buf.tts_audio_len > 0)
@@ -1214,8 +1073,12 @@ void app_main(void)
 
             repeat_tts_playback = false;
 
-            // playback downloaded TTS audio
-            if (audio_buf.tts_audio_buf != NULL)
+            // playback downloaded TTS audio, the first time it was heard while downloading
+            if (audio_buf.tts_audio_streamed)
+            {
+                audio_buf.tts_audio_streamed = false;
+            }
+            else if (audio_buf.tts_audio_buf != NULL)
             {
                 err = playback_audio_file(audio_buf.tts_audio_buf, audio_buf.tts_audio_len, audio_volume, false);
                 if (err != ESP_OK)
@@ -1225,24 +1088,14 @@ void app_main(void)
             }
 
             // playback repeat TTS audio
-            if (audio_buf.to_hear_the_answer_again_00_wav_audio_buf == NULL)
-            {
-                err = malloc_to_hear_the_answer_again_00_wav();
-                if (err != ESP_OK)
-                {
-                    ESP_LOGE(TAG, "malloc_to_hear_the_answer_again_00_wav() err: %s", esp_err_to_name(err));
-                }
+            const audio_clip_id_t repeat_prompt = AUDIO_CLIP_TO_HEAR_THE_ANSWER_AGAIN_00;
+            audio_playback_handle_t repeat_prompt_handle = 0;
 
-                if (err == ESP_OK)
-                {
-                    err = playback_audio_file(audio_buf.to_hear_the_answer_again_00_wav_audio_buf, audio_buf.to_hear_the_answer_again_00_wav_len, audio_volume, true);
-                    if (err != ESP_OK)
-                    {
-                        ESP_LOGE(TAG, "playback_audio_file(to_hear_the_answer_again_00_wav_audio_buf) err: %s", esp_err_to_name(err));
-                    }
-
-                    free_to_hear_the_answer_again_00_wav();
-                }
+            err = audio_playlist_enqueue(&repeat_prompt, 1, true, &repeat_prompt_handle);
+            if (err == ESP_OK)
+            {
+                // start the 5 seconds once the prompt has actually finished playing
+                audio_player_wait(repeat_prompt_handle, portMAX_DELAY);
             }
 
             ESP_LOGI(TAG, "tap the right stem to repeat this answer, otherwise glasses will sleep");
@@ -1273,6 +1126,15 @@ void app_main(void)
                 nvs_data.documentId = NULL;
             }
 
+            net_prepare_cancel();
+
+            // a picture that was never uploaded still holds the camera frame buffer or its copy
+            if (pic != NULL)
+            {
+                camera_return_picture(pic);
+                pic = NULL;
+            }
+
             state_machine = TUTORFISH_SUBMIT_QUESTION;
 
             if (blue_led_task_init)
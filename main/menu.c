@@ -6,6 +6,7 @@
 #include "touch.h"
 #include "audio_io.h"
 #include "state_machine.h"
+#include "latency_trace.h"
 
 static const char *TAG = "menu.c";
 
@@ -21,53 +22,19 @@ esp_err_t browse_menu(void)
 
         if (state_machine == TUTORFISH_HOME)
         {
+            latency_trace_mark(LATENCY_STAGE_MENU);
+
             switch (menu_selection_idx)
             {
             case 0:
 
-                if (audio_buf.tutor_fish_settings_00_wav_audio_buf == NULL)
-                {
-                    err = malloc_tutor_fish_settings_00_wav();
-                    if (err != ESP_OK)
-                    {
-                        ESP_LOGE(TAG, "malloc_tutor_fish_settings_00_wav() err: %s", esp_err_to_name(err));
-                    }
-
-                    if (err == ESP_OK)
-                    {
-                        playback_audio_file(audio_buf.tutor_fish_settings_00_wav_audio_buf, audio_buf.tutor_fish_settings_00_wav_len, audio_volume, true);
-                        if (err != ESP_OK)
-                        {
-                            ESP_LOGE(TAG, "playback_audio_file(tutor_fish_settings_00_wav_audio_buf) err: %s", esp_err_to_name(err));
-                        }
-
-                        free_tutor_fish_settings_00();
-                    }
-                }
+                err = playback_audio_clip(AUDIO_CLIP_TUTOR_FISH_SETTINGS_00, true);
 
                 ESP_LOGI(TAG, "browse_menu(): Tutorfish Settings");
                 break;
             case 1:
 
-                if (audio_buf.submit_a_question_00_wav_audio_buf == NULL)
-                {
-                    err = malloc_submit_a_question_00_wav();
-                    if (err != ESP_OK)
-                    {
-                        ESP_LOGE(TAG, "malloc_tutor_fish_settings_00_wav() err: %s", esp_err_to_name(err));
-                    }
-
-                    if (err == ESP_OK)
-                    {
-                        playback_audio_file(audio_buf.submit_a_question_00_wav_audio_buf, audio_buf.submit_a_question_00_wav_len, audio_volume, true);
-                        if (err != ESP_OK)
-                        {
-                            ESP_LOGE(TAG, "playback_audio_file(submit_a_question_00_wav_audio_buf) err: %s", esp_err_to_name(err));
-                        }
-
-                        free_submit_a_question_00();
-                    }
-                }
+                err = playback_audio_clip(AUDIO_CLIP_SUBMIT_A_QUESTION_00, true);
 
                 ESP_LOGI(TAG, "browse_menu(): Submit Question");
                 break;
@@ -0,0 +1,184 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "net_prepare.h"
+#include "wifi_station.h"
+#include "wifi_bt_status.h"
+#include "esp_http_client_example.h"
+
+static const char *TAG = "net_prepare.c";
+
+// connects the wifi and checks the session cookie in the background while a question is
+// being taken, so the upload can start as soon as the picture is ready. the main task
+// picks the outcomes up in CONNECT_TO_WIFI and TUTORFISH_VALIDATE_SESSION, which still do
+// the work themselves when nothing was prepared or the preparation failed
+
+#define NET_PREPARE_WIFI_DONE_BIT BIT0
+#define NET_PREPARE_SESSION_DONE_BIT BIT1
+
+static EventGroupHandle_t net_prepare_events = NULL;
+static bool active = false; // started and not yet taken up, main task only
+static bool wifi_started = false;
+static esp_err_t wifi_err = ESP_OK;
+static bool session_valid = false;
+static int64_t started_us = 0;
+
+static void net_prepare_task(void *pvParameters)
+{
+    wifi_err = ESP_OK;
+    session_valid = false;
+
+    if (!wifi_bt_status.wifi_init)
+    {
+        wifi_err = _esp_wifi_init();
+        if (wifi_err == ESP_OK)
+        {
+            wifi_bt_status.wifi_init = true;
+        }
+        else
+        {
+            ESP_LOGE(TAG, "_esp_wifi_init() err: %s", esp_err_to_name(wifi_err));
+        }
+    }
+
+    if (wifi_err == ESP_OK && !wifi_bt_status.wifi_sta_init)
+    {
+        wifi_err = wifi_init_sta();
+        if (wifi_err == ESP_OK)
+        {
+            wifi_bt_status.wifi_sta_init = true;
+        }
+        else
+        {
+            ESP_LOGE(TAG, "wifi_init_sta() err: %s", esp_err_to_name(wifi_err));
+        }
+    }
+
+    if (wifi_err == ESP_OK)
+    {
+        // the countdown and the question are playing and recording, the connection is silent
+        wifi_announce_connection(false);
+
+        wifi_bt_status.user_end_wifi_conn = false;
+        wifi_started = true;
+        wifi_err = start_wifi();
+
+        wifi_announce_connection(true);
+    }
+
+    ESP_LOGI(TAG, "wifi %s after %lld ms", wifi_err == ESP_OK ? "connected" : "failed", (esp_timer_get_time() - started_us) / 1000);
+    xEventGroupSetBits(net_prepare_events, NET_PREPARE_WIFI_DONE_BIT);
+
+    if (wifi_err == ESP_OK)
+    {
+        const size_t http_status = http_get_request_(TUTORFISH_HOSTNAME, "/validate-session", NULL, true);
+        session_valid = http_status == 200;
+
+        ESP_LOGI(TAG, "session check %u after %lld ms", http_status, (esp_timer_get_time() - started_us) / 1000);
+    }
+
+    xEventGroupSetBits(net_prepare_events, NET_PREPARE_SESSION_DONE_BIT);
+    vTaskDelete(NULL);
+}
+
+esp_err_t init_net_prepare(void)
+{
+    net_prepare_events = xEventGroupCreate();
+    if (net_prepare_events == NULL)
+    {
+        ESP_LOGE(TAG, "xEventGroupCreate() failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+// starts connecting, nothing is done when a preparation is already running or the wifi is
+// already connected
+esp_err_t net_prepare_start(void)
+{
+    if (active || wifi_bt_status.wifi_conn)
+    {
+        return ESP_OK;
+    }
+
+    xEventGroupClearBits(net_prepare_events, NET_PREPARE_WIFI_DONE_BIT | NET_PREPARE_SESSION_DONE_BIT);
+    wifi_started = false;
+    started_us = esp_timer_get_time();
+
+    BaseType_t task_err = xTaskCreatePinnedToCore(net_prepare_task, "net_prepare_task", 4096, NULL, 4, NULL, 0);
+    if (task_err != pdPASS)
+    {
+        ESP_LOGE(TAG, "xTaskCreatePinnedToCore(net_prepare_task) err: %d", task_err);
+
+        task_err = xTaskCreate(net_prepare_task, "net_prepare_task", 4096, NULL, 4, NULL);
+        if (task_err != pdPASS)
+        {
+            ESP_LOGE(TAG, "xTaskCreate(net_prepare_task) err: %d", task_err);
+            return ESP_FAIL;
+        }
+    }
+
+    active = true;
+
+    return ESP_OK;
+}
+
+bool net_prepare_active(void)
+{
+    return active;
+}
+
+// waits for the connection, instead of start_wifi(). a failed connection ends the
+// preparation, the retry after it connects inline
+esp_err_t net_prepare_wifi(void)
+{
+    xEventGroupWaitBits(net_prepare_events, NET_PREPARE_WIFI_DONE_BIT, pdFALSE, pdTRUE, portMAX_DELAY);
+
+    if (wifi_err != ESP_OK)
+    {
+        xEventGroupWaitBits(net_prepare_events, NET_PREPARE_SESSION_DONE_BIT, pdFALSE, pdTRUE, portMAX_DELAY);
+        active = false;
+    }
+
+    return wifi_err;
+}
+
+// waits for the session check and ends the preparation. false leaves the check, and the
+// renewal of the cookie, to TUTORFISH_VALIDATE_SESSION
+bool net_prepare_session(void)
+{
+    xEventGroupWaitBits(net_prepare_events, NET_PREPARE_SESSION_DONE_BIT, pdFALSE, pdTRUE, portMAX_DELAY);
+    active = false;
+
+    ESP_LOGI(TAG, "ready to upload %lld ms after the question started", (esp_timer_get_time() - started_us) / 1000);
+
+    return session_valid;
+}
+
+// for a question that will not be uploaded, waits for the task to finish and stops the
+// wifi it started
+void net_prepare_cancel(void)
+{
+    if (!active)
+    {
+        return;
+    }
+
+    xEventGroupWaitBits(net_prepare_events, NET_PREPARE_SESSION_DONE_BIT, pdFALSE, pdTRUE, portMAX_DELAY);
+    active = false;
+
+    if (wifi_started)
+    {
+        esp_err_t err = stop_wifi();
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "stop_wifi() err: %s", esp_err_to_name(err));
+        }
+
+        wifi_bt_status.wifi_conn = false;
+    }
+}
@@ -13,6 +13,7 @@
 #include "audio_io.h"
 #include "touch.h"
 #include "menu.h"
+#include "latency_trace.h"
 
 static const char *TAG = "touch.c";
 
@@ -79,6 +80,53 @@ static void handle_backward_touch(void)
     }
 }
 
+static void forward_touched(latency_source_t source)
+{
+    latency_trace_begin(source);
+
+    audio_player_stop();
+
+    ESP_LOGI(TAG, "T%d activated!", TOUCH_PAD_NUM1);
+
+    handle_forward_touch();
+
+    latency_trace_mark(LATENCY_STAGE_HANDLED);
+
+    vTaskDelay(250 / portTICK_PERIOD_MS);
+
+    touch_pad_forward = true;
+}
+
+static void backward_touched(latency_source_t source)
+{
+    latency_trace_begin(source);
+
+    audio_player_stop();
+
+    ESP_LOGI(TAG, "T%d activated!", TOUCH_PAD_NUM5);
+
+    handle_backward_touch();
+
+    latency_trace_mark(LATENCY_STAGE_HANDLED);
+
+    vTaskDelay(250 / portTICK_PERIOD_MS);
+
+    touch_pad_backward = true;
+}
+
+// acts on a synthetic touch as if the pad had been touched, for the latency replay
+void touch_replay(bool forward)
+{
+    if (forward)
+    {
+        forward_touched(LATENCY_SOURCE_REPLAY);
+    }
+    else
+    {
+        backward_touched(LATENCY_SOURCE_REPLAY);
+    }
+}
+
 static void tp_example_read_task(void *pvParameter)
 {
     touch_pad_intr_enable();
@@ -98,35 +146,15 @@ static void tp_example_read_task(void *pvParameter)
 
         if (forward_touch_value <= forward_touch_threshold && !touch_pad_forward)
         {
-            if (audio_buf.system_i2s_playing)
-            {
-                audio_buf.system_i2s_stop = true;
-            }
-
             ESP_LOGI(TAG, "forward_touch_value: %d", forward_touch_value);
-            ESP_LOGI(TAG, "T%d activated!", TOUCH_PAD_NUM1);
-
-            handle_forward_touch();
 
-            vTaskDelay(250 / portTICK_PERIOD_MS);
-
-            touch_pad_forward = true;
+            forward_touched(LATENCY_SOURCE_TOUCH);
         }
         else if (backward_touch_value <= backward_touch_threshold && !touch_pad_backward)
         {
-            if (audio_buf.system_i2s_playing)
-            {
-                audio_buf.system_i2s_stop = true;
-            }
-
             ESP_LOGI(TAG, "backward_touch_value: %d", backward_touch_value);
-            ESP_LOGI(TAG, "T%d activated!", TOUCH_PAD_NUM5);
-
-            handle_backward_touch();
-            
-            vTaskDelay(250 / portTICK_PERIOD_MS);
 
-            touch_pad_backward = true;
+            backward_touched(LATENCY_SOURCE_TOUCH);
         }
 
         vTaskDelay(250 / portTICK_PERIOD_MS);
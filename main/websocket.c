@@ -171,25 +171,7 @@ bool websocket_app_start(camera_fb_t *pic)
     // give camera time to warm up
     //vTaskDelay(500 / portTICK_PERIOD_MS);
 
-    if (audio_buf.taking_a_picture321_02_wav_audio_buf == NULL)
-    {
-        err = malloc_taking_a_picture321_02_wav();
-        if (err != ESP_OK)
-        {
-            ESP_LOGE(TAG, "malloc_taking_a_picture321_02_wav() err: %s", esp_err_to_name(err));
-        }
-
-        if (err == ESP_OK)
-        {
-            err = playback_audio_file(audio_buf.taking_a_picture321_02_wav_audio_buf, audio_buf.taking_a_picture321_02_wav_len, audio_volume, false);
-            if (err != ESP_OK)
-            {
-                ESP_LOGE(TAG, "playback_audio_file(taking_a_picture321_02_wav_audio_buf) err: %s", esp_err_to_name(err));
-            }
-
-            free_taking_a_picture321_02_wav();
-        }
-    }
+    err = playback_audio_clip(AUDIO_CLIP_TAKING_A_PICTURE321_02, false);
 
     bool pic_sent = false;
 
@@ -206,25 +188,7 @@ bool websocket_app_start(camera_fb_t *pic)
             {
                 if (pic->len > 0 && pic_taken_increment++ >= 1)
                 {
-                    if (audio_buf.uploading_the_picture_please_wait_00_wav_audio_buf == NULL)
-                    {
-                        err = malloc_uploading_the_picture_please_wait_00_wav();
-                        if (err != ESP_OK)
-                        {
-                            ESP_LOGE(TAG, "malloc_uploading_the_picture_please_wait_00_wav() err: %s", esp_err_to_name(err));
-                        }
-
-                        if (err == ESP_OK)
-                        {
-                            err = playback_audio_file(audio_buf.uploading_the_picture_please_wait_00_wav_audio_buf, audio_buf.uploading_the_picture_please_wait_00_wav_len, audio_volume, false);
-                            if (err != ESP_OK)
-                            {
-                                ESP_LOGE(TAG, "playback_audio_file(uploading_the_picture_please_wait_00_wav_audio_buf) err: %s", esp_err_to_name(err));
-                            }
-
-                            free_uploading_the_picture_please_wait_00_wav();
-                        }
-                    }
+                    err = playback_audio_clip_async(AUDIO_CLIP_UPLOADING_THE_PICTURE_PLEASE_WAIT_00, false);
 
                     ESP_LOGI(TAG, "Picture sending! Its size is: %zu bytes", pic->len);
                     if (esp_websocket_client_send(client, &pic->buf, pic->len, portMAX_DELAY) > -1)
@@ -275,25 +239,7 @@ bool websocket_app_start(camera_fb_t *pic)
     }
     */
 
-    if (audio_buf.uploading_the_picture_please_wait_00_wav_audio_buf == NULL)
-    {
-        esp_err_t err = malloc_uploading_the_picture_please_wait_00_wav();
-        if (err != ESP_OK)
-        {
-            ESP_LOGE(TAG, "malloc_uploading_the_picture_please_wait_00_wav() err: %s", esp_err_to_name(err));
-        }
-
-        if (err == ESP_OK)
-        {
-            err = playback_audio_file(audio_buf.uploading_the_picture_please_wait_00_wav_audio_buf, audio_buf.uploading_the_picture_please_wait_00_wav_len, audio_volume, false);
-            if (err != ESP_OK)
-            {
-                ESP_LOGE(TAG, "playback_audio_file(uploading_the_picture_please_wait_00_wav_audio_buf) err: %s", esp_err_to_name(err));
-            }
-
-            free_uploading_the_picture_please_wait_00_wav();
-        }
-    }
+    playback_audio_clip_async(AUDIO_CLIP_UPLOADING_THE_PICTURE_PLEASE_WAIT_00, false);
 
     bool pic_sent = false;
 
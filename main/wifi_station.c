@@ -18,6 +18,7 @@
 #include "lwip/sys.h"
 
 #include "wifi_bt_status.h"
+#include "wifi_station.h"
 //#include "home_button.h"
 #include "audio_io.h"
 #include "state_machine.h"
@@ -42,6 +43,7 @@ static EventGroupHandle_t s_wifi_event_group;
 static const char *TAG = "wifi station";
 
 static int s_retry_num = 0;
+static bool announce_connection = true;
 
 static esp_event_handler_instance_t instance_any_id;
 static esp_event_handler_instance_t instance_got_ip;
@@ -53,24 +55,9 @@ static void event_handler(void *arg, esp_event_base_t event_base,
     {
         esp_wifi_connect();
 
-        if (audio_buf.attempt_wifi_conn_00_wav_audio_buf == NULL)
+        if (announce_connection)
         {
-            esp_err_t err = malloc_attempt_wifi_conn_00_wav();
-            if (err != ESP_OK)
-            {
-                ESP_LOGE(TAG, "malloc_attempt_wifi_conn_00_wav() err: %s", esp_err_to_name(err));
-            }
-
-            if (err == ESP_OK)
-            {
-                playback_audio_file(audio_buf.attempt_wifi_conn_00_wav_audio_buf, audio_buf.attempt_wifi_conn_00_wav_audio_len, audio_volume, false);
-                if (err != ESP_OK)
-                {
-                    ESP_LOGE(TAG, "playback_audio_file(submit_a_question_00_wav_audio_buf) err: %s", esp_err_to_name(err));
-                }
-
-                free_attempt_wifi_conn_00();
-            }
+            playback_audio_clip_async(AUDIO_CLIP_ATTEMPT_WIFI_CONN_00, false);
         }
     }
     else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED)
@@ -104,6 +91,12 @@ static void event_handler(void *arg, esp_event_base_t event_base,
     }
 }
 
+// the attempt prompt is left out while a connection is made in the background
+void wifi_announce_connection(bool announce)
+{
+    announce_connection = announce;
+}
+
 esp_err_t wifi_ps_mode(void)
 {
     return esp_wifi_set_ps(WIFI_PS_NONE);
@@ -173,7 +166,7 @@ esp_err_t _esp_wifi_init(void)
     return esp_wifi_init(&cfg);
 }
 
-void wifi_init_sta(void)
+esp_err_t wifi_init_sta(void)
 {
     esp_err_t err;
 
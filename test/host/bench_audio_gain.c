@@ -0,0 +1,244 @@
+// the Q15 gain kernel against a one-sample-at-a-time reference written from its contract:
+// the gain steps towards the target by step per sample, clamps at the target, and every
+// sample is (sample * gain) >> 15 saturated to 16 bits. the output must be bit exact for
+// any gain, ramp and split of the buffer, including odd lengths and a ramp that ends on an
+// odd sample. then samples per second for the kernel and for the float multiply it
+// replaced, and how far the two differ. the host compiler vectorises the float loop, which
+// it cannot do for the LX6, so the speeds here show what the kernel costs and not which of
+// the two is faster on the glasses
+//
+// there is no ESP-DSP path to compare with. the ESP32's esp-dsp has no 16 bit gain kernel
+// that saturates, and the LX6 has no packed 16 bit multiply for one to use, so the scalar
+// pair loop here is what runs on the target too
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "audio_dsp.h"
+#include "test.h"
+#include "test_support.h"
+
+#define BENCH_SAMPLES (16000 * 60) // a minute of answer
+
+typedef struct
+{
+    int32_t gain;
+    int32_t target;
+    int32_t step;
+} ref_gain_t;
+
+static int16_t ref_saturate(int64_t x)
+{
+    return x > INT16_MAX ? INT16_MAX : (x < INT16_MIN ? INT16_MIN : (int16_t)x);
+}
+
+static void ref_apply(ref_gain_t *g, int16_t *samples, int len)
+{
+    for (int i = 0; i < len; i++)
+    {
+        if (g->gain != g->target)
+        {
+            g->gain += g->step;
+            if ((g->step > 0 && g->gain > g->target) || (g->step < 0 && g->gain < g->target))
+            {
+                g->gain = g->target;
+            }
+        }
+
+        // an arithmetic shift, as the kernel's, rounds towards minus infinity
+        const int64_t product = (int64_t)samples[i] * g->gain;
+        samples[i] = ref_saturate(product >= 0 ? product >> 15 : -((-product + 32767) >> 15));
+    }
+}
+
+static uint32_t rng_state = 0x9e3779b9;
+
+static uint32_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static void random_samples(int16_t *samples, int len)
+{
+    for (int i = 0; i < len; i++)
+    {
+        // full scale, with the extremes often enough to hit the clamps
+        switch (rng() % 16)
+        {
+        case 0:
+            samples[i] = INT16_MAX;
+            break;
+        case 1:
+            samples[i] = INT16_MIN;
+            break;
+        default:
+            samples[i] = (int16_t)rng();
+            break;
+        }
+    }
+}
+
+static int32_t random_gain(void)
+{
+    const int32_t edges[] = {0, 1, AUDIO_GAIN_Q15_ONE - 1, AUDIO_GAIN_Q15_ONE, AUDIO_GAIN_Q15_ONE + 1, AUDIO_GAIN_MAX};
+
+    return rng() % 3 == 0 ? edges[rng() % 6] : (int32_t)(rng() % (AUDIO_GAIN_MAX + 1));
+}
+
+// random gains, ramps and buffer splits, applied to the same samples by both
+static void check_bit_exact(void)
+{
+    const int rounds = 20000;
+    int16_t *buf = malloc(4096 * sizeof(int16_t));
+    int16_t *expect = malloc(4096 * sizeof(int16_t));
+    long samples_checked = 0;
+
+    for (int r = 0; r < rounds && test_failures == 0; r++)
+    {
+        audio_gain_t gain;
+        ref_gain_t ref;
+
+        const int32_t start = random_gain();
+        audio_gain_init(&gain, start);
+        ref = (ref_gain_t){start, start, 0};
+
+        // most rounds ramp, some of them over a length that does not divide the distance
+        if (rng() % 4 != 0)
+        {
+            const int ramp = rng() % 3 == 0 ? AUDIO_GAIN_RAMP_SAMPLES : 1 + rng() % 700;
+            audio_gain_ramp(&gain, random_gain(), ramp);
+            ref.target = gain.target;
+            ref.step = gain.step;
+        }
+
+        // the buffer starts at an odd sample now and then, as after a mono fold
+        const int offset = rng() % 2;
+        int len = rng() % (4096 - offset);
+
+        random_samples(&buf[offset], len);
+        memcpy(expect, &buf[offset], len * sizeof(int16_t));
+
+        ref_apply(&ref, expect, len);
+
+        int done = 0;
+        while (done < len)
+        {
+            const int piece = rng() % 2 ? len - done : 1 + (int)(rng() % (len - done));
+            audio_gain_apply(&gain, &buf[offset + done], piece);
+            done += piece;
+        }
+
+        for (int i = 0; i < len; i++)
+        {
+            if (buf[offset + i] != expect[i])
+            {
+                fprintf(stderr, "sample %d of %d: %d != %d, gain %d -> %d step %d\n", i, len, buf[offset + i], expect[i], start, ref.target, ref.step);
+                test_failures++;
+                break;
+            }
+        }
+
+        CHECK_EQ_INT(gain.gain, ref.gain);
+        samples_checked += len;
+    }
+
+    REPORT("bit exact over %d rounds, %ld samples", rounds, samples_checked);
+
+    free(buf);
+    free(expect);
+}
+
+// the loop in playback_audio_file() before the kernel, on its float volume
+static void float_scale(const int16_t *in, int16_t *out, int len, float volume)
+{
+    for (int i = 0; i < len; i++)
+    {
+        out[i] = in[i] * volume;
+    }
+}
+
+static double samples_per_s(double seconds)
+{
+    return BENCH_SAMPLES / seconds;
+}
+
+static void bench(void)
+{
+    int16_t *in = malloc(BENCH_SAMPLES * sizeof(int16_t));
+    int16_t *out = malloc(BENCH_SAMPLES * sizeof(int16_t));
+    int16_t *q15 = malloc(BENCH_SAMPLES * sizeof(int16_t));
+
+    test_tone(in, BENCH_SAMPLES, 440, 16000, 30000);
+
+    const float volumes[] = {0.25f, 0.5f, 0.7f, 0.9f}; // unity gain is not scaled at all
+    int max_diff = 0;
+
+    for (int v = 0; v < 4; v++)
+    {
+        const int runs = 5;
+        double best_float = 1e9;
+        double best_q15 = 1e9;
+
+        for (int r = 0; r < runs; r++)
+        {
+            double start = test_now_s();
+            float_scale(in, out, BENCH_SAMPLES, volumes[v]);
+            const double t_float = test_now_s() - start;
+
+            memcpy(q15, in, BENCH_SAMPLES * sizeof(int16_t));
+            audio_gain_t gain;
+            audio_gain_init(&gain, audio_gain_from_volume(volumes[v]));
+
+            start = test_now_s();
+            audio_gain_apply(&gain, q15, BENCH_SAMPLES);
+            const double t_q15 = test_now_s() - start;
+
+            best_float = t_float < best_float ? t_float : best_float;
+            best_q15 = t_q15 < best_q15 ? t_q15 : best_q15;
+        }
+
+        for (int i = 0; i < BENCH_SAMPLES; i++)
+        {
+            const int diff = abs(q15[i] - out[i]);
+            max_diff = diff > max_diff ? diff : max_diff;
+        }
+
+        REPORT("volume %.2f: float %.0f Msamples/s, q15 %.0f Msamples/s", volumes[v],
+               samples_per_s(best_float) / 1e6, samples_per_s(best_q15) / 1e6);
+    }
+
+    // truncation towards zero against towards minus infinity, and the volume rounded to Q15
+    CHECK(max_diff <= 2);
+    REPORT("q15 against float: at most %d lsb apart", max_diff);
+
+    // a volume change mid answer
+    memcpy(q15, in, BENCH_SAMPLES * sizeof(int16_t));
+    audio_gain_t gain;
+    audio_gain_init(&gain, audio_gain_from_volume(0.7f));
+
+    const double start = test_now_s();
+    for (int i = 0; i < BENCH_SAMPLES; i += 1024)
+    {
+        if (i % (16 * 1024) == 0)
+        {
+            audio_gain_set(&gain, audio_gain_from_volume((i / 1024) % 32 ? 0.4f : 0.9f));
+        }
+        audio_gain_apply(&gain, &q15[i], BENCH_SAMPLES - i < 1024 ? BENCH_SAMPLES - i : 1024);
+    }
+    REPORT("ramping every second: q15 %.0f Msamples/s", samples_per_s(test_now_s() - start) / 1e6);
+
+    free(in);
+    free(out);
+    free(q15);
+}
+
+int main(void)
+{
+    check_bit_exact();
+    bench();
+
+    return test_finish("bench_audio_gain");
+}
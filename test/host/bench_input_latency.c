@@ -0,0 +1,256 @@
+// touch to prompt latency, replayed through touch.c, menu.c and audio_io.c on the fake touch
+// pads and the fake i2s. the firmware's own latency_trace stages are reported as p50/p99, and
+// the test adds the two ends the firmware cannot see: from the finger (the pad value the
+// test sets) to the touch task noticing it, and from the first block handed to i2s to the
+// first sample leaving the dma. taps are 300 ms, long enough for the touch task's 250 ms
+// polling to see them and short enough to be released before it polls again.
+//
+// two runs: taps with the menu idle between them, and taps while the previous prompt is
+// still playing, which adds stopping it. a home button press starts its trace in the gpio
+// isr, that path is checked with latency_trace_begin_from_isr() directly, home_button.c
+// pulls in ota and wifi and is not built for the host. host times only compare runs
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "state_machine.h"
+#include "audio_io.h"
+#include "audio_player.h"
+#include "latency_trace.h"
+#include "touch.h"
+#include "menu.h"
+#include "audio_harness.h"
+#include "fake_i2s.h"
+#include "fake_touch.h"
+#include "test.h"
+#include "test_support.h"
+
+#define TAPS (12)
+#define TAP_MS (300)
+#define BROWSE_INTERVAL_MS (700) // taps while the prompt before is still playing
+
+static volatile bool main_loop_running = true;
+
+// the TUTORFISH_HOME case of app_main()'s loop, the welcome prompt aside
+static void main_loop_task(void *arg)
+{
+    while (main_loop_running)
+    {
+        if (state_machine == TUTORFISH_HOME)
+        {
+            browse_menu();
+        }
+        vTaskDelay(10 / portTICK_PERIOD_MS);
+    }
+
+    vTaskDelete(NULL);
+}
+
+static uint32_t traces(void)
+{
+    latency_stats_t stats;
+
+    return latency_trace_stats(LATENCY_STAGE_INPUT, &stats) == ESP_OK ? stats.count : 0;
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+    const uint32_t x = *(const uint32_t *)a;
+    const uint32_t y = *(const uint32_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+// nearest rank, as latency_trace.c
+static uint32_t percentile(uint32_t *values, int count, int pct)
+{
+    qsort(values, count, sizeof(values[0]), compare_u32);
+
+    return values[(count * pct + 99) / 100 - 1];
+}
+
+typedef struct
+{
+    uint32_t to_i2s[TAPS];     // finger to the prompt's first block handed to i2s
+    uint32_t to_speaker[TAPS]; // finger to its first sample out of the dma, with the menu idle
+    int count;
+} finger_t;
+
+// one tap on pad, returns once its prompt has reached i2s. with the menu idle the prompt is
+// heard and then stopped, so the next tap finds the menu idle again
+static void tap(touch_pad_t pad, finger_t *finger, bool idle)
+{
+    const uint32_t before = traces();
+    const audio_playback_handle_t previous = audio_player_current();
+
+    fake_i2s_reset();
+    const int64_t touched = esp_timer_get_time();
+    fake_touch_pad_set(pad, 500);
+    vTaskDelay(pdMS_TO_TICKS(TAP_MS));
+    fake_touch_pad_set(pad, 1000);
+
+    // the prompt's own stream, the one it stopped may still be draining
+    audio_playback_info_t info = {0};
+    for (int waited = 0; waited < 3000 && (traces() == before || info.started_us == 0); waited += 10)
+    {
+        vTaskDelay(pdMS_TO_TICKS(10));
+
+        const audio_playback_handle_t current = audio_player_current();
+        if (current != previous && current != 0)
+        {
+            audio_player_info(current, &info);
+        }
+    }
+    CHECK_EQ_INT(traces(), before + 1);
+    REQUIRE(info.started_us != 0);
+
+    finger->to_i2s[finger->count] = info.started_us - touched;
+
+    if (idle)
+    {
+        fake_i2s_stats_t dma = {0};
+        for (int waited = 0; waited < 3000 && dma.first_sound_us == 0; waited += 10)
+        {
+            vTaskDelay(pdMS_TO_TICKS(10));
+            fake_i2s_stats(&dma);
+        }
+        REQUIRE(dma.first_sound_us != 0);
+        finger->to_speaker[finger->count] = dma.first_sound_us - touched;
+
+        audio_player_stop();
+        CHECK_ESP_OK(audio_harness_wait_idle(5000));
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+
+    finger->count++;
+}
+
+static void report_stages(const char *run)
+{
+    static const char *const names[LATENCY_STAGE_MAX] = {
+        "total", "handled", "menu", "clip ready", "queued", "first sample",
+    };
+    latency_stats_t total;
+
+    REQUIRE(latency_trace_stats(LATENCY_STAGE_INPUT, &total) == ESP_OK);
+    REPORT("%s, %u taps (us):", run, total.count);
+
+    for (int stage = 0; stage < LATENCY_STAGE_MAX; stage++)
+    {
+        latency_stats_t stats;
+        CHECK_ESP_OK(latency_trace_stats(stage, &stats));
+
+        // every tap passed every stage, and no stage took longer than the whole
+        CHECK_EQ_INT(stats.count, total.count);
+        CHECK(stats.max_us <= total.max_us);
+
+        REPORT("  %-13s p50 %7u  p99 %7u  max %7u", names[stage], stats.p50_us, stats.p99_us, stats.max_us);
+    }
+}
+
+// the whole stream's drain, the most a stop can hold the next prompt back
+static uint32_t dma_depth_us(void)
+{
+    audio_player_stats_t stats;
+    audio_player_stats(&stats);
+
+    return (uint32_t)((int64_t)stats.dma_buf_count * stats.dma_buf_len * 1000000 / AUDIO_SAMPLE_RATE);
+}
+
+// polling, the touch task's own 250 ms delay and the main loop, with room for the host's
+// scheduler
+#define FINGER_TO_I2S_US (250000 + 250000 + 10000 + 300000)
+
+static void report_finger(finger_t *finger, bool idle)
+{
+    const uint32_t p99 = percentile(finger->to_i2s, finger->count, 99);
+    REPORT("  %-13s p50 %7u  p99 %7u", "finger to i2s", percentile(finger->to_i2s, finger->count, 50), p99);
+
+    if (idle)
+    {
+        CHECK(p99 < FINGER_TO_I2S_US);
+
+        const uint32_t speaker_p99 = percentile(finger->to_speaker, finger->count, 99);
+        REPORT("  %-13s p50 %7u  p99 %7u", "to speaker", percentile(finger->to_speaker, finger->count, 50), speaker_p99);
+        CHECK(speaker_p99 < FINGER_TO_I2S_US + dma_depth_us());
+    }
+    else
+    {
+        // and the prompt before fading out and draining
+        CHECK(p99 < FINGER_TO_I2S_US + dma_depth_us());
+    }
+}
+
+static void run_idle(void)
+{
+    finger_t finger = {0};
+
+    latency_trace_reset();
+    for (int i = 0; i < TAPS; i++)
+    {
+        tap(i % 2 == 0 ? TOUCH_PAD_NUM1 : TOUCH_PAD_NUM5, &finger, true);
+    }
+
+    report_stages("menu idle");
+    report_finger(&finger, true);
+}
+
+static void run_browsing(void)
+{
+    finger_t finger = {0};
+
+    latency_trace_reset();
+    for (int i = 0; i < TAPS; i++)
+    {
+        tap(i % 2 == 0 ? TOUCH_PAD_NUM1 : TOUCH_PAD_NUM5, &finger, false);
+
+        // the next tap lands while this prompt plays
+        vTaskDelay(pdMS_TO_TICKS(BROWSE_INTERVAL_MS - TAP_MS));
+        CHECK(audio_player_is_playing());
+    }
+    CHECK_ESP_OK(audio_harness_wait_idle(10000));
+
+    report_stages("browsing, each tap stops the prompt before it");
+    report_finger(&finger, false);
+}
+
+// the home button's trace starts in its isr and skips the touch and menu stages
+static void test_button_trace(void)
+{
+    latency_trace_reset();
+
+    latency_trace_begin_from_isr(LATENCY_SOURCE_BUTTON);
+    CHECK_ESP_OK(playback_audio_clip(AUDIO_CLIP_CONFIRM_SFX_04, true));
+    CHECK_ESP_OK(audio_harness_wait_idle(5000));
+
+    latency_stats_t stats;
+    CHECK_ESP_OK(latency_trace_stats(LATENCY_STAGE_INPUT, &stats));
+    CHECK_EQ_INT(stats.count, 1);
+    CHECK_EQ_INT(latency_trace_stats(LATENCY_STAGE_MENU, &stats), ESP_ERR_NOT_FOUND);
+    CHECK_ESP_OK(latency_trace_stats(LATENCY_STAGE_FIRST_SAMPLE, &stats));
+
+    // marks without a trace in flight are ignored
+    latency_trace_mark(LATENCY_STAGE_FIRST_SAMPLE);
+    CHECK_ESP_OK(latency_trace_stats(LATENCY_STAGE_INPUT, &stats));
+    CHECK_EQ_INT(stats.count, 1);
+}
+
+int main(void)
+{
+    audio_harness_start(0);
+
+    state_machine = TUTORFISH_HOME;
+    REQUIRE(init_touch() == ESP_OK);
+    REQUIRE(xTaskCreate(main_loop_task, "main_loop", 4096, NULL, 5, NULL) == pdPASS);
+
+    run_idle();
+    run_browsing();
+
+    main_loop_running = false;
+    test_button_trace();
+
+    return test_finish("bench_input_latency");
+}
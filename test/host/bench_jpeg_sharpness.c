@@ -0,0 +1,168 @@
+// jpeg_sharpness.c's focus score over the jpeg fixtures in fixtures/jpeg, written by
+// make_fixtures.py there: a printed page as the camera saves it, the same page out of focus,
+// and the page as a progressive, a truncated and a corrupt file. the blurred page must score
+// lower than the sharp one, and the time to score a frame is reported. every file the
+// camera would not write, a cut at any point of the sharp one and a frame with no luma
+// blocks are rejected. each is scored from a buffer of its exact length, so a read past the
+// end fails the test under ASan
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "jpeg_sharpness.h"
+#include "test.h"
+#include "test_support.h"
+
+#define FIXTURES TEST_REPO_DIR "/test/host/fixtures/jpeg/"
+#define ITERATIONS (200)
+#define NO_SCORE (0xDEADBEEF)
+
+typedef struct
+{
+    uint8_t *data;
+    size_t len;
+} jpeg_t;
+
+static jpeg_t read_fixture(const char *name)
+{
+    char path[256];
+    jpeg_t jpeg;
+
+    snprintf(path, sizeof(path), FIXTURES "%s", name);
+    jpeg.data = test_read_file(path, &jpeg.len);
+    REQUIRE(jpeg.data != NULL);
+
+    return jpeg;
+}
+
+// from a buffer of exactly len bytes, the score is left alone on an error
+static esp_err_t score_exact(const uint8_t *data, size_t len, uint32_t *score)
+{
+    uint8_t *copy = malloc(len ? len : 1);
+    memcpy(copy, data, len);
+
+    *score = NO_SCORE;
+    const esp_err_t err = jpeg_sharpness_score(copy, len, score);
+    if (err != ESP_OK)
+    {
+        CHECK_EQ_INT(*score, NO_SCORE);
+    }
+
+    free(copy);
+
+    return err;
+}
+
+static double us_per_frame(const jpeg_t *jpeg)
+{
+    uint32_t score = 0;
+    const double start = test_now_s();
+
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        jpeg_sharpness_score(jpeg->data, jpeg->len, &score);
+    }
+
+    return (test_now_s() - start) * 1e6 / ITERATIONS;
+}
+
+static void bench_scores(void)
+{
+    const jpeg_t sharp = read_fixture("sharp.jpg");
+    const jpeg_t blurred = read_fixture("blurred.jpg");
+    uint32_t sharp_score = 0;
+    uint32_t blurred_score = 0;
+
+    CHECK_ESP_OK(score_exact(sharp.data, sharp.len, &sharp_score));
+    CHECK_ESP_OK(score_exact(blurred.data, blurred.len, &blurred_score));
+    CHECK(blurred_score < sharp_score);
+
+    const double sharp_us = us_per_frame(&sharp);
+    const double blurred_us = us_per_frame(&blurred);
+
+    REPORT("sharp page: score %u, %zu bytes, %.0f us per frame", sharp_score, sharp.len, sharp_us);
+    REPORT("blurred page: score %u, %zu bytes, %.0f us per frame", blurred_score, blurred.len, blurred_us);
+    REPORT("%.1f MB/s of jpeg scored", (sharp.len + blurred.len) / (sharp_us + blurred_us));
+
+    free(sharp.data);
+    free(blurred.data);
+}
+
+static void test_rejected(void)
+{
+    static const struct
+    {
+        const char *name;
+        esp_err_t err;
+    } files[] = {
+        {"progressive.jpg", ESP_ERR_NOT_SUPPORTED},
+        {"truncated.jpg", ESP_ERR_INVALID_SIZE},
+        {"corrupt.jpg", ESP_ERR_INVALID_SIZE},
+    };
+    uint32_t score = 0;
+
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++)
+    {
+        const jpeg_t jpeg = read_fixture(files[i].name);
+        CHECK_EQ_INT(score_exact(jpeg.data, jpeg.len, &score), files[i].err);
+        free(jpeg.data);
+    }
+}
+
+// a cut before the end of image marker loses part of the headers or of the scan
+static void test_every_cut(void)
+{
+    const jpeg_t sharp = read_fixture("sharp.jpg");
+    uint32_t score = 0;
+    int accepted = 0;
+
+    for (size_t len = 0; len < sharp.len - 2; len++)
+    {
+        accepted += score_exact(sharp.data, len, &score) == ESP_OK;
+    }
+    CHECK_EQ_INT(accepted, 0);
+
+    REPORT("%zu cuts of the sharp page rejected", sharp.len - 2);
+
+    free(sharp.data);
+}
+
+// a zero sized frame has no blocks to score
+static void test_no_luma_blocks(void)
+{
+    jpeg_t sharp = read_fixture("sharp.jpg");
+    uint32_t score = 0;
+
+    size_t sof = 0;
+    while (sof + 1 < sharp.len && !(sharp.data[sof] == 0xFF && sharp.data[sof + 1] == 0xC0))
+    {
+        sof++;
+    }
+    REQUIRE(sof + 9 < sharp.len);
+
+    // height, then width
+    for (int field = 0; field < 2; field++)
+    {
+        jpeg_t empty = {.data = malloc(sharp.len), .len = sharp.len};
+        memcpy(empty.data, sharp.data, sharp.len);
+
+        uint8_t *size = &empty.data[sof + 5 + 2 * field];
+        size[0] = 0;
+        size[1] = 0;
+        CHECK_EQ_INT(score_exact(empty.data, empty.len, &score), ESP_ERR_INVALID_SIZE);
+
+        free(empty.data);
+    }
+
+    free(sharp.data);
+}
+
+int main(void)
+{
+    bench_scores();
+    test_rejected();
+    test_every_cut();
+    test_no_luma_blocks();
+
+    return test_finish("bench_jpeg_sharpness");
+}
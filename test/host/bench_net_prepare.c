@@ -0,0 +1,312 @@
+// the question flow's time from "submit" to ready to upload, with the wifi connected and
+// the session checked while the picture is taken (net_prepare.c) against the serial flow
+// it replaced, which connected and checked only after the capture. main.c's calls are
+// replayed in the order its states make them, over a fake radio standing in for
+// wifi_station.c and the real session GET against the local HTTP server.
+//
+// the phase lengths are drawn per question: the countdown prompt, the capture, a spoken
+// question of 2-8 s or none, a connection of 1.8-6 s and a session check of 0.3-1.2 s.
+// they are the ranges seen in the device logs, not measurements of the radio, and run
+// TIME_SCALE times faster than on the glasses. the upload itself is the same in both flows
+// and left out. also checked: the connection is silent while the countdown plays, a failed
+// connection or an expired session falls back to main.c's own paths, and a question that
+// is not uploaded stops the wifi the preparation started
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_http_client_example.h"
+#include "net_prepare.h"
+#include "wifi_station.h"
+#include "wifi_bt_status.h"
+#include "nvs_data_struct.h"
+#include "http_standin.h"
+#include "test.h"
+
+#define TIME_SCALE (10)
+#define QUESTIONS (16)
+#define COUNTDOWN_MS (4440) // taking_a_picture321_02.wav
+#define TOLERANCE_MS (300)  // ticks and the loopback request, on the glasses' time scale
+
+extern nvs_data_t nvs_data;
+
+static char session_cookie[] = "session=host-test";
+
+// the radio, as wifi_station.c drives it
+static struct
+{
+    int connect_ms;
+    bool fail;
+    int starts;
+    int stops;
+    bool announced; // wifi_announce_connection() when the last connection started
+    bool announce;
+} radio = {.announce = true};
+
+esp_err_t _esp_wifi_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t wifi_init_sta(void)
+{
+    return ESP_OK;
+}
+
+void wifi_announce_connection(bool announce)
+{
+    radio.announce = announce;
+}
+
+esp_err_t start_wifi(void)
+{
+    radio.starts++;
+    radio.announced = radio.announce;
+
+    vTaskDelay(pdMS_TO_TICKS(radio.connect_ms / TIME_SCALE));
+
+    wifi_bt_status.wifi_conn = !radio.fail;
+    return radio.fail ? ESP_FAIL : ESP_OK;
+}
+
+esp_err_t stop_wifi(void)
+{
+    radio.stops++;
+    wifi_bt_status.wifi_conn = false;
+    return ESP_OK;
+}
+
+static void radio_reset(int connect_ms, bool fail)
+{
+    radio.connect_ms = connect_ms;
+    radio.fail = fail;
+    radio.starts = 0;
+    radio.stops = 0;
+    wifi_bt_status.wifi_conn = false;
+}
+
+static void session_responds(int status, int session_ms)
+{
+    static const char body[] = "{}";
+    const http_standin_response_t response = {
+        .status = status,
+        .body = (const uint8_t *)body,
+        .body_len = strlen(body),
+        .rtt_ms = session_ms / TIME_SCALE,
+    };
+
+    http_standin_respond(&response);
+}
+
+// on the glasses' time scale
+static int64_t now_ms(void)
+{
+    return esp_timer_get_time() * TIME_SCALE / 1000;
+}
+
+static void phase(int ms)
+{
+    vTaskDelay(pdMS_TO_TICKS(ms / TIME_SCALE));
+}
+
+typedef struct
+{
+    int picture_ms; // countdown, capture and question
+    int connect_ms;
+    int session_ms;
+} question_t;
+
+typedef struct
+{
+    int64_t picture_done;
+    int64_t connected;
+    int64_t ready;
+} timeline_t;
+
+// TUTORFISH_SUBMIT_QUESTION to TUTORFISH_CAPTURE_PIC, both flows
+static timeline_t run_question(const question_t *q, bool overlap)
+{
+    timeline_t t = {0};
+
+    radio_reset(q->connect_ms, false);
+    session_responds(200, q->session_ms);
+    const int64_t start = now_ms();
+
+    if (overlap)
+    {
+        CHECK_ESP_OK(net_prepare_start());
+    }
+    phase(q->picture_ms);
+    t.picture_done = now_ms() - start;
+
+    // CONNECT_TO_WIFI
+    CHECK_ESP_OK(net_prepare_active() ? net_prepare_wifi() : start_wifi());
+    t.connected = now_ms() - start;
+
+    // TUTORFISH_VALIDATE_SESSION
+    if (!(net_prepare_active() && net_prepare_session()))
+    {
+        CHECK(!overlap);
+        CHECK_EQ_INT(http_get_request_(TUTORFISH_HOSTNAME, "/validate-session", NULL, true), 200);
+    }
+    t.ready = now_ms() - start;
+
+    CHECK_EQ_INT(radio.starts, 1);
+    CHECK(!net_prepare_active());
+
+    return t;
+}
+
+static uint32_t lcg = 25;
+
+static int draw(int lo, int hi)
+{
+    lcg = lcg * 1103515245u + 12345u;
+
+    return lo + (int)((lcg >> 16) % (uint32_t)(hi - lo + 1));
+}
+
+static int compare_int(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+static int percentile(int *values, int count, int pct)
+{
+    qsort(values, count, sizeof(values[0]), compare_int);
+
+    return values[(count * pct + 99) / 100 - 1];
+}
+
+static void bench_timeline(void)
+{
+    int serial_ms[QUESTIONS];
+    int overlap_ms[QUESTIONS];
+    int saved_ms[QUESTIONS];
+    int hidden = 0;
+
+    for (int i = 0; i < QUESTIONS; i++)
+    {
+        const int capture_ms = draw(400, 1200);
+        const int question_ms = draw(0, 1) ? draw(2000, 8000) : 0;
+        const question_t q = {
+            .picture_ms = COUNTDOWN_MS + capture_ms + question_ms,
+            .connect_ms = draw(1800, 6000),
+            .session_ms = draw(300, 1200),
+        };
+
+        const timeline_t serial = run_question(&q, false);
+        const timeline_t overlap = run_question(&q, true);
+
+        // serial adds the connection and the check to the picture, overlapped takes the longer
+        const int network_ms = q.connect_ms + q.session_ms;
+        const int expected_ms = q.picture_ms > network_ms ? q.picture_ms : network_ms;
+        CHECK(serial.ready >= q.picture_ms + network_ms - TOLERANCE_MS);
+        CHECK(overlap.ready <= expected_ms + TOLERANCE_MS);
+
+        // the whole connection comes off the end to end time once the picture outlasts it
+        if (network_ms <= q.picture_ms)
+        {
+            CHECK(serial.ready - overlap.ready >= q.connect_ms - TOLERANCE_MS);
+            hidden++;
+        }
+
+        if (i == 0)
+        {
+            REPORT("question 0: picture %d ms, connect %d ms, session %d ms", q.picture_ms, q.connect_ms, q.session_ms);
+            REPORT("  serial:     picture done %5lld, connected %5lld, ready %5lld ms", (long long)serial.picture_done,
+                   (long long)serial.connected, (long long)serial.ready);
+            REPORT("  overlapped: picture done %5lld, connected %5lld, ready %5lld ms", (long long)overlap.picture_done,
+                   (long long)overlap.connected, (long long)overlap.ready);
+        }
+
+        serial_ms[i] = serial.ready;
+        overlap_ms[i] = overlap.ready;
+        saved_ms[i] = serial.ready - overlap.ready;
+    }
+
+    REPORT("%d questions, submit to ready to upload (ms): serial p50 %d p90 %d, overlapped p50 %d p90 %d", QUESTIONS,
+           percentile(serial_ms, QUESTIONS, 50), percentile(serial_ms, QUESTIONS, 90),
+           percentile(overlap_ms, QUESTIONS, 50), percentile(overlap_ms, QUESTIONS, 90));
+    REPORT("saved p50 %d p90 %d ms, connection and check hidden behind the picture for %d of %d",
+           percentile(saved_ms, QUESTIONS, 50), percentile(saved_ms, QUESTIONS, 90), hidden, QUESTIONS);
+}
+
+// the countdown and the question are being played and recorded, the connection is silent
+static void test_silent_connection(void)
+{
+    radio_reset(1000, false);
+    session_responds(200, 300);
+
+    CHECK_ESP_OK(net_prepare_start());
+    CHECK_ESP_OK(net_prepare_wifi());
+    CHECK(net_prepare_session());
+
+    CHECK(!radio.announced);
+    CHECK(radio.announce);
+}
+
+// main.c retries a failed connection and renews an expired cookie itself
+static void test_fallbacks(void)
+{
+    radio_reset(1000, true);
+    session_responds(200, 300);
+    CHECK_ESP_OK(net_prepare_start());
+    CHECK(net_prepare_wifi() != ESP_OK);
+    CHECK(!net_prepare_active());
+
+    radio_reset(1000, false);
+    session_responds(401, 300);
+    CHECK_ESP_OK(net_prepare_start());
+    CHECK_ESP_OK(net_prepare_wifi());
+    CHECK(net_prepare_active());
+    CHECK(!net_prepare_session());
+    CHECK(!net_prepare_active());
+}
+
+static void test_start_and_cancel(void)
+{
+    session_responds(200, 300);
+
+    // a second start while one runs, or a start with the wifi up, connects nothing more
+    radio_reset(1000, false);
+    CHECK_ESP_OK(net_prepare_start());
+    CHECK_ESP_OK(net_prepare_start());
+    CHECK_ESP_OK(net_prepare_wifi());
+    CHECK(net_prepare_session());
+    CHECK_EQ_INT(radio.starts, 1);
+
+    CHECK_ESP_OK(net_prepare_start());
+    CHECK(!net_prepare_active());
+    CHECK_EQ_INT(radio.starts, 1);
+
+    // a question that is not uploaded stops the wifi its preparation started
+    radio_reset(1000, false);
+    CHECK_ESP_OK(net_prepare_start());
+    net_prepare_cancel();
+    CHECK(!net_prepare_active());
+    CHECK_EQ_INT(radio.stops, 1);
+    CHECK(!wifi_bt_status.wifi_conn);
+
+    net_prepare_cancel();
+    CHECK_EQ_INT(radio.stops, 1);
+}
+
+int main(void)
+{
+    http_standin_start();
+    nvs_data.session_cookie = session_cookie;
+    REQUIRE(init_net_prepare() == ESP_OK);
+
+    bench_timeline();
+    test_silent_connection();
+    test_fallbacks();
+    test_start_and_cancel();
+
+    http_standin_stop();
+
+    return test_finish("bench_net_prepare");
+}
@@ -0,0 +1,215 @@
+// the picture upload against a local HTTP server taking the body at the glasses' upload
+// pace, through the lwip sized send buffer, so esp_http_client_write() blocks as it would on
+// the link. https_send_pic() writes the multipart body straight from the camera frame buffer
+// and returns the buffer once its last byte is written. the path it replaced copied the
+// frame into a heap buffer of its size first and returned the frame at once; it is
+// reproduced here as that copy, followed by the same upload from it.
+//
+// reported per frame size: the heap the upload needed, the host time of the copy, and how
+// long the frame buffer was held, which the camera's second frame buffer covers. checked:
+// the server gets the frame byte for byte inside the multipart body, the frame is returned
+// exactly once on success and on a failed connection, and not at all when there is no
+// session cookie, the caller keeps it for the retry. host times only compare the two paths
+
+#define _GNU_SOURCE // memmem()
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_timer.h"
+#include "esp_camera.h"
+#include "http_request.h"
+#include "nvs_data_struct.h"
+#include "audio_harness.h"
+#include "alloc_count.h"
+#include "fake_camera.h"
+#include "http_standin.h"
+#include "test.h"
+#include "test_support.h"
+
+#define LINK_RTT_MS (120)
+#define LINK_UPLOAD_BYTES_PER_S (192 * 1024)
+#define DOCUMENT_ID "6634f0c2a1e5"
+#define MULTIPART_TAIL "\r\n------123--\r\n"
+
+extern nvs_data_t nvs_data;
+
+static char session_cookie[] = "session=host-test";
+static int requests = 0;
+
+// random bytes between the jpeg markers, entropy coded data looks much the same
+static uint8_t *jpeg_frame(size_t len)
+{
+    uint8_t *buf = malloc(len);
+    uint32_t state = (uint32_t)len;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        state = state * 1103515245u + 12345u;
+        buf[i] = state >> 16;
+    }
+    buf[0] = 0xFF;
+    buf[1] = 0xD8;
+    buf[len - 2] = 0xFF;
+    buf[len - 1] = 0xD9;
+
+    return buf;
+}
+
+// the frame is the first part of the body, after its part headers
+static void check_body(const uint8_t *jpeg, size_t len)
+{
+    const http_standin_request_t *req = http_standin_last();
+
+    CHECK(strcmp(req->method, "POST") == 0);
+    CHECK(strcmp(req->target, "/upload-image") == 0);
+    CHECK(strstr(req->headers, session_cookie) != NULL);
+
+    const uint8_t *body = req->body;
+    const uint8_t *part = memmem(body, req->body_len < 512 ? req->body_len : 512, "\r\n\r\n", 4);
+    REQUIRE(part != NULL);
+    part += 4;
+
+    const size_t head_len = part - body;
+    const size_t tail_len = strlen(MULTIPART_TAIL);
+    CHECK_EQ_INT(req->body_len, head_len + len + tail_len);
+    CHECK(req->body_len >= head_len + len && memcmp(part, jpeg, len) == 0);
+    CHECK(req->body_len >= tail_len && memcmp(&body[req->body_len - tail_len], MULTIPART_TAIL, tail_len) == 0);
+}
+
+typedef struct
+{
+    size_t peak_bytes;
+    int64_t copy_us;
+    int64_t held_us;  // from the call to the frame's return
+    int64_t total_us; // the whole upload, to the server's answer
+} upload_t;
+
+static upload_t upload(camera_fb_t *fb)
+{
+    upload_t result = {0};
+    alloc_count_t allocs;
+
+    fake_camera_reset();
+    alloc_count_reset();
+    const int64_t start = esp_timer_get_time();
+
+    CHECK_EQ_INT(https_send_pic(true, fb), 200);
+    result.total_us = esp_timer_get_time() - start;
+    REQUIRE(http_standin_wait(++requests, 10000));
+
+    // less the stand-in's own copy of the request body
+    alloc_count_get(&allocs);
+    result.peak_bytes = allocs.peak_bytes - http_standin_last()->body_len;
+    result.held_us = fake_camera_returned_us() - start;
+    CHECK_EQ_INT(fake_camera_returned(), 1);
+
+    CHECK(nvs_data.documentId != NULL && memcmp(nvs_data.documentId, DOCUMENT_ID, strlen(DOCUMENT_ID)) == 0);
+
+    return result;
+}
+
+// the old path: the frame into a heap copy of its size, the frame back to the driver, and
+// the upload from the copy
+static upload_t upload_copied(camera_fb_t *fb)
+{
+    const int64_t start = esp_timer_get_time();
+
+    uint8_t *copy = malloc(fb->len);
+    REQUIRE(copy != NULL);
+    memcpy(copy, fb->buf, fb->len);
+    const int64_t copied = esp_timer_get_time();
+
+    camera_fb_t copy_fb = *fb;
+    copy_fb.buf = copy;
+    upload_t result = upload(&copy_fb);
+    free(copy);
+
+    // the copy was held through the whole upload
+    result.peak_bytes += fb->len;
+    result.copy_us = copied - start;
+    result.held_us = result.copy_us;
+    result.total_us += result.copy_us;
+
+    return result;
+}
+
+static void bench_upload(size_t len)
+{
+    uint8_t *jpeg = jpeg_frame(len);
+    camera_fb_t fb = {.buf = jpeg, .len = len, .width = 2560, .height = 1600, .format = PIXFORMAT_JPEG};
+
+    const upload_t copied = upload_copied(&fb);
+    check_body(jpeg, len);
+
+    const upload_t streamed = upload(&fb);
+    check_body(jpeg, len);
+    CHECK_ESP_OK(audio_harness_wait_idle(10000));
+
+    // no allocation the size of the frame, and the frame is held for the upload itself
+    CHECK(streamed.peak_bytes < len / 8);
+    CHECK(copied.peak_bytes >= len);
+    CHECK(streamed.held_us < streamed.total_us);
+    CHECK(streamed.held_us >= (int64_t)len * 1000000 / LINK_UPLOAD_BYTES_PER_S / 2);
+
+    REPORT("%zu KB frame at %d KB/s:", len / 1024, LINK_UPLOAD_BYTES_PER_S / 1024);
+    REPORT("  streamed: peak heap %7zu bytes, frame held %5lld ms, upload %5lld ms", streamed.peak_bytes,
+           (long long)streamed.held_us / 1000, (long long)streamed.total_us / 1000);
+    REPORT("  copied:   peak heap %7zu bytes, frame held %5lld ms, upload %5lld ms, copy %lld us", copied.peak_bytes,
+           (long long)copied.held_us / 1000, (long long)copied.total_us / 1000, (long long)copied.copy_us);
+
+    free(jpeg);
+}
+
+// without a cookie nothing is sent and the caller keeps the frame for the retry
+static void test_no_cookie(void)
+{
+    uint8_t *jpeg = jpeg_frame(4096);
+    camera_fb_t fb = {.buf = jpeg, .len = 4096, .format = PIXFORMAT_JPEG};
+
+    nvs_data.session_cookie = NULL;
+    fake_camera_reset();
+    CHECK_EQ_INT(https_send_pic(true, &fb), -1);
+    CHECK_EQ_INT(fake_camera_returned(), 0);
+    nvs_data.session_cookie = session_cookie;
+
+    free(jpeg);
+}
+
+// a connection that fails still hands the frame back, once
+static void test_no_server(void)
+{
+    uint8_t *jpeg = jpeg_frame(64 * 1024);
+    camera_fb_t fb = {.buf = jpeg, .len = 64 * 1024, .format = PIXFORMAT_JPEG};
+
+    http_standin_stop();
+    fake_camera_reset();
+    CHECK(https_send_pic(true, &fb) != 200);
+    CHECK_EQ_INT(fake_camera_returned(), 1);
+
+    free(jpeg);
+}
+
+int main(void)
+{
+    audio_harness_start(0);
+    http_standin_start();
+
+    const http_standin_response_t response = {
+        .status = 200,
+        .body = (const uint8_t *)DOCUMENT_ID,
+        .body_len = strlen(DOCUMENT_ID),
+        .rtt_ms = LINK_RTT_MS,
+        .upload_bytes_per_s = LINK_UPLOAD_BYTES_PER_S,
+    };
+    http_standin_respond(&response);
+    nvs_data.session_cookie = session_cookie;
+
+    bench_upload(320 * 1024);
+    bench_upload(600 * 1024);
+
+    test_no_cookie();
+    test_no_server();
+
+    return test_finish("bench_pic_upload");
+}
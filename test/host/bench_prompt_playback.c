@@ -0,0 +1,218 @@
+// prompt playback against the path it replaced. the old path copied the prompt's wav array
+// into the heap byte by byte, scaled all of it into a second buffer twice its size, zeroed
+// the first 2000 samples to hide the header and only then wrote to i2s. it is reproduced
+// here from the PCM masters, which are what those arrays held, and run on the same fake
+// i2s as playback_audio_clip() playing the prompt as it is linked now.
+//
+// reported per prompt: the heap the play needed and the time from the call to the first
+// i2s_write() and to the first audible sample leaving the dma. host times only compare the
+// two paths with each other, the copy from flash on the target is far slower than here
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/i2s.h"
+#include "esp_timer.h"
+#include "audio_io.h"
+#include "audio_player.h"
+#include "audio_harness.h"
+#include "fake_i2s.h"
+#include "alloc_count.h"
+#include "test.h"
+#include "test_support.h"
+
+typedef struct
+{
+    size_t peak_bytes;
+    int64_t first_write_us;
+    int64_t first_sound_us;
+} play_result_t;
+
+static void wait_for_sound(int timeout_ms)
+{
+    fake_i2s_stats_t dma;
+
+    for (int waited = 0; waited < timeout_ms; waited += portTICK_PERIOD_MS)
+    {
+        fake_i2s_stats(&dma);
+        if (dma.first_sound_us != 0)
+        {
+            return;
+        }
+        vTaskDelay(1);
+    }
+}
+
+static void collect(play_result_t *result, int64_t start_us)
+{
+    alloc_count_t allocs;
+    fake_i2s_stats_t dma;
+
+    alloc_count_get(&allocs);
+    fake_i2s_stats(&dma);
+
+    result->peak_bytes = allocs.peak_bytes;
+    result->first_write_us = dma.first_write_us ? dma.first_write_us - start_us : -1;
+    result->first_sound_us = dma.first_sound_us ? dma.first_sound_us - start_us : -1;
+}
+
+typedef struct
+{
+    const int16_t *buf;
+    int len;
+    volatile bool stop;
+    volatile bool done;
+} reference_write_t;
+
+// the old path wrote with a 10 tick timeout and lost whatever did not fit by then, the
+// write is repeated here as if the whole clip had been queued
+static void reference_write_task(void *arg)
+{
+    reference_write_t *write = arg;
+    int pos = 0;
+
+    while (pos < write->len && !write->stop)
+    {
+        size_t bytes_written = 0;
+        i2s_write(I2S_NUM_1, (const uint8_t *)write->buf + pos, write->len - pos, &bytes_written, 10);
+        pos += bytes_written;
+    }
+
+    write->done = true;
+    vTaskDelete(NULL);
+}
+
+// the old playback_audio_file() with the malloc_*_wav() copy in front of it
+static void play_reference(const uint8_t *flash_array, int len, play_result_t *result)
+{
+    fake_i2s_reset();
+    alloc_count_reset();
+    const int64_t start = esp_timer_get_time();
+
+    uint8_t *audio_file_buf = malloc(len);
+    for (int i = 0; i < len; i++)
+    {
+        audio_file_buf[i] = flash_array[i];
+    }
+
+    const int16_t *samples = (const int16_t *)audio_file_buf;
+    int16_t *temp_buf = malloc(len * sizeof(int16_t));
+    for (int i = 0; i < len / (int)sizeof(int16_t); i++)
+    {
+        temp_buf[i] = i <= 2000 ? 0 : samples[i] * audio_volume;
+    }
+
+    i2s_start(I2S_NUM_1);
+
+    reference_write_t write = {.buf = temp_buf, .len = len};
+    REQUIRE(xTaskCreate(reference_write_task, "reference_write", 4096, &write, 4, NULL) == pdPASS);
+
+    wait_for_sound(2000);
+    collect(result, start);
+
+    write.stop = true;
+    while (!write.done)
+    {
+        vTaskDelay(1);
+    }
+
+    i2s_zero_dma_buffer(I2S_NUM_1);
+    i2s_stop(I2S_NUM_1);
+
+    free(temp_buf);
+    free(audio_file_buf);
+}
+
+static volatile int64_t play_start = 0;
+
+static void play_task(void *arg)
+{
+    fake_i2s_reset();
+    alloc_count_reset();
+    play_start = esp_timer_get_time();
+
+    playback_audio_clip(*(audio_clip_id_t *)arg, true);
+    vTaskDelete(NULL);
+}
+
+// playback_audio_clip() blocks until the prompt is queued, it runs on a task of its own
+// so the prompt can be cut short once it is heard
+static void play_current(audio_clip_id_t id, play_result_t *result)
+{
+    play_start = 0;
+    REQUIRE(xTaskCreate(play_task, "play_task", 4096, &id, 4, NULL) == pdPASS);
+
+    while (play_start == 0)
+    {
+        vTaskDelay(1);
+    }
+
+    wait_for_sound(2000);
+    collect(result, play_start);
+
+    audio_player_stop();
+    vTaskDelay(pdMS_TO_TICKS(50));
+    CHECK_ESP_OK(audio_harness_wait_idle(5000));
+}
+
+int main(void)
+{
+    audio_harness_start(0);
+
+    play_result_t total_ref = {0}, total_cur = {0};
+    int prompts = 0;
+
+    printf("%-38s %10s %10s %9s %9s %9s %9s\n", "prompt", "ref heap", "heap", "ref 1st", "1st", "ref sound", "sound");
+
+    for (int id = 0; id < AUDIO_CLIP_MAX; id++)
+    {
+        if (audio_clip_path(id) != NULL)
+        {
+            continue;
+        }
+
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/audio_source_files/%s.wav", TEST_REPO_DIR, audio_clip_name(id));
+
+        size_t len = 0;
+        uint8_t *master = test_read_file(path, &len);
+        REQUIRE(master != NULL);
+
+        play_result_t ref, cur;
+        play_reference(master, len, &ref);
+        play_current(id, &cur);
+
+        printf("%-38s %10zu %10zu %7lldus %7lldus %7lldus %7lldus\n", audio_clip_name(id), ref.peak_bytes, cur.peak_bytes,
+               (long long)ref.first_write_us, (long long)cur.first_write_us,
+               (long long)ref.first_sound_us, (long long)cur.first_sound_us);
+
+        // both copies of the prompt are gone, nothing is allocated at all
+        CHECK(ref.peak_bytes >= 3 * len);
+        CHECK_EQ_INT(cur.peak_bytes, 0);
+        CHECK(cur.first_write_us >= 0 && cur.first_sound_us >= 0);
+        // the old path zeroed 125 ms at the start, the prompt is heard sooner now
+        CHECK(cur.first_sound_us < ref.first_sound_us);
+
+        total_ref.peak_bytes += ref.peak_bytes;
+        total_cur.peak_bytes += cur.peak_bytes;
+        total_ref.first_write_us += ref.first_write_us;
+        total_cur.first_write_us += cur.first_write_us;
+        total_ref.first_sound_us += ref.first_sound_us;
+        total_cur.first_sound_us += cur.first_sound_us;
+        prompts++;
+
+        free(master);
+    }
+
+    REQUIRE(prompts > 0);
+    REPORT("%d prompts, mean heap per play: %zu bytes before, %zu now", prompts, total_ref.peak_bytes / prompts,
+           total_cur.peak_bytes / prompts);
+    REPORT("mean time to the first i2s_write(): %lld us before, %lld us now", (long long)total_ref.first_write_us / prompts,
+           (long long)total_cur.first_write_us / prompts);
+    REPORT("mean time to the first audible sample: %lld us before, %lld us now", (long long)total_ref.first_sound_us / prompts,
+           (long long)total_cur.first_sound_us / prompts);
+
+    return test_finish("bench_prompt_playback");
+}
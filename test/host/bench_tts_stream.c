@@ -0,0 +1,276 @@
+// the TTS answer download against a local HTTP server paced like the glasses' link. the
+// answer is played while it downloads: http_download_file() is timed from the request to
+// the first audible sample leaving the dma, against the path it replaced, which downloaded
+// the whole body and only then played it. both run on the same fake i2s and the same
+// server, so the difference is the download the old path waited for.
+//
+// also checked: the psram copy kept for "tap to hear again" is the body byte for byte and
+// is marked as already played; a link slower than the audio shows up as underruns and
+// still ends with the whole answer; and a prompt started mid answer ends the answer stream
+// at once while the download carries on into the copy, which is then not marked as played.
+// both first-audio figures include the dma depth, which the fake i2s plays before a new
+// stream as the IDF driver does. host times only compare the two paths, there is no tls
+// or wifi under them
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_http_client.h"
+#include "esp_http_client_example.h"
+#include "http_request.h"
+#include "audio_io.h"
+#include "audio_player.h"
+#include "audio_harness.h"
+#include "fake_i2s.h"
+#include "http_standin.h"
+#include "test.h"
+#include "test_support.h"
+
+#define ANSWER_S (4)
+#define LINK_RTT_MS (120)
+#define LINK_BYTES_PER_S (48 * 1024) // half as fast again as 16 kHz PCM plays
+
+// what the dma holds, a stream starts and stops this much behind its samples on the fake i2s
+// as on the IDF driver
+static int64_t dma_depth_us(void)
+{
+    audio_player_stats_t stats;
+    audio_player_stats(&stats);
+
+    return (int64_t)stats.dma_buf_count * stats.dma_buf_len * 1000000 / AUDIO_SAMPLE_RATE;
+}
+
+static char hostname[] = TUTORFISH_HOSTNAME;
+static char tts_path[] = "/student-download-tts";
+static int requests = 0;
+
+static uint8_t *answer_wav(int seconds, size_t *len)
+{
+    const int count = AUDIO_SAMPLE_RATE * seconds;
+    int16_t *samples = malloc(count * sizeof(int16_t));
+
+    test_tone(samples, count, 520, AUDIO_SAMPLE_RATE, 14000);
+    uint8_t *wav = test_wav_pcm(samples, count, AUDIO_SAMPLE_RATE, 1, len);
+    free(samples);
+
+    return wav;
+}
+
+static void serve(const uint8_t *body, size_t len, size_t bytes_per_s)
+{
+    const http_standin_response_t response = {
+        .status = 200,
+        .body = body,
+        .body_len = len,
+        .rtt_ms = LINK_RTT_MS,
+        .bytes_per_s = bytes_per_s,
+    };
+
+    http_standin_respond(&response);
+}
+
+static void wait_for_sound(int timeout_ms)
+{
+    fake_i2s_stats_t dma;
+
+    for (int waited = 0; waited < timeout_ms; waited += portTICK_PERIOD_MS)
+    {
+        fake_i2s_stats(&dma);
+        if (dma.first_sound_us != 0)
+        {
+            return;
+        }
+        vTaskDelay(1);
+    }
+}
+
+static int64_t first_sound_after(int64_t start_us)
+{
+    fake_i2s_stats_t dma;
+    fake_i2s_stats(&dma);
+
+    return dma.first_sound_us != 0 ? dma.first_sound_us - start_us : -1;
+}
+
+// before the answer was streamed: the whole body into memory, then played
+static int64_t play_downloaded(void)
+{
+    esp_http_client_config_t config = {
+        .host = hostname,
+        .path = tts_path,
+    };
+
+    fake_i2s_reset();
+    const int64_t start = esp_timer_get_time();
+
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    CHECK_ESP_OK(esp_http_client_open(client, 0));
+
+    const int len = esp_http_client_fetch_headers(client);
+    REQUIRE(len > 0);
+
+    char *body = malloc(len);
+    CHECK_EQ_INT(esp_http_client_read(client, body, len), len);
+    esp_http_client_close(client);
+    esp_http_client_cleanup(client);
+    REQUIRE(http_standin_wait(++requests, 10000));
+
+    CHECK_ESP_OK(playback_audio_file(body, len, 1.0f, false));
+    wait_for_sound(2000);
+    const int64_t first_sound = first_sound_after(start);
+
+    CHECK_ESP_OK(audio_harness_wait_idle(20000));
+    free(body);
+
+    return first_sound;
+}
+
+static int64_t play_streamed(const uint8_t *body, size_t len, audio_player_stats_t *stats)
+{
+    audio_player_stats_t before;
+    audio_player_stats(&before);
+
+    fake_i2s_reset();
+    const int64_t start = esp_timer_get_time();
+
+    CHECK_ESP_OK(http_download_file(hostname, tts_path, NULL, false));
+    REQUIRE(http_standin_wait(++requests, 10000));
+    const int64_t first_sound = first_sound_after(start);
+
+    CHECK_ESP_OK(audio_harness_wait_idle(20000));
+
+    audio_player_stats(stats);
+    stats->underruns -= before.underruns;
+
+    // the repeat copy is the answer as served, and it was heard already
+    CHECK_EQ_INT(audio_buf.tts_audio_len, len);
+    CHECK(audio_buf.tts_audio_buf != NULL && memcmp(audio_buf.tts_audio_buf, body, len) == 0);
+    CHECK(audio_buf.tts_audio_streamed);
+
+    // the request asks for ima-adpcm first
+    CHECK(strstr(http_standin_last()->headers, "codec=11") != NULL);
+
+    return first_sound;
+}
+
+static void bench_first_audio(void)
+{
+    size_t len = 0;
+    uint8_t *body = answer_wav(ANSWER_S, &len);
+    serve(body, len, LINK_BYTES_PER_S);
+
+    const int64_t downloaded = play_downloaded();
+
+    audio_player_stats_t stats;
+    const int64_t streamed = play_streamed(body, len, &stats);
+
+    CHECK(streamed > 0 && downloaded > 0);
+    CHECK(streamed < downloaded);
+    // the request, the first read and the dma, not the download
+    CHECK(streamed < LINK_RTT_MS * 1000 + dma_depth_us() + 250 * 1000);
+    CHECK_EQ_INT(stats.underruns, 0);
+
+    REPORT("%d s answer, %zu bytes at %d KB/s, %d ms rtt: first audio %lld ms streamed, %lld ms downloaded first",
+           ANSWER_S, len, LINK_BYTES_PER_S / 1024, LINK_RTT_MS, (long long)streamed / 1000, (long long)downloaded / 1000);
+
+    free(body);
+}
+
+// a link slower than the audio, the player runs dry but the answer is all there
+static void test_slow_link(void)
+{
+    size_t len = 0;
+    uint8_t *body = answer_wav(2, &len);
+    serve(body, len, 20 * 1024);
+
+    audio_player_stats_t stats;
+    const int64_t streamed = play_streamed(body, len, &stats);
+
+    CHECK(streamed > 0);
+    CHECK(stats.underruns > 0);
+    REPORT("2 s answer at 20 KB/s: first audio %lld ms, %u underruns", (long long)streamed / 1000, stats.underruns);
+
+    free(body);
+}
+
+typedef struct
+{
+    volatile bool done;
+    volatile int result;
+    volatile int64_t done_us;
+} download_t;
+
+static void download_task(void *arg)
+{
+    download_t *download = arg;
+
+    download->result = http_download_file(hostname, tts_path, NULL, false);
+    download->done_us = esp_timer_get_time();
+    download->done = true;
+
+    vTaskDelete(NULL);
+}
+
+// a prompt mid answer takes the speaker at once, the answer still downloads for a repeat
+static void test_preempted(void)
+{
+    size_t len = 0;
+    uint8_t *body = answer_wav(6, &len);
+    serve(body, len, LINK_BYTES_PER_S);
+
+    download_t download = {0};
+    fake_i2s_reset();
+    xTaskCreate(download_task, "download", 4096, &download, 5, NULL);
+
+    wait_for_sound(2000);
+    vTaskDelay(pdMS_TO_TICKS(300));
+
+    const audio_clip_id_t prompt = AUDIO_CLIP_TO_HEAR_THE_ANSWER_AGAIN_00;
+    audio_playback_handle_t handle = 0;
+    CHECK_ESP_OK(audio_playlist_enqueue(&prompt, 1, false, &handle));
+
+    audio_playback_info_t info = {0};
+    for (int waited = 0; waited < 2000 && (audio_player_info(handle, &info) != ESP_OK || info.started_us == 0); waited += 10)
+    {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
+    // the prompt waited for the answer's fade-out and the dma, not for the rest of the body
+    CHECK(info.started_us > 0 && info.started_us - info.queued_us < dma_depth_us() + 250 * 1000);
+
+    for (int waited = 0; waited < 10000 && !download.done; waited += 10)
+    {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    REQUIRE(download.done);
+    REQUIRE(http_standin_wait(++requests, 1000));
+
+    CHECK(info.started_us < download.done_us);
+    CHECK_ESP_OK(download.result);
+    CHECK_EQ_INT(audio_buf.tts_audio_len, len);
+    CHECK(audio_buf.tts_audio_buf != NULL && memcmp(audio_buf.tts_audio_buf, body, len) == 0);
+    CHECK(!audio_buf.tts_audio_streamed);
+
+    REPORT("prompt mid answer: started %lld ms after it was queued, %lld ms before the answer finished downloading",
+           (long long)(info.started_us - info.queued_us) / 1000, (long long)(download.done_us - info.started_us) / 1000);
+
+    CHECK_ESP_OK(audio_harness_wait_idle(5000));
+    free(body);
+}
+
+int main(void)
+{
+    audio_harness_start(0);
+    http_standin_start();
+
+    bench_first_audio();
+    test_slow_link();
+    test_preempted();
+
+    http_standin_stop();
+
+    return test_finish("bench_tts_stream");
+}
@@ -0,0 +1,164 @@
+// esp_err, esp_log, esp_timer, cpu_hal and esp_system for the host
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "hal/cpu_hal.h"
+
+#define FAKE_LOG_TAGS (32)
+
+typedef struct
+{
+    char tag[32];
+    esp_log_level_t level;
+} log_tag_level_t;
+
+static log_tag_level_t tag_levels[FAKE_LOG_TAGS];
+static int tag_level_count = 0;
+static int default_level = -1;
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code)
+    {
+    case ESP_OK:
+        return "ESP_OK";
+    case ESP_FAIL:
+        return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:
+        return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:
+        return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:
+        return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:
+        return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:
+        return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED:
+        return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:
+        return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_RESPONSE:
+        return "ESP_ERR_INVALID_RESPONSE";
+    case ESP_ERR_INVALID_CRC:
+        return "ESP_ERR_INVALID_CRC";
+    case ESP_ERR_INVALID_VERSION:
+        return "ESP_ERR_INVALID_VERSION";
+    case ESP_ERR_INVALID_MAC:
+        return "ESP_ERR_INVALID_MAC";
+    default:
+        return "UNKNOWN ERROR";
+    }
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    pthread_mutex_lock(&log_lock);
+
+    if (strcmp(tag, "*") == 0)
+    {
+        default_level = level;
+        tag_level_count = 0;
+    }
+    else
+    {
+        int i = 0;
+        while (i < tag_level_count && strcmp(tag_levels[i].tag, tag) != 0)
+        {
+            i++;
+        }
+
+        if (i < FAKE_LOG_TAGS)
+        {
+            strncpy(tag_levels[i].tag, tag, sizeof(tag_levels[i].tag) - 1);
+            tag_levels[i].level = level;
+            tag_level_count = i == tag_level_count ? i + 1 : tag_level_count;
+        }
+    }
+
+    pthread_mutex_unlock(&log_lock);
+}
+
+static esp_log_level_t level_for(const char *tag)
+{
+    if (default_level < 0)
+    {
+        const char *env = getenv("TEST_LOG_LEVEL");
+        default_level = env != NULL ? atoi(env) : ESP_LOG_WARN;
+    }
+
+    for (int i = 0; i < tag_level_count; i++)
+    {
+        if (strcmp(tag_levels[i].tag, tag) == 0)
+        {
+            return tag_levels[i].level;
+        }
+    }
+
+    return default_level;
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    static const char letters[] = "NEWIDV";
+
+    pthread_mutex_lock(&log_lock);
+
+    if (level <= level_for(tag))
+    {
+        va_list args;
+        va_start(args, format);
+        fprintf(stderr, "%c (%lld) %s: ", letters[level], (long long)(esp_timer_get_time() / 1000), tag);
+        vfprintf(stderr, format, args);
+        fputc('\n', stderr);
+        va_end(args);
+    }
+
+    pthread_mutex_unlock(&log_lock);
+}
+
+static struct timespec boot;
+static pthread_once_t boot_once = PTHREAD_ONCE_INIT;
+
+static void boot_now(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &boot);
+}
+
+int64_t esp_timer_get_time(void)
+{
+    pthread_once(&boot_once, boot_now);
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec - boot.tv_sec) * 1000000LL + (now.tv_nsec - boot.tv_nsec) / 1000;
+}
+
+uint32_t cpu_hal_get_cycle_count(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return (uint32_t)__builtin_ia32_rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint32_t)(now.tv_sec * 1000000000ULL + now.tv_nsec);
+#endif
+}
+
+void esp_restart(void)
+{
+    fprintf(stderr, "esp_restart()\n");
+    exit(3);
+}
@@ -0,0 +1,849 @@
+// FreeRTOS on pthreads. every kernel object shares one lock and one condition variable,
+// waiters re-check their own condition on each broadcast. slow but simple, and the
+// firmware only has a handful of tasks
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/param.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "freertos/ringbuf.h"
+
+struct fake_task
+{
+    pthread_t thread;
+    char name[16];
+    TaskFunction_t fn;
+    void *arg;
+    uint32_t notify_value;
+    bool notify_pending;
+};
+
+struct fake_queue
+{
+    uint8_t *items;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+};
+
+typedef enum
+{
+    SEM_BINARY,
+    SEM_COUNTING,
+    SEM_MUTEX,
+} sem_type_t;
+
+struct fake_semaphore
+{
+    sem_type_t type;
+    UBaseType_t count;
+    UBaseType_t max;
+};
+
+struct fake_event_group
+{
+    EventBits_t bits;
+};
+
+struct fake_ringbuf
+{
+    uint8_t *buf;
+    size_t size;
+    size_t read;
+    size_t used;
+    size_t outstanding; // bytes handed out by a receive and not yet returned
+};
+
+static pthread_mutex_t rtos_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t rtos_changed;
+static pthread_mutex_t critical_lock;
+static pthread_once_t rtos_once = PTHREAD_ONCE_INIT;
+static struct timespec boot_time;
+static __thread struct fake_task *current_task = NULL;
+
+static void rtos_init(void)
+{
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&rtos_changed, &cond_attr);
+
+    pthread_mutexattr_t mutex_attr;
+    pthread_mutexattr_init(&mutex_attr);
+    pthread_mutexattr_settype(&mutex_attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&critical_lock, &mutex_attr);
+
+    clock_gettime(CLOCK_MONOTONIC, &boot_time);
+}
+
+static void lock(void)
+{
+    pthread_once(&rtos_once, rtos_init);
+    pthread_mutex_lock(&rtos_lock);
+}
+
+static void unlock_and_broadcast(void)
+{
+    pthread_cond_broadcast(&rtos_changed);
+    pthread_mutex_unlock(&rtos_lock);
+}
+
+static void unlock(void)
+{
+    pthread_mutex_unlock(&rtos_lock);
+}
+
+static struct timespec deadline_after(TickType_t ticks)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    const uint64_t ns = (uint64_t)ticks * portTICK_PERIOD_MS * 1000000ULL;
+    t.tv_sec += ns / 1000000000ULL;
+    t.tv_nsec += ns % 1000000000ULL;
+    if (t.tv_nsec >= 1000000000L)
+    {
+        t.tv_sec++;
+        t.tv_nsec -= 1000000000L;
+    }
+
+    return t;
+}
+
+// waits for a change with the lock held, false once the deadline has passed
+static bool wait_changed(TickType_t ticks, const struct timespec *deadline)
+{
+    if (ticks == 0)
+    {
+        return false;
+    }
+
+    if (ticks == portMAX_DELAY)
+    {
+        pthread_cond_wait(&rtos_changed, &rtos_lock);
+        return true;
+    }
+
+    return pthread_cond_timedwait(&rtos_changed, &rtos_lock, deadline) != ETIMEDOUT;
+}
+
+void fake_rtos_enter_critical(void)
+{
+    pthread_once(&rtos_once, rtos_init);
+    pthread_mutex_lock(&critical_lock);
+}
+
+void fake_rtos_exit_critical(void)
+{
+    pthread_mutex_unlock(&critical_lock);
+}
+
+// tasks
+
+static void *task_entry(void *arg)
+{
+    current_task = arg;
+    current_task->fn(current_task->arg);
+
+    return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg, UBaseType_t priority,
+                       TaskHandle_t *handle)
+{
+    (void)stack_depth;
+    (void)priority;
+
+    pthread_once(&rtos_once, rtos_init);
+
+    struct fake_task *task = calloc(1, sizeof(*task));
+    if (task == NULL)
+    {
+        return pdFAIL;
+    }
+
+    strncpy(task->name, name, sizeof(task->name) - 1);
+    task->fn = fn;
+    task->arg = arg;
+
+    // published before the thread runs, a task may be notified before it first waits
+    if (handle != NULL)
+    {
+        *handle = task;
+    }
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    const int err = pthread_create(&task->thread, &attr, task_entry, task);
+    pthread_attr_destroy(&attr);
+
+    if (err != 0)
+    {
+        free(task);
+        return pdFAIL;
+    }
+
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core)
+{
+    (void)core;
+
+    return xTaskCreate(fn, name, stack_depth, arg, priority, handle);
+}
+
+// only a task deleting itself is supported, the firmware never deletes another task
+void vTaskDelete(TaskHandle_t handle)
+{
+    if (handle != NULL && handle != current_task)
+    {
+        fprintf(stderr, "vTaskDelete() of another task is not supported\n");
+        abort();
+    }
+
+    free(current_task);
+    current_task = NULL;
+
+    pthread_exit(NULL);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    const uint64_t ns = (uint64_t)ticks * portTICK_PERIOD_MS * 1000000ULL;
+    struct timespec t = {
+        .tv_sec = ns / 1000000000ULL,
+        .tv_nsec = ns % 1000000000ULL,
+    };
+
+    while (nanosleep(&t, &t) != 0 && errno == EINTR)
+    {
+    }
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    pthread_once(&rtos_once, rtos_init);
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    const int64_t ms = (now.tv_sec - boot_time.tv_sec) * 1000LL + (now.tv_nsec - boot_time.tv_nsec) / 1000000LL;
+
+    return (TickType_t)(ms / portTICK_PERIOD_MS);
+}
+
+// threads that were not created by xTaskCreate(), the test's main thread, get a task
+// the first time they ask for one
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    if (current_task == NULL)
+    {
+        current_task = calloc(1, sizeof(*current_task));
+        current_task->thread = pthread_self();
+        strncpy(current_task->name, "main", sizeof(current_task->name) - 1);
+    }
+
+    return current_task;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t handle, uint32_t value, eNotifyAction action)
+{
+    BaseType_t ret = pdPASS;
+
+    lock();
+
+    switch (action)
+    {
+    case eNoAction:
+        break;
+    case eSetBits:
+        handle->notify_value |= value;
+        break;
+    case eIncrement:
+        handle->notify_value++;
+        break;
+    case eSetValueWithOverwrite:
+        handle->notify_value = value;
+        break;
+    case eSetValueWithoutOverwrite:
+        if (handle->notify_pending)
+        {
+            ret = pdFAIL;
+        }
+        else
+        {
+            handle->notify_value = value;
+        }
+        break;
+    }
+    handle->notify_pending = true;
+
+    unlock_and_broadcast();
+
+    return ret;
+}
+
+BaseType_t xTaskNotifyFromISR(TaskHandle_t handle, uint32_t value, eNotifyAction action, BaseType_t *woken)
+{
+    if (woken != NULL)
+    {
+        *woken = pdFALSE;
+    }
+
+    return xTaskNotify(handle, value, action);
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value, TickType_t ticks)
+{
+    struct fake_task *self = xTaskGetCurrentTaskHandle();
+    const struct timespec deadline = deadline_after(ticks);
+
+    lock();
+
+    if (!self->notify_pending)
+    {
+        self->notify_value &= ~clear_on_entry;
+    }
+
+    while (!self->notify_pending && wait_changed(ticks, &deadline))
+    {
+    }
+
+    if (value != NULL)
+    {
+        *value = self->notify_value;
+    }
+
+    const bool notified = self->notify_pending;
+    if (notified)
+    {
+        self->notify_value &= ~clear_on_exit;
+        self->notify_pending = false;
+    }
+
+    unlock();
+
+    return notified ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t handle)
+{
+    return xTaskNotify(handle, 0, eIncrement);
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t handle, BaseType_t *woken)
+{
+    xTaskNotifyFromISR(handle, 0, eIncrement, woken);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+{
+    struct fake_task *self = xTaskGetCurrentTaskHandle();
+    const struct timespec deadline = deadline_after(ticks);
+
+    lock();
+
+    while (self->notify_value == 0 && wait_changed(ticks, &deadline))
+    {
+    }
+
+    const uint32_t value = self->notify_value;
+    if (value != 0)
+    {
+        self->notify_value = clear_on_exit ? 0 : value - 1;
+    }
+    self->notify_pending = false;
+
+    unlock();
+
+    return value;
+}
+
+// queues
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    struct fake_queue *queue = calloc(1, sizeof(*queue));
+    if (queue == NULL)
+    {
+        return NULL;
+    }
+
+    queue->items = calloc(length, item_size ? item_size : 1);
+    if (queue->items == NULL)
+    {
+        free(queue);
+        return NULL;
+    }
+
+    queue->length = length;
+    queue->item_size = item_size;
+
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    if (queue != NULL)
+    {
+        free(queue->items);
+        free(queue);
+    }
+}
+
+static BaseType_t queue_send(QueueHandle_t queue, const void *item, TickType_t ticks, bool front, bool overwrite)
+{
+    const struct timespec deadline = deadline_after(ticks);
+
+    lock();
+
+    while (!overwrite && queue->count == queue->length && wait_changed(ticks, &deadline))
+    {
+    }
+
+    if (!overwrite && queue->count == queue->length)
+    {
+        unlock();
+        return errQUEUE_FULL;
+    }
+
+    UBaseType_t slot;
+    if (overwrite && queue->count == queue->length)
+    {
+        slot = queue->head;
+    }
+    else if (front)
+    {
+        queue->head = (queue->head + queue->length - 1) % queue->length;
+        slot = queue->head;
+        queue->count++;
+    }
+    else
+    {
+        slot = (queue->head + queue->count) % queue->length;
+        queue->count++;
+    }
+
+    memcpy(&queue->items[slot * queue->item_size], item, queue->item_size);
+
+    unlock_and_broadcast();
+
+    return pdPASS;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks)
+{
+    return queue_send(queue, item, ticks, false, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t ticks)
+{
+    return queue_send(queue, item, ticks, true, false);
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *woken)
+{
+    if (woken != NULL)
+    {
+        *woken = pdFALSE;
+    }
+
+    return queue_send(queue, item, 0, false, false);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void *item)
+{
+    return queue_send(queue, item, 0, false, true);
+}
+
+static BaseType_t queue_receive(QueueHandle_t queue, void *item, TickType_t ticks, bool peek)
+{
+    const struct timespec deadline = deadline_after(ticks);
+
+    lock();
+
+    while (queue->count == 0 && wait_changed(ticks, &deadline))
+    {
+    }
+
+    if (queue->count == 0)
+    {
+        unlock();
+        return errQUEUE_EMPTY;
+    }
+
+    memcpy(item, &queue->items[queue->head * queue->item_size], queue->item_size);
+    if (!peek)
+    {
+        queue->head = (queue->head + 1) % queue->length;
+        queue->count--;
+    }
+
+    unlock_and_broadcast();
+
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks)
+{
+    return queue_receive(queue, item, ticks, false);
+}
+
+BaseType_t xQueueReceiveFromISR(QueueHandle_t queue, void *item, BaseType_t *woken)
+{
+    if (woken != NULL)
+    {
+        *woken = pdFALSE;
+    }
+
+    return queue_receive(queue, item, 0, false);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void *item, TickType_t ticks)
+{
+    return queue_receive(queue, item, ticks, true);
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue)
+{
+    lock();
+    queue->head = 0;
+    queue->count = 0;
+    unlock_and_broadcast();
+
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    lock();
+    const UBaseType_t count = queue->count;
+    unlock();
+
+    return count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue)
+{
+    lock();
+    const UBaseType_t spaces = queue->length - queue->count;
+    unlock();
+
+    return spaces;
+}
+
+// semaphores, a mutex is a binary semaphore that starts given. priority inheritance
+// and ownership are not modelled
+
+static SemaphoreHandle_t semaphore_create(sem_type_t type, UBaseType_t max, UBaseType_t initial)
+{
+    struct fake_semaphore *sem = calloc(1, sizeof(*sem));
+    if (sem == NULL)
+    {
+        return NULL;
+    }
+
+    sem->type = type;
+    sem->max = max;
+    sem->count = initial;
+
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return semaphore_create(SEM_BINARY, 1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return semaphore_create(SEM_MUTEX, 1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial)
+{
+    return semaphore_create(SEM_COUNTING, max, initial);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    free(sem);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    const struct timespec deadline = deadline_after(ticks);
+
+    lock();
+
+    while (sem->count == 0 && wait_changed(ticks, &deadline))
+    {
+    }
+
+    if (sem->count == 0)
+    {
+        unlock();
+        return pdFALSE;
+    }
+
+    sem->count--;
+
+    unlock_and_broadcast();
+
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    lock();
+
+    if (sem->count == sem->max)
+    {
+        unlock();
+        return pdFALSE;
+    }
+
+    sem->count++;
+
+    unlock_and_broadcast();
+
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *woken)
+{
+    if (woken != NULL)
+    {
+        *woken = pdFALSE;
+    }
+
+    return xSemaphoreGive(sem);
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t sem)
+{
+    lock();
+    const UBaseType_t count = sem->count;
+    unlock();
+
+    return count;
+}
+
+// event groups
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+    return calloc(1, sizeof(struct fake_event_group));
+}
+
+void vEventGroupDelete(EventGroupHandle_t group)
+{
+    free(group);
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    lock();
+    group->bits |= bits;
+    const EventBits_t now = group->bits;
+    unlock_and_broadcast();
+
+    return now;
+}
+
+BaseType_t xEventGroupSetBitsFromISR(EventGroupHandle_t group, EventBits_t bits, BaseType_t *woken)
+{
+    if (woken != NULL)
+    {
+        *woken = pdFALSE;
+    }
+
+    xEventGroupSetBits(group, bits);
+
+    return pdPASS;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    lock();
+    const EventBits_t before = group->bits;
+    group->bits &= ~bits;
+    unlock_and_broadcast();
+
+    return before;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group)
+{
+    lock();
+    const EventBits_t bits = group->bits;
+    unlock();
+
+    return bits;
+}
+
+static bool bits_satisfied(EventBits_t bits, EventBits_t wanted, BaseType_t wait_all)
+{
+    return wait_all ? (bits & wanted) == wanted : (bits & wanted) != 0;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear_on_exit, BaseType_t wait_all,
+                                TickType_t ticks)
+{
+    const struct timespec deadline = deadline_after(ticks);
+
+    lock();
+
+    while (!bits_satisfied(group->bits, bits, wait_all) && wait_changed(ticks, &deadline))
+    {
+    }
+
+    const EventBits_t now = group->bits;
+    if (clear_on_exit && bits_satisfied(now, bits, wait_all))
+    {
+        group->bits &= ~bits;
+    }
+
+    unlock_and_broadcast();
+
+    return now;
+}
+
+// byte ring buffers, one item may be outstanding at a time as with the IDF's BYTEBUF
+
+RingbufHandle_t xRingbufferCreate(size_t size, RingbufferType_t type)
+{
+    if (type != RINGBUF_TYPE_BYTEBUF)
+    {
+        fprintf(stderr, "only RINGBUF_TYPE_BYTEBUF is supported\n");
+        return NULL;
+    }
+
+    struct fake_ringbuf *ringbuf = calloc(1, sizeof(*ringbuf));
+    if (ringbuf == NULL)
+    {
+        return NULL;
+    }
+
+    ringbuf->buf = malloc(size);
+    if (ringbuf->buf == NULL)
+    {
+        free(ringbuf);
+        return NULL;
+    }
+    ringbuf->size = size;
+
+    return ringbuf;
+}
+
+void vRingbufferDelete(RingbufHandle_t ringbuf)
+{
+    if (ringbuf != NULL)
+    {
+        free(ringbuf->buf);
+        free(ringbuf);
+    }
+}
+
+BaseType_t xRingbufferSend(RingbufHandle_t ringbuf, const void *data, size_t size, TickType_t ticks)
+{
+    const struct timespec deadline = deadline_after(ticks);
+
+    if (size > ringbuf->size)
+    {
+        return pdFALSE;
+    }
+
+    lock();
+
+    while (ringbuf->size - ringbuf->used < size && wait_changed(ticks, &deadline))
+    {
+    }
+
+    if (ringbuf->size - ringbuf->used < size)
+    {
+        unlock();
+        return pdFALSE;
+    }
+
+    const uint8_t *bytes = data;
+    size_t write = (ringbuf->read + ringbuf->used) % ringbuf->size;
+    for (size_t done = 0; done < size;)
+    {
+        const size_t n = MIN(size - done, ringbuf->size - write);
+        memcpy(&ringbuf->buf[write], &bytes[done], n);
+        done += n;
+        write = (write + n) % ringbuf->size;
+    }
+    ringbuf->used += size;
+
+    unlock_and_broadcast();
+
+    return pdTRUE;
+}
+
+void *xRingbufferReceiveUpTo(RingbufHandle_t ringbuf, size_t *size, TickType_t ticks, size_t max_size)
+{
+    const struct timespec deadline = deadline_after(ticks);
+
+    lock();
+
+    while ((ringbuf->used == 0 || ringbuf->outstanding > 0) && wait_changed(ticks, &deadline))
+    {
+    }
+
+    if (ringbuf->used == 0 || ringbuf->outstanding > 0)
+    {
+        unlock();
+        return NULL;
+    }
+
+    // items never wrap, the part past the end comes with the next receive
+    const size_t n = MIN(MIN(ringbuf->used, max_size), ringbuf->size - ringbuf->read);
+    void *item = &ringbuf->buf[ringbuf->read];
+    ringbuf->outstanding = n;
+    *size = n;
+
+    unlock();
+
+    return item;
+}
+
+void *xRingbufferReceive(RingbufHandle_t ringbuf, size_t *size, TickType_t ticks)
+{
+    return xRingbufferReceiveUpTo(ringbuf, size, ticks, ringbuf->size);
+}
+
+void vRingbufferReturnItem(RingbufHandle_t ringbuf, void *item)
+{
+    (void)item;
+
+    lock();
+    ringbuf->read = (ringbuf->read + ringbuf->outstanding) % ringbuf->size;
+    ringbuf->used -= ringbuf->outstanding;
+    ringbuf->outstanding = 0;
+    unlock_and_broadcast();
+}
+
+size_t xRingbufferGetCurFreeSize(RingbufHandle_t ringbuf)
+{
+    lock();
+    const size_t free_size = ringbuf->size - ringbuf->used;
+    unlock();
+
+    return free_size;
+}
@@ -0,0 +1,91 @@
+#include <malloc.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "esp_heap_caps.h"
+#include "fake_heap.h"
+
+static fake_heap_stats_t heap_stats;
+static unsigned fail_caps = 0;
+static pthread_mutex_t heap_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void count(size_t size, uint32_t caps)
+{
+    pthread_mutex_lock(&heap_lock);
+    heap_stats.allocations++;
+    heap_stats.bytes += size;
+    if (caps & MALLOC_CAP_SPIRAM)
+    {
+        heap_stats.spiram_bytes += size;
+    }
+    pthread_mutex_unlock(&heap_lock);
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+    if (caps & fail_caps)
+    {
+        return NULL;
+    }
+
+    count(size, caps);
+
+    return malloc(size);
+}
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps)
+{
+    if (caps & fail_caps)
+    {
+        return NULL;
+    }
+
+    count(n * size, caps);
+
+    return calloc(n, size);
+}
+
+void *heap_caps_realloc(void *ptr, size_t size, uint32_t caps)
+{
+    if (caps & fail_caps)
+    {
+        return NULL;
+    }
+
+    // only the growth is new memory
+    const size_t old = ptr != NULL ? malloc_usable_size(ptr) : 0;
+    count(size > old ? size - old : 0, caps);
+
+    return realloc(ptr, size);
+}
+
+void heap_caps_free(void *ptr)
+{
+    free(ptr);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    (void)caps;
+
+    return 4 * 1024 * 1024;
+}
+
+void fake_heap_reset(void)
+{
+    pthread_mutex_lock(&heap_lock);
+    heap_stats = (fake_heap_stats_t){0};
+    pthread_mutex_unlock(&heap_lock);
+}
+
+void fake_heap_stats(fake_heap_stats_t *stats)
+{
+    pthread_mutex_lock(&heap_lock);
+    *stats = heap_stats;
+    pthread_mutex_unlock(&heap_lock);
+}
+
+void fake_heap_fail_caps(unsigned caps)
+{
+    fail_caps = caps;
+}
@@ -0,0 +1,540 @@
+#define _GNU_SOURCE // memmem()
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "sdkconfig.h"
+#include "esp_http_client.h"
+#include "fake_http.h"
+
+#define FAKE_HTTP_HEADERS (24)
+#define FAKE_HTTP_RECV_BUF (4096)
+
+typedef struct
+{
+    char *key;
+    char *value;
+} fake_header_t;
+
+struct esp_http_client
+{
+    char *host;
+    char *path; // with the query
+    char *user_agent;
+    esp_http_client_method_t method;
+    http_event_handle_cb event_handler;
+    void *user_data;
+
+    fake_header_t headers[FAKE_HTTP_HEADERS];
+    int header_count;
+    const char *post_data;
+    int post_len;
+
+    int fd;
+    int status;
+    long content_length; // -1 until the headers are in, or when the server did not say
+    long body_remaining;
+    bool chunked;
+
+    uint8_t recv_buf[FAKE_HTTP_RECV_BUF];
+    size_t recv_pos;
+    size_t recv_len;
+};
+
+static int server_port = 0;
+static fake_http_stats_t http_stats;
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void fake_http_set_server(int port)
+{
+    server_port = port;
+}
+
+void fake_http_stats(fake_http_stats_t *stats)
+{
+    pthread_mutex_lock(&stats_lock);
+    *stats = http_stats;
+    pthread_mutex_unlock(&stats_lock);
+}
+
+void fake_http_reset(void)
+{
+    pthread_mutex_lock(&stats_lock);
+    memset(&http_stats, 0, sizeof(http_stats));
+    pthread_mutex_unlock(&stats_lock);
+}
+
+static void count_bytes(size_t *counter, size_t n)
+{
+    pthread_mutex_lock(&stats_lock);
+    *counter += n;
+    pthread_mutex_unlock(&stats_lock);
+}
+
+static char *join_path(const char *path, const char *query)
+{
+    const char *p = path != NULL && path[0] != '\0' ? path : "/";
+    const size_t len = strlen(p) + (query != NULL ? strlen(query) + 1 : 0) + 1;
+    char *out = malloc(len);
+
+    snprintf(out, len, "%s%s%s", p, query != NULL && query[0] != '\0' ? "?" : "", query != NULL ? query : "");
+
+    return out;
+}
+
+// http://host[:port]/path?query, the port is ignored like the host
+static void parse_url(esp_http_client_handle_t client, const char *url)
+{
+    const char *host = strstr(url, "://");
+    host = host != NULL ? host + 3 : url;
+
+    const char *path = strchr(host, '/');
+    const size_t host_len = path != NULL ? (size_t)(path - host) : strlen(host);
+
+    free(client->host);
+    client->host = strndup(host, host_len);
+
+    char *colon = strchr(client->host, ':');
+    if (colon != NULL)
+    {
+        *colon = '\0';
+    }
+
+    free(client->path);
+    client->path = strdup(path != NULL ? path : "/");
+}
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config)
+{
+    esp_http_client_handle_t client = calloc(1, sizeof(*client));
+
+    if (config->url != NULL)
+    {
+        parse_url(client, config->url);
+    }
+    else
+    {
+        client->host = strdup(config->host != NULL ? config->host : "localhost");
+        client->path = join_path(config->path, config->query);
+    }
+
+    client->user_agent = strdup(config->user_agent != NULL ? config->user_agent : "ESP32 HTTP Client/1.0");
+    client->method = config->method;
+    client->event_handler = config->event_handler;
+    client->user_data = config->user_data;
+    client->fd = -1;
+    client->content_length = -1;
+
+    return client;
+}
+
+esp_err_t esp_http_client_set_url(esp_http_client_handle_t client, const char *url)
+{
+    parse_url(client, url);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_post_field(esp_http_client_handle_t client, const char *data, int len)
+{
+    client->post_data = data;
+    client->post_len = len;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value)
+{
+    int i = 0;
+    while (i < client->header_count && strcasecmp(client->headers[i].key, key) != 0)
+    {
+        i++;
+    }
+
+    if (i == FAKE_HTTP_HEADERS)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (i == client->header_count)
+    {
+        client->headers[i].key = strdup(key);
+        client->header_count++;
+    }
+    else
+    {
+        free(client->headers[i].value);
+    }
+
+    client->headers[i].value = strdup(value);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_delete_header(esp_http_client_handle_t client, const char *key)
+{
+    for (int i = 0; i < client->header_count; i++)
+    {
+        if (strcasecmp(client->headers[i].key, key) == 0)
+        {
+            free(client->headers[i].key);
+            free(client->headers[i].value);
+            client->headers[i] = client->headers[--client->header_count];
+            return ESP_OK;
+        }
+    }
+
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t esp_http_client_set_method(esp_http_client_handle_t client, esp_http_client_method_t method)
+{
+    client->method = method;
+    return ESP_OK;
+}
+
+static void send_event(esp_http_client_handle_t client, esp_http_client_event_id_t id, void *data, int len)
+{
+    if (client->event_handler == NULL)
+    {
+        return;
+    }
+
+    esp_http_client_event_t evt = {
+        .event_id = id,
+        .client = client,
+        .data = data,
+        .data_len = len,
+        .user_data = client->user_data,
+    };
+
+    client->event_handler(&evt);
+}
+
+static int send_all(int fd, const void *buf, size_t len)
+{
+    size_t sent = 0;
+
+    while (sent < len)
+    {
+        const ssize_t n = send(fd, (const uint8_t *)buf + sent, len - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return -1;
+        }
+        sent += n;
+    }
+
+    return sent;
+}
+
+esp_err_t esp_http_client_open(esp_http_client_handle_t client, int write_len)
+{
+    static const char *methods[] = {"GET", "POST", "PUT", "PATCH", "DELETE", "HEAD"};
+
+    client->fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (client->fd < 0)
+    {
+        return ESP_ERR_HTTP_CONNECT;
+    }
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(server_port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+
+    const int one = 1;
+    setsockopt(client->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    // lwip's send buffer, a write returns once its bytes are in it
+    const int send_buf = CONFIG_LWIP_TCP_SND_BUF_DEFAULT;
+    setsockopt(client->fd, SOL_SOCKET, SO_SNDBUF, &send_buf, sizeof(send_buf));
+
+    if (connect(client->fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        close(client->fd);
+        client->fd = -1;
+        return ESP_ERR_HTTP_CONNECT;
+    }
+
+    pthread_mutex_lock(&stats_lock);
+    http_stats.requests++;
+    pthread_mutex_unlock(&stats_lock);
+
+    send_event(client, HTTP_EVENT_ON_CONNECTED, NULL, 0);
+
+    // as the IDF client, the length given here replaces any Content-Length header set before
+    char length[16];
+    snprintf(length, sizeof(length), "%d", write_len > 0 ? write_len : 0);
+    esp_http_client_set_header(client, "Content-Length", length);
+
+    char request[4096];
+    int len = snprintf(request, sizeof(request), "%s %s HTTP/1.1\r\nHost: %s\r\nUser-Agent: %s\r\n",
+                       methods[client->method], client->path, client->host, client->user_agent);
+
+    for (int i = 0; i < client->header_count && len < (int)sizeof(request); i++)
+    {
+        len += snprintf(&request[len], sizeof(request) - len, "%s: %s\r\n", client->headers[i].key, client->headers[i].value);
+    }
+
+    len += snprintf(&request[len], sizeof(request) - len, "\r\n");
+
+    if (len >= (int)sizeof(request) || send_all(client->fd, request, len) < 0)
+    {
+        esp_http_client_close(client);
+        return ESP_ERR_HTTP_WRITE_DATA;
+    }
+
+    send_event(client, HTTP_EVENT_HEADER_SENT, NULL, 0);
+
+    client->status = 0;
+    client->content_length = -1;
+    client->recv_pos = 0;
+    client->recv_len = 0;
+
+    return ESP_OK;
+}
+
+int esp_http_client_write(esp_http_client_handle_t client, const char *buffer, int len)
+{
+    if (client->fd < 0 || send_all(client->fd, buffer, len) < 0)
+    {
+        return -1;
+    }
+
+    count_bytes(&http_stats.bytes_written, len);
+
+    return len;
+}
+
+// more bytes into recv_buf, false once the server closed or failed
+static bool fill(esp_http_client_handle_t client)
+{
+    if (client->recv_pos == client->recv_len)
+    {
+        client->recv_pos = 0;
+        client->recv_len = 0;
+    }
+
+    if (client->recv_len == sizeof(client->recv_buf))
+    {
+        return false;
+    }
+
+    ssize_t n;
+    do
+    {
+        n = recv(client->fd, &client->recv_buf[client->recv_len], sizeof(client->recv_buf) - client->recv_len, 0);
+    } while (n < 0 && errno == EINTR);
+
+    if (n <= 0)
+    {
+        return false;
+    }
+
+    client->recv_len += n;
+
+    return true;
+}
+
+int esp_http_client_fetch_headers(esp_http_client_handle_t client)
+{
+    if (client->fd < 0)
+    {
+        return -1;
+    }
+
+    // the status line and headers, up to the blank line
+    char *end = NULL;
+    while ((end = memmem(client->recv_buf, client->recv_len, "\r\n\r\n", 4)) == NULL)
+    {
+        if (!fill(client))
+        {
+            return -1;
+        }
+    }
+
+    *end = '\0';
+    client->recv_pos = (uint8_t *)end + 4 - client->recv_buf;
+
+    char *save = NULL;
+    char *line = strtok_r((char *)client->recv_buf, "\r\n", &save);
+    if (line == NULL || sscanf(line, "HTTP/%*s %d", &client->status) != 1)
+    {
+        return -1;
+    }
+
+    client->content_length = -1;
+    client->chunked = false;
+
+    while ((line = strtok_r(NULL, "\r\n", &save)) != NULL)
+    {
+        char *colon = strchr(line, ':');
+        if (colon == NULL)
+        {
+            continue;
+        }
+
+        *colon = '\0';
+        const char *value = colon + 1;
+        while (*value == ' ')
+        {
+            value++;
+        }
+
+        if (strcasecmp(line, "Content-Length") == 0)
+        {
+            client->content_length = atol(value);
+        }
+        else if (strcasecmp(line, "Transfer-Encoding") == 0 && strcasecmp(value, "chunked") == 0)
+        {
+            client->chunked = true;
+        }
+    }
+
+    // a chunked body is not decoded here, the stand-in server does not send one
+    client->body_remaining = client->content_length;
+
+    return client->content_length < 0 ? 0 : client->content_length;
+}
+
+bool esp_http_client_is_chunked_response(esp_http_client_handle_t client)
+{
+    return client->chunked;
+}
+
+// fills buffer unless the body ends first, as the IDF client does
+int esp_http_client_read(esp_http_client_handle_t client, char *buffer, int len)
+{
+    int done = 0;
+
+    while (done < len && client->body_remaining != 0)
+    {
+        if (client->recv_pos == client->recv_len && !fill(client))
+        {
+            // without a content length the body ends when the server closes
+            if (client->content_length >= 0)
+            {
+                return done > 0 ? done : -1;
+            }
+            break;
+        }
+
+        size_t n = client->recv_len - client->recv_pos;
+        n = n < (size_t)(len - done) ? n : (size_t)(len - done);
+        if (client->body_remaining > 0 && (long)n > client->body_remaining)
+        {
+            n = client->body_remaining;
+        }
+
+        memcpy(&buffer[done], &client->recv_buf[client->recv_pos], n);
+        client->recv_pos += n;
+        done += n;
+
+        if (client->body_remaining > 0)
+        {
+            client->body_remaining -= n;
+        }
+    }
+
+    count_bytes(&http_stats.bytes_read, done);
+
+    return done;
+}
+
+// esp_http_client_read() here already reads until len or the end of the body
+int esp_http_client_read_response(esp_http_client_handle_t client, char *buffer, int len)
+{
+    return esp_http_client_read(client, buffer, len);
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client)
+{
+    return client->status;
+}
+
+int esp_http_client_get_content_length(esp_http_client_handle_t client)
+{
+    return client->content_length;
+}
+
+esp_err_t esp_http_client_perform(esp_http_client_handle_t client)
+{
+    esp_err_t err = esp_http_client_open(client, client->post_len);
+    if (err != ESP_OK)
+    {
+        send_event(client, HTTP_EVENT_ERROR, NULL, 0);
+        return err;
+    }
+
+    if (client->post_len > 0 && esp_http_client_write(client, client->post_data, client->post_len) < 0)
+    {
+        esp_http_client_close(client);
+        return ESP_ERR_HTTP_WRITE_DATA;
+    }
+
+    if (esp_http_client_fetch_headers(client) < 0)
+    {
+        esp_http_client_close(client);
+        return ESP_ERR_HTTP_FETCH_HEADER;
+    }
+
+    char buf[1024];
+    int n;
+    while ((n = esp_http_client_read(client, buf, sizeof(buf))) > 0)
+    {
+        send_event(client, HTTP_EVENT_ON_DATA, buf, n);
+    }
+
+    send_event(client, HTTP_EVENT_ON_FINISH, NULL, 0);
+    esp_http_client_close(client);
+
+    return n < 0 ? ESP_FAIL : ESP_OK;
+}
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t client)
+{
+    if (client->fd >= 0)
+    {
+        close(client->fd);
+        client->fd = -1;
+        send_event(client, HTTP_EVENT_DISCONNECTED, NULL, 0);
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client)
+{
+    if (client == NULL)
+    {
+        return ESP_FAIL;
+    }
+
+    esp_http_client_close(client);
+
+    for (int i = 0; i < client->header_count; i++)
+    {
+        free(client->headers[i].key);
+        free(client->headers[i].value);
+    }
+
+    free(client->host);
+    free(client->path);
+    free(client->user_agent);
+    free(client);
+
+    return ESP_OK;
+}
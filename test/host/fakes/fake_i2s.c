@@ -0,0 +1,614 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/param.h>
+
+#include "driver/i2s.h"
+#include "esp_timer.h"
+#include "fake_i2s.h"
+
+// ten minutes at 16 kHz. reserved once, so recording never allocates while a test counts
+// the firmware's allocations, the pages are only touched as they are used
+#define FAKE_I2S_RECORD_MAX (16000 * 600)
+
+// the firmware uses one port, the model only has one
+typedef struct
+{
+    bool installed;
+    bool running;
+    uint32_t rate;
+    int count;
+    int len;
+    QueueHandle_t events;
+
+    int16_t **tx_bufs;
+    bool *tx_fresh;  // written since the dma last sent it
+    int *tx_free;    // indices handed back by the dma, the oldest first
+    int tx_free_len;
+    int tx_curr;     // buffer i2s_write() is filling, -1 for none
+    int tx_pos;      // samples written into it
+    int tx_dma;      // buffer the dma sends next
+
+    int16_t **rx_bufs;
+    int rx_head;
+    int rx_filled;
+    int rx_pos; // samples already read from the head buffer
+
+    int16_t *recording;
+    size_t recorded;
+    bool written; // i2s_write() was called since the start
+    bool sending; // a written buffer was sent since the start
+    fake_i2s_stats_t stats;
+
+    fake_i2s_rx_source_t rx_source;
+    void *rx_ctx;
+
+    pthread_t clock;
+    bool clock_started;
+
+    // load on the writer's core and late interrupts, see fake_i2s.h
+    int stall_every;
+    int stall_us;
+    int writes;
+    int next_delay_us;
+} fake_i2s_port_t;
+
+static fake_i2s_port_t port_state = {.tx_curr = -1};
+static pthread_mutex_t i2s_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t i2s_changed = PTHREAD_COND_INITIALIZER;
+
+static void record(const int16_t *samples, int n)
+{
+    fake_i2s_port_t *p = &port_state;
+
+    if (p->recorded + n > FAKE_I2S_RECORD_MAX)
+    {
+        return;
+    }
+
+    memcpy(&p->recording[p->recorded], samples, n * sizeof(int16_t));
+    p->recorded += n;
+
+    if (p->stats.first_sound_us == 0)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            if (samples[i] != 0)
+            {
+                p->stats.first_sound_us = esp_timer_get_time();
+                break;
+            }
+        }
+    }
+}
+
+// one buffer period of the dma, with i2s_lock held
+static void dma_tick(void)
+{
+    fake_i2s_port_t *p = &port_state;
+    const int sent = p->tx_dma;
+
+    record(p->tx_bufs[sent], p->len);
+    if (p->tx_fresh[sent])
+    {
+        p->sending = true;
+    }
+    else if (p->sending)
+    {
+        p->stats.stale_buffers++;
+    }
+    p->tx_fresh[sent] = false;
+    p->stats.buffers_sent++;
+
+    // the descriptor queue holds count - 1 buffers, when nobody takes them the oldest
+    // drops out and is sent again as it is
+    if (sent == p->tx_curr)
+    {
+        // sent while half written, i2s_write() continues into whatever comes next
+        p->tx_curr = -1;
+    }
+    if (p->tx_free_len == p->count - 1)
+    {
+        memmove(&p->tx_free[0], &p->tx_free[1], (p->tx_free_len - 1) * sizeof(int));
+        p->tx_free_len--;
+    }
+    p->tx_free[p->tx_free_len++] = sent;
+    p->tx_dma = (sent + 1) % p->count;
+
+    const i2s_event_t event = {.type = I2S_EVENT_TX_DONE, .size = p->len * sizeof(int16_t)};
+    if (p->events != NULL && xQueueSend(p->events, &event, 0) != pdTRUE)
+    {
+        // the driver drops the oldest event when the queue is full
+        i2s_event_t dropped;
+        xQueueReceive(p->events, &dropped, 0);
+        xQueueSend(p->events, &event, 0);
+    }
+
+    if (p->rx_filled == p->count)
+    {
+        p->rx_head = (p->rx_head + 1) % p->count;
+        p->rx_filled--;
+        p->rx_pos = 0;
+        p->stats.rx_overflows++;
+    }
+
+    int16_t *rx = p->rx_bufs[(p->rx_head + p->rx_filled) % p->count];
+    if (p->rx_source != NULL)
+    {
+        p->rx_source(p->rx_ctx, rx, p->len);
+    }
+    else
+    {
+        memset(rx, 0, p->len * sizeof(int16_t));
+    }
+    p->rx_filled++;
+
+    pthread_cond_broadcast(&i2s_changed);
+}
+
+static void add_ns(struct timespec *t, uint64_t ns)
+{
+    t->tv_sec += ns / 1000000000ULL;
+    t->tv_nsec += ns % 1000000000ULL;
+    if (t->tv_nsec >= 1000000000L)
+    {
+        t->tv_sec++;
+        t->tv_nsec -= 1000000000L;
+    }
+}
+
+// ticks on an absolute schedule so the period does not drift with scheduling delays
+static void *clock_thread(void *arg)
+{
+    (void)arg;
+
+    struct timespec next;
+    bool scheduled = false;
+
+    pthread_mutex_lock(&i2s_lock);
+
+    while (true)
+    {
+        if (!port_state.running)
+        {
+            scheduled = false;
+            pthread_cond_wait(&i2s_changed, &i2s_lock);
+            continue;
+        }
+
+        if (!scheduled)
+        {
+            clock_gettime(CLOCK_MONOTONIC, &next);
+            scheduled = true;
+        }
+
+        add_ns(&next, (uint64_t)port_state.len * 1000000000ULL / port_state.rate);
+
+        // a late buffer, the ones after it keep to the schedule
+        struct timespec due = next;
+        add_ns(&due, (uint64_t)port_state.next_delay_us * 1000);
+        port_state.next_delay_us = 0;
+
+        pthread_mutex_unlock(&i2s_lock);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, NULL) != 0)
+        {
+        }
+        pthread_mutex_lock(&i2s_lock);
+
+        if (port_state.running)
+        {
+            dma_tick();
+        }
+    }
+
+    return NULL;
+}
+
+esp_err_t i2s_driver_install(i2s_port_t port, const i2s_config_t *config, int queue_size, void *queue)
+{
+    fake_i2s_port_t *p = &port_state;
+
+    if (port != I2S_NUM_1 || config == NULL || config->dma_buf_count < 2 || config->dma_buf_len <= 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&i2s_lock);
+
+    if (p->installed)
+    {
+        pthread_mutex_unlock(&i2s_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    p->rate = config->sample_rate;
+    p->count = config->dma_buf_count;
+    p->len = config->dma_buf_len;
+    p->tx_bufs = calloc(p->count, sizeof(int16_t *));
+    p->rx_bufs = calloc(p->count, sizeof(int16_t *));
+    for (int i = 0; i < p->count; i++)
+    {
+        p->tx_bufs[i] = calloc(p->len, sizeof(int16_t));
+        p->rx_bufs[i] = calloc(p->len, sizeof(int16_t));
+    }
+    p->tx_fresh = calloc(p->count, sizeof(bool));
+    p->tx_free = calloc(p->count, sizeof(int));
+    p->tx_curr = -1;
+    if (p->recording == NULL)
+    {
+        p->recording = malloc(FAKE_I2S_RECORD_MAX * sizeof(int16_t));
+    }
+
+    if (queue != NULL)
+    {
+        p->events = xQueueCreate(queue_size, sizeof(i2s_event_t));
+        *(QueueHandle_t *)queue = p->events;
+    }
+
+    // the driver starts the port on install
+    p->running = true;
+    p->installed = true;
+
+    if (!p->clock_started)
+    {
+        pthread_create(&p->clock, NULL, clock_thread, NULL);
+        pthread_detach(p->clock);
+        p->clock_started = true;
+    }
+
+    pthread_cond_broadcast(&i2s_changed);
+    pthread_mutex_unlock(&i2s_lock);
+
+    return ESP_OK;
+}
+
+// the recording and the statistics outlive the driver
+esp_err_t i2s_driver_uninstall(i2s_port_t port)
+{
+    fake_i2s_port_t *p = &port_state;
+
+    if (port != I2S_NUM_1 || !p->installed)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    pthread_mutex_lock(&i2s_lock);
+
+    p->running = false;
+    p->installed = false;
+    for (int i = 0; i < p->count; i++)
+    {
+        free(p->tx_bufs[i]);
+        free(p->rx_bufs[i]);
+    }
+    free(p->tx_bufs);
+    free(p->rx_bufs);
+    free(p->tx_fresh);
+    free(p->tx_free);
+    p->tx_bufs = NULL;
+    p->rx_bufs = NULL;
+    p->tx_fresh = NULL;
+    p->tx_free = NULL;
+    p->tx_free_len = 0;
+    p->tx_curr = -1;
+    p->tx_pos = 0;
+    p->tx_dma = 0;
+    p->rx_head = 0;
+    p->rx_filled = 0;
+    p->rx_pos = 0;
+
+    if (p->events != NULL)
+    {
+        vQueueDelete(p->events);
+        p->events = NULL;
+    }
+
+    pthread_cond_broadcast(&i2s_changed);
+    pthread_mutex_unlock(&i2s_lock);
+
+    return ESP_OK;
+}
+
+esp_err_t i2s_set_pin(i2s_port_t port, const i2s_pin_config_t *pins)
+{
+    return port == I2S_NUM_1 && pins != NULL ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t i2s_set_sample_rates(i2s_port_t port, uint32_t rate)
+{
+    if (port != I2S_NUM_1 || rate == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&i2s_lock);
+    port_state.rate = rate;
+    pthread_mutex_unlock(&i2s_lock);
+
+    return ESP_OK;
+}
+
+esp_err_t i2s_set_clk(i2s_port_t port, uint32_t rate, i2s_bits_per_sample_t bits, i2s_channel_t channels)
+{
+    if (bits != I2S_BITS_PER_SAMPLE_16BIT || channels != I2S_CHANNEL_MONO)
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    return i2s_set_sample_rates(port, rate);
+}
+
+esp_err_t i2s_start(i2s_port_t port)
+{
+    fake_i2s_port_t *p = &port_state;
+
+    if (port != I2S_NUM_1 || !p->installed)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    pthread_mutex_lock(&i2s_lock);
+
+    // the dma restarts from the first descriptor. as in the driver the buffers already
+    // handed back stay queued for i2s_write(), whatever order they are sent in now
+    p->running = true;
+    p->tx_dma = 0;
+    p->rx_head = 0;
+    p->rx_filled = 0;
+    p->rx_pos = 0;
+    p->written = false;
+    p->sending = false;
+    p->stats.starts++;
+
+    pthread_cond_broadcast(&i2s_changed);
+    pthread_mutex_unlock(&i2s_lock);
+
+    return ESP_OK;
+}
+
+esp_err_t i2s_stop(i2s_port_t port)
+{
+    if (port != I2S_NUM_1 || !port_state.installed)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    pthread_mutex_lock(&i2s_lock);
+    port_state.running = false;
+    port_state.stats.stops++;
+    pthread_cond_broadcast(&i2s_changed);
+    pthread_mutex_unlock(&i2s_lock);
+
+    return ESP_OK;
+}
+
+esp_err_t i2s_zero_dma_buffer(i2s_port_t port)
+{
+    fake_i2s_port_t *p = &port_state;
+
+    if (port != I2S_NUM_1 || !p->installed)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    pthread_mutex_lock(&i2s_lock);
+    for (int i = 0; i < p->count; i++)
+    {
+        memset(p->tx_bufs[i], 0, p->len * sizeof(int16_t));
+    }
+    pthread_mutex_unlock(&i2s_lock);
+
+    return ESP_OK;
+}
+
+// with i2s_lock held, false once the deadline has passed
+static bool wait_changed(TickType_t ticks, const struct timespec *deadline)
+{
+    if (ticks == 0)
+    {
+        return false;
+    }
+
+    if (ticks == portMAX_DELAY)
+    {
+        pthread_cond_wait(&i2s_changed, &i2s_lock);
+        return true;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    if (now.tv_sec > deadline->tv_sec || (now.tv_sec == deadline->tv_sec && now.tv_nsec >= deadline->tv_nsec))
+    {
+        return false;
+    }
+
+    pthread_cond_timedwait(&i2s_changed, &i2s_lock, deadline);
+    return true;
+}
+
+static struct timespec deadline_after(TickType_t ticks)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_REALTIME, &t);
+    if (ticks != portMAX_DELAY)
+    {
+        add_ns(&t, (uint64_t)ticks * portTICK_PERIOD_MS * 1000000ULL);
+    }
+
+    return t;
+}
+
+esp_err_t i2s_write(i2s_port_t port, const void *src, size_t size, size_t *bytes_written, TickType_t ticks)
+{
+    fake_i2s_port_t *p = &port_state;
+    const int16_t *samples = src;
+    const size_t total = size / sizeof(int16_t);
+    const struct timespec deadline = deadline_after(ticks);
+    size_t done = 0;
+
+    if (port != I2S_NUM_1 || !p->installed)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    pthread_mutex_lock(&i2s_lock);
+
+    const bool stall = p->stall_every > 0 && ++p->writes % p->stall_every == 0;
+    if (stall)
+    {
+        const int stall_us = p->stall_us;
+
+        pthread_mutex_unlock(&i2s_lock);
+        const struct timespec t = {.tv_sec = stall_us / 1000000, .tv_nsec = (stall_us % 1000000) * 1000L};
+        nanosleep(&t, NULL);
+        pthread_mutex_lock(&i2s_lock);
+    }
+
+    p->written = true;
+    if (p->stats.first_write_us == 0)
+    {
+        p->stats.first_write_us = esp_timer_get_time();
+    }
+
+    while (done < total)
+    {
+        if (p->tx_curr < 0 || p->tx_pos == p->len)
+        {
+            if (p->tx_free_len == 0)
+            {
+                if (!wait_changed(ticks, &deadline))
+                {
+                    break;
+                }
+                continue;
+            }
+
+            p->tx_curr = p->tx_free[0];
+            memmove(&p->tx_free[0], &p->tx_free[1], (p->tx_free_len - 1) * sizeof(int));
+            p->tx_free_len--;
+            p->tx_pos = 0;
+        }
+
+        const size_t n = MIN(total - done, (size_t)(p->len - p->tx_pos));
+        memcpy(&p->tx_bufs[p->tx_curr][p->tx_pos], &samples[done], n * sizeof(int16_t));
+        p->tx_pos += n;
+        done += n;
+
+        if (p->tx_pos == p->len)
+        {
+            p->tx_fresh[p->tx_curr] = true;
+        }
+    }
+
+    pthread_mutex_unlock(&i2s_lock);
+
+    *bytes_written = done * sizeof(int16_t);
+
+    return ESP_OK;
+}
+
+// like the driver, a timeout returns ESP_OK with what was read so far
+esp_err_t i2s_read(i2s_port_t port, void *dest, size_t size, size_t *bytes_read, TickType_t ticks)
+{
+    fake_i2s_port_t *p = &port_state;
+    int16_t *samples = dest;
+    const size_t total = size / sizeof(int16_t);
+    const struct timespec deadline = deadline_after(ticks);
+    size_t done = 0;
+
+    if (port != I2S_NUM_1 || !p->installed)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    pthread_mutex_lock(&i2s_lock);
+
+    while (done < total)
+    {
+        if (p->rx_filled == 0)
+        {
+            if (!wait_changed(ticks, &deadline))
+            {
+                break;
+            }
+            continue;
+        }
+
+        const size_t n = MIN(total - done, (size_t)(p->len - p->rx_pos));
+        memcpy(&samples[done], &p->rx_bufs[p->rx_head][p->rx_pos], n * sizeof(int16_t));
+        p->rx_pos += n;
+        done += n;
+
+        if (p->rx_pos == p->len)
+        {
+            p->rx_head = (p->rx_head + 1) % p->count;
+            p->rx_filled--;
+            p->rx_pos = 0;
+        }
+    }
+
+    pthread_mutex_unlock(&i2s_lock);
+
+    *bytes_read = done * sizeof(int16_t);
+
+    return ESP_OK;
+}
+
+void fake_i2s_reset(void)
+{
+    pthread_mutex_lock(&i2s_lock);
+    port_state.recorded = 0;
+    memset(&port_state.stats, 0, sizeof(port_state.stats));
+    pthread_mutex_unlock(&i2s_lock);
+}
+
+const int16_t *fake_i2s_tx_samples(size_t *count)
+{
+    pthread_mutex_lock(&i2s_lock);
+    const int16_t *samples = port_state.recording;
+    *count = port_state.recorded;
+    pthread_mutex_unlock(&i2s_lock);
+
+    return samples;
+}
+
+void fake_i2s_stats(fake_i2s_stats_t *stats)
+{
+    pthread_mutex_lock(&i2s_lock);
+    *stats = port_state.stats;
+    pthread_mutex_unlock(&i2s_lock);
+}
+
+bool fake_i2s_running(void)
+{
+    pthread_mutex_lock(&i2s_lock);
+    const bool running = port_state.running;
+    pthread_mutex_unlock(&i2s_lock);
+
+    return running;
+}
+
+void fake_i2s_set_rx_source(fake_i2s_rx_source_t source, void *ctx)
+{
+    pthread_mutex_lock(&i2s_lock);
+    port_state.rx_source = source;
+    port_state.rx_ctx = ctx;
+    pthread_mutex_unlock(&i2s_lock);
+}
+
+void fake_i2s_set_write_stall(int every, int stall_us)
+{
+    pthread_mutex_lock(&i2s_lock);
+    port_state.stall_every = every;
+    port_state.stall_us = stall_us;
+    port_state.writes = 0;
+    pthread_mutex_unlock(&i2s_lock);
+}
+
+void fake_i2s_delay_next_buffer(int us)
+{
+    pthread_mutex_lock(&i2s_lock);
+    port_state.next_delay_us = us;
+    pthread_mutex_unlock(&i2s_lock);
+}
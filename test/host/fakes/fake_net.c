@@ -0,0 +1,160 @@
+// the network side of the IDF around the http client: tls and certificate symbols that are
+// never used over plain HTTP, nvs blobs kept in memory, and the camera frame buffers the
+// upload gives back
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_tls.h"
+#include "esp_crt_bundle.h"
+#include "nvs_flash.h"
+#include "esp_timer.h"
+#include "fake_camera.h"
+
+// the pem files component.mk embeds, as empty strings
+__asm__(".section .rodata\n"
+        ".global _binary_howsmyssl_com_root_cert_pem_start\n"
+        ".global _binary_howsmyssl_com_root_cert_pem_end\n"
+        ".global _binary_postman_root_cert_pem_start\n"
+        ".global _binary_postman_root_cert_pem_end\n"
+        ".global _binary_ca_cert_pem_start\n"
+        "_binary_howsmyssl_com_root_cert_pem_start:\n"
+        "_binary_howsmyssl_com_root_cert_pem_end:\n"
+        "_binary_postman_root_cert_pem_start:\n"
+        "_binary_postman_root_cert_pem_end:\n"
+        "_binary_ca_cert_pem_start:\n"
+        ".byte 0\n"
+        ".text\n");
+
+esp_err_t esp_tls_get_and_clear_last_error(esp_tls_error_handle_t h, int *esp_tls_code, int *esp_tls_flags)
+{
+    if (esp_tls_code != NULL)
+    {
+        *esp_tls_code = 0;
+    }
+    if (esp_tls_flags != NULL)
+    {
+        *esp_tls_flags = 0;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t esp_crt_bundle_attach(void *conf)
+{
+    return ESP_OK;
+}
+
+#define FAKE_NVS_BLOBS (8)
+
+typedef struct
+{
+    char key[16];
+    void *value;
+    size_t len;
+} fake_blob_t;
+
+static fake_blob_t blobs[FAKE_NVS_BLOBS];
+
+esp_err_t nvs_flash_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    *out_handle = 1;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    int i = 0;
+    while (i < FAKE_NVS_BLOBS && blobs[i].value != NULL && strcmp(blobs[i].key, key) != 0)
+    {
+        i++;
+    }
+
+    if (i == FAKE_NVS_BLOBS || strlen(key) >= sizeof(blobs[i].key))
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    free(blobs[i].value);
+    strcpy(blobs[i].key, key);
+    blobs[i].value = malloc(length > 0 ? length : 1);
+    memcpy(blobs[i].value, value, length);
+    blobs[i].len = length;
+
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    for (int i = 0; i < FAKE_NVS_BLOBS && blobs[i].value != NULL; i++)
+    {
+        if (strcmp(blobs[i].key, key) == 0)
+        {
+            if (out_value != NULL)
+            {
+                if (*length < blobs[i].len)
+                {
+                    return ESP_ERR_INVALID_SIZE;
+                }
+                memcpy(out_value, blobs[i].value, blobs[i].len);
+            }
+            *length = blobs[i].len;
+            return ESP_OK;
+        }
+    }
+
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+}
+
+static camera_fb_t *next_frame = NULL;
+static int returned = 0;
+static int64_t returned_us = 0;
+
+void fake_camera_set_frame(camera_fb_t *fb)
+{
+    next_frame = fb;
+}
+
+int fake_camera_returned(void)
+{
+    return returned;
+}
+
+int64_t fake_camera_returned_us(void)
+{
+    return returned_us;
+}
+
+void fake_camera_reset(void)
+{
+    next_frame = NULL;
+    returned = 0;
+    returned_us = 0;
+}
+
+camera_fb_t *esp_camera_fb_get(void)
+{
+    camera_fb_t *fb = next_frame;
+    next_frame = NULL;
+    return fb;
+}
+
+void esp_camera_fb_return(camera_fb_t *fb)
+{
+    returned++;
+    returned_us = esp_timer_get_time();
+}
@@ -0,0 +1,187 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_partition.h"
+#include "esp_spi_flash.h"
+#include "fake_partition.h"
+
+#define FAKE_PARTITIONS (4)
+#define FAKE_FLASH_SECTOR (4096)
+
+typedef struct
+{
+    esp_partition_t partition;
+    uint8_t *data;
+    int mapped; // outstanding esp_partition_mmap() handles
+} fake_partition_entry_t;
+
+static fake_partition_entry_t partitions[FAKE_PARTITIONS];
+
+static fake_partition_entry_t *find(const char *label)
+{
+    for (int i = 0; i < FAKE_PARTITIONS; i++)
+    {
+        if (partitions[i].data != NULL && strcmp(partitions[i].partition.label, label) == 0)
+        {
+            return &partitions[i];
+        }
+    }
+
+    return NULL;
+}
+
+esp_err_t fake_partition_register(const char *label, const void *data, size_t len)
+{
+    fake_partition_unregister(label);
+
+    fake_partition_entry_t *entry = NULL;
+    for (int i = 0; entry == NULL && i < FAKE_PARTITIONS; i++)
+    {
+        if (partitions[i].data == NULL)
+        {
+            entry = &partitions[i];
+        }
+    }
+
+    if (entry == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    const size_t size = (len + FAKE_FLASH_SECTOR - 1) / FAKE_FLASH_SECTOR * FAKE_FLASH_SECTOR;
+    entry->data = malloc(size ? size : FAKE_FLASH_SECTOR);
+    if (entry->data == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    memset(entry->data, 0xff, size ? size : FAKE_FLASH_SECTOR);
+    memcpy(entry->data, data, len);
+
+    memset(&entry->partition, 0, sizeof(entry->partition));
+    entry->partition.type = ESP_PARTITION_TYPE_DATA;
+    entry->partition.subtype = 0x82;
+    entry->partition.address = 0x310000 + (entry - partitions) * 0x100000;
+    entry->partition.size = size ? size : FAKE_FLASH_SECTOR;
+    strncpy(entry->partition.label, label, sizeof(entry->partition.label) - 1);
+    entry->mapped = 0;
+
+    return ESP_OK;
+}
+
+esp_err_t fake_partition_register_file(const char *label, const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    fseek(f, 0, SEEK_END);
+    const long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t *data = malloc(len > 0 ? len : 1);
+    const size_t n = data != NULL ? fread(data, 1, len, f) : 0;
+    fclose(f);
+
+    esp_err_t err = n == (size_t)len ? fake_partition_register(label, data, len) : ESP_FAIL;
+    free(data);
+
+    return err;
+}
+
+void fake_partition_unregister(const char *label)
+{
+    fake_partition_entry_t *entry = find(label);
+    if (entry != NULL)
+    {
+        free(entry->data);
+        entry->data = NULL;
+    }
+}
+
+int fake_partition_mapped(const char *label)
+{
+    fake_partition_entry_t *entry = find(label);
+
+    return entry != NULL ? entry->mapped : 0;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label)
+{
+    fake_partition_entry_t *entry = label != NULL ? find(label) : NULL;
+
+    if (entry == NULL || entry->partition.type != type ||
+        (subtype != ESP_PARTITION_SUBTYPE_ANY && entry->partition.subtype != subtype))
+    {
+        return NULL;
+    }
+
+    return &entry->partition;
+}
+
+static fake_partition_entry_t *entry_of(const esp_partition_t *partition)
+{
+    for (int i = 0; i < FAKE_PARTITIONS; i++)
+    {
+        if (&partitions[i].partition == partition && partitions[i].data != NULL)
+        {
+            return &partitions[i];
+        }
+    }
+
+    return NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
+{
+    fake_partition_entry_t *entry = entry_of(partition);
+
+    if (entry == NULL || dst == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (src_offset > partition->size || size > partition->size - src_offset)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    memcpy(dst, &entry->data[src_offset], size);
+
+    return ESP_OK;
+}
+
+// the mapping is the backing copy itself, handles only count what is still mapped
+esp_err_t esp_partition_mmap(const esp_partition_t *partition, size_t offset, size_t size, spi_flash_mmap_memory_t memory,
+                             const void **out_ptr, spi_flash_mmap_handle_t *out_handle)
+{
+    fake_partition_entry_t *entry = entry_of(partition);
+
+    (void)memory;
+
+    if (entry == NULL || out_ptr == NULL || out_handle == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (offset > partition->size || size > partition->size - offset)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    *out_ptr = &entry->data[offset];
+    *out_handle = (spi_flash_mmap_handle_t)(entry - partitions) + 1;
+    entry->mapped++;
+
+    return ESP_OK;
+}
+
+void spi_flash_munmap(spi_flash_mmap_handle_t handle)
+{
+    if (handle >= 1 && handle <= FAKE_PARTITIONS && partitions[handle - 1].mapped > 0)
+    {
+        partitions[handle - 1].mapped--;
+    }
+}
@@ -0,0 +1,76 @@
+#include <stdatomic.h>
+
+#include "driver/touch_pad.h"
+#include "driver/gpio.h"
+#include "fake_touch.h"
+
+// an untouched pad reads 1000
+static _Atomic uint16_t pad_values[TOUCH_PAD_MAX] = {
+    1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000,
+};
+static _Atomic uint32_t gpio_levels[40];
+
+void fake_touch_pad_set(touch_pad_t pad, uint16_t value)
+{
+    pad_values[pad] = value;
+}
+
+esp_err_t touch_pad_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t touch_pad_set_voltage(touch_high_volt_t high, touch_low_volt_t low, touch_volt_atten_t atten)
+{
+    (void)high;
+    (void)low;
+    (void)atten;
+
+    return ESP_OK;
+}
+
+esp_err_t touch_pad_config(touch_pad_t pad, uint16_t threshold)
+{
+    (void)threshold;
+
+    return pad < TOUCH_PAD_MAX ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t touch_pad_filter_start(uint32_t period_ms)
+{
+    return period_ms > 0 ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t touch_pad_read_filtered(touch_pad_t pad, uint16_t *value)
+{
+    if (pad >= TOUCH_PAD_MAX || value == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *value = pad_values[pad];
+
+    return ESP_OK;
+}
+
+esp_err_t touch_pad_intr_enable(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level)
+{
+    if (gpio < 0 || gpio >= 40)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    gpio_levels[gpio] = level;
+
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio)
+{
+    return gpio >= 0 && gpio < 40 ? (int)gpio_levels[gpio] : 0;
+}
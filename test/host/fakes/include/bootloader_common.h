@@ -0,0 +1,21 @@
+#ifndef FAKE_BOOTLOADER_COMMON_H__
+#define FAKE_BOOTLOADER_COMMON_H__
+
+#include <stdint.h>
+
+// only the app description esp_ota.h names
+typedef struct
+{
+    uint32_t magic_word;
+    uint32_t secure_version;
+    uint32_t reserv1[2];
+    char version[32];
+    char project_name[32];
+    char time[16];
+    char date[16];
+    char idf_ver[32];
+    uint8_t app_elf_sha256[32];
+    uint32_t reserv2[20];
+} esp_app_desc_t;
+
+#endif //FAKE_BOOTLOADER_COMMON_H__
@@ -0,0 +1,12 @@
+#ifndef FAKE_DRIVER_GPIO_H__
+#define FAKE_DRIVER_GPIO_H__
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef int gpio_num_t;
+
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level);
+int gpio_get_level(gpio_num_t gpio);
+
+#endif //FAKE_DRIVER_GPIO_H__
@@ -0,0 +1,55 @@
+#ifndef FAKE_DRIVER_TOUCH_PAD_H__
+#define FAKE_DRIVER_TOUCH_PAD_H__
+
+// pad readings come from fake_touch_pad_set(), see fake_touch.h
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef enum
+{
+    TOUCH_PAD_NUM0,
+    TOUCH_PAD_NUM1,
+    TOUCH_PAD_NUM2,
+    TOUCH_PAD_NUM3,
+    TOUCH_PAD_NUM4,
+    TOUCH_PAD_NUM5,
+    TOUCH_PAD_NUM6,
+    TOUCH_PAD_NUM7,
+    TOUCH_PAD_NUM8,
+    TOUCH_PAD_NUM9,
+    TOUCH_PAD_MAX,
+} touch_pad_t;
+
+typedef enum
+{
+    TOUCH_HVOLT_2V4,
+    TOUCH_HVOLT_2V5,
+    TOUCH_HVOLT_2V6,
+    TOUCH_HVOLT_2V7,
+} touch_high_volt_t;
+
+typedef enum
+{
+    TOUCH_LVOLT_0V5,
+    TOUCH_LVOLT_0V6,
+    TOUCH_LVOLT_0V7,
+    TOUCH_LVOLT_0V8,
+} touch_low_volt_t;
+
+typedef enum
+{
+    TOUCH_HVOLT_ATTEN_1V5,
+    TOUCH_HVOLT_ATTEN_1V,
+    TOUCH_HVOLT_ATTEN_0V5,
+    TOUCH_HVOLT_ATTEN_0V,
+} touch_volt_atten_t;
+
+esp_err_t touch_pad_init(void);
+esp_err_t touch_pad_set_voltage(touch_high_volt_t high, touch_low_volt_t low, touch_volt_atten_t atten);
+esp_err_t touch_pad_config(touch_pad_t pad, uint16_t threshold);
+esp_err_t touch_pad_filter_start(uint32_t period_ms);
+esp_err_t touch_pad_read_filtered(touch_pad_t pad, uint16_t *value);
+esp_err_t touch_pad_intr_enable(void);
+
+#endif //FAKE_DRIVER_TOUCH_PAD_H__
@@ -0,0 +1,9 @@
+#ifndef FAKE_ESP_ATTR_H__
+#define FAKE_ESP_ATTR_H__
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define EXT_RAM_ATTR
+#define RTC_DATA_ATTR
+
+#endif //FAKE_ESP_ATTR_H__
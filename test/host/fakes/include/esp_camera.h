@@ -0,0 +1,33 @@
+#ifndef FAKE_ESP_CAMERA_H__
+#define FAKE_ESP_CAMERA_H__
+
+// the frame buffer type of esp32-camera, without a sensor. a test hands its own frames to
+// the firmware and fake_net.c counts the ones given back
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/time.h>
+#include "esp_err.h"
+
+typedef enum
+{
+    PIXFORMAT_RGB565,
+    PIXFORMAT_YUV422,
+    PIXFORMAT_GRAYSCALE,
+    PIXFORMAT_JPEG,
+} pixformat_t;
+
+typedef struct
+{
+    uint8_t *buf;
+    size_t len;
+    size_t width;
+    size_t height;
+    pixformat_t format;
+    struct timeval timestamp;
+} camera_fb_t;
+
+camera_fb_t *esp_camera_fb_get(void);
+void esp_camera_fb_return(camera_fb_t *fb);
+
+#endif //FAKE_ESP_CAMERA_H__
@@ -0,0 +1,9 @@
+#ifndef FAKE_ESP_CRT_BUNDLE_H__
+#define FAKE_ESP_CRT_BUNDLE_H__
+
+#include "esp_err.h"
+
+// the fake http client speaks plain HTTP, the bundle is never consulted
+esp_err_t esp_crt_bundle_attach(void *conf);
+
+#endif //FAKE_ESP_CRT_BUNDLE_H__
@@ -0,0 +1,8 @@
+#ifndef FAKE_ESP_EVENT_H__
+#define FAKE_ESP_EVENT_H__
+
+#include "esp_err.h"
+
+typedef const char *esp_event_base_t;
+
+#endif //FAKE_ESP_EVENT_H__
@@ -0,0 +1,31 @@
+#ifndef FAKE_ESP_LOG_H__
+#define FAKE_ESP_LOG_H__
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// printed to stderr at or below the level set for the tag, ESP_LOG_WARN by default.
+// TEST_LOG_LEVEL=0..5 in the environment changes the default
+typedef enum
+{
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level);
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...) __attribute__((format(printf, 3, 4)));
+
+#define ESP_LOGE(tag, format, ...) esp_log_write(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) esp_log_write(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) esp_log_write(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) esp_log_write(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) esp_log_write(ESP_LOG_VERBOSE, tag, format, ##__VA_ARGS__)
+
+#define ESP_LOG_BUFFER_HEX(tag, buffer, buff_len) ((void)(tag), (void)(buffer), (void)(buff_len))
+#define ESP_LOG_BUFFER_HEXDUMP(tag, buffer, buff_len, level) ((void)(tag), (void)(buffer), (void)(buff_len))
+
+#endif //FAKE_ESP_LOG_H__
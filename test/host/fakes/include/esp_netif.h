@@ -0,0 +1,6 @@
+#ifndef FAKE_ESP_NETIF_H__
+#define FAKE_ESP_NETIF_H__
+
+#include "esp_err.h"
+
+#endif //FAKE_ESP_NETIF_H__
@@ -0,0 +1,16 @@
+#ifndef FAKE_ESP_SPI_FLASH_H__
+#define FAKE_ESP_SPI_FLASH_H__
+
+#include <stdint.h>
+
+typedef uint32_t spi_flash_mmap_handle_t;
+
+typedef enum
+{
+    SPI_FLASH_MMAP_DATA,
+    SPI_FLASH_MMAP_INST,
+} spi_flash_mmap_memory_t;
+
+void spi_flash_munmap(spi_flash_mmap_handle_t handle);
+
+#endif //FAKE_ESP_SPI_FLASH_H__
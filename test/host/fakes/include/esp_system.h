@@ -0,0 +1,8 @@
+#ifndef FAKE_ESP_SYSTEM_H__
+#define FAKE_ESP_SYSTEM_H__
+
+#include "esp_err.h"
+
+void esp_restart(void) __attribute__((noreturn));
+
+#endif //FAKE_ESP_SYSTEM_H__
@@ -0,0 +1,9 @@
+#ifndef FAKE_ESP_TIMER_H__
+#define FAKE_ESP_TIMER_H__
+
+#include <stdint.h>
+
+// microseconds from CLOCK_MONOTONIC, since the first call
+int64_t esp_timer_get_time(void);
+
+#endif //FAKE_ESP_TIMER_H__
@@ -0,0 +1,11 @@
+#ifndef FAKE_ESP_TLS_H__
+#define FAKE_ESP_TLS_H__
+
+#include "esp_err.h"
+
+typedef struct esp_tls_last_error *esp_tls_error_handle_t;
+
+// always ESP_OK, there is no tls under the fake http client
+esp_err_t esp_tls_get_and_clear_last_error(esp_tls_error_handle_t h, int *esp_tls_code, int *esp_tls_flags);
+
+#endif //FAKE_ESP_TLS_H__
@@ -0,0 +1,14 @@
+#ifndef FAKE_CAMERA_H__
+#define FAKE_CAMERA_H__
+
+#include "esp_camera.h"
+
+// the frame esp_camera_fb_get() hands out next, NULL for none
+void fake_camera_set_frame(camera_fb_t *fb);
+// frames given back through esp_camera_fb_return() since the last reset
+int fake_camera_returned(void);
+// esp_timer_get_time() at the last esp_camera_fb_return(), 0 for none since the reset
+int64_t fake_camera_returned_us(void);
+void fake_camera_reset(void);
+
+#endif //FAKE_CAMERA_H__
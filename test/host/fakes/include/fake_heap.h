@@ -0,0 +1,20 @@
+#ifndef FAKE_HEAP_H__
+#define FAKE_HEAP_H__
+
+#include <stddef.h>
+
+// bytes requested from heap_caps_*() since the reset, frees are not subtracted
+typedef struct
+{
+    size_t allocations;
+    size_t bytes;
+    size_t spiram_bytes;
+} fake_heap_stats_t;
+
+void fake_heap_reset(void);
+void fake_heap_stats(fake_heap_stats_t *stats);
+
+// heap_caps_malloc() fails for requests with these caps while set, 0 for none
+void fake_heap_fail_caps(unsigned caps);
+
+#endif //FAKE_HEAP_H__
@@ -0,0 +1,20 @@
+#ifndef FAKE_HTTP_H__
+#define FAKE_HTTP_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+// every esp_http_client request connects to 127.0.0.1:port, whatever host or url it names
+void fake_http_set_server(int port);
+
+typedef struct
+{
+    uint32_t requests;
+    size_t bytes_written; // request bodies, through esp_http_client_write() and post fields
+    size_t bytes_read;    // response bodies
+} fake_http_stats_t;
+
+void fake_http_stats(fake_http_stats_t *stats);
+void fake_http_reset(void);
+
+#endif //FAKE_HTTP_H__
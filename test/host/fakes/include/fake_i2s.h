@@ -0,0 +1,45 @@
+#ifndef FAKE_I2S_H__
+#define FAKE_I2S_H__
+
+// the i2s dma model behind driver/i2s.h. a clock thread plays one dma buffer per buffer
+// period while the port is started. as in the IDF 4.3 driver a buffer is handed back to
+// i2s_write() once it has been sent, a TX_DONE event is queued for it, and a buffer
+// nobody refilled in time is sent again. every sample sent is recorded, so a test hears
+// exactly what the speaker would, stale replays included
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// fills an rx dma buffer, called from the clock thread
+typedef void (*fake_i2s_rx_source_t)(void *ctx, int16_t *buf, int samples);
+
+typedef struct
+{
+    uint32_t buffers_sent;
+    uint32_t stale_buffers; // sent again without being refilled once the audio had begun
+    uint32_t starts;
+    uint32_t stops;
+    uint32_t rx_overflows;  // rx buffers dropped because nobody was reading
+    int64_t first_write_us; // esp_timer time of the first i2s_write() since the reset
+    int64_t first_sound_us; // the first non-zero sample left the dma
+} fake_i2s_stats_t;
+
+// forgets the recording and the statistics
+void fake_i2s_reset(void);
+
+// the samples sent since the reset, the first ten minutes of them
+const int16_t *fake_i2s_tx_samples(size_t *count);
+void fake_i2s_stats(fake_i2s_stats_t *stats);
+bool fake_i2s_running(void);
+
+void fake_i2s_set_rx_source(fake_i2s_rx_source_t source, void *ctx);
+
+// load on the writer's core: every every'th i2s_write() is held back stall_us before it
+// writes anything, 0 for none
+void fake_i2s_set_write_stall(int every, int stall_us);
+
+// the next buffer is sent us late, as a late interrupt, the following ones on time
+void fake_i2s_delay_next_buffer(int us);
+
+#endif //FAKE_I2S_H__
@@ -0,0 +1,16 @@
+#ifndef FAKE_PARTITION_H__
+#define FAKE_PARTITION_H__
+
+#include <stddef.h>
+#include "esp_err.h"
+
+// registers a data partition holding a copy of the bytes, replacing one of the same label.
+// its size is rounded up to the flash sector and the tail is erased flash (0xff)
+esp_err_t fake_partition_register(const char *label, const void *data, size_t len);
+esp_err_t fake_partition_register_file(const char *label, const char *path);
+void fake_partition_unregister(const char *label);
+
+// esp_partition_mmap() handles on the partition not yet given back with spi_flash_munmap()
+int fake_partition_mapped(const char *label);
+
+#endif //FAKE_PARTITION_H__
@@ -0,0 +1,11 @@
+#ifndef FAKE_TOUCH_H__
+#define FAKE_TOUCH_H__
+
+#include <stdint.h>
+#include "driver/touch_pad.h"
+
+// the filtered value touch_pad_read_filtered() returns for the pad, 1000 until set.
+// a touch lowers the value
+void fake_touch_pad_set(touch_pad_t pad, uint16_t value);
+
+#endif //FAKE_TOUCH_H__
@@ -0,0 +1,85 @@
+#ifndef FAKE_FREERTOS_H__
+#define FAKE_FREERTOS_H__
+
+// FreeRTOS on pthreads for the host build. tasks are threads, priorities and cores are
+// ignored, ticks are CONFIG_FREERTOS_HZ as on the target
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdTRUE (1)
+#define pdFALSE (0)
+#define pdPASS (pdTRUE)
+#define pdFAIL (pdFALSE)
+#define errQUEUE_FULL (0)
+#define errQUEUE_EMPTY (0)
+
+#define configTICK_RATE_HZ (CONFIG_FREERTOS_HZ)
+#define portTICK_PERIOD_MS ((TickType_t)1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(ms) ((TickType_t)((uint64_t)(ms) * configTICK_RATE_HZ / 1000))
+#define configMINIMAL_STACK_SIZE (768)
+#define tskNO_AFFINITY (0x7FFFFFFF)
+
+#define BIT0 (1u << 0)
+#define BIT1 (1u << 1)
+#define BIT2 (1u << 2)
+#define BIT3 (1u << 3)
+#define BIT4 (1u << 4)
+#define BIT5 (1u << 5)
+#define BIT6 (1u << 6)
+#define BIT7 (1u << 7)
+#define BIT8 (1u << 8)
+#define BIT9 (1u << 9)
+#define BIT10 (1u << 10)
+#define BIT11 (1u << 11)
+#define BIT12 (1u << 12)
+#define BIT13 (1u << 13)
+#define BIT14 (1u << 14)
+#define BIT15 (1u << 15)
+
+#ifndef likely
+#define likely(x) __builtin_expect(!!(x), 1)
+#define unlikely(x) __builtin_expect(!!(x), 0)
+#endif
+
+// critical sections share one recursive lock
+typedef struct
+{
+    int unused;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0}
+
+void fake_rtos_enter_critical(void);
+void fake_rtos_exit_critical(void);
+
+#define portENTER_CRITICAL(mux) ((void)(mux), fake_rtos_enter_critical())
+#define portEXIT_CRITICAL(mux) ((void)(mux), fake_rtos_exit_critical())
+#define portENTER_CRITICAL_ISR(mux) portENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL_ISR(mux) portEXIT_CRITICAL(mux)
+#define taskENTER_CRITICAL(mux) portENTER_CRITICAL(mux)
+#define taskEXIT_CRITICAL(mux) portEXIT_CRITICAL(mux)
+#define portYIELD_FROM_ISR() ((void)0)
+#define configASSERT(x)                                                                 \
+    do                                                                                  \
+    {                                                                                   \
+        if (!(x))                                                                       \
+        {                                                                               \
+            fprintf(stderr, "configASSERT(%s) failed at %s:%d\n", #x, __FILE__, __LINE__); \
+            abort();                                                                    \
+        }                                                                               \
+    } while (0)
+
+#endif //FAKE_FREERTOS_H__
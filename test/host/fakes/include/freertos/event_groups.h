@@ -0,0 +1,18 @@
+#ifndef FAKE_FREERTOS_EVENT_GROUPS_H__
+#define FAKE_FREERTOS_EVENT_GROUPS_H__
+
+#include "FreeRTOS.h"
+
+typedef struct fake_event_group *EventGroupHandle_t;
+typedef uint32_t EventBits_t;
+
+EventGroupHandle_t xEventGroupCreate(void);
+void vEventGroupDelete(EventGroupHandle_t group);
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits);
+BaseType_t xEventGroupSetBitsFromISR(EventGroupHandle_t group, EventBits_t bits, BaseType_t *woken);
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group);
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear_on_exit, BaseType_t wait_all,
+                                TickType_t ticks);
+
+#endif //FAKE_FREERTOS_EVENT_GROUPS_H__
@@ -0,0 +1,24 @@
+#ifndef FAKE_FREERTOS_RINGBUF_H__
+#define FAKE_FREERTOS_RINGBUF_H__
+
+#include "FreeRTOS.h"
+
+// only byte buffers, the one type the firmware uses
+typedef struct fake_ringbuf *RingbufHandle_t;
+
+typedef enum
+{
+    RINGBUF_TYPE_NOSPLIT,
+    RINGBUF_TYPE_ALLOWSPLIT,
+    RINGBUF_TYPE_BYTEBUF,
+} RingbufferType_t;
+
+RingbufHandle_t xRingbufferCreate(size_t size, RingbufferType_t type);
+void vRingbufferDelete(RingbufHandle_t ringbuf);
+BaseType_t xRingbufferSend(RingbufHandle_t ringbuf, const void *data, size_t size, TickType_t ticks);
+void *xRingbufferReceive(RingbufHandle_t ringbuf, size_t *size, TickType_t ticks);
+void *xRingbufferReceiveUpTo(RingbufHandle_t ringbuf, size_t *size, TickType_t ticks, size_t max_size);
+void vRingbufferReturnItem(RingbufHandle_t ringbuf, void *item);
+size_t xRingbufferGetCurFreeSize(RingbufHandle_t ringbuf);
+
+#endif //FAKE_FREERTOS_RINGBUF_H__
@@ -0,0 +1,10 @@
+#ifndef FAKE_CPU_HAL_H__
+#define FAKE_CPU_HAL_H__
+
+#include <stdint.h>
+
+// the host's cycle counter where there is one, nanoseconds otherwise. host cycles only
+// compare code paths with each other, they do not predict xtensa cycles
+uint32_t cpu_hal_get_cycle_count(void);
+
+#endif //FAKE_CPU_HAL_H__
@@ -0,0 +1,26 @@
+#ifndef FAKE_NVS_FLASH_H__
+#define FAKE_NVS_FLASH_H__
+
+// the IDF's nvs.h is shadowed by main/include/nvs.h, so the blob api the firmware calls is
+// declared here. the fake keeps it in memory, see fake_net.c
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+typedef uint32_t nvs_handle_t;
+
+typedef enum
+{
+    NVS_READONLY,
+    NVS_READWRITE,
+} nvs_open_mode_t;
+
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle);
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length);
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length);
+esp_err_t nvs_commit(nvs_handle_t handle);
+void nvs_close(nvs_handle_t handle);
+
+#endif //FAKE_NVS_FLASH_H__
@@ -0,0 +1,6 @@
+#ifndef FAKE_PROTOCOL_EXAMPLES_COMMON_H__
+#define FAKE_PROTOCOL_EXAMPLES_COMMON_H__
+
+// the IDF examples' connect helper, included by esp_http_client_example.c and not called
+
+#endif //FAKE_PROTOCOL_EXAMPLES_COMMON_H__
@@ -0,0 +1,11 @@
+#ifndef FAKE_SDKCONFIG_H__
+#define FAKE_SDKCONFIG_H__
+
+// the values of the project sdkconfig that the host build depends on
+#define CONFIG_FREERTOS_HZ 100
+#define CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ 160
+#define CONFIG_SPIRAM_SUPPORT 1
+#define CONFIG_WEBSOCKET_URI "ws://localhost:443"
+#define CONFIG_LWIP_TCP_SND_BUF_DEFAULT 5744
+
+#endif //FAKE_SDKCONFIG_H__
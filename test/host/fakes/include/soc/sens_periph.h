@@ -0,0 +1 @@
+// register definitions, nothing on the host uses them
@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+"""Writes the jpeg fixtures of bench_jpeg_sharpness, kept in the repo beside this script.
+
+    make_fixtures.py [out_dir]
+
+A 320x240 printed page, text and ruled lines with a little sensor noise, saved the way the
+camera writes its frames: baseline, 4:2:2, one interleaved scan.
+    sharp.jpg        the page
+    blurred.jpg      the page out of focus, a gaussian blur of radius 2
+    progressive.jpg  the page as a progressive jpeg, which the camera never writes
+    truncated.jpg    sharp.jpg cut in the middle of its scan
+    corrupt.jpg      sharp.jpg with an end of image marker in the middle of its scan
+Needs Pillow, which the build does not: the files are only rewritten when the scene changes.
+"""
+
+import os
+import random
+import sys
+
+from PIL import Image, ImageDraw, ImageFilter
+
+WIDTH = 320
+HEIGHT = 240
+QUALITY = 80
+
+
+def page():
+    img = Image.new("L", (WIDTH, HEIGHT), 235)
+    draw = ImageDraw.Draw(img)
+    rng = random.Random(23)
+    words = ["solve", "for", "x", "the", "area", "of", "each", "triangle", "is", "3x", "+", "7", "=", "22"]
+
+    for row, y in enumerate(range(12, HEIGHT - 12, 14)):
+        draw.line((8, y + 11, WIDTH - 8, y + 11), fill=190)
+        x = 10 + (row % 3) * 6
+        while x < WIDTH - 40:
+            word = rng.choice(words)
+            draw.text((x, y), word, fill=20)
+            x += 6 * len(word) + 6
+
+    # sensor noise, a few levels either way
+    pixels = img.load()
+    for y in range(HEIGHT):
+        for x in range(WIDTH):
+            pixels[x, y] = max(0, min(255, pixels[x, y] + rng.randint(-3, 3)))
+
+    return img.convert("RGB")
+
+
+def save(img, path, **options):
+    img.save(path, "JPEG", quality=QUALITY, subsampling=1, optimize=False, **options)
+
+
+def scan_middle(data):
+    sos = data.index(b"\xff\xda")
+    scan = sos + 2 + (data[sos + 2] << 8 | data[sos + 3])
+    return scan + (len(data) - 2 - scan) // 2
+
+
+def main():
+    out_dir = sys.argv[1] if len(sys.argv) > 1 else os.path.dirname(os.path.abspath(__file__))
+    img = page()
+
+    save(img, os.path.join(out_dir, "sharp.jpg"))
+    save(img.filter(ImageFilter.GaussianBlur(2)), os.path.join(out_dir, "blurred.jpg"))
+    save(img, os.path.join(out_dir, "progressive.jpg"), progressive=True)
+
+    with open(os.path.join(out_dir, "sharp.jpg"), "rb") as f:
+        sharp = f.read()
+    middle = scan_middle(sharp)
+    # not inside a stuffed 0xff 0x00 pair
+    while sharp[middle - 1] == 0xFF:
+        middle += 1
+
+    with open(os.path.join(out_dir, "truncated.jpg"), "wb") as f:
+        f.write(sharp[:middle])
+    with open(os.path.join(out_dir, "corrupt.jpg"), "wb") as f:
+        f.write(sharp[:middle] + b"\xff\xd9" + sharp[middle + 2:])
+
+
+if __name__ == "__main__":
+    main()
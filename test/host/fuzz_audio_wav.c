@@ -0,0 +1,539 @@
+// the streaming wav parser against a plain whole-buffer parser written here from the RIFF
+// layout. every input is parsed in one call and again cut into random pieces, and both
+// must agree with the reference on where the samples start, the format and whether the
+// header is invalid. LLVMFuzzerTestOneInput() is the libFuzzer entry point, built that
+// way with clang and -DHOST_TESTS_LIBFUZZER=ON. otherwise main() mutates a seed corpus of
+// its own for FUZZ_ITERATIONS rounds (100000 by default) and times the parser after
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "audio_wav.h"
+#include "audio_adpcm.h"
+#include "test.h"
+#include "test_support.h"
+
+typedef enum
+{
+    REF_NEED_MORE,
+    REF_ERROR,
+    REF_DATA,
+} ref_result_t;
+
+static uint32_t le32(const uint8_t *b)
+{
+    return (uint32_t)b[0] | (uint32_t)b[1] << 8 | (uint32_t)b[2] << 16 | (uint32_t)b[3] << 24;
+}
+
+static uint16_t le16(const uint8_t *b)
+{
+    return b[0] | b[1] << 8;
+}
+
+// the whole of buf is there, so chunks are stepped over by their padded sizes
+static ref_result_t ref_parse(const uint8_t *buf, size_t len, size_t *data_offset, audio_wav_format_t *fmt)
+{
+    bool has_fmt = false;
+
+    if (len < 12)
+    {
+        return REF_NEED_MORE;
+    }
+
+    if (memcmp(buf, "RIFF", 4) != 0 || memcmp(&buf[8], "WAVE", 4) != 0)
+    {
+        return REF_ERROR;
+    }
+
+    uint64_t pos = 12;
+
+    for (;;)
+    {
+        if (pos + 8 > len)
+        {
+            return REF_NEED_MORE;
+        }
+
+        const uint8_t *id = &buf[pos];
+        const uint32_t size = le32(&buf[pos + 4]);
+        const uint64_t padded = (uint64_t)size + (size & 1);
+
+        if (memcmp(id, "data", 4) == 0)
+        {
+            if (!has_fmt)
+            {
+                return REF_ERROR;
+            }
+
+            fmt->data_len = size;
+            *data_offset = pos + 8;
+            return REF_DATA;
+        }
+
+        // no chunk before the samples can be larger than a 32 bit file
+        if (padded > UINT32_MAX)
+        {
+            return REF_ERROR;
+        }
+
+        if (memcmp(id, "fmt ", 4) == 0)
+        {
+            if (size < 16)
+            {
+                return REF_ERROR;
+            }
+
+            if (pos + 8 + padded > len)
+            {
+                return REF_NEED_MORE;
+            }
+
+            const uint8_t *f = &buf[pos + 8];
+            fmt->format = le16(&f[0]);
+            fmt->channels = le16(&f[2]);
+            fmt->sample_rate = le32(&f[4]);
+            fmt->block_align = le16(&f[12]);
+            fmt->bits_per_sample = le16(&f[14]);
+            has_fmt = true;
+        }
+
+        pos += 8 + padded;
+    }
+}
+
+static bool same_format(const audio_wav_format_t *a, const audio_wav_format_t *b)
+{
+    return a->format == b->format && a->channels == b->channels && a->sample_rate == b->sample_rate &&
+           a->block_align == b->block_align && a->bits_per_sample == b->bits_per_sample && a->data_len == b->data_len;
+}
+
+static uint32_t rng_state = 0x2545f491;
+
+static uint32_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static void dump_input(const uint8_t *data, size_t size)
+{
+    fprintf(stderr, "  input (%zu bytes):", size);
+    for (size_t i = 0; i < size && i < 96; i++)
+    {
+        fprintf(stderr, "%s%02x", i % 16 == 0 ? "\n   " : " ", data[i]);
+    }
+    fprintf(stderr, "%s\n", size > 96 ? " ..." : "");
+}
+
+// feeds data in pieces of at most max_piece bytes, as the player sees a download, or in one
+// call for max_piece 0. returns the parse error and the offset of the first sample when the
+// data chunk was reached
+static esp_err_t parse_pieces(const uint8_t *data, size_t size, size_t max_piece, audio_wav_parser_t *parser, size_t *offset)
+{
+    esp_err_t err = ESP_OK;
+    size_t pos = 0;
+
+    audio_wav_parser_init(parser);
+
+    while (pos < size && err == ESP_OK && parser->state != AUDIO_WAV_STATE_DATA)
+    {
+        const size_t piece = max_piece == 0 ? size - pos : 1 + rng() % max_piece;
+        const size_t len = piece < size - pos ? piece : size - pos;
+
+        // a copy of exactly len bytes, so a read past the piece is caught by ASan
+        uint8_t *copy = malloc(len);
+        memcpy(copy, &data[pos], len);
+
+        size_t consumed = 0;
+        err = audio_wav_parse(parser, copy, len, &consumed);
+        free(copy);
+
+        if (consumed > len || (err == ESP_OK && parser->state != AUDIO_WAV_STATE_DATA && consumed != len))
+        {
+            fprintf(stderr, "consumed %zu of a %zu byte piece\n", consumed, len);
+            return ESP_ERR_INVALID_SIZE;
+        }
+
+        pos += consumed;
+    }
+
+    *offset = pos;
+
+    return err;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    audio_wav_format_t ref_fmt = {0};
+    size_t ref_offset = 0;
+    const ref_result_t ref = ref_parse(data, size, &ref_offset, &ref_fmt);
+
+    const size_t max_pieces[] = {0, 1, 7, 64};
+    const int failures = test_failures;
+
+    for (int i = 0; i < 4; i++)
+    {
+        audio_wav_parser_t parser;
+        size_t offset = 0;
+        const esp_err_t err = parse_pieces(data, size, max_pieces[i], &parser, &offset);
+
+        switch (ref)
+        {
+        case REF_ERROR:
+            CHECK_EQ_INT(err, ESP_ERR_INVALID_RESPONSE);
+            CHECK_EQ_INT(parser.state, AUDIO_WAV_STATE_ERROR);
+            break;
+
+        case REF_DATA:
+            CHECK_ESP_OK(err);
+            CHECK_EQ_INT(parser.state, AUDIO_WAV_STATE_DATA);
+            CHECK_EQ_INT(offset, ref_offset);
+            CHECK(same_format(&parser.fmt, &ref_fmt));
+            break;
+
+        case REF_NEED_MORE:
+            CHECK_ESP_OK(err);
+            CHECK(parser.state != AUDIO_WAV_STATE_DATA && parser.state != AUDIO_WAV_STATE_ERROR);
+            CHECK_EQ_INT(offset, size);
+            break;
+        }
+
+        if (test_failures != failures)
+        {
+            fprintf(stderr, "  fed in pieces of up to %zu bytes, reference result %d\n", max_pieces[i], ref);
+            dump_input(data, size);
+            break;
+        }
+    }
+
+#ifdef FUZZ_LIBFUZZER
+    if (test_failures != failures)
+    {
+        abort();
+    }
+#endif
+
+    return 0;
+}
+
+#ifndef FUZZ_LIBFUZZER
+
+#define SEED_MAX (16)
+#define INPUT_MAX (4096)
+
+typedef struct
+{
+    uint8_t data[INPUT_MAX];
+    size_t len;
+} input_t;
+
+static input_t seeds[SEED_MAX];
+static int seed_count = 0;
+
+static void put32(uint8_t *b, uint32_t v)
+{
+    b[0] = v;
+    b[1] = v >> 8;
+    b[2] = v >> 16;
+    b[3] = v >> 24;
+}
+
+static void put16(uint8_t *b, uint16_t v)
+{
+    b[0] = v;
+    b[1] = v >> 8;
+}
+
+static void append(input_t *in, const void *data, size_t len)
+{
+    REQUIRE(in->len + len <= INPUT_MAX);
+    memcpy(&in->data[in->len], data, len);
+    in->len += len;
+}
+
+static void append_chunk(input_t *in, const char *id, uint32_t size, const uint8_t *body, size_t body_len)
+{
+    uint8_t hdr[8];
+    memcpy(hdr, id, 4);
+    put32(&hdr[4], size);
+    append(in, hdr, 8);
+    append(in, body, body_len);
+}
+
+static void append_fmt(input_t *in, uint16_t format, uint16_t channels, uint32_t rate, uint16_t bits, uint16_t block_align, size_t extra)
+{
+    uint8_t f[64] = {0};
+    put16(&f[0], format);
+    put16(&f[2], channels);
+    put32(&f[4], rate);
+    put32(&f[8], rate * block_align);
+    put16(&f[12], block_align);
+    put16(&f[14], bits);
+    if (extra > 0)
+    {
+        put16(&f[16], extra - 2);
+    }
+    append_chunk(in, "fmt ", 16 + extra, f, 16 + extra);
+}
+
+static input_t *new_seed(void)
+{
+    REQUIRE(seed_count < SEED_MAX);
+    input_t *in = &seeds[seed_count++];
+    append(in, "RIFF\0\0\0\0WAVE", 12);
+    return in;
+}
+
+static void end_seed(input_t *in, uint32_t data_len, size_t samples_bytes)
+{
+    uint8_t samples[256];
+    for (size_t i = 0; i < sizeof(samples); i++)
+    {
+        samples[i] = rng();
+    }
+    append_chunk(in, "data", data_len, samples, samples_bytes);
+    put32(&in->data[4], in->len - 8);
+}
+
+static void make_seeds(void)
+{
+    uint8_t body[512];
+    memset(body, 'x', sizeof(body));
+
+    // the prompts as tools/audio_assets.py writes them
+    input_t *in = new_seed();
+    append_fmt(in, AUDIO_WAV_FORMAT_PCM, 1, 16000, 16, 2, 0);
+    end_seed(in, 256, 256);
+
+    // a stereo 44.1 kHz file from an editor, with metadata before the samples
+    in = new_seed();
+    append_chunk(in, "LIST", 26, body, 26);
+    append_fmt(in, AUDIO_WAV_FORMAT_PCM, 2, 44100, 16, 4, 0);
+    append_chunk(in, "fact", 4, body, 4);
+    end_seed(in, 256, 256);
+
+    // odd sized chunks are padded
+    in = new_seed();
+    append_chunk(in, "junk", 5, body, 6);
+    append_fmt(in, AUDIO_WAV_FORMAT_PCM, 1, 16000, 16, 2, 0);
+    append_chunk(in, "note", 1, body, 2);
+    end_seed(in, 256, 256);
+
+    // WAVE_FORMAT_EXTENSIBLE sized fmt
+    in = new_seed();
+    append_fmt(in, AUDIO_WAV_FORMAT_PCM, 1, 24000, 16, 2, 24);
+    end_seed(in, 256, 256);
+
+    // an IMA-ADPCM answer as the server streams it, length unknown
+    in = new_seed();
+    append_fmt(in, AUDIO_WAV_FORMAT_IMA_ADPCM, 1, 16000, 4, 256, 4);
+    end_seed(in, UINT32_MAX, 256);
+
+    in = new_seed();
+    append_fmt(in, AUDIO_WAV_FORMAT_PCM, 1, 16000, 16, 2, 0);
+    end_seed(in, 0, 64);
+
+    // the masters in the tree, up to the first samples
+    const char *masters[] = {"welcome_to_tutor_fish_01.wav", "taking_a_picture321_02.wav", "to_conserve_battery_01.wav"};
+    for (int i = 0; i < 3; i++)
+    {
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/audio_source_files/%s", TEST_REPO_DIR, masters[i]);
+
+        size_t len = 0;
+        uint8_t *data = test_read_file(path, &len);
+        REQUIRE(data != NULL);
+
+        in = &seeds[seed_count++];
+        in->len = len < 512 ? len : 512;
+        memcpy(in->data, data, in->len);
+        free(data);
+    }
+}
+
+static const uint32_t interesting32[] = {0, 1, 2, 15, 16, 17, 0x7fffffff, 0x80000000, 0xfffffffe, 0xffffffff};
+static const char *chunk_ids[] = {"RIFF", "WAVE", "fmt ", "data", "LIST", "fact"};
+
+static void mutate(input_t *in)
+{
+    const int rounds = 1 + rng() % 4;
+
+    for (int r = 0; r < rounds; r++)
+    {
+        const size_t at = in->len > 0 ? rng() % in->len : 0;
+
+        switch (rng() % 8)
+        {
+        case 0:
+            if (in->len > 0)
+            {
+                in->data[at] ^= 1 << (rng() % 8);
+            }
+            break;
+
+        case 1:
+            if (in->len > 0)
+            {
+                const uint8_t values[] = {0, 1, 0x7f, 0x80, 0xff};
+                in->data[at] = values[rng() % 5];
+            }
+            break;
+
+        case 2:
+            // sizes and rates live in 32 bit fields, aligned or not
+            if (in->len >= 4)
+            {
+                put32(&in->data[rng() % (in->len - 3)], interesting32[rng() % 10]);
+            }
+            break;
+
+        case 3:
+            if (in->len >= 4)
+            {
+                memcpy(&in->data[rng() % (in->len - 3)], chunk_ids[rng() % 6], 4);
+            }
+            break;
+
+        case 4:
+            in->len = at;
+            break;
+
+        case 5:
+        {
+            const size_t n = 1 + rng() % 16;
+            if (in->len + n <= INPUT_MAX)
+            {
+                memmove(&in->data[at + n], &in->data[at], in->len - at);
+                for (size_t i = 0; i < n; i++)
+                {
+                    in->data[at + i] = rng();
+                }
+                in->len += n;
+            }
+            break;
+        }
+
+        case 6:
+        {
+            const size_t n = 1 + rng() % 16;
+            if (at + n <= in->len)
+            {
+                memmove(&in->data[at], &in->data[at + n], in->len - at - n);
+                in->len -= n;
+            }
+            break;
+        }
+
+        default:
+        {
+            // a piece of another seed, as a chunk moved or repeated
+            const input_t *other = &seeds[rng() % seed_count];
+            if (other->len > 0)
+            {
+                const size_t from = rng() % other->len;
+                size_t n = 1 + rng() % 64;
+                n = n < other->len - from ? n : other->len - from;
+                if (at + n <= INPUT_MAX)
+                {
+                    memcpy(&in->data[at], &other->data[from], n);
+                    in->len = at + n > in->len ? at + n : in->len;
+                }
+            }
+            break;
+        }
+        }
+    }
+}
+
+static void bench_header(const char *what, const input_t *in)
+{
+    const int runs = 20000;
+    audio_wav_parser_t parser;
+    size_t consumed = 0;
+
+    double start = test_now_s();
+    for (int i = 0; i < runs; i++)
+    {
+        audio_wav_parser_init(&parser);
+        audio_wav_parse(&parser, in->data, in->len, &consumed);
+    }
+    const double whole = (test_now_s() - start) / runs;
+    CHECK_EQ_INT(parser.state, AUDIO_WAV_STATE_DATA);
+
+    start = test_now_s();
+    for (int i = 0; i < runs; i++)
+    {
+        audio_wav_parser_init(&parser);
+        for (size_t pos = 0; pos < in->len && parser.state != AUDIO_WAV_STATE_DATA; pos++)
+        {
+            audio_wav_parse(&parser, &in->data[pos], 1, &consumed);
+        }
+    }
+    const double bytewise = (test_now_s() - start) / runs;
+    CHECK_EQ_INT(parser.state, AUDIO_WAV_STATE_DATA);
+
+    REPORT("%s: %.0f ns in one call, %.0f ns a byte at a time", what, whole * 1e9, bytewise * 1e9);
+}
+
+int main(int argc, char **argv)
+{
+    // most inputs are invalid, each would log why
+    esp_log_level_set("audio_wav.c", ESP_LOG_NONE);
+
+    // files given on the command line are replayed, as libFuzzer would with a crash file
+    if (argc > 1)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            size_t len = 0;
+            uint8_t *data = test_read_file(argv[i], &len);
+            REQUIRE(data != NULL);
+            LLVMFuzzerTestOneInput(data, len);
+            free(data);
+        }
+
+        return test_finish("fuzz_audio_wav");
+    }
+
+    make_seeds();
+
+    for (int i = 0; i < seed_count; i++)
+    {
+        audio_wav_format_t fmt;
+        size_t offset;
+        CHECK_EQ_INT(ref_parse(seeds[i].data, seeds[i].len, &offset, &fmt), REF_DATA);
+        LLVMFuzzerTestOneInput(seeds[i].data, seeds[i].len);
+    }
+
+    const char *env = getenv("FUZZ_ITERATIONS");
+    const long iterations = env != NULL ? atol(env) : 100000;
+    long results[3] = {0};
+    static input_t in;
+
+    for (long n = 0; n < iterations && test_failures == 0; n++)
+    {
+        in = seeds[rng() % seed_count];
+        mutate(&in);
+
+        audio_wav_format_t fmt;
+        size_t offset;
+        results[ref_parse(in.data, in.len, &offset, &fmt)]++;
+
+        LLVMFuzzerTestOneInput(in.data, in.len);
+    }
+
+    // the mutations must reach all three outcomes or the run proves little
+    CHECK(results[REF_NEED_MORE] > 0 && results[REF_ERROR] > 0 && results[REF_DATA] > 0);
+    REPORT("%ld inputs: %ld incomplete, %ld invalid, %ld reached the samples",
+           iterations, results[REF_NEED_MORE], results[REF_ERROR], results[REF_DATA]);
+
+    bench_header("44 byte header", &seeds[0]);
+    bench_header("header with LIST and fact chunks", &seeds[1]);
+
+    return test_finish("fuzz_audio_wav");
+}
+
+#endif
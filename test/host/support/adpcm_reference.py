@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+"""Reference IMA-ADPCM vectors from tools/adpcm_encode.py for test_adpcm_conformance.
+
+    adpcm_reference.py out_dir master.wav...
+
+For each signal, at the block size its use on the device has, writes
+    <name>.src  the 16-bit source samples, raw little-endian
+    <name>.wav  the encoded wav file, as the encoder writes it
+    <name>.ref  the encoder's own decode of it, raw little-endian, one sample per source sample
+and lists them in manifest.txt as "<name> <block_align> <sample_count>".
+"""
+
+import math
+import os
+import random
+import struct
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "..", "tools"))
+import adpcm_encode  # noqa: E402
+
+RATE = 16000
+
+
+def sweep(count):
+    # 100 Hz to 7 kHz, most of the band a tts voice uses
+    out = []
+    phase = 0.0
+    for i in range(count):
+        freq = 100 + (7000 - 100) * i / count
+        phase += 2 * math.pi * freq / RATE
+        out.append(int(round(20000 * math.sin(phase))))
+    return out
+
+
+def noise(count):
+    rng = random.Random(11)
+    return [rng.randint(-32768, 32767) for _ in range(count)]
+
+
+def square(count):
+    # full scale edges drive the predictor into the clamp and the step index to 88
+    return [32767 if (i // 40) % 2 else -32768 for i in range(count)]
+
+
+def silence(count):
+    return [0] * count
+
+
+def write_raw(path, samples):
+    with open(path, "wb") as f:
+        f.write(struct.pack("<%dh" % len(samples), *samples))
+
+
+def write_vector(out_dir, manifest, name, samples, block_align):
+    blocks = adpcm_encode.encode(samples, block_align)
+
+    decoded = []
+    for block in blocks:
+        decoded.extend(adpcm_encode.decode_block(block))
+
+    write_raw(os.path.join(out_dir, name + ".src"), samples)
+    write_raw(os.path.join(out_dir, name + ".ref"), decoded[:len(samples)])
+    with open(os.path.join(out_dir, name + ".wav"), "wb") as f:
+        f.write(adpcm_encode.build_wav(RATE, len(samples), blocks, block_align))
+
+    manifest.append("%s %d %d" % (name, block_align, len(samples)))
+
+
+def main():
+    out_dir = sys.argv[1]
+    os.makedirs(out_dir, exist_ok=True)
+    manifest = []
+
+    # tts answers at the largest block, prompts at the encoder's default, questions as
+    # audio_capture.c encodes them. the odd lengths end on a short last block
+    write_vector(out_dir, manifest, "sweep", sweep(RATE * 2 + 7), adpcm_encode.MAX_BLOCK_ALIGN)
+    write_vector(out_dir, manifest, "noise", noise(RATE + 1000), adpcm_encode.MAX_BLOCK_ALIGN)
+    write_vector(out_dir, manifest, "square", square(RATE // 2 + 3), adpcm_encode.BLOCK_ALIGN)
+    write_vector(out_dir, manifest, "silence", silence(RATE // 4), 256)
+
+    for path in sys.argv[2:]:
+        with open(path, "rb") as f:
+            _, samples = adpcm_encode.parse_wav(f.read())
+        name = os.path.splitext(os.path.basename(path))[0]
+        write_vector(out_dir, manifest, name, samples, adpcm_encode.MAX_BLOCK_ALIGN)
+
+    with open(os.path.join(out_dir, "manifest.txt"), "w") as f:
+        f.write("\n".join(manifest) + "\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,92 @@
+#include <malloc.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include "alloc_count.h"
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static atomic_size_t allocations;
+static atomic_size_t bytes;
+static atomic_long held; // may go negative when memory from before the reset is freed
+static atomic_long base;
+static atomic_long peak;
+
+static void held_add(long delta)
+{
+    const long now = atomic_fetch_add(&held, delta) + delta;
+
+    long p = atomic_load(&peak);
+    while (now > p && !atomic_compare_exchange_weak(&peak, &p, now))
+    {
+    }
+}
+
+void *__wrap_malloc(size_t size)
+{
+    void *ptr = __real_malloc(size);
+    if (ptr != NULL)
+    {
+        allocations++;
+        bytes += size;
+        held_add(malloc_usable_size(ptr));
+    }
+
+    return ptr;
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+    void *ptr = __real_calloc(n, size);
+    if (ptr != NULL)
+    {
+        allocations++;
+        bytes += n * size;
+        held_add(malloc_usable_size(ptr));
+    }
+
+    return ptr;
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    const size_t old = ptr != NULL ? malloc_usable_size(ptr) : 0;
+
+    void *moved = __real_realloc(ptr, size);
+    if (moved != NULL)
+    {
+        allocations++;
+        bytes += size;
+        held_add((long)malloc_usable_size(moved) - (long)old);
+    }
+
+    return moved;
+}
+
+void __wrap_free(void *ptr)
+{
+    if (ptr != NULL)
+    {
+        held_add(-(long)malloc_usable_size(ptr));
+    }
+
+    __real_free(ptr);
+}
+
+void alloc_count_reset(void)
+{
+    allocations = 0;
+    bytes = 0;
+    base = atomic_load(&held);
+    peak = base;
+}
+
+void alloc_count_get(alloc_count_t *count)
+{
+    count->allocations = allocations;
+    count->bytes = bytes;
+    count->peak_bytes = peak - base;
+}
@@ -0,0 +1,19 @@
+#ifndef ALLOC_COUNT_H__
+#define ALLOC_COUNT_H__
+
+#include <stddef.h>
+
+// counts malloc(), calloc() and realloc() made by the test's own objects, the firmware and
+// the fakes, libc's internal allocations are not seen. only linked into tests declared
+// with ALLOC_COUNT in CMakeLists.txt
+typedef struct
+{
+    size_t allocations;
+    size_t bytes;      // requested since the reset
+    size_t peak_bytes; // most held at once since the reset, over what was held at the reset
+} alloc_count_t;
+
+void alloc_count_reset(void);
+void alloc_count_get(alloc_count_t *count);
+
+#endif //ALLOC_COUNT_H__
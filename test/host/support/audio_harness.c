@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "audio_harness.h"
+#include "audio_io.h"
+#include "audio_player.h"
+#include "fake_i2s.h"
+#include "test.h"
+#include "test_support.h"
+
+static const char *fs_dir = NULL;
+static int stall_every = 8;
+static int stall_us = 40000;
+
+void audio_harness_calibration_load(int every, int us)
+{
+    stall_every = every;
+    stall_us = us;
+}
+
+void audio_harness_start(int system_clip_ms)
+{
+    fs_dir = test_temp_dir("audio_fs");
+    REQUIRE(fs_dir != NULL);
+    test_audio_fs_root(fs_dir);
+
+    const int ms = system_clip_ms > 0 ? system_clip_ms : 400;
+    const int count = AUDIO_SAMPLE_RATE / 1000 * ms;
+    int16_t *samples = malloc(count * sizeof(int16_t));
+
+    for (int id = 0; id < AUDIO_CLIP_MAX; id++)
+    {
+        if (audio_clip_path(id) == NULL)
+        {
+            continue;
+        }
+
+        // a different pitch per clip, so a test can tell them apart
+        test_tone(samples, count, 300 + 40 * id, AUDIO_SAMPLE_RATE, 12000);
+
+        size_t len = 0;
+        uint8_t *wav = test_wav_pcm(samples, count, AUDIO_SAMPLE_RATE, 1, &len);
+
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s.wav", fs_dir, audio_clip_name(id));
+        REQUIRE(test_write_file(path, wav, len) == 0);
+
+        free(wav);
+    }
+
+    free(samples);
+
+    REQUIRE(init_audio_clips() == ESP_OK);
+
+    fake_i2s_set_write_stall(stall_every, stall_us);
+    REQUIRE(init_i2s() == ESP_OK);
+    fake_i2s_set_write_stall(0, 0);
+}
+
+esp_err_t audio_harness_wait_idle(int timeout_ms)
+{
+    const audio_playback_handle_t handle = audio_player_current();
+    if (handle == 0)
+    {
+        return ESP_OK;
+    }
+
+    return audio_player_wait(handle, pdMS_TO_TICKS(timeout_ms));
+}
+
+const char *audio_harness_fs_dir(void)
+{
+    return fs_dir;
+}
+
+long audio_harness_find_sound(const int16_t *out, size_t count, size_t from)
+{
+    for (size_t i = from; i < count; i++)
+    {
+        if (out[i] != 0)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
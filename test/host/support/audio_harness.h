@@ -0,0 +1,27 @@
+#ifndef AUDIO_HARNESS_H__
+#define AUDIO_HARNESS_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "audio_clip.h"
+
+// brings the audio stack up as app_main() does, on the fake i2s. the system clips, which
+// live on littlefs on the target, are written to a temporary directory first as 16 kHz
+// tones of system_clip_ms each (0 for 400 ms)
+void audio_harness_start(int system_clip_ms);
+
+// the load init_i2s() calibrates the dma under, see fake_i2s_set_write_stall(). by default
+// a 40 ms stall every 8 writes, the host scheduler's hiccups
+void audio_harness_calibration_load(int every, int stall_us);
+
+// blocks until the stream playing now, if any, has been heard
+esp_err_t audio_harness_wait_idle(int timeout_ms);
+
+// the directory standing in for /audio on littlefs
+const char *audio_harness_fs_dir(void);
+
+// index of the first non-zero sample at or after from in the i2s output, -1 for none
+long audio_harness_find_sound(const int16_t *out, size_t count, size_t from);
+
+#endif //AUDIO_HARNESS_H__
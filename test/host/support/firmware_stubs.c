@@ -0,0 +1,90 @@
+// the globals main.c defines, the nvs.c functions the audio modules call and the camera.c
+// one the upload calls, so those modules link without the rest of the app
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "esp_err.h"
+#include "state_machine.h"
+#include "wifi_bt_status.h"
+#include "nvs_data_struct.h"
+#include "nvs.h"
+#include "camera.h"
+#include "test_support.h"
+
+wifi_bt_status_t wifi_bt_status;
+state_machine_t state_machine;
+bool repeat_tts_playback = false;
+float audio_volume = 1.0f;
+nvs_data_t nvs_data;
+
+#define TEST_NVS_KEYS (8)
+
+typedef struct
+{
+    char key[16];
+    uint8_t value;
+} test_nvs_int_t;
+
+static test_nvs_int_t nvs_ints[TEST_NVS_KEYS];
+static int nvs_int_count = 0;
+
+void test_nvs_clear(void)
+{
+    nvs_int_count = 0;
+}
+
+esp_err_t read_nvs_int(char *key, uint8_t *value)
+{
+    for (int i = 0; i < nvs_int_count; i++)
+    {
+        if (strcmp(nvs_ints[i].key, key) == 0)
+        {
+            *value = nvs_ints[i].value;
+            return ESP_OK;
+        }
+    }
+
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t write_nvs_int(char *key, uint8_t value)
+{
+    int i = 0;
+    while (i < nvs_int_count && strcmp(nvs_ints[i].key, key) != 0)
+    {
+        i++;
+    }
+
+    if (i == TEST_NVS_KEYS)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    strncpy(nvs_ints[i].key, key, sizeof(nvs_ints[i].key) - 1);
+    nvs_ints[i].value = value;
+    nvs_int_count = i == nvs_int_count ? i + 1 : nvs_int_count;
+
+    return ESP_OK;
+}
+
+esp_err_t erase_nvs_key(char *nvs_key)
+{
+    for (int i = 0; i < nvs_int_count; i++)
+    {
+        if (strcmp(nvs_ints[i].key, nvs_key) == 0)
+        {
+            nvs_ints[i] = nvs_ints[--nvs_int_count];
+            return ESP_OK;
+        }
+    }
+
+    return ESP_ERR_NOT_FOUND;
+}
+
+// camera.c needs the sensor, a picture a test uploads is always a frame buffer of its own
+void camera_return_picture(camera_fb_t *pic)
+{
+    esp_camera_fb_return(pic);
+}
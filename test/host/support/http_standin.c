@@ -0,0 +1,282 @@
+#define _GNU_SOURCE // memmem()
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fake_http.h"
+#include "http_standin.h"
+#include "test.h"
+#include "test_support.h"
+
+static int listen_fd = -1;
+static pthread_t thread;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t answered_cond = PTHREAD_COND_INITIALIZER;
+static http_standin_response_t response = {.status = 200};
+static http_standin_request_t last;
+static int answered = 0;
+
+static void sleep_until(double t)
+{
+    const double wait = t - test_now_s();
+    if (wait > 0)
+    {
+        struct timespec ts = {(time_t)wait, (long)((wait - (time_t)wait) * 1e9)};
+        while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+        {
+        }
+    }
+}
+
+static bool send_all(int fd, const void *buf, size_t len)
+{
+    size_t sent = 0;
+
+    while (sent < len)
+    {
+        const ssize_t n = send(fd, (const uint8_t *)buf + sent, len - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        sent += n;
+    }
+
+    return true;
+}
+
+// reads the request into req, false when the client went away first. a paced upload is
+// taken 10 ms worth at a time, the client's writes block meanwhile as on the link
+static bool read_request(int fd, http_standin_request_t *req, size_t upload_bytes_per_s)
+{
+    char head[8192];
+    size_t len = 0;
+    char *end = NULL;
+
+    while ((end = memmem(head, len, "\r\n\r\n", 4)) == NULL)
+    {
+        const ssize_t n = recv(fd, &head[len], sizeof(head) - len - 1, 0);
+        if (n <= 0)
+        {
+            return false;
+        }
+        len += n;
+    }
+
+    *end = '\0';
+    const size_t head_len = end + 4 - head;
+
+    char *line_end = strstr(head, "\r\n");
+    if (line_end != NULL)
+    {
+        *line_end = '\0';
+        snprintf(req->headers, sizeof(req->headers), "%s", line_end + 2);
+    }
+    sscanf(head, "%7s %1023s", req->method, req->target);
+
+    long content_length = 0;
+    for (char *h = line_end != NULL ? line_end + 2 : NULL; h != NULL && *h != '\0';)
+    {
+        if (strncasecmp(h, "Content-Length:", 15) == 0)
+        {
+            content_length = atol(h + 15);
+        }
+        h = strstr(h, "\r\n");
+        h = h != NULL ? h + 2 : NULL;
+    }
+
+    req->body = malloc(content_length > 0 ? content_length : 1);
+    req->body_len = len - head_len < (size_t)content_length ? len - head_len : (size_t)content_length;
+    memcpy(req->body, &head[head_len], req->body_len);
+
+    const size_t piece = upload_bytes_per_s / 100 > 256 ? upload_bytes_per_s / 100 : 256;
+    const double start = test_now_s();
+
+    while (req->body_len < (size_t)content_length)
+    {
+        size_t want = content_length - req->body_len;
+        want = upload_bytes_per_s > 0 && want > piece ? piece : want;
+
+        const ssize_t n = recv(fd, &req->body[req->body_len], want, 0);
+        if (n <= 0)
+        {
+            return false;
+        }
+        req->body_len += n;
+
+        if (upload_bytes_per_s > 0)
+        {
+            sleep_until(start + (double)req->body_len / upload_bytes_per_s);
+        }
+    }
+
+    req->body_end_s = test_now_s();
+
+    return true;
+}
+
+static void answer(int fd, const http_standin_response_t *res)
+{
+    sleep_until(test_now_s() + res->rtt_ms / 1000.0);
+
+    char head[256];
+    int len = snprintf(head, sizeof(head), "HTTP/1.1 %d %s\r\nContent-Type: application/octet-stream\r\n", res->status,
+                       res->status == 200 ? "OK" : "Error");
+    if (!res->no_length)
+    {
+        len += snprintf(&head[len], sizeof(head) - len, "Content-Length: %zu\r\n", res->body_len);
+    }
+    len += snprintf(&head[len], sizeof(head) - len, "Connection: close\r\n\r\n");
+
+    if (!send_all(fd, head, len))
+    {
+        return;
+    }
+
+    // 10 ms worth of body at a time, each no earlier than the pace allows
+    const size_t piece = res->bytes_per_s > 0 ? (res->bytes_per_s / 100 > 256 ? res->bytes_per_s / 100 : 256) : res->body_len;
+    const double start = test_now_s();
+
+    for (size_t sent = 0; sent < res->body_len;)
+    {
+        const size_t n = res->body_len - sent < piece ? res->body_len - sent : piece;
+        if (!send_all(fd, &res->body[sent], n))
+        {
+            return;
+        }
+        sent += n;
+
+        if (res->bytes_per_s > 0)
+        {
+            sleep_until(start + (double)sent / res->bytes_per_s);
+        }
+    }
+}
+
+static void *serve(void *arg)
+{
+    while (true)
+    {
+        const int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0)
+        {
+            break;
+        }
+
+        const int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        http_standin_request_t req = {.started_s = test_now_s()};
+
+        pthread_mutex_lock(&lock);
+        const http_standin_response_t res = response;
+        pthread_mutex_unlock(&lock);
+
+        // a few of the glasses' send buffers in flight, not a host socket's worth, so the
+        // client's writes wait on the pace
+        if (res.upload_bytes_per_s > 0)
+        {
+            const int recv_buf = 16 * 1024;
+            setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &recv_buf, sizeof(recv_buf));
+        }
+
+        if (read_request(fd, &req, res.upload_bytes_per_s))
+        {
+            answer(fd, &res);
+        }
+
+        shutdown(fd, SHUT_WR);
+        close(fd);
+        req.response_end_s = test_now_s();
+
+        pthread_mutex_lock(&lock);
+        free(last.body);
+        last = req;
+        answered++;
+        pthread_cond_broadcast(&answered_cond);
+        pthread_mutex_unlock(&lock);
+    }
+
+    return NULL;
+}
+
+void http_standin_start(void)
+{
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    REQUIRE(listen_fd >= 0);
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = 0,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    socklen_t addr_len = sizeof(addr);
+
+    REQUIRE(bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    REQUIRE(listen(listen_fd, 4) == 0);
+    REQUIRE(getsockname(listen_fd, (struct sockaddr *)&addr, &addr_len) == 0);
+
+    fake_http_set_server(ntohs(addr.sin_port));
+    REQUIRE(pthread_create(&thread, NULL, serve, NULL) == 0);
+}
+
+void http_standin_stop(void)
+{
+    shutdown(listen_fd, SHUT_RDWR);
+    close(listen_fd);
+    pthread_join(thread, NULL);
+    listen_fd = -1;
+
+    free(last.body);
+    last.body = NULL;
+}
+
+void http_standin_respond(const http_standin_response_t *res)
+{
+    pthread_mutex_lock(&lock);
+    response = *res;
+    pthread_mutex_unlock(&lock);
+}
+
+bool http_standin_wait(int count, int timeout_ms)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&lock);
+    int err = 0;
+    while (answered < count && err == 0)
+    {
+        err = pthread_cond_timedwait(&answered_cond, &lock, &deadline);
+    }
+    const bool done = answered >= count;
+    pthread_mutex_unlock(&lock);
+
+    return done;
+}
+
+const http_standin_request_t *http_standin_last(void)
+{
+    return &last;
+}
@@ -0,0 +1,46 @@
+#ifndef HTTP_STANDIN_H__
+#define HTTP_STANDIN_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// a one-connection-at-a-time HTTP/1.1 server on 127.0.0.1 standing in for the tutorfish
+// backend. the fake esp_http_client is pointed at it, so the firmware's requests go over a
+// real socket. the response is delayed and paced to look like the glasses' link
+
+typedef struct
+{
+    int status;
+    const uint8_t *body; // not copied, it must outlive the request
+    size_t body_len;
+    int rtt_ms;          // between the end of the request and the response headers
+    size_t bytes_per_s;  // the body's pace, 0 for as fast as the socket takes it
+    bool no_length;      // no Content-Length, the body ends when the connection closes
+    size_t upload_bytes_per_s; // the pace the request body is taken at, 0 for as fast as it comes
+} http_standin_response_t;
+
+typedef struct
+{
+    char method[8];
+    char target[1024]; // path and query
+    char headers[4096];
+    uint8_t *body;
+    size_t body_len;
+    double started_s;    // test_now_s() at the connection
+    double body_end_s;   // the last request body byte arrived
+    double response_end_s;
+} http_standin_request_t;
+
+void http_standin_start(void);
+void http_standin_stop(void);
+
+// the response to every request from now on
+void http_standin_respond(const http_standin_response_t *response);
+
+// waits until count requests have been answered, false on timeout
+bool http_standin_wait(int count, int timeout_ms);
+// the last request answered, valid until the next one arrives
+const http_standin_request_t *http_standin_last(void);
+
+#endif //HTTP_STANDIN_H__
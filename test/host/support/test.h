@@ -0,0 +1,53 @@
+#ifndef TEST_H__
+#define TEST_H__
+
+// checks for the host tests. a failed check is reported and counted, the test carries on
+// and test_finish() turns the count into the exit status ctest reads
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+extern int test_failures;
+
+#define CHECK(cond)                                                          \
+    do                                                                       \
+    {                                                                        \
+        if (!(cond))                                                         \
+        {                                                                    \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            test_failures++;                                                 \
+        }                                                                    \
+    } while (0)
+
+#define CHECK_EQ_INT(a, b)                                                                        \
+    do                                                                                            \
+    {                                                                                             \
+        const long long a_ = (long long)(a);                                                      \
+        const long long b_ = (long long)(b);                                                      \
+        if (a_ != b_)                                                                             \
+        {                                                                                         \
+            fprintf(stderr, "%s:%d: %s == %s failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, a_, b_); \
+            test_failures++;                                                                      \
+        }                                                                                         \
+    } while (0)
+
+#define CHECK_ESP_OK(x) CHECK_EQ_INT((x), ESP_OK)
+
+// stops the test, for a failure the rest cannot run without
+#define REQUIRE(cond)                                                          \
+    do                                                                         \
+    {                                                                          \
+        if (!(cond))                                                           \
+        {                                                                      \
+            fprintf(stderr, "%s:%d: REQUIRE(%s) failed\n", __FILE__, __LINE__, #cond); \
+            exit(1);                                                           \
+        }                                                                      \
+    } while (0)
+
+// a measurement for the log, benchmarks print one line per figure
+#define REPORT(fmt, ...) printf("  " fmt "\n", ##__VA_ARGS__)
+
+int test_finish(const char *name);
+
+#endif //TEST_H__
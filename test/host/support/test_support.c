@@ -0,0 +1,231 @@
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "test.h"
+#include "test_support.h"
+
+int test_failures = 0;
+
+// the firmware's tasks and buffers live for the whole run and are never freed, as on the
+// target, so leak reports would only list those
+const char *__asan_default_options(void)
+{
+    return "detect_leaks=0";
+}
+
+int test_finish(const char *name)
+{
+    if (test_failures > 0)
+    {
+        fprintf(stderr, "%s: %d check(s) failed\n", name, test_failures);
+        return 1;
+    }
+
+    printf("%s: ok\n", name);
+    return 0;
+}
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xff;
+    p[1] = v >> 8;
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    put_u16(p, v & 0xffff);
+    put_u16(p + 2, v >> 16);
+}
+
+uint8_t *test_wav_pcm(const int16_t *samples, int count, uint32_t sample_rate, int channels, size_t *len)
+{
+    const uint32_t data_len = count * sizeof(int16_t);
+    uint8_t *wav = malloc(44 + data_len);
+
+    memcpy(wav, "RIFF", 4);
+    put_u32(wav + 4, 36 + data_len);
+    memcpy(wav + 8, "WAVEfmt ", 8);
+    put_u32(wav + 16, 16);
+    put_u16(wav + 20, 1);
+    put_u16(wav + 22, channels);
+    put_u32(wav + 24, sample_rate);
+    put_u32(wav + 28, sample_rate * channels * sizeof(int16_t));
+    put_u16(wav + 32, channels * sizeof(int16_t));
+    put_u16(wav + 34, 16);
+    memcpy(wav + 36, "data", 4);
+    put_u32(wav + 40, data_len);
+
+    for (int i = 0; i < count; i++)
+    {
+        put_u16(wav + 44 + i * 2, (uint16_t)samples[i]);
+    }
+
+    *len = 44 + data_len;
+
+    return wav;
+}
+
+int test_write_file(const char *path, const void *data, size_t len)
+{
+    FILE *f = fopen(path, "wb");
+    if (f == NULL)
+    {
+        return -1;
+    }
+
+    const size_t n = fwrite(data, 1, len, f);
+    fclose(f);
+
+    return n == len ? 0 : -1;
+}
+
+uint8_t *test_read_file(const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+    {
+        return NULL;
+    }
+
+    fseek(f, 0, SEEK_END);
+    const long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t *data = malloc(size > 0 ? size : 1);
+    if (data == NULL || fread(data, 1, size, f) != (size_t)size)
+    {
+        free(data);
+        fclose(f);
+        return NULL;
+    }
+
+    fclose(f);
+    *len = size;
+
+    return data;
+}
+
+void test_tone(int16_t *samples, int count, double freq_hz, uint32_t sample_rate, double amplitude)
+{
+    const int ramp = sample_rate / 100;
+
+    for (int i = 0; i < count; i++)
+    {
+        double env = 1.0;
+        if (i < ramp)
+        {
+            env = (double)i / ramp;
+        }
+        else if (count - i < ramp)
+        {
+            env = (double)(count - i) / ramp;
+        }
+
+        samples[i] = (int16_t)lrint(amplitude * env * sin(2 * M_PI * freq_hz * i / sample_rate));
+    }
+}
+
+#define TEST_TEMP_DIRS (4)
+
+static char temp_dirs[TEST_TEMP_DIRS][512];
+static int temp_dir_count = 0;
+
+static void remove_temp_dirs(void)
+{
+    for (int i = 0; i < temp_dir_count; i++)
+    {
+        DIR *dir = opendir(temp_dirs[i]);
+        if (dir == NULL)
+        {
+            continue;
+        }
+
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL)
+        {
+            if (entry->d_name[0] != '.')
+            {
+                unlinkat(dirfd(dir), entry->d_name, 0);
+            }
+        }
+
+        closedir(dir);
+        rmdir(temp_dirs[i]);
+    }
+}
+
+const char *test_temp_dir(const char *name)
+{
+    if (temp_dir_count == TEST_TEMP_DIRS)
+    {
+        return NULL;
+    }
+
+    char *dir = temp_dirs[temp_dir_count];
+    snprintf(dir, sizeof(temp_dirs[0]), "%s/%s.%d", TEST_TMP_DIR, name, getpid());
+    if (mkdir(dir, 0700) != 0)
+    {
+        return NULL;
+    }
+
+    if (temp_dir_count++ == 0)
+    {
+        atexit(remove_temp_dirs);
+    }
+
+    return dir;
+}
+
+double test_now_s(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// the firmware reads littlefs under /audio/, the link wraps fopen() and stat() so those
+// paths land in the test's directory
+
+static char audio_root[512];
+
+void test_audio_fs_root(const char *dir)
+{
+    snprintf(audio_root, sizeof(audio_root), "%s", dir);
+}
+
+static const char *map_path(const char *path, char *buf, size_t len)
+{
+    if (audio_root[0] != '\0' && strncmp(path, "/audio/", 7) == 0)
+    {
+        snprintf(buf, len, "%s/%s", audio_root, path + 7);
+        return buf;
+    }
+
+    return path;
+}
+
+FILE *__real_fopen(const char *path, const char *mode);
+int __real_stat(const char *path, struct stat *st);
+
+FILE *__wrap_fopen(const char *path, const char *mode)
+{
+    char buf[1024];
+
+    return __real_fopen(map_path(path, buf, sizeof(buf)), mode);
+}
+
+int __wrap_stat(const char *path, struct stat *st)
+{
+    char buf[1024];
+
+    return __real_stat(map_path(path, buf, sizeof(buf)), st);
+}
@@ -0,0 +1,27 @@
+#ifndef TEST_SUPPORT_H__
+#define TEST_SUPPORT_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+// a 16 bit PCM wav file in memory, free() the result
+uint8_t *test_wav_pcm(const int16_t *samples, int count, uint32_t sample_rate, int channels, size_t *len);
+int test_write_file(const char *path, const void *data, size_t len);
+uint8_t *test_read_file(const char *path, size_t *len);
+
+// a tone at amplitude (full scale 32767) with a short ramp at both ends, as a voice prompt
+void test_tone(int16_t *samples, int count, double freq_hz, uint32_t sample_rate, double amplitude);
+
+// a fresh directory under the build tree, removed with its files at exit
+const char *test_temp_dir(const char *name);
+
+// firmware paths under /audio/ (littlefs on the target) are opened in dir instead
+void test_audio_fs_root(const char *dir);
+
+// monotonic time
+double test_now_s(void);
+
+// the in-memory nvs behind read_nvs_int() and write_nvs_int()
+void test_nvs_clear(void);
+
+#endif //TEST_SUPPORT_H__
@@ -0,0 +1,339 @@
+// audio_adpcm.c against tools/adpcm_encode.py, the encoder every prompt and answer on the
+// device comes from. support/adpcm_reference.py writes a sweep, noise, a full scale square,
+// silence and two masters at the block sizes the device uses, with the encoder's own decode
+// of each as the reference PCM. the C decoder must reproduce that PCM bit for bit, the C
+// encoder must reproduce the encoded blocks byte for byte, and an answer streamed into the
+// player in chunks that split its blocks anywhere must leave the i2s as the reference
+// PCM, its short last block included when the header leaves the length unknown. also
+// reported: decode cycles per second of 16 kHz audio at the answer block size and the
+// bytes an answer takes against 16 bit PCM, in host cycles
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal/cpu_hal.h"
+#include "audio_adpcm.h"
+#include "audio_player.h"
+#include "audio_wav.h"
+#include "audio_dsp.h"
+#include "audio_harness.h"
+#include "fake_i2s.h"
+#include "test.h"
+#include "test_support.h"
+
+#define REFERENCE_DIR TEST_GEN_DIR "/adpcm_reference"
+#define VECTORS_MAX (16)
+#define MATCH_SAMPLES (64) // after the fade-in, enough to find the stream in the i2s output
+
+typedef struct
+{
+    char name[64];
+    int block_align;
+    int count;
+    int16_t *src;
+    int16_t *ref;
+    uint8_t *wav;
+    size_t wav_len;
+    const uint8_t *data; // the wav's data chunk
+    size_t data_len;
+} vector_t;
+
+static vector_t vectors[VECTORS_MAX];
+static int vector_count = 0;
+
+static void *read_reference(const char *name, const char *ext, size_t *len)
+{
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s.%s", REFERENCE_DIR, name, ext);
+
+    void *data = test_read_file(path, len);
+    REQUIRE(data != NULL);
+
+    return data;
+}
+
+static void load_vectors(void)
+{
+    FILE *manifest = fopen(REFERENCE_DIR "/manifest.txt", "r");
+    REQUIRE(manifest != NULL);
+
+    vector_t *v = &vectors[0];
+    while (vector_count < VECTORS_MAX && fscanf(manifest, "%63s %d %d", v->name, &v->block_align, &v->count) == 3)
+    {
+        size_t len = 0;
+        v->src = read_reference(v->name, "src", &len);
+        CHECK_EQ_INT(len, v->count * sizeof(int16_t));
+        v->ref = read_reference(v->name, "ref", &len);
+        CHECK_EQ_INT(len, v->count * sizeof(int16_t));
+        v->wav = read_reference(v->name, "wav", &v->wav_len);
+
+        // the header as the player parses it
+        audio_wav_parser_t parser;
+        size_t consumed = 0;
+        audio_wav_parser_init(&parser);
+        CHECK_ESP_OK(audio_wav_parse(&parser, v->wav, v->wav_len, &consumed));
+        REQUIRE(parser.state == AUDIO_WAV_STATE_DATA);
+        CHECK_EQ_INT(parser.fmt.format, AUDIO_WAV_FORMAT_IMA_ADPCM);
+        CHECK_EQ_INT(parser.fmt.block_align, v->block_align);
+        CHECK_EQ_INT(parser.fmt.bits_per_sample, 4);
+
+        v->data = &v->wav[consumed];
+        v->data_len = parser.fmt.data_len;
+        REQUIRE(consumed + v->data_len <= v->wav_len);
+
+        vector_count++;
+        v++;
+    }
+
+    fclose(manifest);
+    REQUIRE(vector_count > 0);
+}
+
+// the C decoder on the encoder's blocks, as the reference decoded them
+static void test_decode(const vector_t *v)
+{
+    const int block_samples = AUDIO_ADPCM_BLOCK_SAMPLES(v->block_align);
+    int16_t *out = malloc((v->data_len / v->block_align + 1) * block_samples * sizeof(int16_t));
+    int count = 0;
+
+    for (size_t pos = 0; pos < v->data_len; pos += v->block_align)
+    {
+        const size_t len = v->data_len - pos < (size_t)v->block_align ? v->data_len - pos : (size_t)v->block_align;
+        count += audio_adpcm_decode_block(&v->data[pos], len, &out[count]);
+    }
+
+    // a short last block with an even sample count decodes one padding sample
+    CHECK(count == v->count || count == v->count + 1);
+
+    int mismatches = 0;
+    int first = -1;
+    for (int i = 0; i < v->count && i < count; i++)
+    {
+        if (out[i] != v->ref[i])
+        {
+            first = first < 0 ? i : first;
+            mismatches++;
+        }
+    }
+    if (mismatches > 0)
+    {
+        fprintf(stderr, "%s: decoded sample %d is %d, the reference has %d\n", v->name, first, out[first], v->ref[first]);
+    }
+    CHECK_EQ_INT(mismatches, 0);
+
+    free(out);
+}
+
+// the C encoder on the same source, block by block with the step index carried over
+static void test_encode(const vector_t *v)
+{
+    const int block_samples = AUDIO_ADPCM_BLOCK_SAMPLES(v->block_align);
+    uint8_t *encoded = malloc(v->data_len + v->block_align);
+    int32_t index = 0;
+    size_t len = 0;
+
+    for (int start = 0; start < v->count; start += block_samples)
+    {
+        const int n = v->count - start < block_samples ? v->count - start : block_samples;
+        len += audio_adpcm_encode_block(&v->src[start], n, &index, &encoded[len]);
+    }
+
+    CHECK_EQ_INT(len, v->data_len);
+    if (len == v->data_len && memcmp(encoded, v->data, len) != 0)
+    {
+        size_t i = 0;
+        while (encoded[i] == v->data[i])
+        {
+            i++;
+        }
+        fprintf(stderr, "%s: encoded byte %zu is 0x%02x, the reference has 0x%02x\n", v->name, i, encoded[i], v->data[i]);
+        CHECK(false);
+    }
+
+    free(encoded);
+}
+
+// a step index past the table in a block header is taken as the last entry
+static void test_index_clamp(const vector_t *v)
+{
+    uint8_t block[AUDIO_ADPCM_MAX_BLOCK];
+    int16_t clamped[AUDIO_ADPCM_BLOCK_SAMPLES(AUDIO_ADPCM_MAX_BLOCK)];
+    int16_t at_88[AUDIO_ADPCM_BLOCK_SAMPLES(AUDIO_ADPCM_MAX_BLOCK)];
+
+    memcpy(block, v->data, v->block_align);
+    block[2] = 200;
+    const int n = audio_adpcm_decode_block(block, v->block_align, clamped);
+
+    block[2] = 88;
+    CHECK_EQ_INT(audio_adpcm_decode_block(block, v->block_align, at_88), n);
+    CHECK(memcmp(clamped, at_88, n * sizeof(int16_t)) == 0);
+
+    // and a block too short for its header decodes nothing
+    CHECK_EQ_INT(audio_adpcm_decode_block(block, AUDIO_ADPCM_BLOCK_HEADER - 1, clamped), 0);
+}
+
+// a source that hands the player the file in pieces of every size, as a download does
+typedef struct
+{
+    const uint8_t *buf;
+    int len;
+    int pos;
+    int reads;
+} chunked_source_t;
+
+static int chunked_read(void *ctx, uint8_t *buf, int len)
+{
+    static const int sizes[] = {1, 3, 1021, 4, 1500, 2, 777, 1024, 5, 4096, 333};
+    chunked_source_t *source = ctx;
+
+    int n = sizes[source->reads++ % (sizeof(sizes) / sizeof(sizes[0]))];
+    n = n < len ? n : len;
+    n = n < source->len - source->pos ? n : source->len - source->pos;
+
+    memcpy(buf, &source->buf[source->pos], n);
+    source->pos += n;
+
+    return n;
+}
+
+// plays wav in chunks that split its blocks anywhere, its first count samples must leave the
+// i2s as the reference decoded them. returns the samples compared
+static size_t check_streamed(const vector_t *v, const uint8_t *wav, size_t wav_len, int count, int *reads)
+{
+    chunked_source_t chunked = {.buf = wav, .len = wav_len};
+    audio_source_t source = {.read = chunked_read, .ctx = &chunked};
+
+    fake_i2s_reset();
+    CHECK_ESP_OK(audio_player_play(&source, 1.0f, false, AUDIO_PRIORITY_ANSWER));
+    CHECK_ESP_OK(audio_harness_wait_idle(20000));
+    *reads = chunked.reads;
+
+    size_t out_count = 0;
+    const int16_t *out = fake_i2s_tx_samples(&out_count);
+
+    // past the fade-in the player's gain is unity and the output is the decode itself,
+    // found by the first sound after it since a master may open on silence
+    int from = AUDIO_FADE_IN_SAMPLES + 1;
+    while (from < count && v->ref[from] == 0)
+    {
+        from++;
+    }
+    REQUIRE(count > from + MATCH_SAMPLES);
+
+    long at = -1;
+    for (size_t i = 0; at < 0 && i + MATCH_SAMPLES <= out_count; i++)
+    {
+        if (memcmp(&out[i], &v->ref[from], MATCH_SAMPLES * sizeof(int16_t)) == 0)
+        {
+            at = i;
+        }
+    }
+    REQUIRE(at >= 0);
+
+    const size_t compared = count - from;
+    CHECK(at + compared <= out_count);
+    CHECK(at + compared <= out_count && memcmp(&out[at], &v->ref[from], compared * sizeof(int16_t)) == 0);
+
+    return compared;
+}
+
+static void test_streamed(const vector_t *v)
+{
+    int reads = 0;
+    const size_t compared = check_streamed(v, v->wav, v->wav_len, v->count, &reads);
+
+    REPORT("%s: streamed in %d reads, %zu samples after the fade-in as the reference", v->name, reads, compared);
+}
+
+// an answer as the server streams it, the sizes in its header unknown and its last block
+// cut short anywhere. that block is only known to be the last one when the stream ends
+static void test_streamed_unknown_length(const vector_t *v)
+{
+    const size_t header_len = v->data - v->wav;
+    const size_t blocks = v->data_len / v->block_align / 2;
+    const size_t tail = v->block_align / 2 + 1;
+    const size_t wav_len = header_len + blocks * v->block_align + tail;
+    REQUIRE(blocks > 0 && blocks * v->block_align + tail < v->data_len);
+
+    uint8_t *wav = malloc(wav_len);
+    memcpy(wav, v->wav, wav_len);
+    memset(&wav[4], 0xFF, 4);              // RIFF size
+    memset(&wav[header_len - 4], 0xFF, 4); // data size
+
+    const int count = blocks * AUDIO_ADPCM_BLOCK_SAMPLES(v->block_align) + 1 + 2 * (tail - AUDIO_ADPCM_BLOCK_HEADER);
+    REQUIRE(count <= v->count);
+
+    int reads = 0;
+    const size_t compared = check_streamed(v, wav, wav_len, count, &reads);
+
+    REPORT("%s: %zu blocks and %zu bytes of unknown length streamed in %d reads, %zu samples as the reference", v->name,
+           blocks, tail, reads, compared);
+
+    free(wav);
+}
+
+static void bench_decode(const vector_t *v)
+{
+    const int block_samples = AUDIO_ADPCM_BLOCK_SAMPLES(v->block_align);
+    int16_t *out = malloc(block_samples * sizeof(int16_t));
+    uint64_t cycles = 0;
+    uint64_t samples = 0;
+
+    for (int i = 0; i < 20; i++)
+    {
+        for (size_t pos = 0; pos + v->block_align <= v->data_len; pos += v->block_align)
+        {
+            const uint32_t start = cpu_hal_get_cycle_count();
+            samples += audio_adpcm_decode_block(&v->data[pos], v->block_align, out);
+            cycles += (uint32_t)(cpu_hal_get_cycle_count() - start);
+        }
+    }
+
+    const double cycles_per_s = (double)cycles / samples * AUDIO_SAMPLE_RATE;
+    REPORT("decode at %d byte blocks: %.2f M host cycles per second of audio, %.2f%% of a 240 MHz core",
+           v->block_align, cycles_per_s / 1e6, cycles_per_s / 240e6 * 100);
+
+    // the answer's bytes on the link against the same answer as 16 bit PCM
+    const size_t pcm_len = 44 + v->count * sizeof(int16_t);
+    REPORT("%s: %zu bytes as ima-adpcm, %zu as pcm, %.2fx fewer to download", v->name, v->wav_len, pcm_len,
+           (double)pcm_len / v->wav_len);
+
+    free(out);
+}
+
+int main(void)
+{
+    load_vectors();
+    audio_harness_start(0);
+
+    const vector_t *longest = NULL;
+
+    for (int i = 0; i < vector_count; i++)
+    {
+        const vector_t *v = &vectors[i];
+
+        test_decode(v);
+        test_encode(v);
+        test_index_clamp(v);
+
+        // answers are the streamed ones, silence has nothing to find in the output
+        if (v->block_align == AUDIO_ADPCM_MAX_BLOCK)
+        {
+            test_streamed(v);
+            test_streamed_unknown_length(v);
+            longest = longest == NULL || v->count > longest->count ? v : longest;
+        }
+    }
+
+    REQUIRE(longest != NULL);
+    bench_decode(longest);
+
+    for (int i = 0; i < vector_count; i++)
+    {
+        free(vectors[i].src);
+        free(vectors[i].ref);
+        free(vectors[i].wav);
+    }
+
+    return test_finish("test_adpcm_conformance");
+}
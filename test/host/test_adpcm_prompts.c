@@ -0,0 +1,257 @@
+// the ADPCM prompts linked into the app against the PCM masters in audio_source_files. each
+// master is encoded and decoded again with audio_adpcm.c, and each linked prompt is decoded
+// block by block as the player does it, and both must keep the SNR above the 20 dB
+// tools/audio_assets.py builds with. the linked prompts were normalised before they were
+// encoded, so they are compared with the master scaled by the gain that fits them best.
+// reported: bytes against the masters and decode cycles per sample, in host cycles
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "audio_adpcm.h"
+#include "audio_wav.h"
+#include "audio_assets.h"
+#include "hal/cpu_hal.h"
+#include "test.h"
+#include "test_support.h"
+
+#define MIN_SNR_DB (20.0)
+#define BLOCK_ALIGN (512) // tools/adpcm_encode.py's default for prompts
+
+#define ASSET(clip_name) {#clip_name, AUDIO_ASSET_OFFSET_##clip_name, AUDIO_ASSET_LEN_##clip_name}
+
+static const struct
+{
+    const char *name;
+    int offset;
+    int len;
+} assets[] = {
+    ASSET(welcome_to_tutor_fish_01),
+    ASSET(submit_a_question_00),
+    ASSET(tutor_fish_settings_00),
+    ASSET(look_at_your_question_01),
+    ASSET(the_camera_take_a_pic_01),
+    ASSET(to_conserve_battery_01),
+    ASSET(taking_a_picture321_02),
+    ASSET(uploading_the_picture_please_wait_00),
+    ASSET(to_hear_the_answer_again_00),
+    ASSET(tutors_found_answer_00),
+    ASSET(tutors_look_for_answer_00),
+};
+
+#define ASSET_COUNT (sizeof(assets) / sizeof(assets[0]))
+
+// the samples of a 16 bit PCM master, NULL when it is something else
+static int16_t *read_master(const char *name, int *count, size_t *file_len)
+{
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/audio_source_files/%s.wav", TEST_REPO_DIR, name);
+
+    uint8_t *data = test_read_file(path, file_len);
+    REQUIRE(data != NULL);
+
+    audio_wav_parser_t parser;
+    size_t consumed = 0;
+    audio_wav_parser_init(&parser);
+
+    if (audio_wav_parse(&parser, data, *file_len, &consumed) != ESP_OK || parser.state != AUDIO_WAV_STATE_DATA ||
+        parser.fmt.format != AUDIO_WAV_FORMAT_PCM || parser.fmt.bits_per_sample != 16 || parser.fmt.channels != 1)
+    {
+        free(data);
+        return NULL;
+    }
+
+    const size_t data_len = parser.fmt.data_len < *file_len - consumed ? parser.fmt.data_len : *file_len - consumed;
+    *count = data_len / 2;
+
+    int16_t *samples = malloc(*count * sizeof(int16_t));
+    memcpy(samples, &data[consumed], *count * sizeof(int16_t));
+    free(data);
+
+    return samples;
+}
+
+// SNR of decoded against reference scaled by gain
+static double snr_db(const int16_t *reference, const int16_t *decoded, int count, double gain)
+{
+    double signal = 0;
+    double noise = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        const double r = reference[i] * gain;
+        signal += r * r;
+        noise += (decoded[i] - r) * (decoded[i] - r);
+    }
+
+    return noise > 0 ? 10 * log10(signal / noise) : INFINITY;
+}
+
+static double best_gain(const int16_t *reference, const int16_t *decoded, int count)
+{
+    double rd = 0;
+    double rr = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        rd += (double)reference[i] * decoded[i];
+        rr += (double)reference[i] * reference[i];
+    }
+
+    return rr > 0 ? rd / rr : 1.0;
+}
+
+static uint64_t decode_cycles = 0;
+static uint64_t decoded_samples = 0;
+
+// decodes a whole data chunk of block_align sized blocks, the last may be short
+static int decode_all(const uint8_t *data, size_t len, int block_align, int16_t *out)
+{
+    int count = 0;
+
+    for (size_t pos = 0; pos < len; pos += block_align)
+    {
+        const size_t block_len = len - pos < (size_t)block_align ? len - pos : (size_t)block_align;
+
+        const uint32_t start = cpu_hal_get_cycle_count();
+        const int n = audio_adpcm_decode_block(&data[pos], block_len, &out[count]);
+        decode_cycles += (uint32_t)(cpu_hal_get_cycle_count() - start);
+        decoded_samples += n;
+
+        CHECK(n <= (int)AUDIO_ADPCM_BLOCK_SAMPLES(block_len));
+        count += n;
+    }
+
+    return count;
+}
+
+// the C encoder, as the device encodes the recorded question, on the master itself
+static void check_roundtrip(const char *name, const int16_t *samples, int count)
+{
+    const int block_samples = AUDIO_ADPCM_BLOCK_SAMPLES(BLOCK_ALIGN);
+    uint8_t *encoded = malloc((count / block_samples + 1) * BLOCK_ALIGN);
+    int16_t *decoded = malloc((count / block_samples + 1) * block_samples * sizeof(int16_t));
+    int32_t index = 0;
+    size_t len = 0;
+
+    for (int start = 0; start < count; start += block_samples)
+    {
+        const int n = count - start < block_samples ? count - start : block_samples;
+        const int block_len = audio_adpcm_encode_block(&samples[start], n, &index, &encoded[len]);
+
+        CHECK(block_len <= BLOCK_ALIGN);
+        CHECK(block_len == BLOCK_ALIGN || start + n == count);
+        len += block_len;
+    }
+
+    const int decoded_count = decode_all(encoded, len, BLOCK_ALIGN, decoded);
+
+    // a short last block with an even sample count decodes one padding sample
+    CHECK(decoded_count == count || decoded_count == count + 1);
+
+    const double snr = snr_db(samples, decoded, count, 1.0);
+    CHECK(snr >= MIN_SNR_DB);
+
+    REPORT("%s: encoded %d samples in %zu bytes, SNR %.1f dB", name, count, len, snr);
+
+    free(encoded);
+    free(decoded);
+}
+
+// the prompt as it is linked, decoded as the player decodes it
+static size_t check_linked(const char *name, int offset, int len, const int16_t *master, int master_count)
+{
+    const uint8_t *wav = &audio_assets_start[offset];
+
+    audio_wav_parser_t parser;
+    size_t consumed = 0;
+    audio_wav_parser_init(&parser);
+
+    CHECK_ESP_OK(audio_wav_parse(&parser, wav, len, &consumed));
+    REQUIRE(parser.state == AUDIO_WAV_STATE_DATA);
+    CHECK_EQ_INT(parser.fmt.format, AUDIO_WAV_FORMAT_IMA_ADPCM);
+    CHECK_EQ_INT(parser.fmt.channels, 1);
+    CHECK_EQ_INT(parser.fmt.bits_per_sample, 4);
+    CHECK(parser.fmt.block_align > AUDIO_ADPCM_BLOCK_HEADER && parser.fmt.block_align <= AUDIO_ADPCM_MAX_BLOCK);
+    CHECK(consumed + parser.fmt.data_len <= (size_t)len);
+
+    const int block_align = parser.fmt.block_align;
+    const size_t data_len = parser.fmt.data_len;
+    int16_t *decoded = malloc((data_len / block_align + 1) * AUDIO_ADPCM_BLOCK_SAMPLES(block_align) * sizeof(int16_t));
+
+    const int count = decode_all(&wav[consumed], data_len, block_align, decoded);
+
+    CHECK(count == master_count || count == master_count + 1);
+
+    const int compared = count < master_count ? count : master_count;
+    const double gain = best_gain(master, decoded, compared);
+    const double snr = snr_db(master, decoded, compared, gain);
+    CHECK(snr >= MIN_SNR_DB);
+
+    REPORT("%s: linked as %d bytes, SNR %.1f dB against the master at gain %.2f", name, len, snr, gain);
+
+    free(decoded);
+
+    return len;
+}
+
+static void bench_decode(void)
+{
+    // the longest prompt, decoded repeatedly so the figure is not one cold pass
+    const int index = 4;
+    const uint8_t *wav = &audio_assets_start[assets[index].offset];
+
+    audio_wav_parser_t parser;
+    size_t consumed = 0;
+    audio_wav_parser_init(&parser);
+    audio_wav_parse(&parser, wav, assets[index].len, &consumed);
+
+    const int block_align = parser.fmt.block_align;
+    int16_t *out = malloc((parser.fmt.data_len / block_align + 1) * AUDIO_ADPCM_BLOCK_SAMPLES(block_align) * sizeof(int16_t));
+
+    decode_cycles = 0;
+    decoded_samples = 0;
+
+    const double start = test_now_s();
+    for (int i = 0; i < 50; i++)
+    {
+        decode_all(&wav[consumed], parser.fmt.data_len, block_align, out);
+    }
+    const double seconds = test_now_s() - start;
+
+    REPORT("decode: %.1f host cycles per sample, %.0f seconds of 16 kHz audio per second",
+           (double)decode_cycles / decoded_samples, decoded_samples / 16000.0 / seconds);
+
+    free(out);
+}
+
+int main(void)
+{
+    size_t master_bytes = 0;
+    size_t linked_bytes = 0;
+
+    for (size_t i = 0; i < ASSET_COUNT; i++)
+    {
+        int count = 0;
+        size_t file_len = 0;
+        int16_t *master = read_master(assets[i].name, &count, &file_len);
+        REQUIRE(master != NULL);
+
+        check_roundtrip(assets[i].name, master, count);
+        linked_bytes += check_linked(assets[i].name, assets[i].offset, assets[i].len, master, count);
+        master_bytes += file_len;
+
+        free(master);
+    }
+
+    CHECK(linked_bytes <= AUDIO_ASSETS_SIZE);
+
+    // 4 bits a sample against 16, less the headers
+    CHECK(master_bytes > 3.5 * linked_bytes);
+    REPORT("prompts: %zu bytes of PCM masters linked as %zu bytes, %.2fx smaller",
+           master_bytes, linked_bytes, (double)master_bytes / linked_bytes);
+
+    bench_decode();
+
+    return test_finish("test_adpcm_prompts");
+}
@@ -0,0 +1,441 @@
+// the clip cache against a model of itself: a prompt sequence as a session plays it is
+// replayed through audio_clip_acquire() and audio_clip_prefetch(), and after every step the
+// counters must match an LRU of the same budgets kept here. the model only knows the
+// policy, least recently used first and never a clip that is playing, so a change to what
+// is cached or evicted shows up as the step where the two part
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "audio_clip.h"
+#include "test.h"
+#include "test_support.h"
+
+#define CACHE_BUDGET (512 * 1024)    // AUDIO_CLIP_CACHE_BUDGET
+#define PREFETCH_BUDGET (192 * 1024) // AUDIO_CLIP_PREFETCH_BUDGET
+
+// length of each littlefs clip, roughly what is spoken in it
+static const int clip_ms[AUDIO_CLIP_MAX] = {
+    [AUDIO_CLIP_CONFIRM_SFX_04] = 300,
+    [AUDIO_CLIP_RETURNING_HOME_07] = 1500,
+    [AUDIO_CLIP_EXIT_THIS_APP_01] = 2000,
+    [AUDIO_CLIP_HOME_INSTRUCTIONS_00] = 9000,
+    [AUDIO_CLIP_ATTEMPT_WIFI_CONN_00] = 2500,
+    [AUDIO_CLIP_WIFI_DISCONN_00] = 2000,
+    [AUDIO_CLIP_ERROR_MESSAGE_00] = 3000,
+    [AUDIO_CLIP_WAIT_APP_LOADS_00] = 2000,
+    [AUDIO_CLIP_PERCENT_COMPLETED_00] = 1200,
+    [AUDIO_CLIP_ASCII_5_00] = 600,
+    [AUDIO_CLIP_10_00] = 700,
+    [AUDIO_CLIP_20_00] = 700,
+    [AUDIO_CLIP_30_00] = 700,
+    [AUDIO_CLIP_40_00] = 700,
+    [AUDIO_CLIP_50_00] = 700,
+    [AUDIO_CLIP_60_00] = 700,
+    [AUDIO_CLIP_70_00] = 700,
+    [AUDIO_CLIP_80_00] = 700,
+    [AUDIO_CLIP_90_00] = 700,
+};
+
+// boot, two questions of which one fails to upload, a wifi drop and the progress of an
+// update, in the order main.c plays the prompts. the embedded prompts are in it too, they
+// must not touch the cache
+static const audio_clip_id_t session[] = {
+    AUDIO_CLIP_WAIT_APP_LOADS_00,
+    AUDIO_CLIP_WELCOME_TO_TUTOR_FISH_01,
+    AUDIO_CLIP_HOME_INSTRUCTIONS_00,
+    AUDIO_CLIP_CONFIRM_SFX_04,
+    AUDIO_CLIP_SUBMIT_A_QUESTION_00,
+    AUDIO_CLIP_CONFIRM_SFX_04,
+    AUDIO_CLIP_TAKING_A_PICTURE321_02,
+    AUDIO_CLIP_ATTEMPT_WIFI_CONN_00,
+    AUDIO_CLIP_UPLOADING_THE_PICTURE_PLEASE_WAIT_00,
+    AUDIO_CLIP_ERROR_MESSAGE_00,
+    AUDIO_CLIP_RETURNING_HOME_07,
+    AUDIO_CLIP_HOME_INSTRUCTIONS_00,
+    AUDIO_CLIP_CONFIRM_SFX_04,
+    AUDIO_CLIP_SUBMIT_A_QUESTION_00,
+    AUDIO_CLIP_CONFIRM_SFX_04,
+    AUDIO_CLIP_TAKING_A_PICTURE321_02,
+    AUDIO_CLIP_ATTEMPT_WIFI_CONN_00,
+    AUDIO_CLIP_UPLOADING_THE_PICTURE_PLEASE_WAIT_00,
+    AUDIO_CLIP_TUTORS_LOOK_FOR_ANSWER_00,
+    AUDIO_CLIP_TUTORS_FOUND_ANSWER_00,
+    AUDIO_CLIP_TO_HEAR_THE_ANSWER_AGAIN_00,
+    AUDIO_CLIP_CONFIRM_SFX_04,
+    AUDIO_CLIP_WIFI_DISCONN_00,
+    AUDIO_CLIP_ERROR_MESSAGE_00,
+    AUDIO_CLIP_RETURNING_HOME_07,
+    AUDIO_CLIP_CONFIRM_SFX_04,
+    AUDIO_CLIP_WAIT_APP_LOADS_00,
+    AUDIO_CLIP_10_00,
+    AUDIO_CLIP_PERCENT_COMPLETED_00,
+    AUDIO_CLIP_30_00,
+    AUDIO_CLIP_PERCENT_COMPLETED_00,
+    AUDIO_CLIP_50_00,
+    AUDIO_CLIP_PERCENT_COMPLETED_00,
+    AUDIO_CLIP_70_00,
+    AUDIO_CLIP_PERCENT_COMPLETED_00,
+    AUDIO_CLIP_90_00,
+    AUDIO_CLIP_PERCENT_COMPLETED_00,
+    AUDIO_CLIP_ERROR_MESSAGE_00,
+    AUDIO_CLIP_EXIT_THIS_APP_01,
+    AUDIO_CLIP_HOME_INSTRUCTIONS_00,
+    AUDIO_CLIP_CONFIRM_SFX_04,
+    AUDIO_CLIP_ERROR_MESSAGE_00,
+    AUDIO_CLIP_RETURNING_HOME_07,
+};
+
+typedef struct
+{
+    bool littlefs;
+    bool cached;
+    bool prefetched;
+    int refs;
+    uint32_t last_used;
+    size_t len;
+} model_entry_t;
+
+static model_entry_t model[AUDIO_CLIP_MAX];
+static audio_clip_cache_stats_t expected;
+static uint32_t model_counter = 0;
+static uint8_t *file_data[AUDIO_CLIP_MAX];
+
+static void model_evict(model_entry_t *entry)
+{
+    expected.cached_bytes -= entry->len;
+    expected.evictions++;
+
+    if (entry->prefetched)
+    {
+        expected.prefetched_bytes -= entry->len;
+        expected.prefetch_wasted++;
+        entry->prefetched = false;
+    }
+
+    entry->cached = false;
+}
+
+static bool model_make_room(size_t needed)
+{
+    while (expected.cached_bytes + needed > CACHE_BUDGET)
+    {
+        model_entry_t *lru = NULL;
+
+        for (int i = 0; i < AUDIO_CLIP_MAX; i++)
+        {
+            if (model[i].cached && model[i].refs == 0 && (lru == NULL || model[i].last_used < lru->last_used))
+            {
+                lru = &model[i];
+            }
+        }
+
+        if (lru == NULL)
+        {
+            return false;
+        }
+
+        model_evict(lru);
+    }
+
+    return true;
+}
+
+static esp_err_t model_acquire(audio_clip_id_t id)
+{
+    model_entry_t *entry = &model[id];
+
+    if (entry->littlefs)
+    {
+        if (entry->cached)
+        {
+            expected.hits++;
+
+            if (entry->prefetched)
+            {
+                expected.prefetched_bytes -= entry->len;
+                expected.prefetch_hits++;
+                entry->prefetched = false;
+            }
+        }
+        else
+        {
+            expected.misses++;
+
+            if (!model_make_room(entry->len))
+            {
+                return ESP_ERR_NO_MEM;
+            }
+
+            entry->cached = true;
+            expected.cached_bytes += entry->len;
+        }
+    }
+
+    entry->refs++;
+    entry->last_used = ++model_counter;
+
+    return ESP_OK;
+}
+
+static esp_err_t model_prefetch(audio_clip_id_t id)
+{
+    model_entry_t *entry = &model[id];
+
+    if (!entry->littlefs || entry->cached)
+    {
+        return ESP_OK;
+    }
+
+    if (expected.prefetched_bytes + entry->len > PREFETCH_BUDGET || !model_make_room(entry->len))
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    entry->cached = true;
+    entry->prefetched = true;
+    entry->last_used = ++model_counter;
+    expected.cached_bytes += entry->len;
+    expected.prefetched_bytes += entry->len;
+    expected.prefetches++;
+
+    return ESP_OK;
+}
+
+static void check_stats(const char *step, audio_clip_id_t id)
+{
+    audio_clip_cache_stats_t stats;
+    audio_clip_cache_stats(&stats);
+
+    const int failures = test_failures;
+
+    CHECK_EQ_INT(stats.hits, expected.hits);
+    CHECK_EQ_INT(stats.misses, expected.misses);
+    CHECK_EQ_INT(stats.evictions, expected.evictions);
+    CHECK_EQ_INT(stats.cached_bytes, expected.cached_bytes);
+    CHECK_EQ_INT(stats.prefetches, expected.prefetches);
+    CHECK_EQ_INT(stats.prefetch_hits, expected.prefetch_hits);
+    CHECK_EQ_INT(stats.prefetch_wasted, expected.prefetch_wasted);
+    CHECK_EQ_INT(stats.prefetched_bytes, expected.prefetched_bytes);
+    CHECK(stats.cached_bytes <= stats.budget_bytes);
+    CHECK(stats.prefetched_bytes <= stats.prefetch_budget_bytes);
+
+    if (test_failures != failures)
+    {
+        fprintf(stderr, "  after %s %s\n", step, audio_clip_name(id));
+    }
+}
+
+static const audio_clip_t *acquire(audio_clip_id_t id, esp_err_t expected_err)
+{
+    const audio_clip_t *clip = NULL;
+
+    const esp_err_t model_err = model_acquire(id);
+    const esp_err_t err = audio_clip_acquire(id, &clip);
+    CHECK_EQ_INT(err, model_err);
+    CHECK_EQ_INT(err, expected_err);
+    check_stats("acquire", id);
+
+    if (err != ESP_OK)
+    {
+        return NULL;
+    }
+
+    CHECK_EQ_INT(clip->id, id);
+
+    // a cached clip is the file, whether it was just read or has been sitting in the cache
+    if (model[id].littlefs)
+    {
+        CHECK_EQ_INT(clip->len, model[id].len);
+        CHECK(memcmp(clip->buf, file_data[id], model[id].len) == 0);
+    }
+
+    return clip;
+}
+
+static void release(const audio_clip_t *clip)
+{
+    if (clip == NULL)
+    {
+        return;
+    }
+
+    model[clip->id].refs--;
+    audio_clip_release(clip);
+}
+
+static void prefetch(audio_clip_id_t id, esp_err_t expected_err)
+{
+    const esp_err_t model_err = model_prefetch(id);
+    const esp_err_t err = audio_clip_prefetch(id);
+    CHECK_EQ_INT(err, model_err);
+    CHECK_EQ_INT(err, expected_err);
+    check_stats("prefetch", id);
+}
+
+static void write_clips(void)
+{
+    const char *dir = test_temp_dir("audio_fs");
+    REQUIRE(dir != NULL);
+    test_audio_fs_root(dir);
+
+    for (int id = 0; id < AUDIO_CLIP_MAX; id++)
+    {
+        if (audio_clip_path(id) == NULL)
+        {
+            continue;
+        }
+
+        REQUIRE(clip_ms[id] > 0);
+
+        const int count = 16 * clip_ms[id];
+        int16_t *samples = malloc(count * sizeof(int16_t));
+        test_tone(samples, count, 300 + 40 * id, 16000, 12000);
+
+        size_t len = 0;
+        file_data[id] = test_wav_pcm(samples, count, 16000, 1, &len);
+        free(samples);
+
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s.wav", dir, audio_clip_name(id));
+        REQUIRE(test_write_file(path, file_data[id], len) == 0);
+
+        model[id].littlefs = true;
+        model[id].len = len;
+    }
+}
+
+// each prompt is acquired for as long as it plays and released after
+static void replay_session(void)
+{
+    uint32_t misses[AUDIO_CLIP_MAX] = {0};
+    uint32_t plays[AUDIO_CLIP_MAX] = {0};
+
+    for (size_t i = 0; i < sizeof(session) / sizeof(session[0]); i++)
+    {
+        const audio_clip_id_t id = session[i];
+        const uint32_t misses_before = expected.misses;
+
+        release(acquire(id, ESP_OK));
+
+        plays[id]++;
+        misses[id] += expected.misses - misses_before;
+    }
+
+    // the prompts played most come from the cache at least every other time. the session
+    // does not fit the budget, the progress announcement pushes them out once
+    const audio_clip_id_t hot[] = {AUDIO_CLIP_CONFIRM_SFX_04, AUDIO_CLIP_ERROR_MESSAGE_00};
+
+    for (int i = 0; i < 2; i++)
+    {
+        CHECK(plays[hot[i]] > 3);
+        CHECK(plays[hot[i]] - misses[hot[i]] >= misses[hot[i]]);
+
+        REPORT("%s: played %u times, read %u times", audio_clip_name(hot[i]), plays[hot[i]], misses[hot[i]]);
+    }
+
+    // the session is more than the budget, the cache had to evict
+    CHECK(expected.evictions > 0);
+
+    REPORT("session of %zu prompts: %u hits, %u misses, %u evictions, %zu bytes cached",
+           sizeof(session) / sizeof(session[0]), expected.hits, expected.misses, expected.evictions, expected.cached_bytes);
+}
+
+// clips that are playing are never evicted, a clip that does not fit beside them is refused
+// and streamed by the caller instead
+static void held_clips(void)
+{
+    const audio_clip_id_t held[] = {
+        AUDIO_CLIP_HOME_INSTRUCTIONS_00,
+        AUDIO_CLIP_ERROR_MESSAGE_00,
+        AUDIO_CLIP_ATTEMPT_WIFI_CONN_00,
+    };
+    const audio_clip_t *clips[3];
+
+    for (int i = 0; i < 3; i++)
+    {
+        clips[i] = acquire(held[i], ESP_OK);
+    }
+
+    acquire(AUDIO_CLIP_WAIT_APP_LOADS_00, ESP_ERR_NO_MEM);
+
+    // still intact after the evictions the refused clip caused
+    for (int i = 0; i < 3; i++)
+    {
+        REQUIRE(clips[i] != NULL);
+        CHECK(memcmp(clips[i]->buf, file_data[held[i]], clips[i]->len) == 0);
+        release(clips[i]);
+    }
+
+    // and fits once they are done
+    release(acquire(AUDIO_CLIP_WAIT_APP_LOADS_00, ESP_OK));
+}
+
+static void prefetches(void)
+{
+    // clips played in place need no prefetch
+    prefetch(AUDIO_CLIP_TUTORS_FOUND_ANSWER_00, ESP_OK);
+
+    // larger than the prefetch budget on its own
+    release(acquire(AUDIO_CLIP_WIFI_DISCONN_00, ESP_OK));
+    release(acquire(AUDIO_CLIP_EXIT_THIS_APP_01, ESP_OK));
+    release(acquire(AUDIO_CLIP_RETURNING_HOME_07, ESP_OK));
+    release(acquire(AUDIO_CLIP_ERROR_MESSAGE_00, ESP_OK));
+    CHECK(!model[AUDIO_CLIP_HOME_INSTRUCTIONS_00].cached);
+    prefetch(AUDIO_CLIP_HOME_INSTRUCTIONS_00, ESP_ERR_NO_MEM);
+
+    // the numbers of a progress announcement fill the budget before the last one
+    const audio_clip_id_t numbers[] = {
+        AUDIO_CLIP_10_00, AUDIO_CLIP_20_00, AUDIO_CLIP_30_00,
+        AUDIO_CLIP_40_00, AUDIO_CLIP_50_00, AUDIO_CLIP_60_00,
+        AUDIO_CLIP_70_00, AUDIO_CLIP_80_00, AUDIO_CLIP_90_00,
+        AUDIO_CLIP_ASCII_5_00, AUDIO_CLIP_PERCENT_COMPLETED_00,
+    };
+    int refused = 0;
+
+    for (size_t i = 0; i < sizeof(numbers) / sizeof(numbers[0]); i++)
+    {
+        const esp_err_t model_err = model_prefetch(numbers[i]);
+        CHECK_EQ_INT(audio_clip_prefetch(numbers[i]), model_err);
+        check_stats("prefetch", numbers[i]);
+
+        refused += model_err == ESP_ERR_NO_MEM;
+    }
+
+    CHECK(refused > 0);
+
+    // a prefetched clip played is a prefetch hit, one pushed out before it played is wasted
+    release(acquire(AUDIO_CLIP_20_00, ESP_OK));
+    release(acquire(AUDIO_CLIP_HOME_INSTRUCTIONS_00, ESP_OK));
+    release(acquire(AUDIO_CLIP_ATTEMPT_WIFI_CONN_00, ESP_OK));
+    release(acquire(AUDIO_CLIP_WAIT_APP_LOADS_00, ESP_OK));
+
+    CHECK(expected.prefetch_hits > 0);
+    CHECK(expected.prefetch_wasted > 0);
+
+    REPORT("prefetch: %u loaded, %u hits, %u wasted", expected.prefetches, expected.prefetch_hits, expected.prefetch_wasted);
+}
+
+int main(void)
+{
+    REQUIRE(init_audio_clips() == ESP_OK);
+    REQUIRE(!audio_clip_pack_loaded());
+
+    audio_clip_cache_stats(&expected);
+    CHECK_EQ_INT(expected.budget_bytes, CACHE_BUDGET);
+    CHECK_EQ_INT(expected.prefetch_budget_bytes, PREFETCH_BUDGET);
+
+    write_clips();
+
+    replay_session();
+    held_clips();
+    prefetches();
+
+    for (int id = 0; id < AUDIO_CLIP_MAX; id++)
+    {
+        CHECK_EQ_INT(model[id].refs, 0);
+        free(file_data[id]);
+    }
+
+    return test_finish("test_audio_clip_cache");
+}
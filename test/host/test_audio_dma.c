@@ -0,0 +1,196 @@
+// the dma calibration of audio_io.c and the counters of audio_player_stats() it is built on.
+// the boot calibrates with a load on the writer's core that the smallest configurations
+// cannot hide, then the counters are checked against the fake dma: none for audio played
+// in time, a starved stream counts what the dma replayed, a late interrupt shows up as
+// jitter. underruns in use make the next boot calibrate again from the level above
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "audio_player.h"
+#include "audio_harness.h"
+#include "fake_i2s.h"
+#include "nvs.h"
+#include "test.h"
+#include "test_support.h"
+
+#define STALL_EVERY (8)
+#define STALL_MS (110)
+#define LATE_MS (60)
+#define CHECK_PERIOD_MS (10000) // AUDIO_DMA_CHECK_PERIOD
+
+static uint8_t *tone_wav(int ms, size_t *len)
+{
+    const int count = AUDIO_SAMPLE_RATE / 1000 * ms;
+    int16_t *samples = malloc(count * sizeof(int16_t));
+
+    test_tone(samples, count, 440, AUDIO_SAMPLE_RATE, 8000);
+    uint8_t *wav = test_wav_pcm(samples, count, AUDIO_SAMPLE_RATE, 1, len);
+    free(samples);
+
+    return wav;
+}
+
+static void play_tone(int ms)
+{
+    size_t len = 0;
+    uint8_t *wav = tone_wav(ms, &len);
+
+    audio_source_t source;
+    audio_mem_source_t mem;
+    audio_source_memory(&source, &mem, wav, len);
+
+    CHECK_ESP_OK(audio_player_play(&source, 1.0f, false, AUDIO_PRIORITY_PROMPT));
+    CHECK_ESP_OK(audio_harness_wait_idle(ms + 5000));
+
+    free(wav);
+}
+
+static int buffer_ms(const audio_player_stats_t *stats)
+{
+    return stats->dma_buf_len * 1000 / AUDIO_SAMPLE_RATE;
+}
+
+// a stall is hidden once the buffers queued behind the one playing outlast it
+static void test_calibrated(void)
+{
+    audio_player_stats_t stats;
+    audio_player_stats(&stats);
+
+    uint8_t level = 0;
+    CHECK_ESP_OK(read_nvs_int("i2s_dma_level", &level));
+    CHECK(level > 0);
+    CHECK((stats.dma_buf_count - 1) * buffer_ms(&stats) > STALL_MS);
+
+    REPORT("%d ms stall every %d writes: calibrated at level %d, %d x %d samples", STALL_MS, STALL_EVERY, level,
+           stats.dma_buf_count, stats.dma_buf_len);
+}
+
+static void test_in_time(void)
+{
+    audio_player_stats_t before;
+    audio_player_stats_t after;
+    fake_i2s_stats_t dma;
+
+    fake_i2s_reset();
+    audio_player_stats(&before);
+    play_tone(2000);
+    audio_player_stats(&after);
+    fake_i2s_stats(&dma);
+
+    CHECK_EQ_INT(after.underruns - before.underruns, 0);
+    CHECK_EQ_INT(after.dma_underruns - before.dma_underruns, 0);
+    CHECK_EQ_INT(after.late_refills - before.late_refills, 0);
+    CHECK_EQ_INT(dma.stale_buffers, 0);
+    CHECK(after.played_us - before.played_us >= 2000 * 1000);
+}
+
+// the producer stops for longer than the dma buffers last, what the dma sends meanwhile
+// are stale buffers
+static void test_starved(void)
+{
+    audio_player_stats_t before;
+    audio_player_stats_t after;
+    fake_i2s_stats_t dma;
+    audio_playback_handle_t handle;
+    size_t len = 0;
+    uint8_t *wav = tone_wav(1000, &len);
+
+    fake_i2s_reset();
+    audio_player_stats(&before);
+
+    CHECK_ESP_OK(audio_player_begin(1.0f, false, AUDIO_PRIORITY_PROMPT, &handle));
+    const size_t half = len / 2 & ~(size_t)1;
+    audio_player_write(wav, half);
+    vTaskDelay(pdMS_TO_TICKS(1000));
+    audio_player_write(&wav[half], len - half);
+    audio_player_end();
+    CHECK_ESP_OK(audio_player_wait(handle, pdMS_TO_TICKS(5000)));
+
+    audio_player_stats(&after);
+    fake_i2s_stats(&dma);
+
+    const uint32_t dma_underruns = after.dma_underruns - before.dma_underruns;
+    CHECK_EQ_INT(after.underruns - before.underruns, 1);
+    CHECK(dma_underruns > 0);
+    CHECK(after.late_refills - before.late_refills > 0);
+    // the monitor and the fake dma count the same replays, but for the one sent as the
+    // player catches up
+    CHECK(dma.stale_buffers > 0);
+    CHECK(dma_underruns + 1 >= dma.stale_buffers && dma_underruns <= dma.stale_buffers + 1);
+
+    REPORT("starved for 1000 ms: %u dma underruns, the dma replayed %u buffers", dma_underruns, dma.stale_buffers);
+
+    free(wav);
+}
+
+static void test_jitter(void)
+{
+    audio_player_stats_t stats;
+    size_t len = 0;
+    uint8_t *wav = tone_wav(1000, &len);
+
+    audio_source_t source;
+    audio_mem_source_t mem;
+    audio_source_memory(&source, &mem, wav, len);
+
+    CHECK_ESP_OK(audio_player_play(&source, 1.0f, false, AUDIO_PRIORITY_PROMPT));
+    vTaskDelay(pdMS_TO_TICKS(300));
+    fake_i2s_delay_next_buffer(LATE_MS * 1000);
+    CHECK_ESP_OK(audio_harness_wait_idle(5000));
+
+    // the event is timestamped when the monitor gets to it, a tick either way on the host
+    audio_player_stats(&stats);
+    CHECK(stats.max_event_jitter_us >= (LATE_MS - 15) * 1000);
+
+    REPORT("a buffer %d ms late: %u us worst jitter", LATE_MS, stats.max_event_jitter_us);
+
+    free(wav);
+}
+
+// more underruns in use than the target allows are seen at the next check, the stored
+// level goes and the next boot calibrates from the one above
+static void test_recheck(void)
+{
+    audio_player_stats_t stats;
+    uint8_t level = 0;
+    uint8_t floor_level = 0;
+
+    REQUIRE(read_nvs_int("i2s_dma_level", &level) == ESP_OK);
+
+    audio_player_stats(&stats);
+    fake_i2s_set_write_stall(2, (stats.dma_buf_count + 1) * buffer_ms(&stats) * 1000);
+    play_tone(1000);
+    fake_i2s_set_write_stall(0, 0);
+
+    audio_player_stats(&stats);
+    CHECK(stats.dma_underruns > 0);
+
+    for (int waited = 0; waited < CHECK_PERIOD_MS + 2000 && read_nvs_int("i2s_dma_level", &level) == ESP_OK;
+         waited += 100)
+    {
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+
+    CHECK_EQ_INT(read_nvs_int("i2s_dma_level", &level), ESP_ERR_NOT_FOUND);
+    CHECK_ESP_OK(read_nvs_int("i2s_dma_floor", &floor_level));
+    CHECK_EQ_INT(floor_level, level + 1);
+}
+
+int main(void)
+{
+    // the first boot, nothing stored
+    test_nvs_clear();
+    audio_harness_calibration_load(STALL_EVERY, STALL_MS * 1000);
+    audio_harness_start(0);
+
+    test_calibrated();
+    test_in_time();
+    test_starved();
+    test_jitter();
+    test_recheck();
+
+    return test_finish("test_audio_dma");
+}
@@ -0,0 +1,278 @@
+// the fades the player applies inside the gain kernel, heard through the fake i2s. a
+// constant clip makes the ramps exact: the fade-in must rise linearly from the stream's
+// first sample to full level over AUDIO_FADE_IN_SAMPLES, a stop or a preemption must fall
+// linearly to silence over AUDIO_FADE_OUT_SAMPLES from where it lands, and no two samples
+// anywhere may be further apart than one ramp step. the first sample of the stream must
+// also be the first sample of a dma buffer and already audible, where the zeroing this
+// replaced held the first 2000 samples (125 ms) silent
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "audio_player.h"
+#include "audio_dsp.h"
+#include "audio_harness.h"
+#include "fake_i2s.h"
+#include "test.h"
+#include "test_support.h"
+
+#define LEVEL (12000)
+#define PROMPT_LEVEL (-8000)
+
+typedef struct
+{
+    uint8_t *wav;
+    size_t len;
+} clip_t;
+
+static clip_t constant_clip(int16_t level, int count)
+{
+    int16_t *samples = malloc(count * sizeof(int16_t));
+    for (int i = 0; i < count; i++)
+    {
+        samples[i] = level;
+    }
+
+    clip_t clip;
+    clip.wav = test_wav_pcm(samples, count, AUDIO_SAMPLE_RATE, 1, &clip.len);
+    free(samples);
+
+    return clip;
+}
+
+// the ramp as audio_gain_ramp() defines it: a fixed step per sample, clamped at the target
+static int16_t faded(int16_t level, int32_t from, int32_t to, int ramp_samples, int k)
+{
+    const int32_t step = (to - from) / ramp_samples;
+    int32_t gain = from + (k + 1) * step;
+
+    gain = step > 0 ? (gain > to ? to : gain) : (gain < to ? to : gain);
+
+    // an arithmetic shift, as the kernel's
+    const int32_t product = level * gain;
+    return product >= 0 ? product >> 15 : -((-product + 32767) >> 15);
+}
+
+// the largest change between neighbouring samples in out[from, to)
+static int max_jump(const int16_t *out, long from, long to)
+{
+    int jump = 0;
+
+    for (long i = from + 1; i < to; i++)
+    {
+        const int d = abs(out[i] - out[i - 1]);
+        jump = d > jump ? d : jump;
+    }
+
+    return jump;
+}
+
+// one fade step of level, the most a ramp may move the output per sample
+static int ramp_step(int16_t level, int ramp_samples)
+{
+    return abs(level) * (AUDIO_GAIN_Q15_ONE / ramp_samples) / AUDIO_GAIN_Q15_ONE + 1;
+}
+
+// checks the fade-in at out[start], returns how many samples matched
+static int check_fade_in(const int16_t *out, long start, int16_t level)
+{
+    int k = 0;
+
+    for (; k <= AUDIO_FADE_IN_SAMPLES; k++)
+    {
+        if (out[start + k] != faded(level, 0, AUDIO_GAIN_Q15_ONE, AUDIO_FADE_IN_SAMPLES, k))
+        {
+            break;
+        }
+    }
+
+    return k;
+}
+
+// checks the fade-out from the first sample below full level after from, returns where it
+// reached silence or -1 when it did not have the ramp's shape
+static long check_fade_out(const int16_t *out, size_t count, long from, int16_t level)
+{
+    long f = from;
+    while ((size_t)f < count && out[f] == level)
+    {
+        f++;
+    }
+
+    for (int k = 0; (size_t)(f + k) < count; k++)
+    {
+        const int16_t expect = faded(level, AUDIO_GAIN_Q15_ONE, 0, AUDIO_FADE_OUT_SAMPLES, k);
+        if (out[f + k] != expect)
+        {
+            fprintf(stderr, "fade-out sample %d: %d != %d\n", k, out[f + k], expect);
+            return -1;
+        }
+        if (expect == 0)
+        {
+            return f + k;
+        }
+    }
+
+    return -1;
+}
+
+typedef struct
+{
+    clip_t clip;
+    audio_priority_t priority;
+    volatile bool done;
+} player_t;
+
+static void play_task(void *arg)
+{
+    player_t *player = arg;
+
+    audio_source_t source;
+    audio_mem_source_t mem;
+    audio_source_memory(&source, &mem, player->clip.wav, player->clip.len);
+
+    audio_player_play(&source, 1.0f, true, player->priority);
+    player->done = true;
+
+    vTaskDelete(NULL);
+}
+
+static void start_playing(player_t *player)
+{
+    xTaskCreate(play_task, "play", 4096, player, 5, NULL);
+
+    // until the stream is heard
+    fake_i2s_stats_t dma = {0};
+    for (int waited = 0; waited < 2000 && dma.first_sound_us == 0; waited += 10)
+    {
+        vTaskDelay(pdMS_TO_TICKS(10));
+        fake_i2s_stats(&dma);
+    }
+    REQUIRE(dma.first_sound_us != 0);
+}
+
+static void wait_done(player_t *player)
+{
+    for (int waited = 0; waited < 5000 && !player->done; waited += 10)
+    {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    REQUIRE(player->done);
+    CHECK_ESP_OK(audio_harness_wait_idle(5000));
+}
+
+static void test_fade_in(void)
+{
+    clip_t clip = constant_clip(LEVEL, AUDIO_SAMPLE_RATE / 2);
+
+    fake_i2s_reset();
+
+    audio_source_t source;
+    audio_mem_source_t mem;
+    audio_source_memory(&source, &mem, clip.wav, clip.len);
+    CHECK_ESP_OK(audio_player_play(&source, 1.0f, false, AUDIO_PRIORITY_PROMPT));
+    CHECK_ESP_OK(audio_harness_wait_idle(5000));
+
+    size_t count = 0;
+    const int16_t *out = fake_i2s_tx_samples(&count);
+    const long start = audio_harness_find_sound(out, count, 0);
+    REQUIRE(start >= 0);
+
+    audio_player_stats_t stats;
+    audio_player_stats(&stats);
+
+    // nothing silent ahead of the stream's own first sample
+    CHECK_EQ_INT(start % stats.dma_buf_len, 0);
+    CHECK_EQ_INT(check_fade_in(out, start, LEVEL), AUDIO_FADE_IN_SAMPLES + 1);
+    CHECK(max_jump(out, start - 1, start + AUDIO_SAMPLE_RATE / 2) <= ramp_step(LEVEL, AUDIO_FADE_IN_SAMPLES));
+
+    REPORT("fade-in: stream sample 0 is audible at %d, full level after %d samples (%.1f ms)",
+           out[start], AUDIO_FADE_IN_SAMPLES, AUDIO_FADE_IN_SAMPLES * 1000.0 / AUDIO_SAMPLE_RATE);
+
+    free(clip.wav);
+}
+
+static void test_stop(void)
+{
+    player_t player = {.clip = constant_clip(LEVEL, AUDIO_SAMPLE_RATE * 3), .priority = AUDIO_PRIORITY_ANSWER};
+
+    fake_i2s_reset();
+    start_playing(&player);
+    vTaskDelay(pdMS_TO_TICKS(300));
+
+    audio_player_stop();
+    wait_done(&player);
+
+    size_t count = 0;
+    const int16_t *out = fake_i2s_tx_samples(&count);
+    const long start = audio_harness_find_sound(out, count, 0);
+    REQUIRE(start >= 0);
+
+    const long silent = check_fade_out(out, count, start + AUDIO_FADE_IN_SAMPLES + 1, LEVEL);
+    CHECK(silent > 0);
+    CHECK_EQ_INT(audio_harness_find_sound(out, count, silent), -1);
+    CHECK(max_jump(out, start - 1, count) <= ramp_step(LEVEL, AUDIO_FADE_IN_SAMPLES));
+
+    REPORT("stop: %.2f s played, then %d samples (%.0f ms) down to silence", (silent - start) / (double)AUDIO_SAMPLE_RATE,
+           AUDIO_FADE_OUT_SAMPLES, AUDIO_FADE_OUT_SAMPLES * 1000.0 / AUDIO_SAMPLE_RATE);
+
+    free(player.clip.wav);
+}
+
+// the answer fades out, the prompt that cut it off fades in
+static void test_preempt(void)
+{
+    player_t answer = {.clip = constant_clip(LEVEL, AUDIO_SAMPLE_RATE * 3), .priority = AUDIO_PRIORITY_ANSWER};
+    clip_t prompt = constant_clip(PROMPT_LEVEL, AUDIO_SAMPLE_RATE / 4);
+
+    fake_i2s_reset();
+    start_playing(&answer);
+    vTaskDelay(pdMS_TO_TICKS(300));
+
+    audio_source_t source;
+    audio_mem_source_t mem;
+    audio_source_memory(&source, &mem, prompt.wav, prompt.len);
+    CHECK_ESP_OK(audio_player_play(&source, 1.0f, false, AUDIO_PRIORITY_PROMPT));
+    wait_done(&answer);
+
+    size_t count = 0;
+    const int16_t *out = fake_i2s_tx_samples(&count);
+    const long start = audio_harness_find_sound(out, count, 0);
+    REQUIRE(start >= 0);
+
+    const long silent = check_fade_out(out, count, start + AUDIO_FADE_IN_SAMPLES + 1, LEVEL);
+    REQUIRE(silent > 0);
+
+    const long prompt_start = audio_harness_find_sound(out, count, silent);
+    REQUIRE(prompt_start > 0);
+
+    // the answer's drain completed its last dma buffer, the prompt starts a fresh one
+    audio_player_stats_t stats;
+    audio_player_stats(&stats);
+    CHECK_EQ_INT(prompt_start % stats.dma_buf_len, 0);
+    CHECK_EQ_INT(check_fade_in(out, prompt_start, PROMPT_LEVEL), AUDIO_FADE_IN_SAMPLES + 1);
+
+    const int step = ramp_step(PROMPT_LEVEL, AUDIO_FADE_IN_SAMPLES) > ramp_step(LEVEL, AUDIO_FADE_IN_SAMPLES)
+                         ? ramp_step(PROMPT_LEVEL, AUDIO_FADE_IN_SAMPLES)
+                         : ramp_step(LEVEL, AUDIO_FADE_IN_SAMPLES);
+    // up to the prompt's last sample, a constant clip ends in a step of its own
+    CHECK(max_jump(out, start - 1, prompt_start + AUDIO_SAMPLE_RATE / 4) <= step);
+
+    REPORT("preempt: answer faded out, %ld ms of silence, prompt faded in", (prompt_start - silent) * 1000 / AUDIO_SAMPLE_RATE);
+
+    free(answer.clip.wav);
+    free(prompt.wav);
+}
+
+int main(void)
+{
+    audio_harness_start(0);
+
+    test_fade_in();
+    test_stop();
+    test_preempt();
+
+    return test_finish("test_audio_fade");
+}
@@ -0,0 +1,342 @@
+// the audio pack, written by tools/audio_pack.py and read by audio_pack.c from a file-backed
+// partition image. every clip must come back byte for byte, in place on a 4 byte boundary,
+// whatever its length; the system clips must then be acquired from the mapping with no
+// littlefs read and no heap allocation. a corrupt header or index must be refused with the
+// mapping given back, and audio_pack.py list, which is meant to apply the same checks
+// before an image is flashed, must refuse the same images
+
+#include <glob.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "esp_partition.h"
+#include "esp_spi_flash.h"
+#include "audio_clip.h"
+#include "audio_io.h"
+#include "audio_pack.h"
+#include "alloc_count.h"
+#include "fake_partition.h"
+#include "test.h"
+#include "test_support.h"
+
+#define PACK_TOOL TEST_PYTHON " " TEST_REPO_DIR "/tools/audio_pack.py"
+
+static const char *dir = NULL;
+
+static int run_tool(const char *command, const char *args)
+{
+    char line[16384];
+    snprintf(line, sizeof(line), "%s %s %s >/dev/null 2>&1", PACK_TOOL, command, args);
+
+    return system(line);
+}
+
+// packs paths into dir/name, returns the image
+static uint8_t *build_pack(const char *name, char **paths, int count, size_t *len)
+{
+    char args[16384];
+    int n = snprintf(args, sizeof(args), "'%s/%s'", dir, name);
+    for (int i = 0; i < count; i++)
+    {
+        n += snprintf(&args[n], sizeof(args) - n, " '%s'", paths[i]);
+    }
+    REQUIRE(n < (int)sizeof(args));
+    REQUIRE(run_tool("build", args) == 0);
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+
+    return test_read_file(path, len);
+}
+
+static int list_pack(const uint8_t *image, size_t len)
+{
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/listed.bin", dir);
+    REQUIRE(test_write_file(path, image, len) == 0);
+
+    char args[1100];
+    snprintf(args, sizeof(args), "'%s'", path);
+
+    return run_tool("list", args);
+}
+
+// where the firmware sees the partition, to tell where its clips sit in the mapping
+static const uint8_t *mapping_of(const char *label)
+{
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    REQUIRE(partition != NULL);
+
+    const void *mapped = NULL;
+    spi_flash_mmap_handle_t handle;
+    REQUIRE(esp_partition_mmap(partition, 0, partition->size, SPI_FLASH_MMAP_DATA, &mapped, &handle) == ESP_OK);
+    spi_flash_munmap(handle);
+
+    return mapped;
+}
+
+// each clip found by its file name, as the file, in place and aligned
+static void check_clips(const char *label, char **paths, int count)
+{
+    const uint8_t *base = mapping_of(label);
+
+    for (int i = 0; i < count; i++)
+    {
+        char name[AUDIO_PACK_NAME_LEN];
+        const char *file = strrchr(paths[i], '/') + 1;
+        snprintf(name, sizeof(name), "%.*s", (int)(strlen(file) - strlen(".wav")), file);
+
+        size_t len = 0;
+        uint8_t *wav = test_read_file(paths[i], &len);
+        REQUIRE(wav != NULL);
+
+        const uint8_t *buf = NULL;
+        int found_len = 0;
+        CHECK_ESP_OK(audio_pack_find(name, &buf, &found_len));
+        CHECK_EQ_INT(found_len, len);
+        CHECK(buf != NULL && memcmp(buf, wav, len) == 0);
+        CHECK_EQ_INT((buf - base) % AUDIO_PACK_ALIGN, 0);
+
+        free(wav);
+    }
+}
+
+static void test_masters(void)
+{
+    glob_t masters;
+    REQUIRE(glob(TEST_REPO_DIR "/audio_source_files/*.wav", 0, NULL, &masters) == 0);
+
+    size_t len = 0;
+    uint8_t *image = build_pack("masters.bin", masters.gl_pathv, masters.gl_pathc, &len);
+    REQUIRE(image != NULL);
+    CHECK_EQ_INT(list_pack(image, len), 0);
+
+    CHECK_ESP_OK(fake_partition_register("masters", image, len));
+    CHECK_ESP_OK(audio_pack_open("masters"));
+    CHECK_EQ_INT(audio_pack_clip_count(), masters.gl_pathc);
+    check_clips("masters", masters.gl_pathv, masters.gl_pathc);
+
+    const uint8_t *buf = NULL;
+    int found_len = 0;
+    CHECK_EQ_INT(audio_pack_find("welcome_to_tutor_fish", &buf, &found_len), ESP_ERR_NOT_FOUND);
+    CHECK_EQ_INT(audio_pack_find("welcome_to_tutor_fish_01.wav", &buf, &found_len), ESP_ERR_NOT_FOUND);
+
+    REPORT("%zu masters: %zu byte pack", masters.gl_pathc, len);
+
+    free(image);
+    globfree(&masters);
+}
+
+// the system clips at lengths 2 bytes either side of the alignment, then played from the
+// pack through the clip table
+static void test_system_clips(void)
+{
+    char *paths[AUDIO_CLIP_MAX];
+    int count = 0;
+
+    for (int id = 0; id < AUDIO_CLIP_MAX; id++)
+    {
+        if (audio_clip_path(id) == NULL)
+        {
+            continue;
+        }
+
+        // an odd sample count leaves the wav 2 bytes off a 4 byte boundary
+        const int samples_count = 1000 + 37 * id + (id & 1);
+        int16_t *samples = malloc(samples_count * sizeof(int16_t));
+        test_tone(samples, samples_count, 300 + 40 * id, AUDIO_SAMPLE_RATE, 12000);
+
+        size_t len = 0;
+        uint8_t *wav = test_wav_pcm(samples, samples_count, AUDIO_SAMPLE_RATE, 1, &len);
+
+        paths[count] = malloc(1024);
+        snprintf(paths[count], 1024, "%s/%s.wav", dir, audio_clip_name(id));
+        REQUIRE(test_write_file(paths[count], wav, len) == 0);
+        count++;
+
+        free(wav);
+        free(samples);
+    }
+    REQUIRE(count > 1);
+
+    size_t len = 0;
+    uint8_t *image = build_pack("system.bin", paths, count, &len);
+    REQUIRE(image != NULL);
+
+    CHECK_ESP_OK(fake_partition_register("audio", image, len));
+    CHECK_ESP_OK(audio_pack_open("audio"));
+    CHECK_EQ_INT(audio_pack_clip_count(), count);
+    check_clips("audio", paths, count);
+
+    // littlefs is an empty directory, a clip not from the pack would fail to load
+    test_audio_fs_root(test_temp_dir("empty_fs"));
+    CHECK_ESP_OK(init_audio_clips());
+    CHECK(audio_clip_pack_loaded());
+
+    const uint8_t *base = mapping_of("audio");
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "audio");
+
+    alloc_count_reset();
+    for (int id = 0; id < AUDIO_CLIP_MAX; id++)
+    {
+        if (audio_clip_path(id) == NULL)
+        {
+            continue;
+        }
+
+        const audio_clip_t *clip = NULL;
+        CHECK_ESP_OK(audio_clip_acquire(id, &clip));
+        CHECK(clip != NULL && clip->buf >= base && clip->buf + clip->len <= base + partition->size);
+        audio_clip_release(clip);
+    }
+
+    alloc_count_t allocs;
+    alloc_count_get(&allocs);
+    CHECK_EQ_INT(allocs.allocations, 0);
+
+    REPORT("%d system clips acquired from the pack, %zu allocations", count, allocs.allocations);
+
+    for (int i = 0; i < count; i++)
+    {
+        free(paths[i]);
+    }
+    free(image);
+}
+
+typedef struct
+{
+    const char *what;
+    size_t at;      // byte offset into the image
+    uint32_t value; // written there, little-endian
+    esp_err_t expect;
+} corruption_t;
+
+static void put_u32(uint8_t *image, size_t at, uint32_t value)
+{
+    memcpy(&image[at], &value, sizeof(value));
+}
+
+static void put_u16(uint8_t *image, size_t at, uint16_t value)
+{
+    memcpy(&image[at], &value, sizeof(value));
+}
+
+static void test_corrupt(void)
+{
+    size_t len = 0;
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/system.bin", dir);
+    uint8_t *good = test_read_file(path, &len);
+    REQUIRE(good != NULL);
+
+    audio_pack_header_t header;
+    memcpy(&header, good, sizeof(header));
+
+    const size_t entry = sizeof(audio_pack_header_t); // the first index entry
+    const size_t offset_at = entry + offsetof(audio_pack_entry_t, offset);
+    const size_t len_at = entry + offsetof(audio_pack_entry_t, len);
+    const size_t index_end = sizeof(header) + header.clip_count * sizeof(audio_pack_entry_t);
+    const size_t partition_size = (len + 4095) / 4096 * 4096;
+
+    const corruption_t corruptions[] = {
+        {"bad magic", offsetof(audio_pack_header_t, magic), 0x50414655, ESP_ERR_NOT_FOUND},
+        {"pack longer than the partition", offsetof(audio_pack_header_t, pack_len), partition_size + 4, ESP_ERR_INVALID_VERSION},
+        {"pack shorter than its index", offsetof(audio_pack_header_t, pack_len), index_end - 4, ESP_ERR_INVALID_VERSION},
+        {"clip inside the index", offset_at, index_end - 4, ESP_ERR_INVALID_SIZE},
+        {"clip past the pack", offset_at, header.pack_len + 8, ESP_ERR_INVALID_SIZE},
+        {"clip offset near 4 GB", offset_at, 0xfffffff0, ESP_ERR_INVALID_SIZE},
+        {"clip running off the pack", len_at, header.pack_len, ESP_ERR_INVALID_SIZE},
+        {"clip length near 4 GB", len_at, 0xffffffff, ESP_ERR_INVALID_SIZE},
+    };
+
+    uint8_t *image = malloc(len);
+
+    for (size_t i = 0; i < sizeof(corruptions) / sizeof(corruptions[0]); i++)
+    {
+        const corruption_t *c = &corruptions[i];
+        memcpy(image, good, len);
+        put_u32(image, c->at, c->value);
+
+        CHECK_ESP_OK(fake_partition_register("corrupt", image, len));
+        const esp_err_t err = audio_pack_open("corrupt");
+        if (err != c->expect)
+        {
+            fprintf(stderr, "%s: %s\n", c->what, esp_err_to_name(err));
+        }
+        CHECK_EQ_INT(err, c->expect);
+        CHECK_EQ_INT(fake_partition_mapped("corrupt"), 0);
+        CHECK(list_pack(image, len) != 0);
+    }
+
+    // a name without its nul, a version from the future, erased flash
+    memcpy(image, good, len);
+    memset(&image[entry], 'a', AUDIO_PACK_NAME_LEN);
+    CHECK_ESP_OK(fake_partition_register("corrupt", image, len));
+    CHECK_EQ_INT(audio_pack_open("corrupt"), ESP_ERR_INVALID_SIZE);
+    CHECK_EQ_INT(fake_partition_mapped("corrupt"), 0);
+    CHECK(list_pack(image, len) != 0);
+
+    memcpy(image, good, len);
+    put_u16(image, offsetof(audio_pack_header_t, version), AUDIO_PACK_VERSION + 1);
+    CHECK_ESP_OK(fake_partition_register("corrupt", image, len));
+    CHECK_EQ_INT(audio_pack_open("corrupt"), ESP_ERR_INVALID_VERSION);
+    CHECK(list_pack(image, len) != 0);
+
+    memset(image, 0xff, len);
+    CHECK_ESP_OK(fake_partition_register("corrupt", image, len));
+    CHECK_EQ_INT(audio_pack_open("corrupt"), ESP_ERR_NOT_FOUND);
+    CHECK(list_pack(image, len) != 0);
+
+    // a refused pack leaves the one already open in place
+    const uint8_t *buf = NULL;
+    int found_len = 0;
+    CHECK_ESP_OK(audio_pack_find(audio_clip_name(AUDIO_CLIP_CONFIRM_SFX_04), &buf, &found_len));
+
+    fake_partition_unregister("corrupt");
+    free(image);
+    free(good);
+}
+
+// the builder refuses what the index cannot hold
+static void test_builder(void)
+{
+    int16_t samples[100] = {0};
+    size_t len = 0;
+    uint8_t *wav = test_wav_pcm(samples, 100, AUDIO_SAMPLE_RATE, 1, &len);
+
+    char long_name[1024];
+    snprintf(long_name, sizeof(long_name), "%s/%0*d.wav", dir, AUDIO_PACK_NAME_LEN, 0);
+    REQUIRE(test_write_file(long_name, wav, len) == 0);
+
+    // the same name from two directories
+    char first[1024], second[1024];
+    snprintf(first, sizeof(first), "%s/ok.wav", dir);
+    REQUIRE(test_write_file(first, wav, len) == 0);
+    snprintf(second, sizeof(second), "%s/again", dir);
+    REQUIRE(mkdir(second, 0755) == 0);
+    strcat(second, "/ok.wav");
+    REQUIRE(test_write_file(second, wav, len) == 0);
+
+    char args[4096];
+    snprintf(args, sizeof(args), "'%s/bad.bin' '%s/%0*d.wav'", dir, dir, AUDIO_PACK_NAME_LEN, 0);
+    CHECK(run_tool("build", args) != 0);
+    snprintf(args, sizeof(args), "'%s/bad.bin' '%s' '%s'", dir, first, second);
+    CHECK(run_tool("build", args) != 0);
+
+    free(wav);
+}
+
+int main(void)
+{
+    dir = test_temp_dir("audio_pack");
+    REQUIRE(dir != NULL);
+
+    test_masters();
+    test_system_clips();
+    test_corrupt();
+    test_builder();
+
+    return test_finish("test_audio_pack");
+}
@@ -0,0 +1,174 @@
+// the number words of audio_phrase.c and the completion announcement built on them. the
+// clip sequence is checked twice: as composed, and as heard, by the pitch the harness gives
+// each system clip. 0% and 100% have no words and are not announced. after the first
+// announcement the number clips stay in the cache, the next ones load nothing
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "audio_io.h"
+#include "audio_phrase.h"
+#include "audio_harness.h"
+#include "fake_i2s.h"
+#include "test.h"
+
+#define CLIP_MS (400)
+#define CLIP_SAMPLES (AUDIO_SAMPLE_RATE / 1000 * CLIP_MS)
+#define FILE_SIZE (1000)
+
+typedef struct
+{
+    int percentage;
+    int count;
+    audio_clip_id_t clips[3];
+} expected_t;
+
+static const expected_t expected[] = {
+    {0, 0, {0}},
+    {5, 2, {AUDIO_CLIP_ASCII_5_00, AUDIO_CLIP_PERCENT_COMPLETED_00}},
+    {45, 3, {AUDIO_CLIP_40_00, AUDIO_CLIP_ASCII_5_00, AUDIO_CLIP_PERCENT_COMPLETED_00}},
+    {99, 3, {AUDIO_CLIP_90_00, AUDIO_CLIP_ASCII_5_00, AUDIO_CLIP_PERCENT_COMPLETED_00}},
+    {100, 0, {0}},
+};
+
+#define EXPECTED_COUNT (sizeof(expected) / sizeof(expected[0]))
+
+static void test_numbers(void)
+{
+    audio_clip_id_t clips[AUDIO_PHRASE_MAX_CLIPS];
+
+    CHECK_EQ_INT(audio_phrase_number(-5, clips, AUDIO_PHRASE_MAX_CLIPS), 0);
+    CHECK_EQ_INT(audio_phrase_number(4, clips, AUDIO_PHRASE_MAX_CLIPS), 0);
+    CHECK_EQ_INT(audio_phrase_number(250, clips, AUDIO_PHRASE_MAX_CLIPS), 0);
+
+    CHECK_EQ_INT(audio_phrase_number(10, clips, AUDIO_PHRASE_MAX_CLIPS), 1);
+    CHECK_EQ_INT(clips[0], AUDIO_CLIP_10_00);
+    CHECK_EQ_INT(audio_phrase_number(14, clips, AUDIO_PHRASE_MAX_CLIPS), 1);
+    CHECK_EQ_INT(clips[0], AUDIO_CLIP_10_00);
+
+    // cut short by the room given
+    CHECK_EQ_INT(audio_phrase_number(75, clips, 1), 1);
+    CHECK_EQ_INT(clips[0], AUDIO_CLIP_70_00);
+}
+
+static void test_compose(void)
+{
+    static const audio_clip_id_t phrase[] = {AUDIO_PHRASE_VALUE, AUDIO_CLIP_PERCENT_COMPLETED_00};
+
+    for (size_t i = 0; i < EXPECTED_COUNT; i++)
+    {
+        audio_clip_id_t clips[AUDIO_PHRASE_MAX_CLIPS];
+        const int count = audio_phrase_compose(phrase, 2, expected[i].percentage, clips, AUDIO_PHRASE_MAX_CLIPS);
+
+        CHECK_EQ_INT(count, expected[i].count);
+        for (int c = 0; c < count && c < expected[i].count; c++)
+        {
+            CHECK_EQ_INT(clips[c], expected[i].clips[c]);
+        }
+    }
+}
+
+// the harness tone of a clip is 300 + 40 * id Hz, counted by zero crossings over the middle
+// half of its slot in the gapless playlist
+static int clip_at(const int16_t *out, long start)
+{
+    const long from = start + CLIP_SAMPLES / 4;
+    const long len = CLIP_SAMPLES / 2;
+    int crossings = 0;
+
+    for (long i = from + 1; i < from + len; i++)
+    {
+        crossings += (out[i - 1] < 0) != (out[i] < 0);
+    }
+
+    const double hz = crossings / 2.0 * AUDIO_SAMPLE_RATE / len;
+
+    return (int)lrint((hz - 300) / 40);
+}
+
+// the clips heard for one announcement, returns their number
+static int announce(int percentage, audio_clip_id_t *heard, int max_heard)
+{
+    fake_i2s_reset();
+
+    const esp_err_t err = playback_completion_percentage(FILE_SIZE, FILE_SIZE * percentage / 100.0f, false);
+    CHECK_EQ_INT(err, percentage >= 5 && percentage < 100 ? ESP_OK : ESP_ERR_INVALID_ARG);
+
+    // queued for the request task, wait for it to start playing
+    for (int waited = 0; waited < 1000 && !audio_player_is_playing(); waited += 10)
+    {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    CHECK_ESP_OK(audio_harness_wait_idle(10000));
+
+    size_t out_count = 0;
+    const int16_t *out = fake_i2s_tx_samples(&out_count);
+    const long start = audio_harness_find_sound(out, out_count, 0);
+    if (start < 0)
+    {
+        return 0;
+    }
+
+    // the recording ends with the last clip when the dma buffers are small, the middle of
+    // its slot is enough
+    int count = 0;
+    for (long at = start - 1; at + CLIP_SAMPLES * 3 / 4 <= (long)out_count && count < max_heard; at += CLIP_SAMPLES)
+    {
+        const int id = clip_at(out, at);
+        if (id < 0 || id >= AUDIO_CLIP_MAX)
+        {
+            break;
+        }
+        heard[count++] = id;
+    }
+
+    return count;
+}
+
+static void test_heard(void)
+{
+    for (size_t i = 0; i < EXPECTED_COUNT; i++)
+    {
+        audio_clip_id_t heard[AUDIO_PHRASE_MAX_CLIPS];
+        const int count = announce(expected[i].percentage, heard, AUDIO_PHRASE_MAX_CLIPS);
+
+        CHECK_EQ_INT(count, expected[i].count);
+        for (int c = 0; c < count && c < expected[i].count; c++)
+        {
+            CHECK_EQ_INT(heard[c], expected[i].clips[c]);
+        }
+
+        REPORT("%3d%%: %d clips heard", expected[i].percentage, count);
+    }
+}
+
+// every number clip of 45 and 99 was used above, the second round loads none of them
+static void test_resident(void)
+{
+    audio_clip_cache_stats_t before;
+    audio_clip_cache_stats_t after;
+    audio_clip_id_t heard[AUDIO_PHRASE_MAX_CLIPS];
+
+    audio_clip_cache_stats(&before);
+    CHECK_EQ_INT(announce(45, heard, AUDIO_PHRASE_MAX_CLIPS), 3);
+    CHECK_EQ_INT(announce(95, heard, AUDIO_PHRASE_MAX_CLIPS), 3);
+    audio_clip_cache_stats(&after);
+
+    // "percent completed" is not kept resident, it may be loaded again
+    CHECK(after.misses - before.misses <= 2);
+    CHECK(after.hits - before.hits >= 4);
+}
+
+int main(void)
+{
+    audio_harness_start(CLIP_MS);
+
+    test_numbers();
+    test_compose();
+    test_heard();
+    test_resident();
+
+    return test_finish("test_audio_phrase");
+}
@@ -0,0 +1,293 @@
+// the streaming player against the fake i2s dma: what reaches the speaker must be the clip
+// sample for sample once the fade-in is over, a producer slower than real time must show
+// up as underruns and a fast one must not, and playing must not allocate
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "audio_player.h"
+#include "audio_dsp.h"
+#include "audio_harness.h"
+#include "fake_i2s.h"
+#include "alloc_count.h"
+#include "test.h"
+#include "test_support.h"
+
+// the fade-in ramp reaches full gain one sample after AUDIO_FADE_IN_SAMPLES
+#define FADE_END (AUDIO_FADE_IN_SAMPLES + 1)
+
+static int16_t *random_clip(int count, unsigned seed)
+{
+    int16_t *samples = malloc(count * sizeof(int16_t));
+
+    srand(seed);
+    for (int i = 0; i < count; i++)
+    {
+        samples[i] = (int16_t)(rand() % 32768 - 16384);
+    }
+
+    // loud enough that the first faded sample is not scaled to zero
+    samples[0] = 16000;
+
+    return samples;
+}
+
+static long played_since(size_t mark, const int16_t **out, size_t *count)
+{
+    *out = fake_i2s_tx_samples(count);
+
+    return audio_harness_find_sound(*out, *count, mark);
+}
+
+// compares the output with the clip from where it starts, returns the first mismatch
+static long compare_output(const int16_t *out, size_t count, long start, const int16_t *clip, int clip_len, int from)
+{
+    if (start < 0 || (size_t)start + clip_len > count)
+    {
+        return 0;
+    }
+
+    for (int i = from; i < clip_len; i++)
+    {
+        if (out[start + i] != clip[i])
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static void test_sample_exact(void)
+{
+    const int count = AUDIO_SAMPLE_RATE * 3 / 2;
+    int16_t *clip = random_clip(count, 1);
+    size_t wav_len = 0;
+    uint8_t *wav = test_wav_pcm(clip, count, AUDIO_SAMPLE_RATE, 1, &wav_len);
+
+    size_t mark = 0;
+    fake_i2s_tx_samples(&mark);
+
+    audio_source_t source;
+    audio_mem_source_t mem;
+    audio_source_memory(&source, &mem, wav, wav_len);
+
+    alloc_count_reset();
+    CHECK_ESP_OK(audio_player_play(&source, 1.0f, false, AUDIO_PRIORITY_PROMPT));
+    CHECK_ESP_OK(audio_harness_wait_idle(5000));
+
+    alloc_count_t allocs;
+    alloc_count_get(&allocs);
+    REPORT("mono clip of %d samples: %zu bytes allocated while playing", count, allocs.peak_bytes);
+    CHECK_EQ_INT(allocs.peak_bytes, 0);
+
+    const int16_t *out;
+    size_t out_count;
+    const long start = played_since(mark, &out, &out_count);
+    REQUIRE(start >= 0);
+
+    // the fade only ever lowers the level
+    for (int i = 0; i < FADE_END; i++)
+    {
+        CHECK(abs(out[start + i]) <= abs(clip[i]));
+    }
+
+    CHECK_EQ_INT(compare_output(out, out_count, start, clip, count, FADE_END), -1);
+
+    // and silence after the clip
+    CHECK_EQ_INT(audio_harness_find_sound(out, out_count, start + count), -1);
+
+    free(wav);
+    free(clip);
+}
+
+// stereo frames are averaged to the mono bus
+static void test_stereo(void)
+{
+    const int frames = AUDIO_SAMPLE_RATE / 2;
+    int16_t *interleaved = random_clip(frames * 2, 2);
+    int16_t *expected = malloc(frames * sizeof(int16_t));
+
+    interleaved[0] = interleaved[1] = 16000;
+    for (int i = 0; i < frames; i++)
+    {
+        expected[i] = (interleaved[2 * i] + interleaved[2 * i + 1]) / 2;
+    }
+
+    size_t wav_len = 0;
+    uint8_t *wav = test_wav_pcm(interleaved, frames * 2, AUDIO_SAMPLE_RATE, 2, &wav_len);
+
+    size_t mark = 0;
+    fake_i2s_tx_samples(&mark);
+
+    audio_source_t source;
+    audio_mem_source_t mem;
+    audio_source_memory(&source, &mem, wav, wav_len);
+
+    CHECK_ESP_OK(audio_player_play(&source, 1.0f, false, AUDIO_PRIORITY_PROMPT));
+    CHECK_ESP_OK(audio_harness_wait_idle(5000));
+
+    const int16_t *out;
+    size_t out_count;
+    const long start = played_since(mark, &out, &out_count);
+    REQUIRE(start >= 0);
+    CHECK_EQ_INT(compare_output(out, out_count, start, expected, frames, FADE_END), -1);
+
+    free(wav);
+    free(expected);
+    free(interleaved);
+}
+
+// two files written as one stream play back to back with no gap and no second fade
+static void test_playlist(void)
+{
+    const int first_len = AUDIO_SAMPLE_RATE / 3 + 7; // ends part way through a block
+    const int second_len = AUDIO_SAMPLE_RATE / 2;
+    int16_t *first = random_clip(first_len, 3);
+    int16_t *second = random_clip(second_len, 4);
+    size_t first_wav_len = 0, second_wav_len = 0;
+    uint8_t *first_wav = test_wav_pcm(first, first_len, AUDIO_SAMPLE_RATE, 1, &first_wav_len);
+    uint8_t *second_wav = test_wav_pcm(second, second_len, AUDIO_SAMPLE_RATE, 1, &second_wav_len);
+
+    int16_t *expected = malloc((first_len + second_len) * sizeof(int16_t));
+    memcpy(expected, first, first_len * sizeof(int16_t));
+    memcpy(&expected[first_len], second, second_len * sizeof(int16_t));
+
+    size_t mark = 0;
+    fake_i2s_tx_samples(&mark);
+
+    CHECK_ESP_OK(audio_player_begin(1.0f, false, AUDIO_PRIORITY_PROMPT, NULL));
+    audio_player_next_clip();
+    CHECK_EQ_INT(audio_player_write(first_wav, first_wav_len), first_wav_len);
+    audio_player_next_clip();
+    CHECK_EQ_INT(audio_player_write(second_wav, second_wav_len), second_wav_len);
+    audio_player_end();
+    CHECK_ESP_OK(audio_harness_wait_idle(5000));
+
+    const int16_t *out;
+    size_t out_count;
+    const long start = played_since(mark, &out, &out_count);
+    REQUIRE(start >= 0);
+    CHECK_EQ_INT(compare_output(out, out_count, start, expected, first_len + second_len, FADE_END), -1);
+
+    free(expected);
+    free(second_wav);
+    free(first_wav);
+    free(second);
+    free(first);
+}
+
+// feeds a clip at rate_percent of real time, returns the player's and the dma's underruns
+static void stream_at_rate(int rate_percent, uint32_t *underruns, uint32_t *stale)
+{
+    const int count = AUDIO_SAMPLE_RATE * 2;
+    const int chunk = 256; // 16 ms
+    int16_t *clip = random_clip(count, 5);
+    size_t wav_len = 0;
+    uint8_t *wav = test_wav_pcm(clip, count, AUDIO_SAMPLE_RATE, 1, &wav_len);
+
+    audio_player_stats_t before, after;
+    fake_i2s_stats_t dma_before, dma_after;
+    audio_player_stats(&before);
+    fake_i2s_stats(&dma_before);
+
+    CHECK_ESP_OK(audio_player_begin(1.0f, false, AUDIO_PRIORITY_PROMPT, NULL));
+    audio_player_next_clip();
+    CHECK_EQ_INT(audio_player_write(wav, 44), 44);
+
+    const double start = test_now_s();
+    for (int pos = 0; pos < count; pos += chunk)
+    {
+        const int n = pos + chunk <= count ? chunk : count - pos;
+        CHECK_EQ_INT(audio_player_write(&wav[44 + pos * 2], n * 2), n * 2);
+
+        // the chunk's share of real time, scaled
+        const double due = start + (double)(pos + n) / AUDIO_SAMPLE_RATE * 100 / rate_percent;
+        while (rate_percent < 1000 && test_now_s() < due)
+        {
+            vTaskDelay(1);
+        }
+    }
+
+    audio_player_end();
+    CHECK_ESP_OK(audio_harness_wait_idle(10000));
+
+    audio_player_stats(&after);
+    fake_i2s_stats(&dma_after);
+    *underruns = after.underruns - before.underruns;
+    *stale = dma_after.stale_buffers - dma_before.stale_buffers;
+
+    free(wav);
+    free(clip);
+}
+
+static void test_underruns(void)
+{
+    uint32_t underruns, stale;
+
+    stream_at_rate(1000, &underruns, &stale);
+    REPORT("producer at 10x real time: %u underruns, %u stale dma buffers", underruns, stale);
+    CHECK_EQ_INT(underruns, 0);
+    CHECK_EQ_INT(stale, 0);
+
+    stream_at_rate(50, &underruns, &stale);
+    REPORT("producer at 0.5x real time: %u underruns, %u stale dma buffers", underruns, stale);
+    CHECK(underruns > 0);
+    CHECK(stale > 0);
+}
+
+// the first block plays as soon as it is written, not once the clip has been processed
+static void test_first_block_latency(void)
+{
+    const int count = AUDIO_SAMPLE_RATE * 2;
+    int16_t *clip = random_clip(count, 6);
+    size_t wav_len = 0;
+    uint8_t *wav = test_wav_pcm(clip, count, AUDIO_SAMPLE_RATE, 1, &wav_len);
+
+    fake_i2s_reset();
+
+    audio_playback_handle_t handle = 0;
+    CHECK_ESP_OK(audio_player_begin(1.0f, false, AUDIO_PRIORITY_PROMPT, &handle));
+    audio_player_next_clip();
+
+    // one block only, the rest is held back until the first has been handed to i2s
+    CHECK_EQ_INT(audio_player_write(wav, 44 + AUDIO_BLOCK_BYTES), 44 + AUDIO_BLOCK_BYTES);
+
+    fake_i2s_stats_t dma;
+    for (int i = 0; i < 100; i++)
+    {
+        fake_i2s_stats(&dma);
+        if (dma.first_write_us != 0)
+        {
+            break;
+        }
+        vTaskDelay(1);
+    }
+    CHECK(dma.first_write_us != 0);
+
+    CHECK(audio_player_write(&wav[44 + AUDIO_BLOCK_BYTES], wav_len - 44 - AUDIO_BLOCK_BYTES) > 0);
+    audio_player_end();
+    CHECK_ESP_OK(audio_player_wait(handle, pdMS_TO_TICKS(5000)));
+
+    audio_playback_info_t info;
+    CHECK_ESP_OK(audio_player_info(handle, &info));
+    REPORT("%d sample clip: first block to i2s %lld us after begin", count, (long long)(info.started_us - info.queued_us));
+
+    free(wav);
+    free(clip);
+}
+
+int main(void)
+{
+    audio_harness_start(0);
+
+    test_sample_exact();
+    test_stereo();
+    test_playlist();
+    test_underruns();
+    test_first_block_latency();
+
+    return test_finish("test_audio_player");
+}
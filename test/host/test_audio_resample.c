@@ -0,0 +1,360 @@
+// the polyphase resampler, at the rates tts services emit, into the 16 kHz bus. a tone is
+// fitted at the frequency it must come out at: up to 4.5 kHz (or 3/4 of a lower input
+// nyquist) its gain must be flat and what is left over (distortion, aliasing, rounding)
+// far below it; above the bus's nyquist it must be filtered out rather than folded back.
+// the 32 taps run at the input rate, so from 44.1 kHz up the transition band reaches past
+// 9 kHz and rejection there is only held to -20 dB, tts is served at 16-24 kHz. the
+// roll-off at 6 and 6.8 kHz is reported. the output must not depend on how the input was
+// split into blocks, and a 24 kHz clip played through the player must come out at its own
+// pitch and length. reported: host cycles per second of output audio per rate
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal/cpu_hal.h"
+#include "audio_resample.h"
+#include "audio_player.h"
+#include "audio_dsp.h"
+#include "audio_harness.h"
+#include "fake_i2s.h"
+#include "test.h"
+#include "test_support.h"
+
+#define SETTLE (AUDIO_RESAMPLE_TAPS * 2) // output samples skipped before fitting
+#define PASSBAND_HZ (4500)
+#define PASSBAND_RIPPLE_DB (0.5)
+#define PASSBAND_SNR_DB (50.0)
+#define STOPBAND_DB (-40.0)      // up to twice the bus rate
+#define STOPBAND_HIGH_DB (-20.0) // 44.1 and 48 kHz
+
+static const uint32_t rates[] = {8000, 11025, 22050, 24000, 32000, 44100, 48000};
+
+#define RATE_COUNT (sizeof(rates) / sizeof(rates[0]))
+
+// a steady tone, no ramps, at amplitude
+static void tone(int16_t *samples, int count, double freq_hz, uint32_t rate, double amplitude)
+{
+    for (int i = 0; i < count; i++)
+    {
+        samples[i] = (int16_t)lrint(amplitude * sin(2 * M_PI * freq_hz * i / rate));
+    }
+}
+
+// the whole input through the resampler in blocks of at most block samples, returns the count
+static int resample_all(audio_resampler_t *rs, const int16_t *in, int count, int16_t *out, int block)
+{
+    int n = 0;
+
+    for (int pos = 0; pos < count;)
+    {
+        const int len = count - pos < block ? count - pos : block;
+        n += audio_resample(rs, &in[pos], len, &out[n]);
+        pos += len;
+    }
+
+    return n;
+}
+
+typedef struct
+{
+    double amplitude;
+    double snr_db; // the fitted tone against everything else
+} fit_t;
+
+// least squares fit of a sine and cosine at freq_hz
+static fit_t fit_tone(const int16_t *y, int count, double freq_hz, uint32_t rate)
+{
+    double scc = 0, sss = 0, scs = 0, syc = 0, sys = 0, syy = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        const double c = cos(2 * M_PI * freq_hz * i / rate);
+        const double s = sin(2 * M_PI * freq_hz * i / rate);
+        scc += c * c;
+        sss += s * s;
+        scs += c * s;
+        syc += y[i] * c;
+        sys += y[i] * s;
+        syy += (double)y[i] * y[i];
+    }
+
+    const double det = scc * sss - scs * scs;
+    const double a = (syc * sss - sys * scs) / det;
+    const double b = (sys * scc - syc * scs) / det;
+
+    // the fitted tone's energy, the rest is the residual
+    const double fitted = a * syc + b * sys;
+    const double residual = syy - fitted > 0 ? syy - fitted : 0;
+
+    fit_t fit = {.amplitude = sqrt(a * a + b * b)};
+    fit.snr_db = residual > 0 ? 10 * log10(fitted / residual) : INFINITY;
+
+    return fit;
+}
+
+static double rms(const int16_t *y, int count)
+{
+    double sum = 0;
+    for (int i = 0; i < count; i++)
+    {
+        sum += (double)y[i] * y[i];
+    }
+
+    return sqrt(sum / count);
+}
+
+static void test_response(uint32_t in_rate)
+{
+    static const double freqs[] = {100, 440, 1000, 2000, 3000, 3500, 4000, 4500, 6000, 6800};
+    const int in_count = in_rate / 2;
+    const int out_max = in_count * AUDIO_SAMPLE_RATE / in_rate + AUDIO_RESAMPLE_MAX_OUT(AUDIO_SAMPLE_RATE);
+    int16_t *in = malloc(in_count * sizeof(int16_t));
+    int16_t *out = malloc(out_max * sizeof(int16_t));
+    audio_resampler_t *rs = malloc(sizeof(*rs));
+
+    const double amplitude = 16000;
+    double worst_gain_db = 0;
+    double worst_snr_db = INFINITY;
+    double edge_db[2] = {NAN, NAN}; // at 6 and 6.8 kHz
+
+    for (size_t f = 0; f < sizeof(freqs) / sizeof(freqs[0]); f++)
+    {
+        // both nyquist rates bound the passband, the input's with the filter's margin
+        if (freqs[f] > 0.75 * in_rate / 2)
+        {
+            continue;
+        }
+
+        tone(in, in_count, freqs[f], in_rate, amplitude);
+        CHECK_ESP_OK(audio_resampler_init(rs, in_rate, AUDIO_SAMPLE_RATE));
+        const int n = resample_all(rs, in, in_count, out, AUDIO_RESAMPLE_CHUNK);
+
+        // the filter's delay is a phase shift, which the fit absorbs
+        const fit_t fit = fit_tone(&out[SETTLE], n - SETTLE, freqs[f], AUDIO_SAMPLE_RATE);
+        const double gain_db = 20 * log10(fit.amplitude / amplitude);
+
+        CHECK(fit.snr_db >= PASSBAND_SNR_DB);
+
+        if (freqs[f] > PASSBAND_HZ)
+        {
+            edge_db[freqs[f] > 6000] = gain_db;
+            continue;
+        }
+
+        if (fabs(gain_db) > PASSBAND_RIPPLE_DB || fit.snr_db < PASSBAND_SNR_DB)
+        {
+            fprintf(stderr, "%u Hz in, %.0f Hz: gain %.2f dB, snr %.1f dB\n", in_rate, freqs[f], gain_db, fit.snr_db);
+        }
+        CHECK(fabs(gain_db) <= PASSBAND_RIPPLE_DB);
+
+        worst_gain_db = fabs(gain_db) > fabs(worst_gain_db) ? gain_db : worst_gain_db;
+        worst_snr_db = fit.snr_db < worst_snr_db ? fit.snr_db : worst_snr_db;
+    }
+
+    // above the bus's nyquist, tones that would otherwise fold back into the voice band
+    const double stopband_db = in_rate <= 2 * AUDIO_SAMPLE_RATE ? STOPBAND_DB : STOPBAND_HIGH_DB;
+    double worst_stop_db = -INFINITY;
+    for (double freq = 9500; freq < 0.95 * in_rate / 2; freq += 2500)
+    {
+        tone(in, in_count, freq, in_rate, amplitude);
+        CHECK_ESP_OK(audio_resampler_init(rs, in_rate, AUDIO_SAMPLE_RATE));
+        const int n = resample_all(rs, in, in_count, out, AUDIO_RESAMPLE_CHUNK);
+
+        const double level_db = 20 * log10((rms(&out[SETTLE], n - SETTLE) + 1e-9) / (amplitude / sqrt(2)));
+        if (level_db > stopband_db)
+        {
+            fprintf(stderr, "%u Hz in, %.0f Hz: %.1f dB through\n", in_rate, freq, level_db);
+        }
+        CHECK(level_db <= stopband_db);
+
+        worst_stop_db = level_db > worst_stop_db ? level_db : worst_stop_db;
+    }
+
+    // the output is as long as the input, give or take the filter's delay
+    CHECK_ESP_OK(audio_resampler_init(rs, in_rate, AUDIO_SAMPLE_RATE));
+    const int n = resample_all(rs, in, in_count, out, AUDIO_RESAMPLE_CHUNK);
+    const int expect = (int)((int64_t)in_count * AUDIO_SAMPLE_RATE / in_rate);
+    CHECK(abs(n - expect) <= AUDIO_RESAMPLE_TAPS);
+
+    if (in_rate > AUDIO_SAMPLE_RATE)
+    {
+        REPORT("%5u Hz: flat within %+.2f dB at >= %.1f dB snr, %+.2f dB at 6 kHz, %+.2f dB at 6.8 kHz, stopband %.1f dB",
+               in_rate, worst_gain_db, worst_snr_db, edge_db[0], edge_db[1], worst_stop_db);
+    }
+    else
+    {
+        REPORT("%5u Hz: flat within %+.2f dB at >= %.1f dB snr", in_rate, worst_gain_db, worst_snr_db);
+    }
+
+    free(rs);
+    free(out);
+    free(in);
+}
+
+// dc at unity and a full scale tone without wrapping
+static void test_levels(uint32_t in_rate)
+{
+    const int in_count = in_rate / 4;
+    const int out_max = in_count * AUDIO_SAMPLE_RATE / in_rate + AUDIO_RESAMPLE_MAX_OUT(AUDIO_SAMPLE_RATE);
+    int16_t *in = malloc(in_count * sizeof(int16_t));
+    int16_t *out = malloc(out_max * sizeof(int16_t));
+    audio_resampler_t *rs = malloc(sizeof(*rs));
+
+    for (int i = 0; i < in_count; i++)
+    {
+        in[i] = -20000;
+    }
+    CHECK_ESP_OK(audio_resampler_init(rs, in_rate, AUDIO_SAMPLE_RATE));
+    int n = resample_all(rs, in, in_count, out, AUDIO_RESAMPLE_CHUNK);
+
+    int worst = 0;
+    for (int i = SETTLE; i < n; i++)
+    {
+        worst = abs(out[i] - in[0]) > worst ? abs(out[i] - in[0]) : worst;
+    }
+    CHECK(worst <= 2);
+
+    tone(in, in_count, 1000, in_rate, 32767);
+    CHECK_ESP_OK(audio_resampler_init(rs, in_rate, AUDIO_SAMPLE_RATE));
+    n = resample_all(rs, in, in_count, out, AUDIO_RESAMPLE_CHUNK);
+    CHECK(fit_tone(&out[SETTLE], n - SETTLE, 1000, AUDIO_SAMPLE_RATE).snr_db >= PASSBAND_SNR_DB);
+
+    free(rs);
+    free(out);
+    free(in);
+}
+
+// block by block the stream is the same whatever the block sizes
+static void test_blocks(uint32_t in_rate)
+{
+    const int in_count = in_rate / 4 + 17;
+    const int out_max = in_count * AUDIO_SAMPLE_RATE / in_rate + AUDIO_RESAMPLE_MAX_OUT(AUDIO_SAMPLE_RATE);
+    int16_t *in = malloc(in_count * sizeof(int16_t));
+    int16_t *whole = malloc(out_max * sizeof(int16_t));
+    int16_t *pieces = malloc(out_max * sizeof(int16_t));
+    audio_resampler_t *rs = malloc(sizeof(*rs));
+
+    test_tone(in, in_count, 1234, in_rate, 20000);
+
+    CHECK_ESP_OK(audio_resampler_init(rs, in_rate, AUDIO_SAMPLE_RATE));
+    const int n = resample_all(rs, in, in_count, whole, AUDIO_RESAMPLE_CHUNK);
+
+    CHECK_ESP_OK(audio_resampler_init(rs, in_rate, AUDIO_SAMPLE_RATE));
+    int m = 0;
+    for (int pos = 0, i = 0; pos < in_count; i++)
+    {
+        int len = 1 + (i * 37) % AUDIO_RESAMPLE_CHUNK;
+        len = len < in_count - pos ? len : in_count - pos;
+        m += audio_resample(rs, &in[pos], len, &pieces[m]);
+        pos += len;
+    }
+
+    CHECK_EQ_INT(m, n);
+    CHECK(m == n && memcmp(whole, pieces, n * sizeof(int16_t)) == 0);
+
+    free(rs);
+    free(pieces);
+    free(whole);
+    free(in);
+}
+
+static void bench_throughput(uint32_t in_rate)
+{
+    const int in_count = in_rate * 2;
+    const int out_max = in_count * AUDIO_SAMPLE_RATE / in_rate + AUDIO_RESAMPLE_MAX_OUT(AUDIO_SAMPLE_RATE);
+    int16_t *in = malloc(in_count * sizeof(int16_t));
+    int16_t *out = malloc(out_max * sizeof(int16_t));
+    audio_resampler_t *rs = malloc(sizeof(*rs));
+
+    test_tone(in, in_count, 800, in_rate, 20000);
+    CHECK_ESP_OK(audio_resampler_init(rs, in_rate, AUDIO_SAMPLE_RATE));
+
+    uint64_t cycles = 0;
+    int n = 0;
+    for (int pos = 0; pos < in_count; pos += AUDIO_RESAMPLE_CHUNK)
+    {
+        const int len = in_count - pos < AUDIO_RESAMPLE_CHUNK ? in_count - pos : AUDIO_RESAMPLE_CHUNK;
+        const uint32_t start = cpu_hal_get_cycle_count();
+        n += audio_resample(rs, &in[pos], len, &out[n]);
+        cycles += (uint32_t)(cpu_hal_get_cycle_count() - start);
+    }
+
+    REPORT("%5u Hz: %.2f M host cycles per second of output", in_rate, (double)cycles / n * AUDIO_SAMPLE_RATE / 1e6);
+
+    free(rs);
+    free(out);
+    free(in);
+}
+
+// a 24 kHz clip through the player: the wav header picks the resampler, the tone keeps its
+// pitch and the clip its length on the 16 kHz bus
+static void test_player(void)
+{
+    const uint32_t rate = 24000;
+    const int count = rate; // one second
+    int16_t *samples = malloc(count * sizeof(int16_t));
+    tone(samples, count, 1000, rate, 12000);
+
+    size_t len = 0;
+    uint8_t *wav = test_wav_pcm(samples, count, rate, 1, &len);
+
+    fake_i2s_reset();
+    audio_source_t source;
+    audio_mem_source_t mem;
+    audio_source_memory(&source, &mem, wav, len);
+    CHECK_ESP_OK(audio_player_play(&source, 1.0f, false, AUDIO_PRIORITY_ANSWER));
+    CHECK_ESP_OK(audio_harness_wait_idle(5000));
+
+    size_t out_count = 0;
+    const int16_t *out = fake_i2s_tx_samples(&out_count);
+    const long start = audio_harness_find_sound(out, out_count, 0);
+    REQUIRE(start >= 0);
+
+    long end = out_count;
+    while (end > start && out[end - 1] == 0)
+    {
+        end--;
+    }
+
+    const long played = end - start;
+    CHECK(labs(played - AUDIO_SAMPLE_RATE) <= AUDIO_RESAMPLE_TAPS);
+
+    // between the fades
+    const int from = AUDIO_FADE_IN_SAMPLES + SETTLE;
+    const fit_t fit = fit_tone(&out[start + from], played - 2 * from, 1000, AUDIO_SAMPLE_RATE);
+    CHECK(fit.snr_db >= 40.0);
+    CHECK(fabs(20 * log10(fit.amplitude / 12000)) <= PASSBAND_RIPPLE_DB);
+
+    REPORT("24 kHz clip through the player: %ld samples at 16 kHz, 1 kHz tone at %.1f dB snr", played, fit.snr_db);
+
+    free(wav);
+    free(samples);
+}
+
+int main(void)
+{
+    audio_resampler_t rs;
+
+    // unsupported rates are refused, the bus rate passes straight through
+    CHECK_EQ_INT(audio_resampler_init(&rs, 4000, AUDIO_SAMPLE_RATE), ESP_ERR_NOT_SUPPORTED);
+    CHECK_EQ_INT(audio_resampler_init(&rs, 96000, AUDIO_SAMPLE_RATE), ESP_ERR_NOT_SUPPORTED);
+    CHECK_ESP_OK(audio_resampler_init(&rs, AUDIO_SAMPLE_RATE, AUDIO_SAMPLE_RATE));
+    CHECK(!audio_resampler_active(&rs));
+
+    for (size_t i = 0; i < RATE_COUNT; i++)
+    {
+        test_response(rates[i]);
+        test_levels(rates[i]);
+        test_blocks(rates[i]);
+    }
+
+    for (size_t i = 0; i < RATE_COUNT; i++)
+    {
+        bench_throughput(rates[i]);
+    }
+
+    audio_harness_start(0);
+    test_player();
+
+    return test_finish("test_audio_resample");
+}
@@ -0,0 +1,454 @@
+// the spoken question's voice detector (audio_vad.c) and recording (audio_capture.c). the
+// speech fixture is a prompt master from audio_source_files, a real voice, between stretches
+// of the microphone's background hiss; the hiss fixture is white noise stepping up from that
+// background to loud. checked: the onset and end frames against where the master's voice
+// begins and ends, no onset at all in hiss, the capture block size's ima-adpcm round trip,
+// and the wav audio_capture_question() leaves: its header, sample count and data length for
+// a question trimmed to its speech, and for one that starts at once, so its preroll is
+// clipped at sample 0, and runs past AUDIO_CAPTURE_MAX_SPEECH_MS, so it ends in a short
+// block. the recordings are fed through the fake i2s in real time
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "audio_adpcm.h"
+#include "audio_capture.h"
+#include "audio_vad.h"
+#include "audio_wav.h"
+#include "audio_player.h"
+#include "audio_harness.h"
+#include "fake_i2s.h"
+#include "test.h"
+#include "test_support.h"
+
+#define MASTER "look_at_your_question_01"
+#define MIN_SNR_DB (20.0) // as for the prompts, tools/audio_assets.py
+#define HISS_AMPLITUDE (60)
+#define LEAD_MS (1000)
+#define TRAIL_MS (1500)
+#define LOOPS (3)          // past AUDIO_CAPTURE_MAX_SPEECH_MS
+#define CUT_LEAD_MS (160)  // the microphone settling and 100 ms of hiss
+
+// audio_capture.c's recording parameters
+#define BLOCK (256)
+#define BLOCK_SAMPLES AUDIO_ADPCM_BLOCK_SAMPLES(BLOCK)
+#define WAV_HEADER (60)
+#define SETTLE_SAMPLES (AUDIO_SAMPLE_RATE / 1000 * 60)
+#define PREROLL_SAMPLES (AUDIO_SAMPLE_RATE / 1000 * 200)
+#define TAIL_SAMPLES (AUDIO_SAMPLE_RATE / 1000 * 200)
+#define MAX_SPEECH_SAMPLES (AUDIO_SAMPLE_RATE / 1000 * AUDIO_CAPTURE_MAX_SPEECH_MS)
+
+#define MS_SAMPLES(ms) (AUDIO_SAMPLE_RATE / 1000 * (ms))
+
+typedef struct
+{
+    int16_t *samples;
+    int count;
+} fixture_t;
+
+static uint32_t lcg = 18;
+
+static int16_t noise(int amplitude)
+{
+    lcg = lcg * 1103515245u + 12345u;
+
+    return (int16_t)((int)((lcg >> 16) % (2 * amplitude + 1)) - amplitude);
+}
+
+static fixture_t read_master(void)
+{
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/audio_source_files/%s.wav", TEST_REPO_DIR, MASTER);
+
+    size_t len = 0;
+    uint8_t *data = test_read_file(path, &len);
+    REQUIRE(data != NULL);
+
+    audio_wav_parser_t parser;
+    size_t consumed = 0;
+    audio_wav_parser_init(&parser);
+    REQUIRE(audio_wav_parse(&parser, data, len, &consumed) == ESP_OK && parser.state == AUDIO_WAV_STATE_DATA);
+    REQUIRE(parser.fmt.format == AUDIO_WAV_FORMAT_PCM && parser.fmt.sample_rate == AUDIO_SAMPLE_RATE);
+    REQUIRE(parser.fmt.channels == 1 && parser.fmt.bits_per_sample == 16);
+
+    fixture_t master;
+    master.count = MIN(parser.fmt.data_len, len - consumed) / sizeof(int16_t);
+    master.samples = malloc(master.count * sizeof(int16_t));
+    memcpy(master.samples, &data[consumed], master.count * sizeof(int16_t));
+    free(data);
+
+    return master;
+}
+
+// the master between stretches of background hiss
+static fixture_t speech_fixture(const fixture_t *master, int lead_ms, int trail_ms)
+{
+    const int lead = MS_SAMPLES(lead_ms);
+    fixture_t f = {.count = lead + master->count + MS_SAMPLES(trail_ms)};
+
+    f.samples = malloc(f.count * sizeof(int16_t));
+    for (int i = 0; i < f.count; i++)
+    {
+        f.samples[i] = noise(HISS_AMPLITUDE);
+    }
+    for (int i = 0; i < master->count; i++)
+    {
+        f.samples[lead + i] += master->samples[i];
+    }
+
+    return f;
+}
+
+// hiss growing louder a second at a time, up to wind on the microphone
+static fixture_t hiss_fixture(void)
+{
+    static const int amplitudes[] = {HISS_AMPLITUDE, 500, 2000, 8000};
+    const int step = MS_SAMPLES(1000);
+    fixture_t f = {.count = step * 4};
+
+    f.samples = malloc(f.count * sizeof(int16_t));
+    for (int i = 0; i < f.count; i++)
+    {
+        f.samples[i] = noise(amplitudes[i / step]);
+    }
+
+    return f;
+}
+
+static int32_t frame_level(const int16_t *frame)
+{
+    int32_t sum = 0;
+    for (int i = 0; i < AUDIO_VAD_FRAME_SAMPLES; i++)
+    {
+        sum += abs(frame[i]);
+    }
+
+    return sum / AUDIO_VAD_FRAME_SAMPLES;
+}
+
+typedef struct
+{
+    int onsets;
+    int ends;
+    int onset_frame; // of the first onset, -1 for none
+    int end_frame;   // of the first end
+} vad_run_t;
+
+static vad_run_t run_vad(const int16_t *samples, int count)
+{
+    vad_run_t run = {.onset_frame = -1, .end_frame = -1};
+    audio_vad_t vad;
+    audio_vad_init(&vad);
+
+    for (int frame = 0; (frame + 1) * AUDIO_VAD_FRAME_SAMPLES <= count; frame++)
+    {
+        const audio_vad_result_t result = audio_vad_process(&vad, &samples[frame * AUDIO_VAD_FRAME_SAMPLES], AUDIO_VAD_FRAME_SAMPLES);
+
+        if (result == AUDIO_VAD_ONSET)
+        {
+            run.onset_frame = run.onsets++ == 0 ? frame : run.onset_frame;
+        }
+        else if (result == AUDIO_VAD_END)
+        {
+            run.end_frame = run.ends++ == 0 ? frame : run.end_frame;
+        }
+    }
+
+    return run;
+}
+
+// speech starts AUDIO_VAD_ONSET_FRAMES into the voice and ends AUDIO_VAD_HANGOVER_FRAMES
+// after it, the voice being the frames of the master above AUDIO_VAD_MIN_LEVEL
+static void test_speech_frames(const fixture_t *master)
+{
+    fixture_t f = speech_fixture(master, LEAD_MS, TRAIL_MS);
+    const int lead_frames = MS_SAMPLES(LEAD_MS) / AUDIO_VAD_FRAME_SAMPLES;
+
+    int first_voice = -1;
+    int last_voice = -1;
+    for (int frame = 0; (frame + 1) * AUDIO_VAD_FRAME_SAMPLES <= master->count; frame++)
+    {
+        if (frame_level(&master->samples[frame * AUDIO_VAD_FRAME_SAMPLES]) > AUDIO_VAD_MIN_LEVEL)
+        {
+            first_voice = first_voice < 0 ? frame : first_voice;
+            last_voice = frame;
+        }
+    }
+    REQUIRE(first_voice >= 0);
+
+    const vad_run_t run = run_vad(f.samples, f.count);
+
+    CHECK_EQ_INT(run.onsets, 1);
+    CHECK_EQ_INT(run.ends, 1);
+
+    // an unvoiced start is only counted once the voice follows it
+    const int onset_expected = lead_frames + first_voice + AUDIO_VAD_ONSET_FRAMES - 1;
+    CHECK(run.onset_frame >= onset_expected && run.onset_frame <= onset_expected + 3);
+
+    // quieter unvoiced frames after the voice keep the speech going a little
+    const int end_expected = lead_frames + last_voice + AUDIO_VAD_HANGOVER_FRAMES;
+    CHECK(run.end_frame >= end_expected && run.end_frame <= end_expected + 5);
+
+    REPORT("speech: voice in frames %d-%d, onset at frame %d, end at frame %d", lead_frames + first_voice,
+           lead_frames + last_voice, run.onset_frame, run.end_frame);
+
+    free(f.samples);
+}
+
+static void test_hiss(void)
+{
+    fixture_t f = hiss_fixture();
+    const vad_run_t run = run_vad(f.samples, f.count);
+
+    CHECK_EQ_INT(run.onsets, 0);
+    CHECK_EQ_INT(run.ends, 0);
+
+    free(f.samples);
+}
+
+// SNR of decoded against reference
+static double snr_db(const int16_t *reference, const int16_t *decoded, int count)
+{
+    double signal = 0;
+    double noise_power = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        signal += (double)reference[i] * reference[i];
+        noise_power += (double)(decoded[i] - reference[i]) * (decoded[i] - reference[i]);
+    }
+
+    return noise_power > 0 ? 10 * log10(signal / noise_power) : INFINITY;
+}
+
+// the master encoded at the capture block size with the step index carried between blocks
+static void test_adpcm_roundtrip(const fixture_t *master)
+{
+    uint8_t block[BLOCK];
+    int16_t *decoded = malloc((master->count + 1) * sizeof(int16_t));
+    int32_t index = 0;
+    int count = 0;
+
+    for (int start = 0; start < master->count; start += BLOCK_SAMPLES)
+    {
+        const int n = MIN(master->count - start, BLOCK_SAMPLES);
+        const int len = audio_adpcm_encode_block(&master->samples[start], n, &index, block);
+
+        CHECK(len == BLOCK || (start + n == master->count && len == AUDIO_ADPCM_BLOCK_HEADER + n / 2));
+        count += audio_adpcm_decode_block(block, len, &decoded[count]);
+    }
+
+    // a short last block with an even sample count decodes one padding sample
+    CHECK(count == master->count || count == master->count + 1);
+
+    const double snr = snr_db(master->samples, decoded, master->count);
+    CHECK(snr >= MIN_SNR_DB);
+
+    REPORT("adpcm at %d byte blocks: SNR %.1f dB", BLOCK, snr);
+
+    free(decoded);
+}
+
+// what the microphone hears once the bus starts
+typedef struct
+{
+    const fixture_t *fixture;
+    int pos;
+} rx_feed_t;
+
+static void feed_rx(void *ctx, int16_t *buf, int samples)
+{
+    rx_feed_t *feed = ctx;
+
+    for (int i = 0; i < samples; i++)
+    {
+        buf[i] = feed->pos < feed->fixture->count ? feed->fixture->samples[feed->pos++] : noise(HISS_AMPLITUDE);
+    }
+}
+
+typedef struct
+{
+    uint32_t riff_len;
+    uint16_t format;
+    uint16_t block_align;
+    uint16_t block_samples;
+    uint32_t fact_samples;
+    uint32_t data_len;
+} capture_header_t;
+
+static uint32_t le32(const uint8_t *b)
+{
+    return b[0] | b[1] << 8 | b[2] << 16 | (uint32_t)b[3] << 24;
+}
+
+static uint16_t le16(const uint8_t *b)
+{
+    return b[0] | b[1] << 8;
+}
+
+static capture_header_t parse_header(const uint8_t *wav)
+{
+    CHECK(memcmp(wav, "RIFF", 4) == 0 && memcmp(&wav[8], "WAVE", 4) == 0);
+    CHECK(memcmp(&wav[12], "fmt ", 4) == 0 && memcmp(&wav[40], "fact", 4) == 0 && memcmp(&wav[52], "data", 4) == 0);
+
+    const capture_header_t h = {
+        .riff_len = le32(&wav[4]),
+        .format = le16(&wav[20]),
+        .block_align = le16(&wav[32]),
+        .block_samples = le16(&wav[38]),
+        .fact_samples = le32(&wav[48]),
+        .data_len = le32(&wav[56]),
+    };
+
+    return h;
+}
+
+// records the fixture, the recording seen by the vad starts after the microphone settled
+static int capture(const fixture_t *f, const uint8_t **wav)
+{
+    rx_feed_t feed = {.fixture = f};
+    fake_i2s_stats_t dma;
+
+    fake_i2s_reset();
+    fake_i2s_set_rx_source(feed_rx, &feed);
+    CHECK_ESP_OK(audio_capture_question());
+    fake_i2s_set_rx_source(NULL, NULL);
+
+    fake_i2s_stats(&dma);
+    CHECK_EQ_INT(dma.rx_overflows, 0);
+
+    return audio_capture_wav(wav);
+}
+
+// the decoded recording against the fixture from the sample it should start at
+static double recording_snr(const uint8_t *wav, int wav_len, const capture_header_t *h, const int16_t *from)
+{
+    int16_t *decoded = malloc((h->fact_samples + 1) * sizeof(int16_t));
+    int count = 0;
+
+    for (int pos = WAV_HEADER; pos < wav_len; pos += BLOCK)
+    {
+        count += audio_adpcm_decode_block(&wav[pos], MIN(BLOCK, wav_len - pos), &decoded[count]);
+    }
+    CHECK(count == (int)h->fact_samples || count == (int)h->fact_samples + 1);
+
+    const double snr = snr_db(from, decoded, h->fact_samples);
+    free(decoded);
+
+    return snr;
+}
+
+// trimmed to the blocks holding the preroll before the onset to the tail after the speech,
+// every block full
+static void test_capture_trimmed(const fixture_t *master)
+{
+    fixture_t f = speech_fixture(master, LEAD_MS, TRAIL_MS);
+    const int16_t *heard = &f.samples[SETTLE_SAMPLES];
+
+    // the same frames through the same vad
+    const vad_run_t run = run_vad(heard, f.count - SETTLE_SAMPLES);
+    REQUIRE(run.onset_frame >= 0 && run.end_frame > run.onset_frame);
+
+    const int onset = (run.onset_frame + 1 - AUDIO_VAD_ONSET_FRAMES) * AUDIO_VAD_FRAME_SAMPLES;
+    const int speech_end = (run.end_frame + 1 - AUDIO_VAD_HANGOVER_FRAMES) * AUDIO_VAD_FRAME_SAMPLES;
+    REQUIRE(onset > PREROLL_SAMPLES);
+
+    const int first_block = (onset - PREROLL_SAMPLES) / BLOCK_SAMPLES;
+    const int end_block = (speech_end + TAIL_SAMPLES + BLOCK_SAMPLES - 1) / BLOCK_SAMPLES;
+
+    const uint8_t *wav = NULL;
+    const int wav_len = capture(&f, &wav);
+    REQUIRE(wav_len > WAV_HEADER);
+
+    const capture_header_t h = parse_header(wav);
+    CHECK_EQ_INT(h.format, AUDIO_WAV_FORMAT_IMA_ADPCM);
+    CHECK_EQ_INT(h.block_align, BLOCK);
+    CHECK_EQ_INT(h.block_samples, BLOCK_SAMPLES);
+    CHECK_EQ_INT(h.fact_samples, (end_block - first_block) * BLOCK_SAMPLES);
+    CHECK_EQ_INT(h.data_len, (end_block - first_block) * BLOCK);
+    CHECK_EQ_INT(h.riff_len, WAV_HEADER - 8 + h.data_len);
+    CHECK_EQ_INT(wav_len, WAV_HEADER + h.data_len);
+
+    const double snr = recording_snr(wav, wav_len, &h, &heard[first_block * BLOCK_SAMPLES]);
+    CHECK(snr >= MIN_SNR_DB);
+
+    REPORT("trimmed question: blocks %d-%d of the recording, %u samples, %d bytes, SNR %.1f dB", first_block,
+           end_block - 1, h.fact_samples, wav_len, snr);
+
+    free(f.samples);
+}
+
+// speech 100 ms into the recording: the preroll would start before it, and the question
+// is cut at AUDIO_CAPTURE_MAX_SPEECH_MS in the middle of a block
+static void test_capture_cut(const fixture_t *master)
+{
+    fixture_t looped = {.count = master->count * LOOPS};
+    looped.samples = malloc(looped.count * sizeof(int16_t));
+    for (int i = 0; i < looped.count; i++)
+    {
+        looped.samples[i] = master->samples[i % master->count];
+    }
+
+    // the vad takes its noise floor from the first frame, a few frames of hiss come first
+    fixture_t f = speech_fixture(&looped, CUT_LEAD_MS, 0);
+    free(looped.samples);
+    const int16_t *heard = &f.samples[SETTLE_SAMPLES];
+
+    const vad_run_t run = run_vad(heard, f.count - SETTLE_SAMPLES);
+    REQUIRE(run.onset_frame >= 0);
+    REQUIRE(run.ends == 0);
+
+    const int onset = MAX((run.onset_frame + 1 - AUDIO_VAD_ONSET_FRAMES) * AUDIO_VAD_FRAME_SAMPLES, 0);
+    REQUIRE(onset < PREROLL_SAMPLES);
+
+    // recorded a frame at a time until the limit, all of it is kept
+    int recorded = (run.onset_frame + 1) * AUDIO_VAD_FRAME_SAMPLES;
+    while (recorded - onset < MAX_SPEECH_SAMPLES)
+    {
+        recorded += AUDIO_VAD_FRAME_SAMPLES;
+    }
+    const int partial_samples = recorded % BLOCK_SAMPLES;
+    REQUIRE(partial_samples > 0);
+
+    const uint8_t *wav = NULL;
+    const int wav_len = capture(&f, &wav);
+    REQUIRE(wav_len > WAV_HEADER);
+
+    const capture_header_t h = parse_header(wav);
+    CHECK_EQ_INT(h.fact_samples, recorded);
+    CHECK_EQ_INT(h.data_len, recorded / BLOCK_SAMPLES * BLOCK + AUDIO_ADPCM_BLOCK_HEADER + partial_samples / 2);
+    CHECK_EQ_INT(h.riff_len, WAV_HEADER - 8 + h.data_len);
+    CHECK_EQ_INT(wav_len, WAV_HEADER + h.data_len);
+
+    // from the first sample recorded
+    const double snr = recording_snr(wav, wav_len, &h, heard);
+    CHECK(snr >= MIN_SNR_DB);
+
+    REPORT("cut question: %u samples ending in a block of %d, %d bytes, SNR %.1f dB", h.fact_samples, partial_samples,
+           wav_len, snr);
+
+    free(f.samples);
+}
+
+int main(void)
+{
+    fixture_t master = read_master();
+
+    test_speech_frames(&master);
+    test_hiss();
+    test_adpcm_roundtrip(&master);
+
+    audio_harness_start(0);
+    REQUIRE(init_audio_capture() == ESP_OK);
+
+    test_capture_trimmed(&master);
+    test_capture_cut(&master);
+
+    free(master.samples);
+
+    return test_finish("test_audio_vad");
+}
@@ -0,0 +1,383 @@
+// camera_lifecycle.c against a fake sensor driver on a clock of its own. the driver keeps
+// what the esp32-camera driver and the OV5640 would: whether the sensor is powered, whether
+// its registers and the frame buffer are loaded, and the frames it streams, and fails the
+// test on a call the hardware would not take (registers written while powered down, a
+// stream on an unpowered sensor, a deinit under a running stream). every walk between two
+// states is checked for the calls it makes, the state it leaves the sensor in and the time
+// it takes, and a driver error at each step for the state it stops at.
+//
+// the submit question flow is replayed as main.c runs it, warm for the countdown prompt and
+// capture after it, against the old flow that powered the sensor up after the prompt and
+// kept its third frame. the costs are a model, not measured on the glasses: the init the
+// driver logs allocating the 629145 byte frame buffer and loading the registers over SCCB,
+// and a WQXGA jpeg frame at 7.5 fps
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "camera_lifecycle.h"
+#include "audio_wav.h"
+#include "test.h"
+#include "test_support.h"
+
+#define INIT_US (450000)   // frame buffer and registers
+#define DEINIT_US (20000)
+#define POWER_UP_US (10000) // out of PWDN, registers kept
+#define FRAME_US (133333)   // WQXGA jpeg at 7.5 fps
+#define OLD_KEPT_FRAME (3)  // the old flow uploaded the third frame after power up
+#define COUNTDOWN_CLIP TEST_REPO_DIR "/audio_source_files/taking_a_picture321_02.wav"
+
+typedef enum
+{
+    CALL_INIT,
+    CALL_DEINIT,
+    CALL_POWER_ON,
+    CALL_POWER_OFF,
+    CALL_STREAM_ON,
+    CALL_STREAM_OFF,
+    CALL_MAX
+} call_t;
+
+static struct
+{
+    int64_t now_us;
+    bool powered;
+    bool loaded; // registers and frame buffer
+    bool streaming;
+    int64_t stream_start_us;
+    int inits;
+    int calls[CALL_MAX];
+    char sequence[64]; // the calls of the last walk, one letter each
+    call_t fail;       // the call that fails next, CALL_MAX for none
+} sensor;
+
+static void record(call_t call)
+{
+    static const char letters[CALL_MAX] = {'I', 'D', 'P', 'p', 'S', 's'};
+    const size_t len = strlen(sensor.sequence);
+
+    if (len + 1 < sizeof(sensor.sequence))
+    {
+        sensor.sequence[len] = letters[call];
+    }
+    sensor.calls[call]++;
+}
+
+static bool fails(call_t call)
+{
+    record(call);
+    if (sensor.fail == call)
+    {
+        sensor.fail = CALL_MAX;
+        return true;
+    }
+
+    return false;
+}
+
+static esp_err_t fake_init(void)
+{
+    // the registers are written over SCCB, the sensor must be out of PWDN
+    CHECK(sensor.powered);
+    CHECK(!sensor.loaded);
+    if (fails(CALL_INIT))
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    sensor.now_us += INIT_US;
+    sensor.loaded = true;
+    sensor.inits++;
+    return ESP_OK;
+}
+
+static esp_err_t fake_deinit(void)
+{
+    CHECK(sensor.loaded);
+    CHECK(!sensor.streaming);
+    if (fails(CALL_DEINIT))
+    {
+        return ESP_FAIL;
+    }
+
+    sensor.now_us += DEINIT_US;
+    sensor.loaded = false;
+    return ESP_OK;
+}
+
+static esp_err_t fake_power(bool on)
+{
+    CHECK(!sensor.streaming);
+    if (fails(on ? CALL_POWER_ON : CALL_POWER_OFF))
+    {
+        return ESP_FAIL;
+    }
+
+    sensor.now_us += on ? POWER_UP_US : 0;
+    sensor.powered = on;
+    return ESP_OK;
+}
+
+// frames are captured back to back from the start of the stream
+static int64_t next_frame_end(void)
+{
+    const int64_t streamed = sensor.now_us - sensor.stream_start_us;
+
+    return sensor.stream_start_us + (streamed / FRAME_US + 1) * FRAME_US;
+}
+
+static esp_err_t fake_stream(bool on)
+{
+    CHECK(sensor.powered && sensor.loaded);
+    CHECK(sensor.streaming != on);
+    if (fails(on ? CALL_STREAM_ON : CALL_STREAM_OFF))
+    {
+        return ESP_FAIL;
+    }
+
+    if (on)
+    {
+        sensor.stream_start_us = sensor.now_us;
+    }
+    else if (sensor.now_us > sensor.stream_start_us)
+    {
+        // camera_stream() waits for the frame in flight to be returned
+        sensor.now_us = next_frame_end();
+    }
+    sensor.streaming = on;
+    return ESP_OK;
+}
+
+static int64_t fake_now_us(void)
+{
+    return sensor.now_us;
+}
+
+static const camera_driver_t fake_driver = {
+    .init = fake_init,
+    .deinit = fake_deinit,
+    .power = fake_power,
+    .stream = fake_stream,
+    .now_us = fake_now_us,
+};
+
+static void sensor_reset(void)
+{
+    memset(&sensor, 0, sizeof(sensor));
+    sensor.now_us = 1000000;
+    sensor.fail = CALL_MAX;
+}
+
+// what the sensor must be doing in each state
+static void check_sensor(camera_state_t state)
+{
+    CHECK_EQ_INT(sensor.loaded, state != CAMERA_STATE_OFF);
+    CHECK_EQ_INT(sensor.powered, state >= CAMERA_STATE_WARM);
+    CHECK_EQ_INT(sensor.streaming, state == CAMERA_STATE_WARM);
+}
+
+static void walk_to(camera_lifecycle_t *cam, camera_state_t state)
+{
+    CHECK_ESP_OK(camera_lifecycle_set(cam, state));
+    CHECK_EQ_INT(cam->state, state);
+    check_sensor(state);
+}
+
+// the calls each walk makes, by the states it starts and ends in
+static const char *const walks[CAMERA_STATE_MAX][CAMERA_STATE_MAX] = {
+    [CAMERA_STATE_OFF] = {"", "PIp", "PIpPS", "PIpP"},
+    [CAMERA_STATE_STANDBY] = {"D", "", "PS", "P"},
+    [CAMERA_STATE_WARM] = {"spD", "sp", "", "s"},
+    [CAMERA_STATE_CAPTURE] = {"pD", "p", "S", ""},
+};
+
+static void test_walks(void)
+{
+    for (int from = 0; from < CAMERA_STATE_MAX; from++)
+    {
+        for (int to = 0; to < CAMERA_STATE_MAX; to++)
+        {
+            camera_lifecycle_t cam;
+
+            sensor_reset();
+            camera_lifecycle_init(&cam, &fake_driver);
+            walk_to(&cam, from);
+
+            const int inits = sensor.inits;
+            const int64_t entered_us = cam.entered_us;
+            const int64_t start_us = sensor.now_us;
+            memset(sensor.sequence, 0, sizeof(sensor.sequence));
+            sensor.now_us += 5000; // time spent in the state before
+
+            walk_to(&cam, to);
+            if (strcmp(sensor.sequence, walks[from][to]) != 0)
+            {
+                fprintf(stderr, "%s -> %s called %s, expected %s\n", camera_state_name(from), camera_state_name(to),
+                        sensor.sequence, walks[from][to]);
+                CHECK(false);
+            }
+
+            // the registers and frame buffer survive everything but off
+            CHECK_EQ_INT(sensor.inits - inits, from == CAMERA_STATE_OFF && to != CAMERA_STATE_OFF);
+
+            // a walk restarts the clock of the state, staying put does not
+            CHECK_EQ_INT(cam.entered_us, from == to ? entered_us : sensor.now_us);
+            CHECK(from != to || sensor.now_us == start_us + 5000);
+
+            // setting warm again keeps the stream it has
+            if (to == CAMERA_STATE_WARM)
+            {
+                const int stream_on = sensor.calls[CALL_STREAM_ON];
+                walk_to(&cam, CAMERA_STATE_WARM);
+                CHECK_EQ_INT(sensor.calls[CALL_STREAM_ON], stream_on);
+            }
+        }
+    }
+
+    camera_lifecycle_t cam;
+    sensor_reset();
+    camera_lifecycle_init(&cam, &fake_driver);
+    CHECK_EQ_INT(camera_lifecycle_set(&cam, CAMERA_STATE_MAX), ESP_ERR_INVALID_ARG);
+    CHECK_EQ_INT(cam.state, CAMERA_STATE_OFF);
+    CHECK(strcmp(camera_state_name(CAMERA_STATE_MAX), "?") == 0);
+}
+
+typedef struct
+{
+    camera_state_t from;
+    camera_state_t to;
+    call_t fail;
+    camera_state_t stops_at;
+    bool streaming; // after the error
+} failure_t;
+
+static const failure_t driver_errors[] = {
+    {CAMERA_STATE_OFF, CAMERA_STATE_STANDBY, CALL_POWER_ON, CAMERA_STATE_OFF, false},
+    {CAMERA_STATE_OFF, CAMERA_STATE_CAPTURE, CALL_INIT, CAMERA_STATE_OFF, false},
+    {CAMERA_STATE_STANDBY, CAMERA_STATE_WARM, CALL_POWER_ON, CAMERA_STATE_STANDBY, false},
+    {CAMERA_STATE_STANDBY, CAMERA_STATE_WARM, CALL_STREAM_ON, CAMERA_STATE_WARM, false},
+    {CAMERA_STATE_WARM, CAMERA_STATE_CAPTURE, CALL_STREAM_OFF, CAMERA_STATE_WARM, true},
+    {CAMERA_STATE_WARM, CAMERA_STATE_OFF, CALL_POWER_OFF, CAMERA_STATE_WARM, false},
+    {CAMERA_STATE_STANDBY, CAMERA_STATE_OFF, CALL_DEINIT, CAMERA_STATE_STANDBY, false},
+};
+
+// a driver error leaves the camera in the last state it reached, and the same call again
+// carries on from there
+static void test_driver_errors(void)
+{
+    // the errors are the point, and this runs last
+    esp_log_level_set("camera_lifecycle.c", ESP_LOG_NONE);
+
+    for (size_t i = 0; i < sizeof(driver_errors) / sizeof(driver_errors[0]); i++)
+    {
+        const failure_t *f = &driver_errors[i];
+        camera_lifecycle_t cam;
+
+        sensor_reset();
+        camera_lifecycle_init(&cam, &fake_driver);
+        walk_to(&cam, f->from);
+
+        sensor.fail = f->fail;
+        CHECK(camera_lifecycle_set(&cam, f->to) != ESP_OK);
+        CHECK_EQ_INT(cam.state, f->stops_at);
+        CHECK_EQ_INT(cam.streaming, f->streaming);
+        CHECK_EQ_INT(sensor.streaming, f->streaming);
+
+        // a failed init does not leave the sensor powered
+        if (f->fail == CALL_INIT)
+        {
+            CHECK(!sensor.powered);
+        }
+
+        const int inits = sensor.inits;
+        walk_to(&cam, f->to);
+        CHECK(sensor.inits - inits <= (f->stops_at == CAMERA_STATE_OFF ? 1 : 0));
+    }
+}
+
+static int64_t countdown_us(void)
+{
+    size_t len = 0;
+    uint8_t *wav = test_read_file(COUNTDOWN_CLIP, &len);
+    REQUIRE(wav != NULL);
+
+    audio_wav_parser_t parser;
+    size_t consumed = 0;
+    audio_wav_parser_init(&parser);
+    CHECK_ESP_OK(audio_wav_parse(&parser, wav, len, &consumed));
+    REQUIRE(parser.state == AUDIO_WAV_STATE_DATA);
+    free(wav);
+
+    const uint32_t bytes_per_s = parser.fmt.sample_rate * parser.fmt.channels * parser.fmt.bits_per_sample / 8;
+    return (int64_t)parser.fmt.data_len * 1000000 / bytes_per_s;
+}
+
+// main.c's submit flow: warm from standby as the countdown starts, capture when it ends,
+// standby after the picture. shutter is the end of the countdown, the picture is the first
+// frame camera_capture() gets once the stream has stopped
+static void test_submit_flow(void)
+{
+    const int64_t countdown = countdown_us();
+    const int offsets = 10;
+    int64_t worst = 0;
+    int64_t sum = 0;
+    int warm_frames = -1;
+
+    REPORT("countdown prompt: %d ms", (int)(countdown / 1000));
+
+    // the countdown ends anywhere in a frame, depending on the ms the audio took to start
+    for (int i = 0; i < offsets; i++)
+    {
+        camera_lifecycle_t cam;
+
+        sensor_reset();
+        camera_lifecycle_init(&cam, &fake_driver);
+        walk_to(&cam, CAMERA_STATE_STANDBY);
+        const int inits = sensor.inits;
+
+        const int64_t start_us = sensor.now_us;
+        walk_to(&cam, CAMERA_STATE_WARM);
+        CHECK(sensor.now_us - start_us <= POWER_UP_US);
+
+        sensor.now_us = start_us + countdown + FRAME_US * i / offsets;
+        const int64_t shutter_us = sensor.now_us;
+        const int streamed = (int)((sensor.now_us - sensor.stream_start_us) / FRAME_US);
+
+        walk_to(&cam, CAMERA_STATE_CAPTURE);
+        const int64_t picture_us = sensor.now_us + FRAME_US;
+        walk_to(&cam, CAMERA_STATE_STANDBY);
+
+        // no init in the flow, and the exposure had the whole countdown to settle
+        CHECK_EQ_INT(sensor.inits, inits);
+        warm_frames = warm_frames < 0 || streamed < warm_frames ? streamed : warm_frames;
+
+        const int64_t latency = picture_us - shutter_us;
+        worst = latency > worst ? latency : worst;
+        sum += latency;
+    }
+
+    // the frame in flight when the countdown ends and the next one
+    CHECK(worst <= 2 * FRAME_US);
+    CHECK(warm_frames >= 2);
+
+    // the old flow: power up after the prompt, keep the third frame, and a full deinit and
+    // init of the driver after a failed capture
+    const int64_t old_latency = POWER_UP_US + OLD_KEPT_FRAME * FRAME_US;
+    const int64_t old_retry = DEINIT_US + INIT_US;
+
+    REPORT("shutter to jpeg: mean %d ms, worst %d ms (a frame is %d ms), %d frames discarded while warm",
+           (int)(sum / offsets / 1000), (int)(worst / 1000), FRAME_US / 1000, warm_frames);
+    REPORT("old flow: %d ms, and %d ms to reinitialise after a failed capture", (int)(old_latency / 1000),
+           (int)(old_retry / 1000));
+    CHECK(worst < old_latency);
+}
+
+int main(void)
+{
+    test_walks();
+    test_submit_flow();
+    test_driver_errors();
+
+    return test_finish("test_camera_lifecycle");
+}
@@ -0,0 +1,364 @@
+// jpeg_quality.c's control law, replayed over frame size traces. the traces are not recorded
+// on the glasses, no log of the sensor's sizes per quality is kept in the repo: each is a
+// scene's WQXGA jpeg size at quality 10 frame by frame, turned into the size at the quality
+// the controller asks for by a model of the sensor, size ~ (10 / quality)^k. k is 1.0 as the
+// controller assumes, and 0.7 and 1.3 for a sensor whose sizes fall slower or faster, with a
+// few percent of frame to frame jitter. a frame that does not fit the 629145 byte frame
+// buffer is a failed fb get, as on the sensor. camera_capture()'s loop is replayed with its
+// limits, since camera.c itself needs the driver, to check a picture within the budget comes
+// out of the same capture attempt whatever quality it starts at
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "jpeg_quality.h"
+#include "test.h"
+
+#define FB_BYTES (629145) // the driver's WQXGA frame buffer, as it logs it
+#define FRAME_US (180000) // a WQXGA frame in good light
+#define TRACE_FRAMES (48)
+#define JITTER_PCT (6)
+#define SETTLED_FRAMES (5) // frames at the end of each part of a trace the quality must hold for
+
+// camera_capture()'s limits, static in camera.c
+#define CAMERA_BASE_JPG_QUALITY (6)
+#define CAMERA_WARMUP_FRAMES (2)
+#define CAMERA_MAX_FRAMES (8)
+#define CAMERA_BURST_FRAMES (3)
+#define CAMERA_MAX_FAILURES (5)
+
+typedef struct
+{
+    const char *name;
+    uint32_t bytes_at_10[2]; // the scene's size at quality 10, before and after frame `change`
+    int change;
+    uint32_t capture_us;
+} scene_t;
+
+// sized after camera.c's note that quality 4 fits the frame buffer in daylight, so a page
+// is at most ~250 KB at quality 10. the worksheet and the noisy low light page do not fit
+// at quality 4
+static const scene_t scenes[] = {
+    {"printed page", {220000, 220000}, TRACE_FRAMES, FRAME_US},
+    {"dense worksheet", {300000, 300000}, TRACE_FRAMES, FRAME_US},
+    {"blank desk", {60000, 60000}, TRACE_FRAMES, FRAME_US},
+    {"page, then worksheet", {200000, 320000}, 24, FRAME_US},
+    {"worksheet, then desk", {320000, 70000}, 24, FRAME_US},
+    {"low light page", {260000, 260000}, TRACE_FRAMES, 2000000},
+};
+
+static const double exponents[] = {0.7, 1.0, 1.3};
+
+static uint32_t jitter_state;
+
+// a few percent either way, the same sequence for every run
+static double jitter(void)
+{
+    jitter_state = jitter_state * 1103515245u + 12345u;
+
+    return 1.0 + ((int)((jitter_state >> 16) % (2 * JITTER_PCT + 1)) - JITTER_PCT) / 100.0;
+}
+
+static size_t frame_bytes(const scene_t *scene, int frame, int quality, double k)
+{
+    const uint32_t at_10 = scene->bytes_at_10[frame < scene->change ? 0 : 1];
+
+    return (size_t)(at_10 * pow(10.0 / quality, k) * jitter());
+}
+
+// every step the law takes is bounded, so a single odd frame cannot throw it to a limit
+static void check_step(int before, int after, bool failed)
+{
+    CHECK(after >= JPEG_QUALITY_MIN && after <= JPEG_QUALITY_MAX);
+
+    if (failed)
+    {
+        CHECK(after > before || before == JPEG_QUALITY_MAX);
+        CHECK(after <= (before * 4 / 3 > before ? before * 4 / 3 : before + 1));
+        return;
+    }
+
+    const int up = before * 3 / 2 > before + 1 ? before * 3 / 2 : before + 1;
+    const int down = before * 3 / 4 < before - 1 ? before * 3 / 4 : before - 1;
+    CHECK(after <= up && after >= down);
+}
+
+typedef struct
+{
+    int to_budget[2]; // frames from the start and from the scene change to one within the budget
+    int reversals;    // steps against the step before, once within the budget
+    int failures;
+    int quality[2];   // the quality each part of the trace ends on
+    int held[2];      // frames it held that quality for
+} run_t;
+
+static run_t run_trace(const scene_t *scene, double k, int quality)
+{
+    jpeg_quality_t ctl;
+    run_t run = {.to_budget = {-1, -1}};
+    int part = 0;
+    int start = 0;
+    int last_step = 0;
+    int changed = 0;
+
+    jitter_state = 7;
+    jpeg_quality_init(&ctl, quality, JPEG_QUALITY_TARGET_BYTES);
+
+    for (int frame = 0; frame < TRACE_FRAMES; frame++)
+    {
+        // a scene change is a new disturbance, the controller settles again
+        if (frame == scene->change)
+        {
+            run.quality[0] = ctl.quality;
+            run.held[0] = frame - changed;
+            part = 1;
+            start = frame;
+            last_step = 0;
+        }
+
+        const int before = ctl.quality;
+        const size_t len = frame_bytes(scene, frame, before, k);
+        const bool failed = len > FB_BYTES;
+
+        if (failed)
+        {
+            jpeg_quality_failed(&ctl);
+            run.failures++;
+        }
+        else
+        {
+            jpeg_quality_frame(&ctl, len, scene->capture_us);
+            if (run.to_budget[part] < 0 && jpeg_quality_within_budget(&ctl, len))
+            {
+                run.to_budget[part] = frame - start + 1;
+            }
+        }
+        check_step(before, ctl.quality, failed);
+
+        if (ctl.quality != before)
+        {
+            changed = frame + 1;
+        }
+        if (ctl.quality != before && run.to_budget[part] >= 0)
+        {
+            const int step = ctl.quality > before ? 1 : -1;
+            run.reversals += last_step != 0 && step != last_step;
+            last_step = step;
+        }
+    }
+
+    run.quality[part] = ctl.quality;
+    run.held[part] = TRACE_FRAMES - changed;
+    if (part == 0)
+    {
+        run.to_budget[1] = run.to_budget[0];
+        run.quality[1] = ctl.quality;
+        run.held[1] = run.held[0];
+    }
+    return run;
+}
+
+static void test_traces(void)
+{
+    REPORT("frames to the budget from quality %d and after the scene changes, failed fb gets, reversals, "
+           "settled qualities:",
+           CAMERA_BASE_JPG_QUALITY);
+
+    for (size_t s = 0; s < sizeof(scenes) / sizeof(scenes[0]); s++)
+    {
+        const scene_t *scene = &scenes[s];
+
+        for (size_t e = 0; e < sizeof(exponents) / sizeof(exponents[0]); e++)
+        {
+            const run_t run = run_trace(scene, exponents[e], CAMERA_BASE_JPG_QUALITY);
+
+            REPORT("  %-22s k %.1f: %2d, %2d frames, %d failed, %d reversals, quality %2d, %2d", scene->name,
+                   exponents[e], run.to_budget[0], run.to_budget[1], run.failures, run.reversals, run.quality[0],
+                   run.quality[1]);
+
+            // within the frames one capture may take
+            CHECK(run.to_budget[0] > 0 && run.to_budget[0] <= CAMERA_MAX_FRAMES);
+            CHECK(run.to_budget[1] > 0 && run.to_budget[1] <= CAMERA_MAX_FRAMES);
+
+            // the deadband is wider than the jitter and it settles. a sensor whose size falls
+            // faster than the law assumes overshoots a step at the edge of the deadband, and
+            // may hunt once before it holds
+            CHECK(run.held[0] >= SETTLED_FRAMES && run.held[1] >= SETTLED_FRAMES);
+            CHECK(run.reversals <= (exponents[e] > 1.0 ? 2 : 0));
+        }
+    }
+}
+
+// a frame too large for the frame buffer, a scene the quality was never steered for
+static void test_failed_frames(void)
+{
+    jpeg_quality_t ctl;
+    const scene_t *worksheet = &scenes[1];
+
+    jitter_state = 7;
+    jpeg_quality_init(&ctl, JPEG_QUALITY_MIN, JPEG_QUALITY_TARGET_BYTES);
+
+    int failures = 0;
+    while (frame_bytes(worksheet, 0, ctl.quality, 1.0) > FB_BYTES)
+    {
+        const int before = ctl.quality;
+        jpeg_quality_failed(&ctl);
+        check_step(before, ctl.quality, true);
+        failures++;
+    }
+    CHECK(failures > 0 && failures < CAMERA_MAX_FAILURES);
+    REPORT("dense worksheet from quality %d: %d failed fb gets before a frame fits at %d", JPEG_QUALITY_MIN, failures,
+           ctl.quality);
+
+    // at the coarsest a failure has nowhere to go
+    jpeg_quality_init(&ctl, JPEG_QUALITY_MAX, JPEG_QUALITY_TARGET_BYTES);
+    CHECK_EQ_INT(jpeg_quality_failed(&ctl), JPEG_QUALITY_MAX);
+}
+
+// camera_capture()'s loop over a trace: warm up frames steer but are dropped, burst frames
+// must be within the budget unless the capture is about to give up
+static bool replay_capture(const scene_t *scene, double k, int quality, int warm_frames, int *frames_taken)
+{
+    jpeg_quality_t ctl;
+    const int warmup = warm_frames < CAMERA_WARMUP_FRAMES ? CAMERA_WARMUP_FRAMES - warm_frames : 0;
+    int frames = 0;
+    int failures = 0;
+    int scored = 0;
+    bool kept = false;
+
+    jitter_state = 11;
+    jpeg_quality_init(&ctl, quality, JPEG_QUALITY_TARGET_BYTES);
+
+    while (scored < CAMERA_BURST_FRAMES && frames < CAMERA_MAX_FRAMES && failures < CAMERA_MAX_FAILURES)
+    {
+        const size_t len = frame_bytes(scene, frames + failures, ctl.quality, k);
+        if (len > FB_BYTES)
+        {
+            jpeg_quality_failed(&ctl);
+            failures++;
+            continue;
+        }
+
+        jpeg_quality_frame(&ctl, len, scene->capture_us);
+        frames++;
+        const bool last = frames == CAMERA_MAX_FRAMES || failures == CAMERA_MAX_FAILURES - 1;
+
+        if (frames <= warmup || !(jpeg_quality_within_budget(&ctl, len) || (last && !kept)))
+        {
+            continue;
+        }
+
+        // only a frame within the budget makes the picture on these traces
+        CHECK(jpeg_quality_within_budget(&ctl, len));
+        scored++;
+        kept = true;
+    }
+
+    *frames_taken = frames + failures;
+    return kept;
+}
+
+static void test_capture_attempt(void)
+{
+    static const int starts[] = {JPEG_QUALITY_MIN, CAMERA_BASE_JPG_QUALITY, 12, JPEG_QUALITY_MAX};
+
+    for (size_t s = 0; s < sizeof(scenes) / sizeof(scenes[0]); s++)
+    {
+        for (size_t q = 0; q < sizeof(starts) / sizeof(starts[0]); q++)
+        {
+            for (size_t e = 0; e < sizeof(exponents) / sizeof(exponents[0]); e++)
+            {
+                int frames = 0;
+                const bool kept = replay_capture(&scenes[s], exponents[e], starts[q], 0, &frames);
+                if (!kept)
+                {
+                    fprintf(stderr, "%s from quality %d at k %.1f: no picture after %d frames\n", scenes[s].name,
+                            starts[q], exponents[e], frames);
+                }
+                CHECK(kept);
+            }
+        }
+    }
+
+    // from the finest quality the worksheet overflows, the old path slept and asked again
+    int cold = 0;
+    int warm = 0;
+    CHECK(replay_capture(&scenes[1], 1.0, JPEG_QUALITY_MIN, 0, &cold));
+    CHECK(replay_capture(&scenes[1], 1.0, JPEG_QUALITY_MIN, CAMERA_WARMUP_FRAMES, &warm));
+    CHECK(warm <= cold);
+    REPORT("dense worksheet from quality %d: picture after %d frames, %d when the camera was warm", JPEG_QUALITY_MIN,
+           cold, warm);
+}
+
+// a slow capture counts like a large frame, a frame at the budget still goes coarser
+static void test_slow_capture(void)
+{
+    jpeg_quality_t ctl;
+
+    jpeg_quality_init(&ctl, 10, JPEG_QUALITY_TARGET_BYTES);
+    CHECK_EQ_INT(jpeg_quality_frame(&ctl, JPEG_QUALITY_TARGET_BYTES, FRAME_US), 10);
+    CHECK(jpeg_quality_frame(&ctl, JPEG_QUALITY_TARGET_BYTES, JPEG_QUALITY_SLOW_CAPTURE_US * 2) > 10);
+
+    // and stays at the coarsest while the light does not improve
+    for (int i = 0; i < TRACE_FRAMES; i++)
+    {
+        jpeg_quality_frame(&ctl, JPEG_QUALITY_TARGET_BYTES / 4, JPEG_QUALITY_SLOW_CAPTURE_US * 2);
+    }
+    CHECK_EQ_INT(ctl.quality, JPEG_QUALITY_MAX);
+}
+
+static void test_deadband_and_limits(void)
+{
+    jpeg_quality_t ctl;
+    const size_t target = JPEG_QUALITY_TARGET_BYTES;
+
+    // the edges of the deadband keep the quality, past them it moves in proportion
+    jpeg_quality_init(&ctl, 10, target);
+    CHECK_EQ_INT(jpeg_quality_frame(&ctl, target * (100 + JPEG_QUALITY_DEADBAND_PCT) / 100, 0), 10);
+    CHECK_EQ_INT(jpeg_quality_frame(&ctl, target * (100 - JPEG_QUALITY_DEADBAND_PCT) / 100, 0), 10);
+    CHECK_EQ_INT(jpeg_quality_frame(&ctl, target * 117 / 100, 0), 12);
+    jpeg_quality_init(&ctl, 10, target);
+    CHECK_EQ_INT(jpeg_quality_frame(&ctl, target * 80 / 100, 0), 8);
+
+    // and by one where the proportion rounds back to the same quality
+    jpeg_quality_init(&ctl, 4, target);
+    CHECK_EQ_INT(jpeg_quality_frame(&ctl, target * 120 / 100, 0), 5);
+
+    // a huge or an empty frame moves at most the bounded step
+    jpeg_quality_init(&ctl, 12, target);
+    CHECK_EQ_INT(jpeg_quality_frame(&ctl, target * 50, 0), 18);
+    jpeg_quality_init(&ctl, 12, target);
+    CHECK_EQ_INT(jpeg_quality_frame(&ctl, 1, 0), 9);
+
+    // and never past the limits
+    jpeg_quality_init(&ctl, JPEG_QUALITY_MAX, target);
+    CHECK_EQ_INT(jpeg_quality_frame(&ctl, target * 50, 0), JPEG_QUALITY_MAX);
+    jpeg_quality_init(&ctl, JPEG_QUALITY_MIN, target);
+    CHECK_EQ_INT(jpeg_quality_frame(&ctl, 1, 0), JPEG_QUALITY_MIN);
+
+    jpeg_quality_init(&ctl, 0, target);
+    CHECK_EQ_INT(ctl.quality, JPEG_QUALITY_MIN);
+    jpeg_quality_init(&ctl, 63, target);
+    CHECK_EQ_INT(ctl.quality, JPEG_QUALITY_MAX);
+
+    // the budget is the target and its deadband
+    const size_t edge = target * (100 + JPEG_QUALITY_DEADBAND_PCT) / 100;
+    CHECK(jpeg_quality_within_budget(&ctl, edge));
+    CHECK(!jpeg_quality_within_budget(&ctl, edge + 1));
+    CHECK(jpeg_quality_within_budget(&ctl, 0));
+
+    // sizes past 4 GB / 100 do not wrap into the budget
+    CHECK(!jpeg_quality_within_budget(&ctl, (size_t)UINT32_MAX));
+}
+
+int main(void)
+{
+    test_traces();
+    test_failed_frames();
+    test_capture_attempt();
+    test_slow_capture();
+    test_deadband_and_limits();
+
+    return test_finish("test_jpeg_quality");
+}
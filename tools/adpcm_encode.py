@@ -0,0 +1,242 @@
+#!/usr/bin/env python3
+"""Encode 16-bit PCM prompts as mono IMA-ADPCM wav files (format 0x11).
+
+The output is decoded again with the same algorithm as main/audio_adpcm.c and the
+SNR against the source is reported, so a bad encode is caught before it is flashed.
+
+    tools/adpcm_encode.py in.wav out.wav
+    tools/adpcm_encode.py submit_a_question_00.wav audio_source_files/submit_a_question_00.wav
+
+Inputs can be wav files or xxd style headers (`const uint8_t <name>_wav[] = {...}`),
+outputs are written in the format given by the output file extension.
+"""
+
+import argparse
+import math
+import os
+import re
+import struct
+import sys
+
+BLOCK_ALIGN = 512  # prompts may be mixed over other audio, which allows up to 512
+MAX_BLOCK_ALIGN = 1024  # AUDIO_ADPCM_MAX_BLOCK, the limit for streamed tts answers
+HEADER_LEN = 4
+
+
+def samples_per_block(block_align):
+    return 1 + (block_align - HEADER_LEN) * 2
+
+STEP_TABLE = [
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+    19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+    130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+    876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+    5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767]
+
+INDEX_TABLE = [-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8]
+
+
+def clamp(value, low, high):
+    return max(low, min(high, value))
+
+
+def step_diff(step, nibble):
+    diff = step >> 3
+    if nibble & 4:
+        diff += step
+    if nibble & 2:
+        diff += step >> 1
+    if nibble & 1:
+        diff += step >> 2
+    return diff
+
+
+def encode_sample(sample, predictor, index):
+    step = STEP_TABLE[index]
+    diff = sample - predictor
+    nibble = 0
+    if diff < 0:
+        nibble = 8
+        diff = -diff
+
+    if diff >= step:
+        nibble |= 4
+        diff -= step
+    if diff >= step >> 1:
+        nibble |= 2
+        diff -= step >> 1
+    if diff >= step >> 2:
+        nibble |= 1
+
+    delta = step_diff(step, nibble)
+    predictor = clamp(predictor - delta if nibble & 8 else predictor + delta, -32768, 32767)
+    index = clamp(index + INDEX_TABLE[nibble], 0, 88)
+
+    return nibble, predictor, index
+
+
+def decode_block(block):
+    predictor, index = struct.unpack_from("<hB", block)
+    index = min(index, 88)
+    out = [predictor]
+
+    for byte in block[HEADER_LEN:]:
+        for nibble in (byte & 0x0F, byte >> 4):
+            delta = step_diff(STEP_TABLE[index], nibble)
+            predictor = clamp(predictor - delta if nibble & 8 else predictor + delta, -32768, 32767)
+            index = clamp(index + INDEX_TABLE[nibble], 0, 88)
+            out.append(predictor)
+
+    return out
+
+
+def encode(samples, block_align=BLOCK_ALIGN):
+    blocks = []
+    index = 0
+    block_samples = samples_per_block(block_align)
+
+    for start in range(0, len(samples), block_samples):
+        chunk = samples[start:start + block_samples]
+        predictor = chunk[0]
+        block = bytearray(struct.pack("<hBB", predictor, index, 0))
+
+        nibbles = []
+        for sample in chunk[1:]:
+            nibble, predictor, index = encode_sample(sample, predictor, index)
+            nibbles.append(nibble)
+
+        # a short last block is padded to a whole byte
+        if len(nibbles) % 2:
+            nibbles.append(0)
+
+        for i in range(0, len(nibbles), 2):
+            block.append(nibbles[i] | nibbles[i + 1] << 4)
+
+        blocks.append(bytes(block))
+
+    return blocks
+
+
+def parse_wav(data):
+    if data[0:4] != b"RIFF" or data[8:12] != b"WAVE":
+        raise ValueError("not a RIFF/WAVE file")
+
+    fmt = None
+    pos = 12
+    while pos + 8 <= len(data):
+        chunk_id, size = struct.unpack_from("<4sI", data, pos)
+        body = data[pos + 8:pos + 8 + size]
+        if chunk_id == b"fmt ":
+            fmt = struct.unpack_from("<HHIIHH", body)
+        elif chunk_id == b"data":
+            if fmt is None:
+                raise ValueError("data chunk before fmt chunk")
+            audio_format, channels, rate, _, _, bits = fmt
+            if audio_format != 1 or bits != 16 or channels != 1:
+                raise ValueError("only 16-bit mono PCM input is supported")
+            count = len(body) // 2
+            return rate, list(struct.unpack("<%dh" % count, body[:count * 2]))
+        pos += 8 + size + (size & 1)
+
+    raise ValueError("no data chunk")
+
+
+def build_wav(rate, sample_count, blocks, block_align=BLOCK_ALIGN):
+    data = b"".join(blocks)
+    block_samples = samples_per_block(block_align)
+    byte_rate = rate * block_align // block_samples
+    fmt = struct.pack("<HHIIHHHH", 0x11, 1, rate, byte_rate, block_align, 4, 2, block_samples)
+    fact = struct.pack("<I", sample_count)
+
+    body = b"WAVE"
+    body += b"fmt " + struct.pack("<I", len(fmt)) + fmt
+    body += b"fact" + struct.pack("<I", len(fact)) + fact
+    body += b"data" + struct.pack("<I", len(data)) + data
+    if len(data) & 1:
+        body += b"\0"
+
+    return b"RIFF" + struct.pack("<I", len(body)) + body
+
+
+def read_header(path):
+    with open(path) as f:
+        text = f.read()
+
+    match = re.search(r"const uint8_t (\w+)_wav\[\] = \{(.*?)\};", text, re.S)
+    if match is None:
+        raise ValueError("%s is not an xxd style header" % path)
+
+    return match.group(1), bytes(int(b, 16) for b in re.findall(r"0x[0-9a-fA-F]{2}", match.group(2)))
+
+
+def write_header(path, name, data):
+    lines = ["const uint8_t %s_wav[] = {" % name]
+    for i in range(0, len(data), 12):
+        row = ", ".join("0x%02x" % b for b in data[i:i + 12])
+        lines.append("  " + row + ("," if i + 12 < len(data) else ""))
+    lines.append("};")
+    lines.append("const int %s_wav_len = %d;" % (name, len(data)))
+
+    with open(path, "w") as f:
+        f.write("\n".join(lines) + "\n")
+
+
+def snr_db(reference, decoded):
+    signal = sum(s * s for s in reference)
+    noise = sum((a - b) ** 2 for a, b in zip(reference, decoded))
+    if noise == 0:
+        return float("inf")
+    return 10 * math.log10(signal / noise) if signal else 0.0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", help="16-bit mono PCM .wav or xxd .h")
+    parser.add_argument("output", help=".wav or .h")
+    parser.add_argument("--min-snr", type=float, default=20.0, help="fail below this SNR in dB")
+    parser.add_argument("--block-align", type=int, default=BLOCK_ALIGN,
+                        help="bytes per block, up to %d for tts answers (default %d)" % (MAX_BLOCK_ALIGN, BLOCK_ALIGN))
+    args = parser.parse_args()
+
+    if not HEADER_LEN < args.block_align <= MAX_BLOCK_ALIGN:
+        parser.error("--block-align must be between %d and %d" % (HEADER_LEN + 1, MAX_BLOCK_ALIGN))
+
+    if args.input.endswith(".h"):
+        name, source = read_header(args.input)
+    else:
+        name = os.path.splitext(os.path.basename(args.input))[0]
+        with open(args.input, "rb") as f:
+            source = f.read()
+
+    rate, samples = parse_wav(source)
+    blocks = encode(samples, args.block_align)
+
+    decoded = []
+    for block in blocks:
+        decoded.extend(decode_block(block))
+    decoded = decoded[:len(samples)]
+
+    snr = snr_db(samples, decoded)
+    encoded = build_wav(rate, len(samples), blocks, args.block_align)
+
+    print("%s: %d -> %d bytes (%.1fx), SNR %.1f dB" % (name, len(source), len(encoded), len(source) / len(encoded), snr))
+
+    if snr < args.min_snr:
+        print("%s: SNR below %.1f dB, not written" % (name, args.min_snr), file=sys.stderr)
+        return 1
+
+    if args.output.endswith(".h"):
+        write_header(args.output, name, encoded)
+    else:
+        with open(args.output, "wb") as f:
+            f.write(encoded)
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,175 @@
+#!/usr/bin/env python3
+"""Build the firmware's audio clips from the wav files in audio_source_files.
+
+Run by main/CMakeLists.txt whenever a source wav or this tool changes. 16-bit PCM
+sources are normalised to a common peak level and, with --adpcm, compressed to
+IMA-ADPCM as tools/adpcm_encode.py does. Sources that are already compressed are
+used as they are. The clips are then written as either
+
+    embed  a binary blob linked into the app (_binary_audio_assets_bin_start) and a
+           header giving each clip's offset and length as constants, so the firmware
+           resolves embedded clips at compile time
+    pack   the audio pack image for the "audio" partition (tools/audio_pack.py). the pack
+           replaces the littlefs image there, so with --clip-table every clip the
+           firmware names in main/audio_clip.c must be among the inputs
+
+    tools/audio_assets.py embed --adpcm build/audio_assets.bin build/audio_assets.h audio_source_files/*.wav
+    tools/audio_assets.py pack --adpcm --clip-table main/audio_clip.c build/audio_pack.bin build/audio_assets.h \
+        audio_source_files/*.wav system_clips/*.wav
+
+The size of every clip is printed, so a clip that grew is seen in the build log.
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+import adpcm_encode
+import audio_pack
+
+WAV_FORMAT_PCM = 1
+NORMALIZE_DBFS = -1.0
+
+# the registry entries in main/audio_clip.c, not the macro definitions
+CLIP_ENTRY = re.compile(r"=\s*(?:EMBEDDED|LITTLEFS)_CLIP\((\w+)\)")
+
+
+def clip_table(path):
+    with open(path) as f:
+        return CLIP_ENTRY.findall(f.read())
+
+
+def build_pcm_wav(rate, samples):
+    data = struct.pack("<%dh" % len(samples), *samples)
+    fmt = struct.pack("<HHIIHH", WAV_FORMAT_PCM, 1, rate, rate * 2, 2, 16)
+
+    body = b"WAVE"
+    body += b"fmt " + struct.pack("<I", len(fmt)) + fmt
+    body += b"data" + struct.pack("<I", len(data)) + data
+
+    return b"RIFF" + struct.pack("<I", len(body)) + body
+
+
+def normalize(samples, dbfs):
+    peak = max((abs(s) for s in samples), default=0)
+    if peak == 0:
+        return samples
+
+    gain = 32767 * 10 ** (dbfs / 20) / peak
+    return [adpcm_encode.clamp(int(round(s * gain)), -32768, 32767) for s in samples]
+
+
+# returns the clip as it is stored and what was done to it
+def process(name, data, args):
+    audio_format, _, _ = audio_pack.wav_format(data)
+    if audio_format != WAV_FORMAT_PCM:
+        return data, "as is"
+
+    rate, samples = adpcm_encode.parse_wav(data)
+    if args.normalize is not None:
+        samples = normalize(samples, args.normalize)
+
+    if not args.adpcm:
+        return build_pcm_wav(rate, samples), "pcm"
+
+    blocks = adpcm_encode.encode(samples, args.block_align)
+    decoded = []
+    for block in blocks:
+        decoded.extend(adpcm_encode.decode_block(block))
+
+    snr = adpcm_encode.snr_db(samples, decoded[:len(samples)])
+    if snr < args.min_snr:
+        raise ValueError("%s: ADPCM SNR %.1f dB is below %.1f dB" % (name, snr, args.min_snr))
+
+    return adpcm_encode.build_wav(rate, len(samples), blocks, args.block_align), "adpcm %.1f dB" % snr
+
+
+def write_header(path, embedded, blob_len, index):
+    lines = [
+        "// generated by tools/audio_assets.py from audio_source_files, do not edit",
+        "#ifndef AUDIO_ASSETS_H__",
+        "#define AUDIO_ASSETS_H__",
+        "",
+        "#include <stdint.h>",
+        "",
+        "#define AUDIO_ASSETS_EMBEDDED (%d)" % embedded,
+    ]
+
+    if embedded:
+        lines += [
+            "#define AUDIO_ASSETS_SIZE (%d)" % blob_len,
+            "",
+            'extern const uint8_t audio_assets_start[] asm("_binary_audio_assets_bin_start");',
+            "",
+        ]
+        for name, offset, length in index:
+            lines.append("#define AUDIO_ASSET_OFFSET_%s (%d)" % (name, offset))
+            lines.append("#define AUDIO_ASSET_LEN_%s (%d)" % (name, length))
+
+    lines += ["", "#endif //AUDIO_ASSETS_H__", ""]
+
+    with open(path, "w") as f:
+        f.write("\n".join(lines))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("mode", choices=["embed", "pack"])
+    parser.add_argument("output", help="linked blob or audio pack image")
+    parser.add_argument("header", help="generated audio_assets.h")
+    parser.add_argument("inputs", nargs="+", help=".wav files, named as the firmware looks them up")
+    parser.add_argument("--normalize", type=float, default=NORMALIZE_DBFS, metavar="DBFS",
+                        help="peak level of pcm sources (default %.1f)" % NORMALIZE_DBFS)
+    parser.add_argument("--no-normalize", dest="normalize", action="store_const", const=None)
+    parser.add_argument("--adpcm", action="store_true", help="compress pcm sources to IMA-ADPCM")
+    parser.add_argument("--block-align", type=int, default=adpcm_encode.BLOCK_ALIGN)
+    parser.add_argument("--min-snr", type=float, default=20.0, help="fail below this ADPCM SNR in dB")
+    parser.add_argument("--clip-table", metavar="AUDIO_CLIP_C",
+                        help="fail unless every clip registered in this file is among the inputs")
+    args = parser.parse_args()
+
+    try:
+        if args.clip_table is not None:
+            names = set(name for name, _ in audio_pack.read_clips(args.inputs))
+            missing = [name for name in clip_table(args.clip_table) if name not in names]
+            if missing:
+                raise ValueError("%s: no source for %s" % (args.output, ", ".join(missing)))
+
+        clips = []
+        source_total = 0
+        print("%-40s %8s %8s  %s" % ("clip", "source", "stored", ""))
+        for name, data in sorted(audio_pack.read_clips(args.inputs)):
+            if args.mode == "embed" and not name.isidentifier():
+                raise ValueError("%s: embedded clip names must be C identifiers" % name)
+
+            stored, how = process(name, data, args)
+            clips.append((name, stored))
+            source_total += len(data)
+            print("%-40s %8d %8d  %s" % (name, len(data), len(stored), how))
+
+        if args.mode == "pack":
+            audio_pack.build(args.output, clips)
+            write_header(args.header, False, 0, [])
+            return 0
+
+        blob = b""
+        index = []
+        for name, data in clips:
+            index.append((name, len(blob), len(data)))
+            blob += data + b"\0" * (audio_pack.align(len(data)) - len(data))
+
+        with open(args.output, "wb") as f:
+            f.write(blob)
+        write_header(args.header, True, len(blob), index)
+
+        print("%s: %d clips, %d bytes linked into the app (%d bytes of source)" % (args.output, len(clips), len(blob), source_total))
+    except ValueError as e:
+        print(e, file=sys.stderr)
+        return 1
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+"""Build and inspect the audio pack written to the "audio" partition (main/audio_pack.h).
+
+The pack is a header, an index of clips (name, offset, length, wav format) and the
+clips' wav files on 4 byte boundaries. The firmware maps it with esp_partition_mmap
+and plays the clips in place, clips are found by their file name without .wav.
+
+    tools/audio_pack.py build audio_pack.bin system_audio/*.wav
+    tools/audio_pack.py list audio_pack.bin
+    parttool.py write_partition --partition-name audio --input audio_pack.bin
+
+The build writes the pack from audio_source_files with tools/audio_assets.py when
+AUDIO_ASSETS_MODE is "pack" (main/CMakeLists.txt) and flashes it with the app.
+
+list reads a pack or a dump of the whole partition and applies the same checks as
+audio_pack_open(), so an image can be verified before it is flashed.
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+MAGIC = 0x50414654  # "TFAP"
+VERSION = 1
+NAME_LEN = 48
+ALIGN = 4
+PARTITION_SIZE = 0x3DA000  # audio partition in partitions.csv
+
+HEADER = struct.Struct("<IHHII")
+ENTRY = struct.Struct("<%dsIIHHI" % NAME_LEN)
+
+
+def wav_format(data):
+    if data[0:4] != b"RIFF" or data[8:12] != b"WAVE":
+        raise ValueError("not a RIFF/WAVE file")
+
+    pos = 12
+    while pos + 8 <= len(data):
+        chunk_id, size = struct.unpack_from("<4sI", data, pos)
+        if chunk_id == b"fmt ":
+            audio_format, channels, rate = struct.unpack_from("<HHI", data, pos + 8)
+            return audio_format, channels, rate
+        pos += 8 + size + (size & 1)
+
+    raise ValueError("no fmt chunk")
+
+
+def align(value):
+    return (value + ALIGN - 1) // ALIGN * ALIGN
+
+
+def read_clips(inputs):
+    clips = []
+    for path in inputs:
+        name = os.path.splitext(os.path.basename(path))[0]
+        with open(path, "rb") as f:
+            clips.append((name, f.read()))
+    return clips
+
+
+def build(output, clips):
+    for i, (name, _) in enumerate(clips):
+        if len(name.encode()) >= NAME_LEN:
+            raise ValueError("%s: name longer than %d bytes" % (name, NAME_LEN - 1))
+        if any(name == other for other, _ in clips[:i]):
+            raise ValueError("%s: duplicate clip name" % name)
+
+    offset = align(HEADER.size + ENTRY.size * len(clips))
+    index = b""
+    body = b""
+
+    for name, data in clips:
+        audio_format, channels, rate = wav_format(data)
+        index += ENTRY.pack(name.encode(), offset + len(body), len(data), audio_format, channels, rate)
+        body += data + b"\0" * (align(len(data)) - len(data))
+
+    head = HEADER.size + len(index)
+    pack_len = offset + len(body)
+    image = HEADER.pack(MAGIC, VERSION, len(clips), pack_len, 0) + index + b"\0" * (offset - head) + body
+
+    if pack_len > PARTITION_SIZE:
+        raise ValueError("pack is %d bytes, the audio partition holds %d" % (pack_len, PARTITION_SIZE))
+
+    with open(output, "wb") as f:
+        f.write(image)
+
+    print("%s: %d clips, %d bytes (%.0f%% of the audio partition)" % (output, len(clips), pack_len, 100.0 * pack_len / PARTITION_SIZE))
+
+
+def read(path):
+    with open(path, "rb") as f:
+        image = f.read()
+
+    magic, version, clip_count, pack_len, _ = HEADER.unpack_from(image)
+    if magic != MAGIC:
+        raise ValueError("no audio pack in %s" % path)
+
+    index_end = HEADER.size + ENTRY.size * clip_count
+    if version != VERSION or pack_len > min(len(image), PARTITION_SIZE) or pack_len < index_end:
+        raise ValueError("unsupported audio pack, version %d, %d bytes" % (version, pack_len))
+
+    entries = []
+    for i in range(clip_count):
+        raw_name, offset, length, audio_format, channels, rate = ENTRY.unpack_from(image, HEADER.size + i * ENTRY.size)
+        if b"\0" not in raw_name or offset < index_end or offset > pack_len or length > pack_len - offset:
+            raise ValueError("entry %d is corrupt" % i)
+        name = raw_name.split(b"\0", 1)[0].decode()
+        if wav_format(image[offset:offset + length]) != (audio_format, channels, rate):
+            raise ValueError("%s: index format does not match the wav header" % name)
+        entries.append((name, offset, length, audio_format, channels, rate))
+
+    return pack_len, entries
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    build_parser = sub.add_parser("build", help="write a pack from wav files")
+    build_parser.add_argument("output")
+    build_parser.add_argument("inputs", nargs="+", help=".wav files, named as the firmware looks them up")
+
+    list_parser = sub.add_parser("list", help="verify a pack or partition image and list its clips")
+    list_parser.add_argument("image")
+
+    args = parser.parse_args()
+
+    try:
+        if args.command == "build":
+            build(args.output, read_clips(args.inputs))
+        else:
+            pack_len, entries = read(args.image)
+            for name, offset, length, audio_format, channels, rate in entries:
+                print("%-40s 0x%06x %7d bytes  fmt 0x%02x %d ch %d Hz" % (name, offset, length, audio_format, channels, rate))
+            print("%d clips, %d bytes" % (len(entries), pack_len))
+    except ValueError as e:
+        print(e, file=sys.stderr)
+        return 1
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())